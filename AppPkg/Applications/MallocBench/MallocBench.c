@@ -0,0 +1,197 @@
+/** @file
+    Benchmark for the StdLib malloc, calloc, realloc, and free functions.
+
+    Runs a few allocation patterns typical of interpreters such as Python,
+    first through malloc and free, then through the UEFI AllocatePool and
+    FreePool services for comparison, and shows the malloc statistics.
+
+    Usage: MallocBench [Iterations]
+
+    Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+    This program and the accompanying materials
+    are licensed and made available under the terms and conditions of the BSD License
+    which accompanies this distribution. The full text of the license may be found at
+    http://opensource.org/licenses/bsd-license.
+
+    THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+    WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+#include  <Uefi.h>
+#include  <Library/UefiBootServicesTableLib.h>
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+
+#define NUM_SLOTS   4096      ///< Number of live allocations kept by each pattern
+
+typedef void *(*ALLOC_FN)(size_t Size);
+typedef void  (*FREE_FN)(void *Ptr);
+
+static void   *mSlot[NUM_SLOTS];
+static UINT32  mSeed;
+
+/** Simple xorshift generator, so that every run uses the same sequence. **/
+static
+UINT32
+NextRandom(void)
+{
+  mSeed ^= mSeed << 13;
+  mSeed ^= mSeed >> 17;
+  mSeed ^= mSeed << 5;
+  return mSeed;
+}
+
+/** Allocate through the UEFI pool services. **/
+static
+void *
+PoolAlloc(size_t Size)
+{
+  void   *Buffer;
+
+  if(gBS->AllocatePool(EfiLoaderData, Size, &Buffer) != EFI_SUCCESS) {
+    return NULL;
+  }
+  return Buffer;
+}
+
+/** Free through the UEFI pool services. **/
+static
+void
+PoolFree(void *Ptr)
+{
+  if(Ptr != NULL) {
+    (void) gBS->FreePool(Ptr);
+  }
+}
+
+/** Replace random slots with new allocations of 1 to MaxSize bytes.
+
+    @param  Alloc       Allocation function to use.
+    @param  Free        Matching free function.
+    @param  Iterations  Number of replacements.
+    @param  MaxSize     Largest size allocated.
+
+    @return   Elapsed time, in clock ticks.
+**/
+static
+clock_t
+ChurnPattern(ALLOC_FN Alloc, FREE_FN Free, UINTN Iterations, UINT32 MaxSize)
+{
+  clock_t   Start;
+  UINTN     Index;
+  UINT32    Slot;
+  size_t    Size;
+
+  mSeed = 0x2545F491;
+  Start = clock();
+  for(Index = 0; Index < Iterations; ++Index) {
+    Slot = NextRandom() % NUM_SLOTS;
+    Size = (size_t)(NextRandom() % MaxSize) + 1;
+    Free(mSlot[Slot]);
+    mSlot[Slot] = Alloc(Size);
+    if(mSlot[Slot] != NULL) {
+      *(UINT8 *)mSlot[Slot] = (UINT8)Size;
+    }
+  }
+  for(Slot = 0; Slot < NUM_SLOTS; ++Slot) {
+    Free(mSlot[Slot]);
+    mSlot[Slot] = NULL;
+  }
+  return clock() - Start;
+}
+
+/** Grow buffers step by step with realloc, as string and list builders do.
+
+    @param  Iterations  Number of buffers built.
+
+    @return   Elapsed time, in clock ticks.
+**/
+static
+clock_t
+GrowPattern(UINTN Iterations)
+{
+  clock_t   Start;
+  UINTN     Index;
+  size_t    Size;
+  void     *Buffer;
+  void     *NewBuffer;
+
+  Start = clock();
+  for(Index = 0; Index < Iterations; ++Index) {
+    Buffer = NULL;
+    for(Size = 16; Size <= 65536; Size += Size / 4) {
+      NewBuffer = realloc(Buffer, Size);
+      if(NewBuffer == NULL) {
+        break;
+      }
+      Buffer = NewBuffer;
+      ((UINT8 *)Buffer)[Size - 1] = 0;
+    }
+    free(Buffer);
+  }
+  return clock() - Start;
+}
+
+/** Show a result line.  Times are converted to milliseconds. **/
+static
+void
+ShowResult(const char *Name, clock_t Malloc, clock_t Pool)
+{
+  printf("  %-24s %10lu ms %10lu ms\n", Name,
+         (unsigned long)((UINT64)Malloc * 1000 / CLOCKS_PER_SEC),
+         (unsigned long)((UINT64)Pool * 1000 / CLOCKS_PER_SEC));
+}
+
+/** Run the malloc benchmark.
+
+    @param[in]  Argc    Number of argument tokens pointed to by Argv.
+    @param[in]  Argv    Array of Argc pointers to command line tokens.
+
+    @retval  0         The application exited normally.
+    @retval  Other     An error occurred.
+**/
+int
+main (
+  IN int Argc,
+  IN char **Argv
+  )
+{
+  MALLOC_STATS    Stats;
+  UINTN           Iterations;
+
+  Iterations = 1000000;
+  if(Argc > 1) {
+    Iterations = (UINTN)strtoul(Argv[1], NULL, 0);
+  }
+
+  printf("Malloc benchmark, %lu iterations per pattern\n", (unsigned long)Iterations);
+  printf("  %-24s %13s %13s\n", "Pattern", "malloc", "AllocatePool");
+  ShowResult("Small (1-256 bytes)",
+             ChurnPattern(malloc, free, Iterations, 256),
+             ChurnPattern(PoolAlloc, PoolFree, Iterations, 256));
+  ShowResult("Mixed (1-8192 bytes)",
+             ChurnPattern(malloc, free, Iterations, 8192),
+             ChurnPattern(PoolAlloc, PoolFree, Iterations, 8192));
+  ShowResult("Large (1-512 KB)",
+             ChurnPattern(malloc, free, Iterations / 16, SIZE_512KB),
+             ChurnPattern(PoolAlloc, PoolFree, Iterations / 16, SIZE_512KB));
+  printf("  %-24s %10lu ms\n", "Realloc growth",
+         (unsigned long)((UINT64)GrowPattern(Iterations / 64) * 1000 / CLOCKS_PER_SEC));
+
+  GetMallocStats(&Stats);
+  printf("\nMalloc statistics\n");
+  printf("  Arena bytes:          %lu\n", (unsigned long)Stats.ArenaBytes);
+  printf("  Huge block bytes:     %lu\n", (unsigned long)Stats.HugeBytes);
+  printf("  Small bytes in use:   %lu\n", (unsigned long)Stats.SmallBytes);
+  printf("  Large bytes in use:   %lu\n", (unsigned long)Stats.LargeBytes);
+  printf("  Size class runs:      %lu\n", (unsigned long)Stats.RunBytes);
+  printf("  Free large bytes:     %lu\n", (unsigned long)Stats.LargeFreeBytes);
+  printf("  Allocations:          %lu\n", (unsigned long)Stats.MallocCalls);
+  printf("  Frees:                %lu\n", (unsigned long)Stats.FreeCalls);
+  printf("  AllocatePages calls:  %lu\n", (unsigned long)Stats.PageAllocations);
+  printf("  FreePages calls:      %lu\n", (unsigned long)Stats.PageFrees);
+
+  return 0;
+}
@@ -0,0 +1,412 @@
+/** @file
+  Measure TCP throughput through the socket layer.
+
+  Run the receiver on one system and the sender on another, or both
+  on the same system when using EmulatorPkg with EmuSnpDxe:
+
+    SockBench -r [port] [receive depth]
+    SockBench <ip address> [port] [seconds] [send size]
+
+  Both sides wait for the socket with poll, so the results include the
+  readiness path used by applications that avoid blocking calls.
+
+  Copyright (c) 2016, Intel Corporation
+  All rights reserved. This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <Uefi.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <sys/poll.h>
+#include <sys/socket.h>
+
+#define BENCH_PORT          4321    ///<  Default TCP port
+#define BENCH_SECONDS       10      ///<  Default length of the send test
+#define BENCH_SEND_SIZE     1460    ///<  Default send size, one Ethernet segment
+#define BENCH_POLL_TIMEOUT  5000    ///<  Milliseconds to wait for the socket
+
+UINT8 mBuffer[ 65536 ];
+
+
+/**
+  Display the throughput
+
+  @param [in] pLabel  Zero terminated label string
+  @param [in] Bytes   Number of bytes transferred
+  @param [in] Calls   Number of send or recv calls
+  @param [in] Ticks   Elapsed time in clock ticks
+**/
+void
+ShowThroughput (
+  IN CONST char * pLabel,
+  IN UINT64 Bytes,
+  IN UINT64 Calls,
+  IN clock_t Ticks
+  )
+{
+  UINT64 Milliseconds;
+
+  Milliseconds = ((UINT64)Ticks * 1000 ) / CLOCKS_PER_SEC;
+  if ( 0 == Milliseconds ) {
+    Milliseconds = 1;
+  }
+  printf ( "%s: %llu bytes in %llu calls, %llu mSec, %llu KiB/Sec\r\n",
+           pLabel,
+           Bytes,
+           Calls,
+           Milliseconds,
+           ( Bytes * 1000 ) / ( Milliseconds * 1024 ));
+}
+
+
+/**
+  Wait for the socket to become ready
+
+  @param [in] s       Socket to poll
+  @param [in] Events  Events of interest
+
+  @retval  >0     The socket is ready
+  @retval  0      The timeout expired
+  @retval  -1     An error occurred
+**/
+int
+WaitForSocket (
+  IN int s,
+  IN short Events
+  )
+{
+  struct pollfd Fd;
+  int RetVal;
+
+  Fd.fd = s;
+  Fd.events = Events;
+  Fd.revents = 0;
+  RetVal = poll ( &Fd, 1, BENCH_POLL_TIMEOUT );
+  if (( 0 < RetVal )
+    && ( 0 == ( Fd.revents & Events ))
+    && ( 0 != ( Fd.revents & ( POLLERR | POLLNVAL )))) {
+    RetVal = -1;
+  }
+  return RetVal;
+}
+
+
+/**
+  Receive data until the remote system closes the connection
+
+  @param [in] PortNumber  TCP port to listen on
+  @param [in] RxDepth     Receive operations to post, zero selects the default
+
+  @retval 0   Successful operation
+**/
+int
+BenchReceive (
+  IN UINT16 PortNumber,
+  IN UINT32 RxDepth
+  )
+{
+  int a;
+  UINT64 Bytes;
+  ssize_t BytesReceived;
+  UINT64 Calls;
+  struct sockaddr_in LocalPort;
+  struct sockaddr_in RemotePort;
+  socklen_t RemotePortLength;
+  int RetVal;
+  int s;
+  clock_t Start;
+
+  //
+  //  Create the socket
+  //
+  s = socket ( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+  if ( -1 == s ) {
+    RetVal = errno;
+    printf ( "ERROR - socket error, errno: %d\r\n", RetVal );
+    return RetVal;
+  }
+
+  //
+  //  Use for/break instead of goto
+  //
+  a = -1;
+  for ( ; ; ) {
+    //
+    //  Select the receive depth before the port is allocated,
+    //  accepted sockets inherit the value
+    //
+    if ( 0 != RxDepth ) {
+      RetVal = setsockopt ( s,
+                            SOL_SOCKET,
+                            SO_RCVDEPTH,
+                            (char *)&RxDepth,
+                            sizeof ( RxDepth ));
+      if ( -1 == RetVal ) {
+        RetVal = errno;
+        printf ( "ERROR - setsockopt SO_RCVDEPTH error, errno: %d\r\n", RetVal );
+        break;
+      }
+    }
+
+    //
+    //  Bind the socket to the benchmark port
+    //
+    memset ( &LocalPort, 0, sizeof ( LocalPort ));
+    LocalPort.sin_len = sizeof ( LocalPort );
+    LocalPort.sin_family = AF_INET;
+    LocalPort.sin_port = htons ( PortNumber );
+    RetVal = bind ( s, (struct sockaddr *)&LocalPort, sizeof ( LocalPort ));
+    if ( -1 == RetVal ) {
+      RetVal = errno;
+      printf ( "ERROR - bind error, errno: %d\r\n", RetVal );
+      break;
+    }
+    RetVal = listen ( s, 1 );
+    if ( -1 == RetVal ) {
+      RetVal = errno;
+      printf ( "ERROR - listen error, errno: %d\r\n", RetVal );
+      break;
+    }
+    printf ( "Waiting for a connection on port %d\r\n", PortNumber );
+
+    //
+    //  Wait for the connection
+    //
+    do {
+      RetVal = WaitForSocket ( s, POLLIN );
+    } while ( 0 == RetVal );
+    if ( -1 == RetVal ) {
+      RetVal = errno;
+      printf ( "ERROR - poll error, errno: %d\r\n", RetVal );
+      break;
+    }
+    RemotePortLength = sizeof ( RemotePort );
+    a = accept ( s, (struct sockaddr *)&RemotePort, &RemotePortLength );
+    if ( -1 == a ) {
+      RetVal = errno;
+      printf ( "ERROR - accept error, errno: %d\r\n", RetVal );
+      break;
+    }
+    printf ( "Connection from %s:%d\r\n",
+             inet_ntoa ( RemotePort.sin_addr ),
+             ntohs ( RemotePort.sin_port ));
+
+    //
+    //  Receive until the remote system closes the connection
+    //
+    Bytes = 0;
+    Calls = 0;
+    Start = clock ( );
+    for ( ; ; ) {
+      RetVal = WaitForSocket ( a, POLLIN );
+      if ( 0 == RetVal ) {
+        printf ( "ERROR - Receive timeout\r\n" );
+        RetVal = ETIMEDOUT;
+        break;
+      }
+      if ( -1 == RetVal ) {
+        RetVal = errno;
+        printf ( "ERROR - poll error, errno: %d\r\n", RetVal );
+        break;
+      }
+      BytesReceived = recv ( a, (char *)&mBuffer[0], sizeof ( mBuffer ), 0 );
+      if ( 0 >= BytesReceived ) {
+        RetVal = ( 0 == BytesReceived ) ? 0 : errno;
+        break;
+      }
+      Bytes += BytesReceived;
+      Calls += 1;
+    }
+    ShowThroughput ( "Received", Bytes, Calls, clock ( ) - Start );
+    break;
+  }
+
+  //
+  //  Done with the sockets
+  //
+  if ( -1 != a ) {
+    close ( a );
+  }
+  close ( s );
+  return RetVal;
+}
+
+
+/**
+  Send data to the receiver for the specified number of seconds
+
+  @param [in] pAddress    Zero terminated IPv4 address string
+  @param [in] PortNumber  TCP port of the receiver
+  @param [in] Seconds     Length of the test
+  @param [in] SendSize    Number of bytes passed to each send call
+
+  @retval 0   Successful operation
+**/
+int
+BenchSend (
+  IN CONST char * pAddress,
+  IN UINT16 PortNumber,
+  IN UINT32 Seconds,
+  IN size_t SendSize
+  )
+{
+  UINT64 Bytes;
+  ssize_t BytesSent;
+  UINT64 Calls;
+  clock_t End;
+  struct sockaddr_in RemotePort;
+  int RetVal;
+  int s;
+  clock_t Start;
+
+  //
+  //  Build the remote address
+  //
+  memset ( &RemotePort, 0, sizeof ( RemotePort ));
+  RemotePort.sin_len = sizeof ( RemotePort );
+  RemotePort.sin_family = AF_INET;
+  RemotePort.sin_port = htons ( PortNumber );
+  if ( 0 == inet_aton ( pAddress, &RemotePort.sin_addr )) {
+    printf ( "ERROR - Invalid IPv4 address: %s\r\n", pAddress );
+    return EINVAL;
+  }
+
+  //
+  //  Create the socket
+  //
+  s = socket ( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+  if ( -1 == s ) {
+    RetVal = errno;
+    printf ( "ERROR - socket error, errno: %d\r\n", RetVal );
+    return RetVal;
+  }
+
+  //
+  //  Use for/break instead of goto
+  //
+  for ( ; ; ) {
+    RetVal = connect ( s, (struct sockaddr *)&RemotePort, sizeof ( RemotePort ));
+    if ( -1 == RetVal ) {
+      RetVal = errno;
+      printf ( "ERROR - connect error, errno: %d\r\n", RetVal );
+      break;
+    }
+    printf ( "Sending %d byte buffers to %s:%d for %d seconds\r\n",
+             (int)SendSize,
+             pAddress,
+             PortNumber,
+             Seconds );
+
+    //
+    //  Send until the time expires
+    //
+    Bytes = 0;
+    Calls = 0;
+    Start = clock ( );
+    End = Start + ( Seconds * CLOCKS_PER_SEC );
+    while ( End > clock ( )) {
+      RetVal = WaitForSocket ( s, POLLOUT );
+      if ( 0 == RetVal ) {
+        printf ( "ERROR - Transmit timeout\r\n" );
+        RetVal = ETIMEDOUT;
+        break;
+      }
+      if ( -1 == RetVal ) {
+        RetVal = errno;
+        printf ( "ERROR - poll error, errno: %d\r\n", RetVal );
+        break;
+      }
+      BytesSent = send ( s, (char *)&mBuffer[0], SendSize, 0 );
+      if ( -1 == BytesSent ) {
+        if ( EAGAIN == errno ) {
+          continue;
+        }
+        RetVal = errno;
+        printf ( "ERROR - send error, errno: %d\r\n", RetVal );
+        break;
+      }
+      Bytes += BytesSent;
+      Calls += 1;
+      RetVal = 0;
+    }
+    ShowThroughput ( "Sent", Bytes, Calls, clock ( ) - Start );
+    break;
+  }
+
+  //
+  //  Done with the socket
+  //
+  close ( s );
+  return RetVal;
+}
+
+
+/**
+  Measure the TCP throughput
+
+  @param [in] Argc  The number of arguments
+  @param [in] Argv  The argument value array
+
+  @retval  0        The application exited normally.
+  @retval  Other    An error occurred.
+**/
+int
+main (
+  IN int Argc,
+  IN char **Argv
+  )
+{
+  UINT16 PortNumber;
+  size_t SendSize;
+
+  if (( 2 > Argc ) || ( 0 == strcmp ( Argv[1], "-?" ))) {
+    printf ( "%s -r [port] [receive depth]\r\n", Argv[0]);
+    printf ( "%s <ip address> [port] [seconds] [send size]\r\n", Argv[0]);
+    return EINVAL;
+  }
+
+  PortNumber = BENCH_PORT;
+  if ( 0 == strcmp ( Argv[1], "-r" )) {
+    //
+    //  Receive side
+    //
+    if ( 2 < Argc ) {
+      PortNumber = (UINT16)atoi ( Argv[2]);
+    }
+    return BenchReceive ( PortNumber,
+                          ( 3 < Argc ) ? (UINT32)atoi ( Argv[3]) : 0 );
+  }
+
+  //
+  //  Send side
+  //
+  if ( 2 < Argc ) {
+    PortNumber = (UINT16)atoi ( Argv[2]);
+  }
+  SendSize = BENCH_SEND_SIZE;
+  if ( 4 < Argc ) {
+    SendSize = (size_t)atoi ( Argv[4]);
+    if (( 0 == SendSize ) || ( sizeof ( mBuffer ) < SendSize )) {
+      SendSize = sizeof ( mBuffer );
+    }
+  }
+  return BenchSend ( Argv[1],
+                     PortNumber,
+                     ( 3 < Argc ) ? (UINT32)atoi ( Argv[3]) : BENCH_SECONDS,
+                     SendSize );
+}
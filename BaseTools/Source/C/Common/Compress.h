@@ -21,6 +21,15 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "CommonLib.h"
 #include <Common/UefiBaseTypes.h>
+
+//
+// Compression levels accepted by TianoCompressEx() and EfiCompressEx().
+// The level only selects how hard the match finder searches; streams
+// produced at either level are decoded by the same decompressors.
+//
+#define COMPRESS_LEVEL_FAST     0
+#define COMPRESS_LEVEL_DEFAULT  1
+
 /*++
 
 Routine Description:
@@ -39,6 +48,23 @@ TianoCompress (
 
 /*++
 
+Routine Description:
+
+  Tiano compression routine with a selectable compression level.
+
+--*/
+EFI_STATUS
+TianoCompressEx (
+  IN      UINT8   *SrcBuffer,
+  IN      UINT32  SrcSize,
+  IN      UINT8   *DstBuffer,
+  IN OUT  UINT32  *DstSize,
+  IN      UINT32  Level
+  )
+;
+
+/*++
+
 Routine Description:
 
   Efi compression routine.
@@ -55,6 +81,23 @@ EfiCompress (
 
 /*++
 
+Routine Description:
+
+  Efi compression routine with a selectable compression level.
+
+--*/
+EFI_STATUS
+EfiCompressEx (
+  IN      UINT8   *SrcBuffer,
+  IN      UINT32  SrcSize,
+  IN      UINT8   *DstBuffer,
+  IN OUT  UINT32  *DstSize,
+  IN      UINT32  Level
+  )
+;
+
+/*++
+
 Routine Description:
 
   The compression routine.
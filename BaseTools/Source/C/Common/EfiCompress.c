@@ -31,14 +31,25 @@ typedef INT16             NODE;
 #define WNDBIT            13
 #define WNDSIZ            (1U << WNDBIT)
 #define MAXMATCH          256
-#define PERC_FLAG         0x8000U
 #define CODE_BIT          16
 #define NIL               0
-#define MAX_HASH_VAL      (3 * WNDSIZ + (WNDSIZ / 512 + 1) * UINT8_MAX)
-#define HASH(p, c)        ((p) + ((c) << (WNDBIT - 9)) + WNDSIZ * 2)
+#define HASH_BIT          14
+#define HASH_SIZE         (1U << HASH_BIT)
+#define HASH(p)           (((((UINT32)mText[p] << 16) | ((UINT32)mText[(p) + 1] << 8) | mText[(p) + 2]) * 0x9E3779B1U) >> (32 - HASH_BIT))
+#define CHILD(p)          (((p) & (WNDSIZ - 1)) * 2)
 #define CRCPOLY           0xA001
 #define UPDATE_CRC(c)     mCrc = mCrcTable[(mCrc ^ (c)) & 0xFF] ^ (mCrc >> UINT8_BIT)
 
+//
+// Match finder search depth, and the pointer length above which the
+// covered positions are not indexed, for each compression level. Positions
+// covered by a pointer that overlaps the text it copies are never indexed.
+//
+#define MAX_DEPTH_FAST      8
+#define MAX_DEPTH_DEFAULT   48
+#define MAX_INSERT_FAST     16
+#define MAX_INSERT_DEFAULT  MAXMATCH
+
 //
 // C: the Char&Len Set; P: the Position Set; T: the exTra Set
 //
@@ -80,40 +91,26 @@ VOID
 InitSlide (
   );
 
-STATIC 
-NODE 
-Child (
-  IN NODE q, 
-  IN UINT8 c
-  );
-
-STATIC 
-VOID 
-MakeChild (
-  IN NODE q, 
-  IN UINT8 c, 
-  IN NODE r
-  );
-  
 STATIC 
 VOID 
-Split (
-  IN NODE Old
+UpdateSlide (
   );
 
 STATIC 
 VOID 
 InsertNode (
+  IN BOOLEAN FindMatch
   );
-  
+
 STATIC 
 VOID 
-DeleteNode (
+AdvancePosition (
   );
 
 STATIC 
 VOID 
 GetNextMatch (
+  IN BOOLEAN FindMatch
   );
   
 STATIC 
@@ -239,17 +236,17 @@ MakeTree (
 
 STATIC UINT8  *mSrc, *mDst, *mSrcUpperLimit, *mDstUpperLimit;
 
-STATIC UINT8  *mLevel, *mText, *mChildCount, *mBuf, mCLen[NC], mPTLen[NPT], *mLen;
+STATIC UINT8  *mText, *mBuf, mCLen[NC], mPTLen[NPT], *mLen;
 STATIC INT16  mHeap[NC + 1];
 STATIC INT32  mRemainder, mMatchLen, mBitCount, mHeapSize, mN;
 STATIC UINT32 mBufSiz = 0, mOutputPos, mOutputMask, mSubBitBuf, mCrc;
-STATIC UINT32 mCompSize, mOrigSize;
+STATIC UINT32 mCompSize, mOrigSize, mMaxDepth, mMaxInsert;
 
 STATIC UINT16 *mFreq, *mSortPtr, mLenCnt[17], mLeft[2 * NC - 1], mRight[2 * NC - 1],
               mCrcTable[UINT8_MAX + 1], mCFreq[2 * NC - 1],mCCode[NC],
               mPFreq[2 * NP - 1], mPTCode[NPT], mTFreq[2 * NT - 1];
 
-STATIC NODE   mPos, mMatchPos, mAvail, *mPosition, *mParent, *mPrev, *mNext = NULL;
+STATIC NODE   mPos, mMatchPos, *mHashHead, *mChild = NULL;
 
 
 //
@@ -265,6 +262,25 @@ EfiCompress (
   )
 /*++
 
+Routine Description:
+
+  Efi compression routine, using the default compression level.
+
+--*/
+{
+  return EfiCompressEx (SrcBuffer, SrcSize, DstBuffer, DstSize, COMPRESS_LEVEL_DEFAULT);
+}
+
+EFI_STATUS
+EfiCompressEx (
+  IN      UINT8   *SrcBuffer,
+  IN      UINT32  SrcSize,
+  IN      UINT8   *DstBuffer,
+  IN OUT  UINT32  *DstSize,
+  IN      UINT32  Level
+  )
+/*++
+
 Routine Description:
 
   The main compression routine.
@@ -276,6 +292,9 @@ Arguments:
   DstBuffer   - The buffer to store the compressed data
   DstSize     - On input, the size of DstBuffer; On output,
                 the size of the actual compressed data.
+  Level       - COMPRESS_LEVEL_FAST or COMPRESS_LEVEL_DEFAULT. The level only
+                changes how hard the match finder searches; the output format
+                is the same for both.
 
 Returns:
 
@@ -293,12 +312,16 @@ Returns:
   mBufSiz = 0;
   mBuf = NULL;
   mText       = NULL;
-  mLevel      = NULL;
-  mChildCount = NULL;
-  mPosition   = NULL;
-  mParent     = NULL;
-  mPrev       = NULL;
-  mNext       = NULL;
+  mHashHead   = NULL;
+  mChild      = NULL;
+
+  if (Level == COMPRESS_LEVEL_FAST) {
+    mMaxDepth  = MAX_DEPTH_FAST;
+    mMaxInsert = MAX_INSERT_FAST;
+  } else {
+    mMaxDepth  = MAX_DEPTH_DEFAULT;
+    mMaxInsert = MAX_INSERT_DEFAULT;
+  }
 
   
   mSrc = SrcBuffer;
@@ -415,14 +438,9 @@ Returns:
     mText[i] = 0;
   }
 
-  mLevel      = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*mLevel));
-  mChildCount = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*mChildCount));
-  mPosition   = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*mPosition));
-  mParent     = malloc (WNDSIZ * 2 * sizeof(*mParent));
-  mPrev       = malloc (WNDSIZ * 2 * sizeof(*mPrev));
-  mNext       = malloc ((MAX_HASH_VAL + 1) * sizeof(*mNext));
-  if (mLevel == NULL || mChildCount == NULL || mPosition == NULL ||
-    mParent == NULL || mPrev == NULL || mNext == NULL) {
+  mHashHead   = malloc (HASH_SIZE * sizeof(*mHashHead));
+  mChild      = malloc (WNDSIZ * 2 * sizeof(*mChild));
+  if (mHashHead == NULL || mChild == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
   
@@ -456,28 +474,12 @@ Returns: (VOID)
     free (mText);
   }
   
-  if (mLevel) {
-    free (mLevel);
+  if (mHashHead) {
+    free (mHashHead);
   }
   
-  if (mChildCount) {
-    free (mChildCount);
-  }
-  
-  if (mPosition) {
-    free (mPosition);
-  }
-  
-  if (mParent) {
-    free (mParent);
-  }
-  
-  if (mPrev) {
-    free (mPrev);
-  }
-  
-  if (mNext) {
-    free (mNext);
+  if (mChild) {
+    free (mChild);
   }
   
   if (mBuf) {
@@ -503,349 +505,172 @@ Returns: (VOID)
 
 --*/
 {
-  NODE i;
-
-  for (i = WNDSIZ; i <= WNDSIZ + UINT8_MAX; i++) {
-    mLevel[i] = 1;
-    mPosition[i] = NIL;  /* sentinel */
-  }
-  for (i = WNDSIZ; i < WNDSIZ * 2; i++) {
-    mParent[i] = NIL;
-  }  
-  mAvail = 1;
-  for (i = 1; i < WNDSIZ - 1; i++) {
-    mNext[i] = (NODE)(i + 1);
-  }
-  
-  mNext[WNDSIZ - 1] = NIL;
-  for (i = WNDSIZ * 2; i <= MAX_HASH_VAL; i++) {
-    mNext[i] = NIL;
-  }  
-}
-
-
-STATIC 
-NODE 
-Child (
-  IN NODE q, 
-  IN UINT8 c
-  )
-/*++
+  UINT32 i;
 
-Routine Description:
-
-  Find child node given the parent node and the edge character
-  
-Arguments:
-
-  q       - the parent node
-  c       - the edge character
-  
-Returns:
-
-  The child node (NIL if not found)  
-  
---*/
-{
-  NODE r;
-  
-  r = mNext[HASH(q, c)];
-  mParent[NIL] = q;  /* sentinel */
-  while (mParent[r] != q) {
-    r = mNext[r];
+  for (i = 0; i < HASH_SIZE; i++) {
+    mHashHead[i] = NIL;
   }
-  
-  return r;
 }
 
 STATIC 
 VOID 
-MakeChild (
-  IN NODE q, 
-  IN UINT8 c, 
-  IN NODE r
-  )
+UpdateSlide ()
 /*++
 
 Routine Description:
 
-  Create a new child for a given parent node.
+  Rebase the String Info Log after the text window has been slid down by
+  WNDSIZ bytes. Positions that fall out of the window become NIL.
   
-Arguments:
+Arguments: (VOID)
 
-  q       - the parent node
-  c       - the edge character
-  r       - the child node
-  
 Returns: (VOID)
 
 --*/
 {
-  NODE h, t;
-  
-  h = (NODE)HASH(q, c);
-  t = mNext[h];
-  mNext[h] = r;
-  mNext[r] = t;
-  mPrev[t] = r;
-  mPrev[r] = h;
-  mParent[r] = q;
-  mChildCount[q]++;
+  UINT32 i;
+
+  for (i = 0; i < HASH_SIZE; i++) {
+    mHashHead[i] = (NODE)((mHashHead[i] >= (NODE)WNDSIZ) ? mHashHead[i] - WNDSIZ : NIL);
+  }
+  for (i = 0; i < WNDSIZ * 2; i++) {
+    mChild[i] = (NODE)((mChild[i] >= (NODE)WNDSIZ) ? mChild[i] - WNDSIZ : NIL);
+  }
 }
 
 STATIC 
 VOID 
-Split (
-  NODE Old
+InsertNode (
+  IN BOOLEAN FindMatch
   )
 /*++
 
 Routine Description:
 
-  Split a node.
-  
-Arguments:
+  Insert string info for current position into the String Info Log and
+  optionally find the longest match for it.
 
-  Old     - the node to split
+  Positions sharing the same hash of their first THRESHOLD bytes form a
+  binary search tree ordered by the strings that start there, with the
+  newest position at the root. Every node visited while re-rooting the
+  tree at the current position is a match candidate. mMaxDepth bounds the
+  number of nodes visited; whatever lies below the cut is dropped.
   
-Returns: (VOID)
-
---*/
-{
-  NODE New, t;
-
-  New = mAvail;
-  mAvail = mNext[New];
-  mChildCount[New] = 0;
-  t = mPrev[Old];
-  mPrev[New] = t;
-  mNext[t] = New;
-  t = mNext[Old];
-  mNext[New] = t;
-  mPrev[t] = New;
-  mParent[New] = mParent[Old];
-  mLevel[New] = (UINT8)mMatchLen;
-  mPosition[New] = mPos;
-  MakeChild(New, mText[mMatchPos + mMatchLen], Old);
-  MakeChild(New, mText[mPos + mMatchLen], mPos);
-}
-
-STATIC 
-VOID 
-InsertNode ()
-/*++
-
-Routine Description:
+Arguments:
 
-  Insert string info for current position into the String Info Log
-  
-Arguments: (VOID)
+  FindMatch - FALSE if the caller will not use the match
 
 Returns: (VOID)
 
 --*/
 {
-  NODE q, r, j, t;
-  UINT8 c, *t1, *t2;
+  NODE    r, Limit, *Smaller, *Larger;
+  UINT32  h, Depth;
+  INT32   Len, SmallerLen, LargerLen, BestLen;
+  UINT8   *t1, *t2;
+
+  h = HASH(mPos);
+  r = mHashHead[h];
+  mHashHead[h] = mPos;
 
-  if (mMatchLen >= 4) {
-    
-    //
-    // We have just got a long match, the target tree
-    // can be located by MatchPos + 1. Travese the tree
-    // from bottom up to get to a proper starting point.
-    // The usage of PERC_FLAG ensures proper node deletion
-    // in DeleteNode() later.
-    //
-    
-    mMatchLen--;
-    r = (INT16)((mMatchPos + 1) | WNDSIZ);
-    while ((q = mParent[r]) == NIL) {
-      r = mNext[r];
-    }
-    while (mLevel[q] >= mMatchLen) {
-      r = q;  q = mParent[q];
-    }
-    t = q;
-    while (mPosition[t] < 0) {
-      mPosition[t] = mPos;
-      t = mParent[t];
-    }
-    if (t < WNDSIZ) {
-      mPosition[t] = (NODE)(mPos | PERC_FLAG);
-    }    
-  } else {
-    
-    //
-    // Locate the target tree
-    //
-    
-    q = (INT16)(mText[mPos] + WNDSIZ);
-    c = mText[mPos + 1];
-    if ((r = Child(q, c)) == NIL) {
-      MakeChild(q, c, mPos);
-      mMatchLen = 1;
-      return;
-    }
-    mMatchLen = 2;
-  }
-  
   //
-  // Traverse down the tree to find a match.
-  // Update Position value along the route.
-  // Node split or creation is involved.
+  // Only positions less than WNDSIZ bytes back can be encoded. NIL is
+  // always below the limit because mPos never drops under WNDSIZ.
   //
-  
+  Limit = (NODE)(mPos - WNDSIZ + 1);
+  Smaller = &mChild[CHILD(mPos) + 1];
+  Larger = &mChild[CHILD(mPos)];
+  SmallerLen = LargerLen = BestLen = 0;
+  Depth = mMaxDepth;
+  t1 = &mText[mPos];
+
   for ( ; ; ) {
-    if (r >= WNDSIZ) {
-      j = MAXMATCH;
-      mMatchPos = r;
-    } else {
-      j = mLevel[r];
-      mMatchPos = (NODE)(mPosition[r] & ~PERC_FLAG);
+    if (r < Limit || Depth-- == 0) {
+      *Smaller = *Larger = NIL;
+      break;
     }
-    if (mMatchPos >= mPos) {
-      mMatchPos -= WNDSIZ;
-    }    
-    t1 = &mText[mPos + mMatchLen];
-    t2 = &mText[mMatchPos + mMatchLen];
-    while (mMatchLen < j) {
-      if (*t1 != *t2) {
-        Split(r);
-        return;
+    t2 = &mText[r];
+    Len = (SmallerLen < LargerLen) ? SmallerLen : LargerLen;
+    if (t2[Len] == t1[Len]) {
+      while (++Len < MAXMATCH && t2[Len] == t1[Len]) {
+        ;
+      }
+      if (Len > BestLen) {
+        BestLen = Len;
+        mMatchPos = r;
+      }
+      if (Len >= MAXMATCH) {
+        *Smaller = mChild[CHILD(r) + 1];
+        *Larger = mChild[CHILD(r)];
+        break;
       }
-      mMatchLen++;
-      t1++;
-      t2++;
-    }
-    if (mMatchLen >= MAXMATCH) {
-      break;
     }
-    mPosition[r] = mPos;
-    q = r;
-    if ((r = Child(q, *t1)) == NIL) {
-      MakeChild(q, *t1, mPos);
-      return;
+    if (t2[Len] < t1[Len]) {
+      *Smaller = r;
+      Smaller = &mChild[CHILD(r)];
+      r = *Smaller;
+      SmallerLen = Len;
+    } else {
+      *Larger = r;
+      Larger = &mChild[CHILD(r) + 1];
+      r = *Larger;
+      LargerLen = Len;
     }
-    mMatchLen++;
   }
-  t = mPrev[r];
-  mPrev[mPos] = t;
-  mNext[t] = mPos;
-  t = mNext[r];
-  mNext[mPos] = t;
-  mPrev[t] = mPos;
-  mParent[mPos] = q;
-  mParent[r] = NIL;
-  
-  //
-  // Special usage of 'next'
-  //
-  mNext[r] = mPos;
-  
+
+  mMatchLen = FindMatch ? BestLen : 0;
 }
 
 STATIC 
 VOID 
-DeleteNode ()
+AdvancePosition ()
 /*++
 
 Routine Description:
 
-  Delete outdated string info. (The Usage of PERC_FLAG
-  ensures a clean deletion)
-  
+  Advance the current position (read in new data if needed) and
+  rebase outdated string info, without indexing the new position.
+
 Arguments: (VOID)
 
 Returns: (VOID)
 
 --*/
 {
-  NODE q, r, s, t, u;
+  INT32 n;
 
-  if (mParent[mPos] == NIL) {
-    return;
-  }
-  
-  r = mPrev[mPos];
-  s = mNext[mPos];
-  mNext[r] = s;
-  mPrev[s] = r;
-  r = mParent[mPos];
-  mParent[mPos] = NIL;
-  if (r >= WNDSIZ || --mChildCount[r] > 1) {
-    return;
-  }
-  t = (NODE)(mPosition[r] & ~PERC_FLAG);
-  if (t >= mPos) {
-    t -= WNDSIZ;
-  }
-  s = t;
-  q = mParent[r];
-  while ((u = mPosition[q]) & PERC_FLAG) {
-    u &= ~PERC_FLAG;
-    if (u >= mPos) {
-      u -= WNDSIZ;
-    }
-    if (u > s) {
-      s = u;
-    }
-    mPosition[q] = (INT16)(s | WNDSIZ);
-    q = mParent[q];
-  }
-  if (q < WNDSIZ) {
-    if (u >= mPos) {
-      u -= WNDSIZ;
-    }
-    if (u > s) {
-      s = u;
-    }
-    mPosition[q] = (INT16)(s | WNDSIZ | PERC_FLAG);
+  mRemainder--;
+  if (++mPos == WNDSIZ * 2) {
+    memmove(&mText[0], &mText[WNDSIZ], WNDSIZ + MAXMATCH);
+    n = FreadCrc(&mText[WNDSIZ + MAXMATCH], WNDSIZ);
+    mRemainder += n;
+    mPos = WNDSIZ;
+    UpdateSlide();
   }
-  s = Child(r, mText[t + mLevel[r]]);
-  t = mPrev[s];
-  u = mNext[s];
-  mNext[t] = u;
-  mPrev[u] = t;
-  t = mPrev[r];
-  mNext[t] = s;
-  mPrev[s] = t;
-  t = mNext[r];
-  mPrev[t] = s;
-  mNext[s] = t;
-  mParent[s] = mParent[r];
-  mParent[r] = NIL;
-  mNext[r] = mAvail;
-  mAvail = r;
 }
 
 STATIC 
 VOID 
-GetNextMatch ()
+GetNextMatch (
+  IN BOOLEAN FindMatch
+  )
 /*++
 
 Routine Description:
 
   Advance the current position (read in new data if needed).
-  Delete outdated string info. Find a match string for current position.
+  Rebase outdated string info. Find a match string for current position.
 
-Arguments: (VOID)
+Arguments:
+
+  FindMatch - Whether to search for a match at the new position
 
 Returns: (VOID)
 
 --*/
 {
-  INT32 n;
-
-  mRemainder--;
-  if (++mPos == WNDSIZ * 2) {
-    memmove(&mText[0], &mText[WNDSIZ], WNDSIZ + MAXMATCH);
-    n = FreadCrc(&mText[WNDSIZ + MAXMATCH], WNDSIZ);
-    mRemainder += n;
-    mPos = WNDSIZ;
-  }
-  DeleteNode();
-  InsertNode();
+  AdvancePosition();
+  InsertNode(FindMatch);
 }
 
 STATIC
@@ -869,6 +694,7 @@ Returns:
   EFI_STATUS  Status;
   INT32       LastMatchLen;
   NODE        LastMatchPos;
+  BOOLEAN     SkipInsert;
 
   Status = AllocateMemory();
   if (EFI_ERROR(Status)) {
@@ -884,14 +710,14 @@ Returns:
   
   mMatchLen = 0;
   mPos = WNDSIZ;
-  InsertNode();
+  InsertNode(TRUE);
   if (mMatchLen > mRemainder) {
     mMatchLen = mRemainder;
   }
   while (mRemainder > 0) {
     LastMatchLen = mMatchLen;
     LastMatchPos = mMatchPos;
-    GetNextMatch();
+    GetNextMatch(TRUE);
     if (mMatchLen > mRemainder) {
       mMatchLen = mRemainder;
     }
@@ -912,8 +738,19 @@ Returns:
       
       Output(LastMatchLen + (UINT8_MAX + 1 - THRESHOLD),
              (mPos - LastMatchPos - 2) & (WNDSIZ - 1));
+      //
+      // Index the positions covered by the pointer. The interior of long
+      // pointers and of pointers that overlap the text they copy (runs of
+      // repeated data) is skipped.
+      //
+      SkipInsert = (BOOLEAN)(LastMatchLen > (INT32)mMaxInsert ||
+                             (INT32)((mPos - LastMatchPos - 2) & (WNDSIZ - 1)) + 1 < LastMatchLen);
       while (--LastMatchLen > 0) {
-        GetNextMatch();
+        if (SkipInsert && LastMatchLen > THRESHOLD) {
+          AdvancePosition();
+        } else {
+          GetNextMatch((BOOLEAN)(LastMatchLen == 1));
+        }
       }
       if (mMatchLen > mRemainder) {
         mMatchLen = mRemainder;
@@ -30,14 +30,28 @@ typedef INT32 NODE;
 #define WNDSIZ        (1U << WNDBIT)
 #define MAXMATCH      256
 #define BLKSIZ        (1U << 14)  // 16 * 1024U
-#define PERC_FLAG     0x80000000U
 #define CODE_BIT      16
 #define NIL           0
-#define MAX_HASH_VAL  (3 * WNDSIZ + (WNDSIZ / 512 + 1) * UINT8_MAX)
-#define HASH(p, c)    ((p) + ((c) << (WNDBIT - 9)) + WNDSIZ * 2)
+#define HASH_BIT      16
+#define HASH_SIZE     (1U << HASH_BIT)
+#define HASH(p)       (((((UINT32) mText[p] << 16) | ((UINT32) mText[(p) + 1] << 8) | mText[(p) + 2]) * 0x9E3779B1U) >> (32 - HASH_BIT))
+#define CHILD(p)      (((p) & (WNDSIZ - 1)) * 2)
 #define CRCPOLY       0xA001
 #define UPDATE_CRC(c) mCrc = mCrcTable[(mCrc ^ (c)) & 0xFF] ^ (mCrc >> UINT8_BIT)
 
+//
+// Match finder search depth for each compression level
+//
+#define MAX_DEPTH_FAST      8
+#define MAX_DEPTH_DEFAULT   48
+
+//
+// Positions covered by a pointer longer than this are not indexed. Neither
+// are the positions covered by a pointer that overlaps the text it copies.
+//
+#define MAX_INSERT_FAST     16
+#define MAX_INSERT_DEFAULT  MAXMATCH
+
 //
 // C: the Char&Len Set; P: the Position Set; T: the exTra Set
 //
@@ -80,43 +94,28 @@ InitSlide (
   VOID
   );
 
-STATIC
-NODE
-Child (
-  IN NODE   NodeQ,
-  IN UINT8  CharC
-  );
-
-STATIC
-VOID
-MakeChild (
-  IN NODE  NodeQ,
-  IN UINT8 CharC,
-  IN NODE  NodeR
-  );
-
 STATIC
 VOID
-Split (
-  IN NODE Old
+UpdateSlide (
+  VOID
   );
 
 STATIC
 VOID
 InsertNode (
-  VOID
+  IN BOOLEAN FindMatch
   );
 
 STATIC
 VOID
-DeleteNode (
+AdvancePosition (
   VOID
   );
 
 STATIC
 VOID
 GetNextMatch (
-  VOID
+  IN BOOLEAN FindMatch
   );
 
 STATIC
@@ -248,16 +247,16 @@ MakeTree (
 //
 STATIC UINT8  *mSrc, *mDst, *mSrcUpperLimit, *mDstUpperLimit;
 
-STATIC UINT8  *mLevel, *mText, *mChildCount, *mBuf, mCLen[NC], mPTLen[NPT], *mLen;
+STATIC UINT8  *mText, *mBuf, mCLen[NC], mPTLen[NPT], *mLen;
 STATIC INT16  mHeap[NC + 1];
 STATIC INT32  mRemainder, mMatchLen, mBitCount, mHeapSize, mN;
 STATIC UINT32 mBufSiz = 0, mOutputPos, mOutputMask, mSubBitBuf, mCrc;
-STATIC UINT32 mCompSize, mOrigSize;
+STATIC UINT32 mCompSize, mOrigSize, mMaxDepth, mMaxInsert;
 
 STATIC UINT16 *mFreq, *mSortPtr, mLenCnt[17], mLeft[2 * NC - 1], mRight[2 * NC - 1], mCrcTable[UINT8_MAX + 1],
   mCFreq[2 * NC - 1], mCCode[NC], mPFreq[2 * NP - 1], mPTCode[NPT], mTFreq[2 * NT - 1];
 
-STATIC NODE   mPos, mMatchPos, mAvail, *mPosition, *mParent, *mPrev, *mNext = NULL;
+STATIC NODE   mPos, mMatchPos, *mHashHead, *mChild = NULL;
 
 //
 // functions
@@ -271,6 +270,25 @@ TianoCompress (
   )
 /*++
 
+Routine Description:
+
+  Tiano compression routine, using the default compression level.
+
+--*/
+{
+  return TianoCompressEx (SrcBuffer, SrcSize, DstBuffer, DstSize, COMPRESS_LEVEL_DEFAULT);
+}
+
+EFI_STATUS
+TianoCompressEx (
+  IN      UINT8   *SrcBuffer,
+  IN      UINT32  SrcSize,
+  IN      UINT8   *DstBuffer,
+  IN OUT  UINT32  *DstSize,
+  IN      UINT32  Level
+  )
+/*++
+
 Routine Description:
 
   The internal implementation of [Efi/Tiano]Compress().
@@ -282,9 +300,9 @@ Arguments:
   DstBuffer   - The buffer to store the compressed data
   DstSize     - On input, the size of DstBuffer; On output,
                 the size of the actual compressed data.
-  Version     - The version of de/compression algorithm.
-                Version 1 for UEFI 2.0 de/compression algorithm.
-                Version 2 for Tiano de/compression algorithm.
+  Level       - COMPRESS_LEVEL_FAST or COMPRESS_LEVEL_DEFAULT. The level only
+                changes how hard the match finder searches; the output format
+                is the same for both.
 
 Returns:
 
@@ -304,12 +322,16 @@ Returns:
   mBufSiz         = 0;
   mBuf            = NULL;
   mText           = NULL;
-  mLevel          = NULL;
-  mChildCount     = NULL;
-  mPosition       = NULL;
-  mParent         = NULL;
-  mPrev           = NULL;
-  mNext           = NULL;
+  mHashHead       = NULL;
+  mChild          = NULL;
+
+  if (Level == COMPRESS_LEVEL_FAST) {
+    mMaxDepth     = MAX_DEPTH_FAST;
+    mMaxInsert    = MAX_INSERT_FAST;
+  } else {
+    mMaxDepth     = MAX_DEPTH_DEFAULT;
+    mMaxInsert    = MAX_INSERT_DEFAULT;
+  }
 
   mSrc            = SrcBuffer;
   mSrcUpperLimit  = mSrc + SrcSize;
@@ -417,16 +439,18 @@ Returns:
   UINT32  Index;
 
   mText = malloc (WNDSIZ * 2 + MAXMATCH);
+  if (mText == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
   for (Index = 0; Index < WNDSIZ * 2 + MAXMATCH; Index++) {
     mText[Index] = 0;
   }
 
-  mLevel      = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof (*mLevel));
-  mChildCount = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof (*mChildCount));
-  mPosition   = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof (*mPosition));
-  mParent     = malloc (WNDSIZ * 2 * sizeof (*mParent));
-  mPrev       = malloc (WNDSIZ * 2 * sizeof (*mPrev));
-  mNext       = malloc ((MAX_HASH_VAL + 1) * sizeof (*mNext));
+  mHashHead   = malloc (HASH_SIZE * sizeof (*mHashHead));
+  mChild      = malloc (WNDSIZ * 2 * sizeof (*mChild));
+  if (mHashHead == NULL || mChild == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
 
   mBufSiz     = BLKSIZ;
   mBuf        = malloc (mBufSiz);
@@ -464,28 +488,12 @@ Returns: (VOID)
     free (mText);
   }
 
-  if (mLevel != NULL) {
-    free (mLevel);
-  }
-
-  if (mChildCount != NULL) {
-    free (mChildCount);
-  }
-
-  if (mPosition != NULL) {
-    free (mPosition);
-  }
-
-  if (mParent != NULL) {
-    free (mParent);
-  }
-
-  if (mPrev != NULL) {
-    free (mPrev);
+  if (mHashHead != NULL) {
+    free (mHashHead);
   }
 
-  if (mNext != NULL) {
-    free (mNext);
+  if (mChild != NULL) {
+    free (mChild);
   }
 
   if (mBuf != NULL) {
@@ -512,397 +520,199 @@ Returns: (VOID)
 
 --*/
 {
-  NODE  Index;
-
-  for (Index = WNDSIZ; Index <= WNDSIZ + UINT8_MAX; Index++) {
-    mLevel[Index]     = 1;
-    mPosition[Index]  = NIL;  /* sentinel */
-  }
-
-  for (Index = WNDSIZ; Index < WNDSIZ * 2; Index++) {
-    mParent[Index] = NIL;
-  }
-
-  mAvail = 1;
-  for (Index = 1; Index < WNDSIZ - 1; Index++) {
-    mNext[Index] = (NODE) (Index + 1);
-  }
+  UINT32  Index;
 
-  mNext[WNDSIZ - 1] = NIL;
-  for (Index = WNDSIZ * 2; Index <= MAX_HASH_VAL; Index++) {
-    mNext[Index] = NIL;
+  for (Index = 0; Index < HASH_SIZE; Index++) {
+    mHashHead[Index] = NIL;
   }
 }
 
 STATIC
-NODE
-Child (
-  IN NODE  NodeQ,
-  IN UINT8 CharC
+VOID
+UpdateSlide (
+  VOID
   )
 /*++
 
 Routine Description:
 
-  Find child node given the parent node and the edge character
+  Rebase the String Info Log after the text window has been slid down by
+  WNDSIZ bytes. Positions that fall out of the window become NIL.
   
-Arguments:
+Arguments: (VOID)
 
-  NodeQ       - the parent node
-  CharC       - the edge character
-  
-Returns:
+Returns: (VOID)
 
-  The child node (NIL if not found)  
-  
 --*/
 {
-  NODE  NodeR;
+  UINT32  Index;
 
-  NodeR = mNext[HASH (NodeQ, CharC)];
-  //
-  // sentinel
-  //
-  mParent[NIL] = NodeQ;
-  while (mParent[NodeR] != NodeQ) {
-    NodeR = mNext[NodeR];
+  for (Index = 0; Index < HASH_SIZE; Index++) {
+    mHashHead[Index] = (mHashHead[Index] >= (NODE) WNDSIZ) ? (NODE) (mHashHead[Index] - WNDSIZ) : NIL;
   }
 
-  return NodeR;
+  for (Index = 0; Index < WNDSIZ * 2; Index++) {
+    mChild[Index] = (mChild[Index] >= (NODE) WNDSIZ) ? (NODE) (mChild[Index] - WNDSIZ) : NIL;
+  }
 }
 
 STATIC
 VOID
-MakeChild (
-  IN NODE  Parent,
-  IN UINT8 CharC,
-  IN NODE  Child
+InsertNode (
+  IN BOOLEAN FindMatch
   )
 /*++
 
 Routine Description:
 
-  Create a new child for a given parent node.
-  
-Arguments:
-
-  Parent       - the parent node
-  CharC   - the edge character
-  Child       - the child node
-  
-Returns: (VOID)
-
---*/
-{
-  NODE  Node1;
-  NODE  Node2;
-
-  Node1           = (NODE) HASH (Parent, CharC);
-  Node2           = mNext[Node1];
-  mNext[Node1]    = Child;
-  mNext[Child]    = Node2;
-  mPrev[Node2]    = Child;
-  mPrev[Child]    = Node1;
-  mParent[Child]  = Parent;
-  mChildCount[Parent]++;
-}
-
-STATIC
-VOID
-Split (
-  NODE Old
-  )
-/*++
-
-Routine Description:
+  Insert string info for current position into the String Info Log and
+  optionally find the longest match for it.
 
-  Split a node.
+  Positions sharing the same hash of their first THRESHOLD bytes form a
+  binary search tree ordered by the strings that start there, with the
+  newest position at the root. Inserting the current position re-roots the
+  tree at it, and every node visited on the way down is a match candidate,
+  so the longest match falls out of the insertion itself. mMaxDepth bounds
+  the number of nodes visited; whatever lies below the cut is dropped.
   
 Arguments:
 
-  Old     - the node to split
-  
-Returns: (VOID)
-
---*/
-{
-  NODE  New;
-  NODE  TempNode;
-
-  New               = mAvail;
-  mAvail            = mNext[New];
-  mChildCount[New]  = 0;
-  TempNode          = mPrev[Old];
-  mPrev[New]        = TempNode;
-  mNext[TempNode]   = New;
-  TempNode          = mNext[Old];
-  mNext[New]        = TempNode;
-  mPrev[TempNode]   = New;
-  mParent[New]      = mParent[Old];
-  mLevel[New]       = (UINT8) mMatchLen;
-  mPosition[New]    = mPos;
-  MakeChild (New, mText[mMatchPos + mMatchLen], Old);
-  MakeChild (New, mText[mPos + mMatchLen], mPos);
-}
-
-STATIC
-VOID
-InsertNode (
-  VOID
-  )
-/*++
-
-Routine Description:
-
-  Insert string info for current position into the String Info Log
-  
-Arguments: (VOID)
+  FindMatch - FALSE if the caller will not use the match (the position
+              is covered by a pointer that has already been output)
 
 Returns: (VOID)
 
 --*/
 {
-  NODE  NodeQ;
-  NODE  NodeR;
-  NODE  Index2;
-  NODE  NodeT;
-  UINT8 CharC;
-  UINT8 *t1;
-  UINT8 *t2;
-
-  if (mMatchLen >= 4) {
-    //
-    // We have just got a long match, the target tree
-    // can be located by MatchPos + 1. Travese the tree
-    // from bottom up to get to a proper starting point.
-    // The usage of PERC_FLAG ensures proper node deletion
-    // in DeleteNode() later.
-    //
-    mMatchLen--;
-    NodeR = (NODE) ((mMatchPos + 1) | WNDSIZ);
-    NodeQ = mParent[NodeR];
-    while (NodeQ == NIL) {
-      NodeR = mNext[NodeR];
-      NodeQ = mParent[NodeR];
-    }
-
-    while (mLevel[NodeQ] >= mMatchLen) {
-      NodeR = NodeQ;
-      NodeQ = mParent[NodeQ];
-    }
-
-    NodeT = NodeQ;
-    while (mPosition[NodeT] < 0) {
-      mPosition[NodeT]  = mPos;
-      NodeT             = mParent[NodeT];
-    }
-
-    if (NodeT < WNDSIZ) {
-      mPosition[NodeT] = (NODE) (mPos | (UINT32) PERC_FLAG);
-    }
-  } else {
-    //
-    // Locate the target tree
-    //
-    NodeQ = (NODE) (mText[mPos] + WNDSIZ);
-    CharC = mText[mPos + 1];
-    NodeR = Child (NodeQ, CharC);
-    if (NodeR == NIL) {
-      MakeChild (NodeQ, CharC, mPos);
-      mMatchLen = 1;
-      return ;
-    }
+  NODE    Candidate;
+  NODE    Limit;
+  NODE    *Smaller;
+  NODE    *Larger;
+  UINT32  Hash;
+  UINT32  Depth;
+  INT32   Length;
+  INT32   SmallerLen;
+  INT32   LargerLen;
+  INT32   BestLen;
+  UINT8   *t1;
+  UINT8   *t2;
+
+  Hash            = HASH (mPos);
+  Candidate       = mHashHead[Hash];
+  mHashHead[Hash] = mPos;
 
-    mMatchLen = 2;
-  }
   //
-  // Traverse down the tree to find a match.
-  // Update Position value along the route.
-  // Node split or creation is involved.
+  // Only positions less than WNDSIZ bytes back can be encoded. NIL is
+  // always below the limit because mPos never drops under WNDSIZ.
   //
-  for (;;) {
-    if (NodeR >= WNDSIZ) {
-      Index2    = MAXMATCH;
-      mMatchPos = NodeR;
-    } else {
-      Index2    = mLevel[NodeR];
-      mMatchPos = (NODE) (mPosition[NodeR] & (UINT32)~PERC_FLAG);
-    }
+  Limit       = (NODE) (mPos - WNDSIZ + 1);
+  Smaller     = &mChild[CHILD (mPos) + 1];
+  Larger      = &mChild[CHILD (mPos)];
+  SmallerLen  = 0;
+  LargerLen   = 0;
+  BestLen     = 0;
+  Depth       = mMaxDepth;
+  t1          = &mText[mPos];
 
-    if (mMatchPos >= mPos) {
-      mMatchPos -= WNDSIZ;
+  for (;;) {
+    if (Candidate < Limit || Depth-- == 0) {
+      *Smaller  = NIL;
+      *Larger   = NIL;
+      break;
     }
 
-    t1  = &mText[mPos + mMatchLen];
-    t2  = &mText[mMatchPos + mMatchLen];
-    while (mMatchLen < Index2) {
-      if (*t1 != *t2) {
-        Split (NodeR);
-        return ;
+    t2      = &mText[Candidate];
+    Length  = (SmallerLen < LargerLen) ? SmallerLen : LargerLen;
+    if (t2[Length] == t1[Length]) {
+      while (++Length < MAXMATCH && t2[Length] == t1[Length]) {
+        ;
       }
 
-      mMatchLen++;
-      t1++;
-      t2++;
-    }
+      if (Length > BestLen) {
+        BestLen   = Length;
+        mMatchPos = Candidate;
+      }
 
-    if (mMatchLen >= MAXMATCH) {
-      break;
+      if (Length >= MAXMATCH) {
+        //
+        // The candidate equals the current string as far as it can be
+        // compared, so it is replaced by the current position outright.
+        //
+        *Smaller  = mChild[CHILD (Candidate) + 1];
+        *Larger   = mChild[CHILD (Candidate)];
+        break;
+      }
     }
 
-    mPosition[NodeR]  = mPos;
-    NodeQ             = NodeR;
-    NodeR             = Child (NodeQ, *t1);
-    if (NodeR == NIL) {
-      MakeChild (NodeQ, *t1, mPos);
-      return ;
+    if (t2[Length] < t1[Length]) {
+      *Smaller    = Candidate;
+      Smaller     = &mChild[CHILD (Candidate)];
+      Candidate   = *Smaller;
+      SmallerLen  = Length;
+    } else {
+      *Larger     = Candidate;
+      Larger      = &mChild[CHILD (Candidate) + 1];
+      Candidate   = *Larger;
+      LargerLen   = Length;
     }
-
-    mMatchLen++;
   }
 
-  NodeT           = mPrev[NodeR];
-  mPrev[mPos]     = NodeT;
-  mNext[NodeT]    = mPos;
-  NodeT           = mNext[NodeR];
-  mNext[mPos]     = NodeT;
-  mPrev[NodeT]    = mPos;
-  mParent[mPos]   = NodeQ;
-  mParent[NodeR]  = NIL;
-
-  //
-  // Special usage of 'next'
-  //
-  mNext[NodeR] = mPos;
-
+  mMatchLen = FindMatch ? BestLen : 0;
 }
 
 STATIC
 VOID
-DeleteNode (
+AdvancePosition (
   VOID
   )
 /*++
 
 Routine Description:
 
-  Delete outdated string info. (The Usage of PERC_FLAG
-  ensures a clean deletion)
-  
+  Advance the current position (read in new data if needed) and
+  rebase outdated string info, without indexing the new position.
+
 Arguments: (VOID)
 
 Returns: (VOID)
 
 --*/
 {
-  NODE  NodeQ;
-  NODE  NodeR;
-  NODE  NodeS;
-  NODE  NodeT;
-  NODE  NodeU;
-
-  if (mParent[mPos] == NIL) {
-    return ;
-  }
-
-  NodeR         = mPrev[mPos];
-  NodeS         = mNext[mPos];
-  mNext[NodeR]  = NodeS;
-  mPrev[NodeS]  = NodeR;
-  NodeR         = mParent[mPos];
-  mParent[mPos] = NIL;
-  if (NodeR >= WNDSIZ) {
-    return ;
-  }
-
-  mChildCount[NodeR]--;
-  if (mChildCount[NodeR] > 1) {
-    return ;
-  }
-
-  NodeT = (NODE) (mPosition[NodeR] & (UINT32)~PERC_FLAG);
-  if (NodeT >= mPos) {
-    NodeT -= WNDSIZ;
-  }
-
-  NodeS = NodeT;
-  NodeQ = mParent[NodeR];
-  NodeU = mPosition[NodeQ];
-  while (NodeU & (UINT32) PERC_FLAG) {
-    NodeU &= (UINT32)~PERC_FLAG;
-    if (NodeU >= mPos) {
-      NodeU -= WNDSIZ;
-    }
-
-    if (NodeU > NodeS) {
-      NodeS = NodeU;
-    }
-
-    mPosition[NodeQ]  = (NODE) (NodeS | WNDSIZ);
-    NodeQ             = mParent[NodeQ];
-    NodeU             = mPosition[NodeQ];
-  }
-
-  if (NodeQ < WNDSIZ) {
-    if (NodeU >= mPos) {
-      NodeU -= WNDSIZ;
-    }
-
-    if (NodeU > NodeS) {
-      NodeS = NodeU;
-    }
+  INT32 Number;
 
-    mPosition[NodeQ] = (NODE) (NodeS | WNDSIZ | (UINT32) PERC_FLAG);
+  mRemainder--;
+  mPos++;
+  if (mPos == WNDSIZ * 2) {
+    memmove (&mText[0], &mText[WNDSIZ], WNDSIZ + MAXMATCH);
+    Number = FreadCrc (&mText[WNDSIZ + MAXMATCH], WNDSIZ);
+    mRemainder += Number;
+    mPos = WNDSIZ;
+    UpdateSlide ();
   }
-
-  NodeS           = Child (NodeR, mText[NodeT + mLevel[NodeR]]);
-  NodeT           = mPrev[NodeS];
-  NodeU           = mNext[NodeS];
-  mNext[NodeT]    = NodeU;
-  mPrev[NodeU]    = NodeT;
-  NodeT           = mPrev[NodeR];
-  mNext[NodeT]    = NodeS;
-  mPrev[NodeS]    = NodeT;
-  NodeT           = mNext[NodeR];
-  mPrev[NodeT]    = NodeS;
-  mNext[NodeS]    = NodeT;
-  mParent[NodeS]  = mParent[NodeR];
-  mParent[NodeR]  = NIL;
-  mNext[NodeR]    = mAvail;
-  mAvail          = NodeR;
 }
 
 STATIC
 VOID
 GetNextMatch (
-  VOID
+  IN BOOLEAN FindMatch
   )
 /*++
 
 Routine Description:
 
   Advance the current position (read in new data if needed).
-  Delete outdated string info. Find a match string for current position.
+  Rebase outdated string info. Find a match string for current position.
 
-Arguments: (VOID)
+Arguments:
+
+  FindMatch - Whether to search for a match at the new position
 
 Returns: (VOID)
 
 --*/
 {
-  INT32 Number;
-
-  mRemainder--;
-  mPos++;
-  if (mPos == WNDSIZ * 2) {
-    memmove (&mText[0], &mText[WNDSIZ], WNDSIZ + MAXMATCH);
-    Number = FreadCrc (&mText[WNDSIZ + MAXMATCH], WNDSIZ);
-    mRemainder += Number;
-    mPos = WNDSIZ;
-  }
-
-  DeleteNode ();
-  InsertNode ();
+  AdvancePosition ();
+  InsertNode (FindMatch);
 }
 
 STATIC
@@ -928,6 +738,7 @@ Returns:
   EFI_STATUS  Status;
   INT32       LastMatchLen;
   NODE        LastMatchPos;
+  BOOLEAN     SkipInsert;
 
   Status = AllocateMemory ();
   if (EFI_ERROR (Status)) {
@@ -943,7 +754,7 @@ Returns:
 
   mMatchLen   = 0;
   mPos        = WNDSIZ;
-  InsertNode ();
+  InsertNode (TRUE);
   if (mMatchLen > mRemainder) {
     mMatchLen = mRemainder;
   }
@@ -951,7 +762,7 @@ Returns:
   while (mRemainder > 0) {
     LastMatchLen  = mMatchLen;
     LastMatchPos  = mMatchPos;
-    GetNextMatch ();
+    GetNextMatch (TRUE);
     if (mMatchLen > mRemainder) {
       mMatchLen = mRemainder;
     }
@@ -978,9 +789,23 @@ Returns:
         LastMatchLen + (UINT8_MAX + 1 - THRESHOLD),
         (mPos - LastMatchPos - 2) & (WNDSIZ - 1)
         );
+      //
+      // Index the positions covered by the pointer so later strings can
+      // refer to them. A pointer that overlaps the text it copies stands
+      // for a run of repeated data; its interior is skipped to keep the
+      // cost linear.
+      //
+      SkipInsert = (BOOLEAN) (
+                     LastMatchLen > (INT32) mMaxInsert ||
+                     (INT32) ((mPos - LastMatchPos - 2) & (WNDSIZ - 1)) + 1 < LastMatchLen
+                     );
       LastMatchLen--;
       while (LastMatchLen > 0) {
-        GetNextMatch ();
+        if (SkipInsert && LastMatchLen > THRESHOLD) {
+          AdvancePosition ();
+        } else {
+          GetNextMatch ((BOOLEAN) (LastMatchLen == 1));
+        }
         LastMatchLen--;
       }
 
@@ -120,43 +120,28 @@ InitSlide (
   VOID
   );
 
-STATIC
-NODE
-Child (
-  IN NODE   NodeQ,
-  IN UINT8  CharC
-  );
-
-STATIC
-VOID
-MakeChild (
-  IN NODE  NodeQ,
-  IN UINT8 CharC,
-  IN NODE  NodeR
-  );
-
 STATIC
 VOID
-Split (
-  IN NODE Old
+UpdateSlide (
+  VOID
   );
 
 STATIC
 VOID
 InsertNode (
-  VOID
+  IN BOOLEAN FindMatch
   );
 
 STATIC
 VOID
-DeleteNode (
+AdvancePosition (
   VOID
   );
 
 STATIC
 VOID
 GetNextMatch (
-  VOID
+  IN BOOLEAN FindMatch
   );
 
 STATIC
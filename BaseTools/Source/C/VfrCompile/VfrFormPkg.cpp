@@ -126,6 +126,7 @@ CFormPkg::CFormPkg (
   mBufferNodeQueueHead = Node;
   mBufferNodeQueueTail = Node;
   mCurrBufferNode      = Node;
+  mBufferNodeIndex[BufferStart] = Node;
 }
 
 CFormPkg::~CFormPkg ()
@@ -143,6 +144,7 @@ CFormPkg::~CFormPkg ()
   }
   mBufferNodeQueueTail = NULL;
   mCurrBufferNode      = NULL;
+  mBufferNodeIndex.clear ();
 
   while (PendingAssignList != NULL) {
     pPNode = PendingAssignList;
@@ -150,6 +152,7 @@ CFormPkg::~CFormPkg ()
     delete pPNode;
   }
   PendingAssignList = NULL;
+  mPendingAssignIndex.clear ();
 }
 
 SBufferNode *
@@ -175,6 +178,7 @@ CFormPkg::CreateNewNode (
     Node->mNext       = NULL;
   }
 
+  mBufferNodeIndex[Node->mBufferStart] = Node;
   return Node;
 }
 
@@ -253,6 +257,7 @@ CFormPkg::Read (
   )
 {
   UINT32       Index;
+  UINT32       Avail;
 
   if ((Size == 0) || (Buffer == NULL)) {
     return 0;
@@ -262,17 +267,27 @@ CFormPkg::Read (
     return 0;
   }
 
-  for (Index = 0; Index < Size; Index++) {
-    if ((mReadBufferNode->mBufferStart + mReadBufferOffset) < mReadBufferNode->mBufferFree) {
-      Buffer[Index] = mReadBufferNode->mBufferStart[mReadBufferOffset++];
-    } else {
+  //
+  // Copy as much of each buffer node as fits, moving on to the next node
+  // once the current one is drained.
+  //
+  Index = 0;
+  while (Index < Size) {
+    Avail = (UINT32) (mReadBufferNode->mBufferFree - mReadBufferNode->mBufferStart) - mReadBufferOffset;
+    if (Avail == 0) {
       if ((mReadBufferNode = mReadBufferNode->mNext) == NULL) {
         return Index;
-      } else {
-        mReadBufferOffset = 0;
-        Index --;
       }
+      mReadBufferOffset = 0;
+      continue;
     }
+
+    if (Avail > Size - Index) {
+      Avail = Size - Index;
+    }
+    memcpy (Buffer + Index, mReadBufferNode->mBufferStart + mReadBufferOffset, Avail);
+    mReadBufferOffset += Avail;
+    Index             += Avail;
   }
 
   return Size;
@@ -512,6 +527,7 @@ CFormPkg::AssignPending (
 
   pNew->mNext       = PendingAssignList;
   PendingAssignList = pNew;
+  mPendingAssignIndex.insert (std::make_pair (std::string (pNew->mKey), pNew));
   return VFR_RETURN_SUCCESS;
 }
 
@@ -522,16 +538,16 @@ CFormPkg::DoPendingAssign (
   IN UINT32 ValLen
   )
 {
-  SPendingAssign *pNode;
+  std::pair<SPendingAssignIndex::iterator, SPendingAssignIndex::iterator> Range;
+  SPendingAssignIndex::iterator                                           Iter;
 
   if ((Key == NULL) || (ValAddr == NULL)) {
     return;
   }
 
-  for (pNode = PendingAssignList; pNode != NULL; pNode = pNode->mNext) {
-    if (strcmp (pNode->mKey, Key) == 0) {
-      pNode->AssignValue (ValAddr, ValLen);
-    }
+  Range = mPendingAssignIndex.equal_range (Key);
+  for (Iter = Range.first; Iter != Range.second; Iter++) {
+    Iter->second->AssignValue (ValAddr, ValLen);
   }
 }
 
@@ -570,16 +586,21 @@ CFormPkg::GetBinBufferNodeForAddr (
   IN CHAR8              *BinBuffAddr
   )
 {
-  SBufferNode *TmpNode;
+  SBufferNode                *TmpNode;
+  SBufferNodeIndex::iterator Iter;
 
-  TmpNode = mBufferNodeQueueHead;
-
-  while (TmpNode != NULL) {
-    if (TmpNode->mBufferStart <= BinBuffAddr && TmpNode->mBufferFree >= BinBuffAddr) {
-      return TmpNode;
-    }
+  //
+  // The node holding the address is the one with the highest start address
+  // not above it.
+  //
+  Iter = mBufferNodeIndex.upper_bound (BinBuffAddr);
+  if (Iter == mBufferNodeIndex.begin ()) {
+    return NULL;
+  }
 
-    TmpNode = TmpNode->mNext;
+  TmpNode = (--Iter)->second;
+  if (TmpNode->mBufferStart <= BinBuffAddr && TmpNode->mBufferFree >= BinBuffAddr) {
+    return TmpNode;
   }
 
   return NULL;
@@ -983,19 +1004,45 @@ CIfrRecordInfoDB::CIfrRecordInfoDB (
   mRecordCount       = EFI_IFR_RECORDINFO_IDX_START;
   mIfrRecordListHead = NULL;
   mIfrRecordListTail = NULL;
+  mIfrRecordPoolFree = EFI_IFR_RECORD_POOL_SIZE;
+  mIfrRecordLineIndexValid = FALSE;
 }
 
 CIfrRecordInfoDB::~CIfrRecordInfoDB (
   VOID
   )
 {
-  SIfrRecord *pNode;
+  UINT32 Index;
+
+  //
+  // Records live in the pool blocks, whatever order the list was left in.
+  //
+  for (Index = 0; Index < mIfrRecordPool.size (); Index++) {
+    delete[] mIfrRecordPool[Index];
+  }
+  mIfrRecordPool.clear ();
+  mIfrRecordIndex.clear ();
+  mIfrRecordLineIndex.clear ();
+  mIfrRecordListHead = NULL;
+  mIfrRecordListTail = NULL;
+}
 
-  while (mIfrRecordListHead != NULL) {
-    pNode = mIfrRecordListHead;
-    mIfrRecordListHead = mIfrRecordListHead->mNext;
-    delete pNode;
+SIfrRecord *
+CIfrRecordInfoDB::AllocRecord (
+  VOID
+  )
+{
+  SIfrRecord *Block;
+
+  if (mIfrRecordPoolFree == EFI_IFR_RECORD_POOL_SIZE) {
+    if ((Block = new SIfrRecord[EFI_IFR_RECORD_POOL_SIZE]) == NULL) {
+      return NULL;
+    }
+    mIfrRecordPool.push_back (Block);
+    mIfrRecordPoolFree = 0;
   }
+
+  return &mIfrRecordPool.back ()[mIfrRecordPoolFree++];
 }
 
 SIfrRecord *
@@ -1003,19 +1050,13 @@ CIfrRecordInfoDB::GetRecordInfoFromIdx (
   IN UINT32 RecordIdx
   )
 {
-  UINT32     Idx;
-  SIfrRecord *pNode = NULL;
-
-  if (RecordIdx == EFI_IFR_RECORDINFO_IDX_INVALUD) {
+  if ((RecordIdx == EFI_IFR_RECORDINFO_IDX_INVALUD) ||
+      (RecordIdx <= EFI_IFR_RECORDINFO_IDX_START) ||
+      (RecordIdx - EFI_IFR_RECORDINFO_IDX_START > mIfrRecordIndex.size ())) {
     return NULL;
   }
 
-  for (Idx = (EFI_IFR_RECORDINFO_IDX_START + 1), pNode = mIfrRecordListHead;
-       (Idx != RecordIdx) && (pNode != NULL);
-       Idx++, pNode = pNode->mNext)
-  ;
-
-  return pNode;
+  return mIfrRecordIndex[RecordIdx - EFI_IFR_RECORDINFO_IDX_START - 1];
 }
 
 UINT32
@@ -1032,7 +1073,7 @@ CIfrRecordInfoDB::IfrRecordRegister (
     return EFI_IFR_RECORDINFO_IDX_INVALUD;
   }
 
-  if ((pNew = new SIfrRecord) == NULL) {
+  if ((pNew = AllocRecord ()) == NULL) {
     return EFI_IFR_RECORDINFO_IDX_INVALUD;
   }
 
@@ -1043,6 +1084,8 @@ CIfrRecordInfoDB::IfrRecordRegister (
     mIfrRecordListTail->mNext = pNew;
     mIfrRecordListTail = pNew;
   }
+  mIfrRecordIndex.push_back (pNew);
+  mIfrRecordLineIndexValid = FALSE;
   mRecordCount++;
 
   return mRecordCount;
@@ -1078,7 +1121,21 @@ CIfrRecordInfoDB::IfrRecordInfoUpdate (
   pNode->mOffset    = Offset;
   pNode->mBinBufLen = BinBufLen;
   pNode->mIfrBinBuf = BinBuf;
+  mIfrRecordLineIndexValid = FALSE;
+}
+
+VOID
+CIfrRecordInfoDB::BuildLineIndex (
+  VOID
+  )
+{
+  SIfrRecord *pNode;
 
+  mIfrRecordLineIndex.clear ();
+  for (pNode = mIfrRecordListHead; pNode != NULL; pNode = pNode->mNext) {
+    mIfrRecordLineIndex[pNode->mLineNo].push_back (pNode);
+  }
+  mIfrRecordLineIndexValid = TRUE;
 }
 
 VOID
@@ -1123,15 +1180,34 @@ CIfrRecordInfoDB::IfrRecordOutput (
   return;   
 }   
 
+STATIC
+VOID
+OutputRecord (
+  IN FILE       *File,
+  IN SIfrRecord *pNode
+  )
+{
+  UINT8 Index;
+
+  fprintf (File, ">%08X: ", pNode->mOffset);
+  if (pNode->mIfrBinBuf != NULL) {
+    for (Index = 0; Index < pNode->mBinBufLen; Index++) {
+      fprintf (File, "%02X ", (UINT8)(pNode->mIfrBinBuf[Index]));
+    }
+  }
+  fprintf (File, "\n");
+}
+
 VOID
 CIfrRecordInfoDB::IfrRecordOutput (
   IN FILE   *File,
   IN UINT32 LineNo
   )
 {
-  SIfrRecord *pNode;
-  UINT8      Index;
-  UINT32     TotalSize;
+  SIfrRecord                    *pNode;
+  UINT32                        TotalSize;
+  UINT32                        LineIdx;
+  SIfrRecordLineIndex::iterator Iter;
 
   if (mSwitch == FALSE) {
     return;
@@ -1143,17 +1219,26 @@ CIfrRecordInfoDB::IfrRecordOutput (
 
   TotalSize = 0;
 
-  for (pNode = mIfrRecordListHead; pNode != NULL; pNode = pNode->mNext) {
-    if (pNode->mLineNo == LineNo || LineNo == 0) {
-      fprintf (File, ">%08X: ", pNode->mOffset);
-      TotalSize += pNode->mBinBufLen;
-      if (pNode->mIfrBinBuf != NULL) {
-        for (Index = 0; Index < pNode->mBinBufLen; Index++) {
-          fprintf (File, "%02X ", (UINT8)(pNode->mIfrBinBuf[Index]));
-        }
+  if (LineNo != 0) {
+    //
+    // The record list file asks for every source line in turn, so look up
+    // the records of one line through the line index, not the whole list.
+    //
+    if (!mIfrRecordLineIndexValid) {
+      BuildLineIndex ();
+    }
+    Iter = mIfrRecordLineIndex.find (LineNo);
+    if (Iter != mIfrRecordLineIndex.end ()) {
+      for (LineIdx = 0; LineIdx < Iter->second.size (); LineIdx++) {
+        OutputRecord (File, Iter->second[LineIdx]);
       }
-      fprintf (File, "\n");
     }
+    return;
+  }
+
+  for (pNode = mIfrRecordListHead; pNode != NULL; pNode = pNode->mNext) {
+    OutputRecord (File, pNode);
+    TotalSize += pNode->mBinBufLen;
   }
   
   if (LineNo == 0) {
@@ -1256,6 +1341,7 @@ CIfrRecordInfoDB::IfrAdjustDynamicOpcodeInRecords (
   pStartNode = NULL;
   pEndNode   = NULL;
   OpcodeOffset = 0;
+  mIfrRecordLineIndexValid = FALSE;
 
   //
   // Base on the offset info to get the node.
@@ -1325,6 +1411,7 @@ CIfrRecordInfoDB::IfrRecordAdjust (
   pNode = mIfrRecordListHead;
   preNode = pNode;
   QuestionScope = 0;
+  mIfrRecordLineIndexValid = FALSE;
   while (pNode != NULL) {
     OpHead = (EFI_IFR_OP_HEADER *) pNode->mIfrBinBuf;
     
@@ -20,6 +20,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "EfiVfr.h"
 #include "VfrError.h"
 #include "VfrUtilityLib.h"
+#include <vector>
 
 #define NO_QST_REFED "no question refered"
 
@@ -96,6 +97,13 @@ struct SBufferNode {
   struct SBufferNode *mNext;
 };
 
+//
+// Buffer nodes keyed by their start address, and pending assignments keyed
+// by question name, so that back-patching does not walk the whole package.
+//
+typedef std::map<CHAR8 *, SBufferNode *>             SBufferNodeIndex;
+typedef std::multimap<std::string, SPendingAssign *> SPendingAssignIndex;
+
 typedef struct {
   BOOLEAN  CompatibleMode;
   EFI_GUID *OverrideClassGuid;
@@ -107,6 +115,7 @@ private:
   SBufferNode         *mBufferNodeQueueHead;
   SBufferNode         *mBufferNodeQueueTail;
   SBufferNode         *mCurrBufferNode;
+  SBufferNodeIndex    mBufferNodeIndex;
 
   SBufferNode         *mReadBufferNode;
   UINT32              mReadBufferOffset;
@@ -122,6 +131,7 @@ private:
 
 private:
   SPendingAssign      *PendingAssignList;
+  SPendingAssignIndex mPendingAssignIndex;
 
 public:
   CFormPkg (IN UINT32 BufferSize = 4096);
@@ -180,6 +190,15 @@ struct SIfrRecord {
 #define EFI_IFR_RECORDINFO_IDX_INVALUD 0xFFFFFF
 #define EFI_IFR_RECORDINFO_IDX_START   0x0
 
+//
+// Records are carved out of fixed size blocks, and found by record index
+// through a table rather than by walking the record list.
+//
+#define EFI_IFR_RECORD_POOL_SIZE       1024
+
+typedef std::vector<SIfrRecord *>                     SIfrRecordIndex;
+typedef std::map<UINT32, std::vector<SIfrRecord *> > SIfrRecordLineIndex;
+
 class CIfrRecordInfoDB {
 private:
   bool       mSwitch;
@@ -187,6 +206,14 @@ private:
   SIfrRecord *mIfrRecordListHead;
   SIfrRecord *mIfrRecordListTail;
 
+  SIfrRecordIndex     mIfrRecordIndex;
+  SIfrRecordIndex     mIfrRecordPool;
+  UINT32              mIfrRecordPoolFree;
+  SIfrRecordLineIndex mIfrRecordLineIndex;
+  BOOLEAN             mIfrRecordLineIndexValid;
+
+  SIfrRecord * AllocRecord (VOID);
+  VOID         BuildLineIndex (VOID);
   SIfrRecord * GetRecordInfoFromIdx (IN UINT32);
   BOOLEAN          CheckQuestionOpCode (IN UINT8);
   BOOLEAN          CheckIdOpCode (IN UINT8);
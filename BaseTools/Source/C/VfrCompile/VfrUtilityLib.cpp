@@ -573,8 +573,15 @@ CVfrVarDataTypeDB::RegisterNewType (
   IN SVfrDataType  *New
   )
 {
+  SVfrDataField *pField;
+
   New->mNext               = mDataTypeList;
   mDataTypeList            = New;
+
+  mDataTypeIndex[New->mTypeName] = New;
+  for (pField = New->mMembers; pField != NULL; pField = pField->mNext) {
+    mDataFieldIndex.insert (std::make_pair (std::make_pair (New, std::string (pField->mFieldName)), pField));
+  }
 }
 
 EFI_VFR_RETURN_CODE
@@ -663,34 +670,33 @@ CVfrVarDataTypeDB::GetTypeField (
   OUT SVfrDataField *&Field
   )
 {
-  SVfrDataField  *pField = NULL;
+  SVfrDataFieldIndex::iterator Iter;
 
   if ((FName == NULL) && (Type == NULL)) {
     return VFR_RETURN_FATAL_ERROR;
   }
 
-  for (pField = Type->mMembers; pField != NULL; pField = pField->mNext) {
-    //
-    // For type EFI_IFR_TYPE_TIME, because field name is not correctly wrote,
-    // add code to adjust it.
-    //
-    if (Type->mType == EFI_IFR_TYPE_TIME) {
-      if (strcmp (FName, "Hour") == 0) {
-        FName = "Hours";
-      } else if (strcmp (FName, "Minute") == 0) {
-        FName = "Minuts";
-      } else if (strcmp (FName, "Second") == 0) {
-        FName = "Seconds";
-      }
+  //
+  // For type EFI_IFR_TYPE_TIME, because field name is not correctly wrote,
+  // add code to adjust it.
+  //
+  if (Type->mType == EFI_IFR_TYPE_TIME) {
+    if (strcmp (FName, "Hour") == 0) {
+      FName = "Hours";
+    } else if (strcmp (FName, "Minute") == 0) {
+      FName = "Minuts";
+    } else if (strcmp (FName, "Second") == 0) {
+      FName = "Seconds";
     }
+  }
 
-    if (strcmp (pField->mFieldName, FName) == 0) {
-      Field = pField;
-      return VFR_RETURN_SUCCESS;
-    }
+  Iter = mDataFieldIndex.find (std::make_pair (Type, std::string (FName)));
+  if (Iter == mDataFieldIndex.end ()) {
+    return VFR_RETURN_UNDEFINED;
   }
 
-  return VFR_RETURN_UNDEFINED;
+  Field = Iter->second;
+  return VFR_RETURN_SUCCESS;
 }
 
 EFI_VFR_RETURN_CODE
@@ -980,6 +986,7 @@ CVfrVarDataTypeDB::DeclareDataTypeBegin (
   pNewType->mNext        = NULL;
 
   mNewDataType           = pNewType;
+  mCurrDataField         = NULL;
 }
 
 EFI_VFR_RETURN_CODE
@@ -987,8 +994,6 @@ CVfrVarDataTypeDB::SetNewTypeName (
   IN CHAR8   *TypeName
   )
 {
-  SVfrDataType *pType;
-
   if (mNewDataType == NULL) {
     return VFR_RETURN_ERROR_SKIPED;
   }
@@ -999,10 +1004,8 @@ CVfrVarDataTypeDB::SetNewTypeName (
     return VFR_RETURN_INVALID_PARAMETER;
   }
 
-  for (pType = mDataTypeList; pType != NULL; pType = pType->mNext) {
-    if (strcmp(pType->mTypeName, TypeName) == 0) {
-      return VFR_RETURN_REDEFINED;
-    }
+  if (mDataTypeIndex.find (TypeName) != mDataTypeIndex.end ()) {
+    return VFR_RETURN_REDEFINED;
   }
 
   strcpy(mNewDataType->mTypeName, TypeName);
@@ -1018,7 +1021,6 @@ CVfrVarDataTypeDB::DataTypeAddField (
 {
   SVfrDataField       *pNewField  = NULL;
   SVfrDataType        *pFieldType = NULL;
-  SVfrDataField       *pTmp;
   UINT32              Align;
 
   CHECK_ERROR_RETURN (GetDataType (TypeName, &pFieldType), VFR_RETURN_SUCCESS);
@@ -1027,10 +1029,8 @@ CVfrVarDataTypeDB::DataTypeAddField (
    return VFR_RETURN_INVALID_PARAMETER;
   }
 
-  for (pTmp = mNewDataType->mMembers; pTmp != NULL; pTmp = pTmp->mNext) {
-    if (strcmp (pTmp->mFieldName, FieldName) == 0) {
-      return VFR_RETURN_REDEFINED;
-    }
+  if (mDataFieldIndex.find (std::make_pair (mNewDataType, std::string (FieldName))) != mDataFieldIndex.end ()) {
+    return VFR_RETURN_REDEFINED;
   }
 
   Align = MIN (mPackAlign, pFieldType->mAlign);
@@ -1046,15 +1046,18 @@ CVfrVarDataTypeDB::DataTypeAddField (
   } else {
     pNewField->mOffset     = mNewDataType->mTotalSize + ALIGN_STUFF(mNewDataType->mTotalSize, Align);
   }
+  //
+  // mCurrDataField is the last member added to mNewDataType.
+  //
   if (mNewDataType->mMembers == NULL) {
     mNewDataType->mMembers = pNewField;
     pNewField->mNext       = NULL;
   } else {
-    for (pTmp = mNewDataType->mMembers; pTmp->mNext != NULL; pTmp = pTmp->mNext)
-      ;
-    pTmp->mNext            = pNewField;
+    mCurrDataField->mNext  = pNewField;
     pNewField->mNext       = NULL;
   }
+  mCurrDataField           = pNewField;
+  mDataFieldIndex[std::make_pair (mNewDataType, std::string (FieldName))] = pNewField;
 
   mNewDataType->mAlign     = MIN (mPackAlign, MAX (pFieldType->mAlign, mNewDataType->mAlign));
   mNewDataType->mTotalSize = pNewField->mOffset + (pNewField->mFieldType->mTotalSize) * ((ArrayNum == 0) ? 1 : ArrayNum);
@@ -1089,7 +1092,7 @@ CVfrVarDataTypeDB::GetDataType (
   OUT SVfrDataType **DataType
   )
 {
-  SVfrDataType *pDataType = NULL;
+  SVfrDataTypeIndex::iterator Iter;
 
   if (TypeName == NULL) {
     return VFR_RETURN_ERROR_SKIPED;
@@ -1101,14 +1104,13 @@ CVfrVarDataTypeDB::GetDataType (
 
   *DataType = NULL;
 
-  for (pDataType = mDataTypeList; pDataType != NULL; pDataType = pDataType->mNext) {
-    if (strcmp (TypeName, pDataType->mTypeName) == 0) {
-      *DataType = pDataType;
-      return VFR_RETURN_SUCCESS;
-    }
+  Iter = mDataTypeIndex.find (TypeName);
+  if (Iter == mDataTypeIndex.end ()) {
+    return VFR_RETURN_UNDEFINED;
   }
 
-  return VFR_RETURN_UNDEFINED;
+  *DataType = Iter->second;
+  return VFR_RETURN_SUCCESS;
 }
 
 EFI_VFR_RETURN_CODE
@@ -1149,7 +1151,7 @@ CVfrVarDataTypeDB::GetDataTypeSize (
   OUT UINT32 *Size
   )
 {
-  SVfrDataType *pDataType = NULL;
+  SVfrDataTypeIndex::iterator Iter;
 
   if (Size == NULL) {
     return VFR_RETURN_FATAL_ERROR;
@@ -1157,14 +1159,13 @@ CVfrVarDataTypeDB::GetDataTypeSize (
 
   *Size = 0;
 
-  for (pDataType = mDataTypeList; pDataType != NULL; pDataType = pDataType->mNext) {
-    if (strcmp (TypeName, pDataType->mTypeName) == 0) {
-      *Size = pDataType->mTotalSize;
-      return VFR_RETURN_SUCCESS;
-    }
+  Iter = mDataTypeIndex.find (TypeName);
+  if (Iter == mDataTypeIndex.end ()) {
+    return VFR_RETURN_UNDEFINED;
   }
 
-  return VFR_RETURN_UNDEFINED;
+  *Size = Iter->second->mTotalSize;
+  return VFR_RETURN_SUCCESS;
 }
 
 EFI_VFR_RETURN_CODE
@@ -1249,19 +1250,11 @@ CVfrVarDataTypeDB::IsTypeNameDefined (
   IN CHAR8 *TypeName
   )
 {
-  SVfrDataType *pType;
-
   if (TypeName == NULL) {
     return FALSE;
   }
 
-  for (pType = mDataTypeList; pType != NULL; pType = pType->mNext) {
-    if (strcmp (pType->mTypeName, TypeName) == 0) {
-      return TRUE;
-    }
-  }
-
-  return FALSE;
+  return (BOOLEAN) (mDataTypeIndex.find (TypeName) != mDataTypeIndex.end ());
 }
 
 VOID
@@ -1515,6 +1508,20 @@ CVfrDataStorage::MarkVarStoreIdUnused (
   mFreeVarStoreIdBitMap[Index] &= ~(0x80000000 >> Offset);
 }
 
+VOID
+CVfrDataStorage::RegisterVarStore (
+  IN     SVfrVarStorageNode *pNode,
+  IN OUT SVfrVarStorageNode *&List
+  )
+{
+  pNode->mNext = List;
+  List         = pNode;
+
+  if (pNode->mVarStoreName != NULL) {
+    mVarStoreIndex.insert (std::make_pair (std::string (pNode->mVarStoreName), pNode));
+  }
+}
+
 EFI_VFR_RETURN_CODE
 CVfrDataStorage::DeclareNameVarStoreBegin (
   IN CHAR8           *StoreName,
@@ -1581,8 +1588,7 @@ CVfrDataStorage::DeclareNameVarStoreEnd (
   )
 {
   mNewVarStorageNode->mGuid = *Guid;
-  mNewVarStorageNode->mNext = mNameVarStoreList;
-  mNameVarStoreList         = mNewVarStorageNode;
+  RegisterVarStore (mNewVarStorageNode, mNameVarStoreList);
 
   mNewVarStorageNode        = NULL;
 
@@ -1618,8 +1624,7 @@ CVfrDataStorage::DeclareEfiVarStore (
     return VFR_RETURN_OUT_FOR_RESOURCES;
   }
 
-  pNode->mNext       = mEfiVarStoreList;
-  mEfiVarStoreList   = pNode;
+  RegisterVarStore (pNode, mEfiVarStoreList);
 
   return VFR_RETURN_SUCCESS;
 }
@@ -1661,8 +1666,7 @@ CVfrDataStorage::DeclareBufferVarStore (
     return VFR_RETURN_OUT_FOR_RESOURCES;
   }
 
-  pNew->mNext         = mBufferVarStoreList;
-  mBufferVarStoreList = pNew;
+  RegisterVarStore (pNew, mBufferVarStoreList);
 
   if (gCVfrBufferConfig.Register(StoreName, Guid) != 0) {
     return VFR_RETURN_FATAL_ERROR;
@@ -1780,29 +1784,28 @@ CVfrDataStorage::GetVarStoreId (
   EFI_VFR_RETURN_CODE   ReturnCode;
   SVfrVarStorageNode    *pNode;
   BOOLEAN               HasFoundOne = FALSE;
+  UINT32                Index;
+  std::pair<SVfrVarStorageIndex::iterator, SVfrVarStorageIndex::iterator> Range;
+  SVfrVarStorageIndex::iterator                                           Iter;
+  static CONST EFI_VFR_VARSTORE_TYPE SearchOrder[] = {
+    EFI_VFR_VARSTORE_BUFFER,
+    EFI_VFR_VARSTORE_EFI,
+    EFI_VFR_VARSTORE_NAME
+  };
 
   mCurrVarStorageNode = NULL;
 
-  for (pNode = mBufferVarStoreList; pNode != NULL; pNode = pNode->mNext) {
-    if (strcmp (pNode->mVarStoreName, StoreName) == 0) {
-      if (CheckGuidField(pNode, StoreGuid, &HasFoundOne, &ReturnCode)) {
-        *VarStoreId = mCurrVarStorageNode->mVarStoreId;
-        return ReturnCode;
-      }
-    }
-  }
-
-  for (pNode = mEfiVarStoreList; pNode != NULL; pNode = pNode->mNext) {
-    if (strcmp (pNode->mVarStoreName, StoreName) == 0) {
-      if (CheckGuidField(pNode, StoreGuid, &HasFoundOne, &ReturnCode)) {
-        *VarStoreId = mCurrVarStorageNode->mVarStoreId;
-        return ReturnCode;
+  //
+  // Visit the varstores with this name in the same order as walking the
+  // buffer, EFI and name/value lists would: by list, newest first.
+  //
+  Range = mVarStoreIndex.equal_range (StoreName);
+  for (Index = 0; Index < sizeof (SearchOrder) / sizeof (SearchOrder[0]); Index++) {
+    for (Iter = Range.second; Iter != Range.first; ) {
+      pNode = (--Iter)->second;
+      if (pNode->mVarStoreType != SearchOrder[Index]) {
+        continue;
       }
-    }
-  }
-
-  for (pNode = mNameVarStoreList; pNode != NULL; pNode = pNode->mNext) {
-    if (strcmp (pNode->mVarStoreName, StoreName) == 0) {
       if (CheckGuidField(pNode, StoreGuid, &HasFoundOne, &ReturnCode)) {
         *VarStoreId = mCurrVarStorageNode->mVarStoreId;
         return ReturnCode;
@@ -1820,6 +1823,7 @@ CVfrDataStorage::GetVarStoreId (
   //
   // Assume that Data strucutre name is used as StoreName, and check again. 
   //
+  pNode      = NULL;
   ReturnCode = GetVarStoreByDataType (StoreName, &pNode, StoreGuid);
   if (pNode != NULL) {
     mCurrVarStorageNode = pNode;
@@ -2470,9 +2474,18 @@ CVfrQuestionDB::CVfrQuestionDB ()
   // Question ID 0 is reserved.
   mFreeQIdBitMap[0] = 0x80000000;
   mQuestionList     = NULL;
+  mQuestionSeq      = 0;
 }
 
 CVfrQuestionDB::~CVfrQuestionDB ()
+{
+  ClearQuestions ();
+}
+
+VOID
+CVfrQuestionDB::ClearQuestions (
+  VOID
+  )
 {
   SVfrQuestionNode     *pNode;
 
@@ -2481,6 +2494,57 @@ CVfrQuestionDB::~CVfrQuestionDB ()
     mQuestionList = mQuestionList->mNext;
     delete pNode;
   }
+
+  mQuestionNameIndex.clear ();
+  mQuestionVarIdIndex.clear ();
+  mQuestionIdIndex.clear ();
+  mQuestionSeq = 0;
+}
+
+//
+// Link a question at the head of mQuestionList and index it. mQuestionId
+// must already be set.
+//
+VOID
+CVfrQuestionDB::InsertQuestion (
+  IN SVfrQuestionNode *pNode
+  )
+{
+  pNode->mNext  = mQuestionList;
+  mQuestionList = pNode;
+
+  mQuestionSeq++;
+  mQuestionNameIndex[std::make_pair (std::string (pNode->mName), mQuestionSeq)]      = pNode;
+  mQuestionVarIdIndex[std::make_pair (std::string (pNode->mVarIdStr), mQuestionSeq)] = pNode;
+  mQuestionIdIndex[std::make_pair (pNode->mQuestionId, mQuestionSeq)]                = pNode;
+}
+
+//
+// Return the question a walk of mQuestionList would find first under Key,
+// optionally also requiring its name to be Name.
+//
+SVfrQuestionNode *
+CVfrQuestionDB::LookupQuestion (
+  IN SVfrQuestionNameIndex &Index,
+  IN CHAR8                 *Key,
+  IN CHAR8                 *Name
+  )
+{
+  SVfrQuestionNameIndex::iterator Iter;
+  std::string                     KeyStr (Key);
+
+  Iter = Index.upper_bound (std::make_pair (KeyStr, (UINT32) 0xFFFFFFFF));
+  while (Iter != Index.begin ()) {
+    --Iter;
+    if (Iter->first.first != KeyStr) {
+      break;
+    }
+    if ((Name == NULL) || (strcmp (Iter->second->mName, Name) == 0)) {
+      return Iter->second;
+    }
+  }
+
+  return NULL;
 }
 
 //
@@ -2492,13 +2556,8 @@ CVfrQuestionDB::ResetInit(
   )
 {
   UINT32               Index;
-  SVfrQuestionNode     *pNode;
 
-  while (mQuestionList != NULL) {
-    pNode = mQuestionList;
-    mQuestionList = mQuestionList->mNext;
-    delete pNode;
-  }
+  ClearQuestions ();
 
   for (Index = 0; Index < EFI_FREE_QUESTION_ID_BITMAP_SIZE; Index++) {
     mFreeQIdBitMap[Index] = 0;
@@ -2552,8 +2611,7 @@ CVfrQuestionDB::RegisterQuestion (
   }
   pNode->mQuestionId = QuestionId;
 
-  pNode->mNext       = mQuestionList;
-  mQuestionList      = pNode;
+  InsertQuestion (pNode);
 
   gCFormPkg.DoPendingAssign (VarIdStr, (VOID *)&QuestionId, sizeof(EFI_QUESTION_ID));
 
@@ -2600,10 +2658,9 @@ CVfrQuestionDB::RegisterOldDateQuestion (
   pNode[0]->mQtype      = QUESTION_DATE;
   pNode[1]->mQtype      = QUESTION_DATE;
   pNode[2]->mQtype      = QUESTION_DATE;
-  pNode[0]->mNext       = pNode[1];
-  pNode[1]->mNext       = pNode[2];
-  pNode[2]->mNext       = mQuestionList;
-  mQuestionList         = pNode[0];
+  InsertQuestion (pNode[2]);
+  InsertQuestion (pNode[1]);
+  InsertQuestion (pNode[0]);
 
   gCFormPkg.DoPendingAssign (YearVarId, (VOID *)&QuestionId, sizeof(EFI_QUESTION_ID));
   gCFormPkg.DoPendingAssign (MonthVarId, (VOID *)&QuestionId, sizeof(EFI_QUESTION_ID));
@@ -2707,10 +2764,9 @@ CVfrQuestionDB::RegisterNewDateQuestion (
   pNode[0]->mQtype      = QUESTION_DATE;
   pNode[1]->mQtype      = QUESTION_DATE;
   pNode[2]->mQtype      = QUESTION_DATE;
-  pNode[0]->mNext       = pNode[1];
-  pNode[1]->mNext       = pNode[2];
-  pNode[2]->mNext       = mQuestionList;
-  mQuestionList         = pNode[0];
+  InsertQuestion (pNode[2]);
+  InsertQuestion (pNode[1]);
+  InsertQuestion (pNode[0]);
 
   for (Index = 0; Index < 3; Index++) {
     if (VarIdStr[Index] != NULL) {
@@ -2776,10 +2832,9 @@ CVfrQuestionDB::RegisterOldTimeQuestion (
   pNode[0]->mQtype      = QUESTION_TIME;
   pNode[1]->mQtype      = QUESTION_TIME;
   pNode[2]->mQtype      = QUESTION_TIME;
-  pNode[0]->mNext       = pNode[1];
-  pNode[1]->mNext       = pNode[2];
-  pNode[2]->mNext       = mQuestionList;
-  mQuestionList         = pNode[0];
+  InsertQuestion (pNode[2]);
+  InsertQuestion (pNode[1]);
+  InsertQuestion (pNode[0]);
 
   gCFormPkg.DoPendingAssign (HourVarId, (VOID *)&QuestionId, sizeof(EFI_QUESTION_ID));
   gCFormPkg.DoPendingAssign (MinuteVarId, (VOID *)&QuestionId, sizeof(EFI_QUESTION_ID));
@@ -2883,10 +2938,9 @@ CVfrQuestionDB::RegisterNewTimeQuestion (
   pNode[0]->mQtype      = QUESTION_TIME;
   pNode[1]->mQtype      = QUESTION_TIME;
   pNode[2]->mQtype      = QUESTION_TIME;
-  pNode[0]->mNext       = pNode[1];
-  pNode[1]->mNext       = pNode[2];
-  pNode[2]->mNext       = mQuestionList;
-  mQuestionList         = pNode[0];
+  InsertQuestion (pNode[2]);
+  InsertQuestion (pNode[1]);
+  InsertQuestion (pNode[0]);
 
   for (Index = 0; Index < 3; Index++) {
     if (VarIdStr[Index] != NULL) {
@@ -3006,11 +3060,10 @@ CVfrQuestionDB::RegisterRefQuestion (
   pNode[1]->mQtype      = QUESTION_REF;
   pNode[2]->mQtype      = QUESTION_REF;
   pNode[3]->mQtype      = QUESTION_REF;  
-  pNode[0]->mNext       = pNode[1];
-  pNode[1]->mNext       = pNode[2];
-  pNode[2]->mNext       = pNode[3];
-  pNode[3]->mNext       = mQuestionList;  
-  mQuestionList         = pNode[0];
+  InsertQuestion (pNode[3]);
+  InsertQuestion (pNode[2]);
+  InsertQuestion (pNode[1]);
+  InsertQuestion (pNode[0]);
 
   gCFormPkg.DoPendingAssign (VarIdStr[0], (VOID *)&QuestionId, sizeof(EFI_QUESTION_ID));
   gCFormPkg.DoPendingAssign (VarIdStr[1], (VOID *)&QuestionId, sizeof(EFI_QUESTION_ID));
@@ -3037,7 +3090,9 @@ CVfrQuestionDB::UpdateQuestionId (
   IN EFI_QUESTION_ID   NewQId
   )
 {
-  SVfrQuestionNode *pNode = NULL;
+  SVfrQuestionNode              *pNode = NULL;
+  SVfrQuestionIdIndex::iterator Iter;
+  UINT32                        Seq;
   
   if (QId == NewQId) {
     // don't update
@@ -3051,20 +3106,20 @@ CVfrQuestionDB::UpdateQuestionId (
     return VFR_RETURN_REDEFINED;
   }
 
-  for (pNode = mQuestionList; pNode != NULL; pNode = pNode->mNext) {
-    if (pNode->mQuestionId == QId) {
-      break;
-    }
-  }
-
-  if (pNode == NULL) {
+  Iter = mQuestionIdIndex.upper_bound (std::make_pair (QId, (UINT32) 0xFFFFFFFF));
+  if ((Iter == mQuestionIdIndex.begin ()) || ((--Iter)->first.first != QId)) {
     return VFR_RETURN_UNDEFINED;
   }
+  pNode = Iter->second;
+  Seq   = Iter->first.second;
 
   MarkQuestionIdUnused (QId);
   pNode->mQuestionId = NewQId;
   MarkQuestionIdUsed (NewQId);
 
+  mQuestionIdIndex.erase (Iter);
+  mQuestionIdIndex[std::make_pair (NewQId, Seq)] = pNode;
+
   gCFormPkg.DoPendingAssign (pNode->mVarIdStr, (VOID *)&NewQId, sizeof(EFI_QUESTION_ID));
 
   return VFR_RETURN_SUCCESS;
@@ -3091,25 +3146,18 @@ CVfrQuestionDB::GetQuestionId (
     return ;
   }
 
-  for (pNode = mQuestionList; pNode != NULL; pNode = pNode->mNext) {
-    if (Name != NULL) {
-      if (strcmp (pNode->mName, Name) != 0) {
-        continue;
-      }
-    }
-
-    if (VarIdStr != NULL) {
-      if (strcmp (pNode->mVarIdStr, VarIdStr) != 0) {
-        continue;
-      }
-  	}
+  if (VarIdStr != NULL) {
+    pNode = LookupQuestion (mQuestionVarIdIndex, VarIdStr, Name);
+  } else {
+    pNode = LookupQuestion (mQuestionNameIndex, Name);
+  }
 
+  if (pNode != NULL) {
     QuestionId = pNode->mQuestionId;
     BitMask    = pNode->mBitMask;
     if (QType != NULL) {
       *QType     = pNode->mQtype;
     }
-    break;
   }
 
   return ;
@@ -3120,16 +3168,15 @@ CVfrQuestionDB::FindQuestion (
   IN EFI_QUESTION_ID QuestionId
   )
 {
-  SVfrQuestionNode *pNode;
+  SVfrQuestionIdIndex::iterator Iter;
 
   if (QuestionId == EFI_QUESTION_ID_INVALID) {
     return VFR_RETURN_INVALID_PARAMETER;
   }
 
-  for (pNode = mQuestionList; pNode != NULL; pNode = pNode->mNext) {
-    if (pNode->mQuestionId == QuestionId) {
-      return VFR_RETURN_SUCCESS;
-    }
+  Iter = mQuestionIdIndex.lower_bound (std::make_pair (QuestionId, (UINT32) 0));
+  if ((Iter != mQuestionIdIndex.end ()) && (Iter->first.first == QuestionId)) {
+    return VFR_RETURN_SUCCESS;
   }
 
   return VFR_RETURN_UNDEFINED;
@@ -3140,16 +3187,12 @@ CVfrQuestionDB::FindQuestion (
   IN CHAR8 *Name
   )
 {
-  SVfrQuestionNode *pNode;
-
   if (Name == NULL) {
     return VFR_RETURN_FATAL_ERROR;
   }
 
-  for (pNode = mQuestionList; pNode != NULL; pNode = pNode->mNext) {
-    if (strcmp (pNode->mName, Name) == 0) {
-      return VFR_RETURN_SUCCESS;
-    }
+  if (LookupQuestion (mQuestionNameIndex, Name) != NULL) {
+    return VFR_RETURN_SUCCESS;
   }
 
   return VFR_RETURN_UNDEFINED;
@@ -3284,7 +3327,7 @@ CVfrStringDB::GetVarStoreNameFormStringId (
   UINT8       BlockType;
   EFI_HII_STRING_PACKAGE_HDR *PkgHeader;
   
-  if (mStringFileName == '\0' ) {
+  if (mStringFileName == NULL) {
     return NULL;
   }
 
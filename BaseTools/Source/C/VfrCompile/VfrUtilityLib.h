@@ -17,6 +17,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define _VFRUTILITYLIB_H_
 
 #include "string.h"
+#include <map>
+#include <string>
 #include "Common/UefiBaseTypes.h"
 #include "EfiVfr.h"
 #include "VfrError.h"
@@ -157,6 +159,13 @@ struct SVfrPackStackNode {
   }
 };
 
+//
+// Name indexes kept alongside the declaration-ordered lists below, so that
+// lookups from large forms do not walk every type, field or varstore.
+//
+typedef std::map<std::string, SVfrDataType *>                            SVfrDataTypeIndex;
+typedef std::map<std::pair<SVfrDataType *, std::string>, SVfrDataField *> SVfrDataFieldIndex;
+
 class CVfrVarDataTypeDB {
 private:
   UINT32                    mPackAlign;
@@ -167,6 +176,8 @@ public:
 
 private:
   SVfrDataType              *mDataTypeList;
+  SVfrDataTypeIndex         mDataTypeIndex;
+  SVfrDataFieldIndex        mDataFieldIndex;
 
   SVfrDataType              *mNewDataType;
   SVfrDataType              *mCurrDataType;
@@ -265,6 +276,8 @@ struct EFI_VARSTORE_INFO {
   BOOLEAN operator == (IN EFI_VARSTORE_INFO *);
 };
 
+typedef std::multimap<std::string, SVfrVarStorageNode *> SVfrVarStorageIndex;
+
 #define EFI_VARSTORE_ID_MAX              0xFFFF
 #define EFI_FREE_VARSTORE_ID_BITMAP_SIZE ((EFI_VARSTORE_ID_MAX + 1) / EFI_BITS_PER_UINT32)
 
@@ -275,6 +288,7 @@ private:
   struct SVfrVarStorageNode *mBufferVarStoreList;
   struct SVfrVarStorageNode *mEfiVarStoreList;
   struct SVfrVarStorageNode *mNameVarStoreList;
+  SVfrVarStorageIndex       mVarStoreIndex;
 
   struct SVfrVarStorageNode *mCurrVarStorageNode;
   struct SVfrVarStorageNode *mNewVarStorageNode;
@@ -289,6 +303,7 @@ private:
                                   IN EFI_GUID *, 
                                   IN BOOLEAN *, 
                                   OUT EFI_VFR_RETURN_CODE *);
+  VOID            RegisterVarStore (IN SVfrVarStorageNode *, IN OUT SVfrVarStorageNode *&);
 
 public:
   CVfrDataStorage ();
@@ -342,9 +357,21 @@ struct SVfrQuestionNode {
   ~SVfrQuestionNode ();
 };
 
+//
+// Question indexes are keyed by (key, registration sequence). mQuestionList
+// holds the newest question first, so the highest sequence under a key is
+// the node a walk of the list would have found first.
+//
+typedef std::map<std::pair<std::string, UINT32>, SVfrQuestionNode *>     SVfrQuestionNameIndex;
+typedef std::map<std::pair<EFI_QUESTION_ID, UINT32>, SVfrQuestionNode *> SVfrQuestionIdIndex;
+
 class CVfrQuestionDB {
 private:
   SVfrQuestionNode          *mQuestionList;
+  UINT32                    mQuestionSeq;
+  SVfrQuestionNameIndex     mQuestionNameIndex;
+  SVfrQuestionNameIndex     mQuestionVarIdIndex;
+  SVfrQuestionIdIndex       mQuestionIdIndex;
   UINT32                    mFreeQIdBitMap[EFI_FREE_QUESTION_ID_BITMAP_SIZE];
 
 private:
@@ -352,6 +379,9 @@ private:
   BOOLEAN         ChekQuestionIdFree (IN EFI_QUESTION_ID);
   VOID            MarkQuestionIdUsed (IN EFI_QUESTION_ID);
   VOID            MarkQuestionIdUnused (IN EFI_QUESTION_ID);
+  VOID            InsertQuestion (IN SVfrQuestionNode *);
+  VOID            ClearQuestions (VOID);
+  SVfrQuestionNode *LookupQuestion (IN SVfrQuestionNameIndex &, IN CHAR8 *, IN CHAR8 *Name = NULL);
 
 public:
   CVfrQuestionDB ();
@@ -0,0 +1,240 @@
+/** @file
+Test harness that runs the compression routines of the BaseTools Common library
+on a file. It lets the unit tests check TianoCompress output with the decoder in
+Common/Decompress.c and cover EfiCompress, which has no command line tool.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Compress.h"
+#include "Decompress.h"
+
+STATIC
+UINT8 *
+ReadInput (
+  IN  CHAR8   *FileName,
+  OUT UINT32  *Size
+  )
+/*++
+
+Routine Description:
+
+  Read a whole file into an allocated buffer.
+
+Arguments:
+
+  FileName - The name of the file.
+  Size     - The size of the file.
+
+Returns:
+
+  The buffer, or NULL on error.
+
+--*/
+{
+  FILE    *File;
+  UINT8   *Buffer;
+  long    Length;
+
+  File = fopen (FileName, "rb");
+  if (File == NULL) {
+    return NULL;
+  }
+  fseek (File, 0, SEEK_END);
+  Length = ftell (File);
+  fseek (File, 0, SEEK_SET);
+  //
+  // Keep the buffer non-empty so an empty file is not mistaken for an error.
+  //
+  Buffer = malloc (Length + 1);
+  if (Buffer != NULL && fread (Buffer, 1, Length, File) != (size_t) Length) {
+    free (Buffer);
+    Buffer = NULL;
+  }
+  fclose (File);
+  *Size = (UINT32) Length;
+  return Buffer;
+}
+
+STATIC
+EFI_STATUS
+Encode (
+  IN      UINT8   *Input,
+  IN      UINT32  InputSize,
+  IN      UINT32  Level,
+  OUT     UINT8   **Output,
+  OUT     UINT32  *OutputSize
+  )
+/*++
+
+Routine Description:
+
+  Compress a buffer with EfiCompressEx, growing the output buffer on demand.
+
+Arguments:
+
+  Input      - The data to compress.
+  InputSize  - The size of the data.
+  Level      - COMPRESS_LEVEL_FAST or COMPRESS_LEVEL_DEFAULT.
+  Output     - The allocated compressed data.
+  OutputSize - The size of the compressed data.
+
+Returns:
+
+  EFI_SUCCESS or the error returned by EfiCompressEx.
+
+--*/
+{
+  EFI_STATUS  Status;
+
+  *OutputSize = 0;
+  *Output     = malloc (1);
+  Status      = EfiCompressEx (Input, InputSize, *Output, OutputSize, Level);
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    free (*Output);
+    *Output = malloc (*OutputSize);
+    if (*Output == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Status = EfiCompressEx (Input, InputSize, *Output, OutputSize, Level);
+  }
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+Decode (
+  IN      UINT8   *Input,
+  IN      UINT32  InputSize,
+  IN      BOOLEAN IsTiano,
+  OUT     UINT8   **Output,
+  OUT     UINT32  *OutputSize
+  )
+/*++
+
+Routine Description:
+
+  Decompress a buffer with EfiDecompress or TianoDecompress.
+
+Arguments:
+
+  Input      - The compressed data.
+  InputSize  - The size of the compressed data.
+  IsTiano    - TRUE for the Tiano format, FALSE for the EFI format.
+  Output     - The allocated decompressed data.
+  OutputSize - The size of the decompressed data.
+
+Returns:
+
+  EFI_SUCCESS or the error returned by the decompressor.
+
+--*/
+{
+  EFI_STATUS  Status;
+  UINT8       *Scratch;
+  UINT32      ScratchSize;
+
+  if (IsTiano) {
+    Status = TianoGetInfo (Input, InputSize, OutputSize, &ScratchSize);
+  } else {
+    Status = EfiGetInfo (Input, InputSize, OutputSize, &ScratchSize);
+  }
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  *Output = malloc (*OutputSize + 1);
+  Scratch = malloc (ScratchSize);
+  if (*Output == NULL || Scratch == NULL) {
+    free (Scratch);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  if (IsTiano) {
+    Status = TianoDecompress (Input, InputSize, *Output, *OutputSize, Scratch, ScratchSize);
+  } else {
+    Status = EfiDecompress (Input, InputSize, *Output, *OutputSize, Scratch, ScratchSize);
+  }
+  free (Scratch);
+  return Status;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+/*++
+
+Routine Description:
+
+  Usage: CompressHarness <mode> <input> <output>
+
+  mode is one of:
+    -ec   EfiCompress at the default level
+    -ef   EfiCompress at the fast level
+    -ed   EfiDecompress
+    -td   TianoDecompress
+
+Returns:
+
+  0 on success, 1 on error.
+
+--*/
+{
+  EFI_STATUS  Status;
+  UINT8       *Input;
+  UINT32      InputSize;
+  UINT8       *Output;
+  UINT32      OutputSize;
+  FILE        *File;
+
+  if (argc != 4) {
+    fprintf (stderr, "usage: %s -ec|-ef|-ed|-td <input> <output>\n", argv[0]);
+    return 1;
+  }
+
+  Input = ReadInput (argv[2], &InputSize);
+  if (Input == NULL) {
+    fprintf (stderr, "cannot read %s\n", argv[2]);
+    return 1;
+  }
+
+  Output = NULL;
+  if (strcmp (argv[1], "-ec") == 0) {
+    Status = Encode (Input, InputSize, COMPRESS_LEVEL_DEFAULT, &Output, &OutputSize);
+  } else if (strcmp (argv[1], "-ef") == 0) {
+    Status = Encode (Input, InputSize, COMPRESS_LEVEL_FAST, &Output, &OutputSize);
+  } else if (strcmp (argv[1], "-ed") == 0) {
+    Status = Decode (Input, InputSize, FALSE, &Output, &OutputSize);
+  } else if (strcmp (argv[1], "-td") == 0) {
+    Status = Decode (Input, InputSize, TRUE, &Output, &OutputSize);
+  } else {
+    fprintf (stderr, "unknown mode %s\n", argv[1]);
+    return 1;
+  }
+  if (EFI_ERROR (Status)) {
+    fprintf (stderr, "%s failed with status 0x%x\n", argv[1], (unsigned) Status);
+    return 1;
+  }
+
+  File = fopen (argv[3], "wb");
+  if (File == NULL || fwrite (Output, 1, OutputSize, File) != OutputSize) {
+    fprintf (stderr, "cannot write %s\n", argv[3]);
+    return 1;
+  }
+  fclose (File);
+  free (Output);
+  free (Input);
+  return 0;
+}
@@ -1,7 +1,7 @@
 ## @file
 # Unit tests for TianoCompress utility
 #
-#  Copyright (c) 2008, Intel Corporation. All rights reserved.<BR>
+#  Copyright (c) 2008 - 2016, Intel Corporation. All rights reserved.<BR>
 #
 #  This program and the accompanying materials
 #  are licensed and made available under the terms and conditions of the BSD License
@@ -15,31 +15,103 @@
 ##
 # Import Modules
 #
+import base64
 import os
+import platform
 import random
+import shutil
+import subprocess
 import sys
+import tempfile
 import unittest
 
 import TestTools
 
+#
+# The harness links the Common library compression routines, so the tool output
+# is also checked with Common/Decompress.c and EfiCompress gets covered.
+#
+HarnessSources = [
+    os.path.join(TestTools.TestsDir, 'CompressHarness.c'),
+    os.path.join(TestTools.CSourceDir, 'Common', 'Decompress.c'),
+    os.path.join(TestTools.CSourceDir, 'Common', 'EfiCompress.c'),
+    ]
+
+def GetArchIncludeDir():
+    machine = platform.machine().lower()
+    if machine in ('x86_64', 'amd64'):
+        arch = 'X64'
+    elif machine in ('aarch64', 'arm64'):
+        arch = 'AArch64'
+    elif machine.startswith('arm'):
+        arch = 'Arm'
+    else:
+        arch = 'Ia32'
+    return os.path.join(TestTools.CSourceDir, 'Include', arch)
+
+#
+# KnownGoodData compressed by the TianoCompress encoder that predates the
+# binary-tree match finder. Decoding it checks that the decoders still accept
+# streams from the previous encoder.
+#
+KnownGoodData = ''.join(
+    ['EFI_STATUS Status%d = gBS->LocateProtocol ();\n' % (x % 7) for x in xrange(40)]
+    )
+KnownGoodTiano = base64.b64decode(
+    'XwAAAAgHAAAAQFKS0p3+x/9APYj/AUAwUUUUpgK7zGXr0mCrqOahGgb7T20X8oAAAgHDHLY3'
+    'XO1MjV6+dyFYXF5x25pB676dIqQTkov9f70yUGTAycGUAykGVAxp006adNOmnX06AA=='
+    )
+
 class Tests(TestTools.BaseToolsTest):
 
+    @classmethod
+    def setUpClass(cls):
+        cls.harnessDir = tempfile.mkdtemp()
+        cls.harness = os.path.join(cls.harnessDir, 'CompressHarness')
+        args = [os.environ.get('CC', 'cc'), '-fshort-wchar',
+                '-I', os.path.join(TestTools.CSourceDir, 'Include', 'Common'),
+                '-I', os.path.join(TestTools.CSourceDir, 'Include'),
+                '-I', os.path.join(TestTools.CSourceDir, 'Common'),
+                '-I', GetArchIncludeDir(),
+                '-o', cls.harness] + HarnessSources
+        assert subprocess.call(args) == 0
+
+    @classmethod
+    def tearDownClass(cls):
+        shutil.rmtree(cls.harnessDir, True)
+
     def setUp(self):
         TestTools.BaseToolsTest.setUp(self)
         self.toolName = 'TianoCompress'
 
+    def RunHarness(self, mode, input, output):
+        return subprocess.call(
+            [self.harness, mode, self.GetTmpFilePath(input), self.GetTmpFilePath(output)]
+            )
+
+    def checkDecoded(self, description, data, compressed, decoded):
+        finish = self.ReadTmpFile(decoded)
+        if finish != data:
+            print
+            print 'Original data did not match', description
+            self.DisplayBinaryData('original data', data)
+            self.DisplayBinaryData('after compression', self.ReadTmpFile(compressed))
+            self.DisplayBinaryData('after decompression', finish)
+        self.assertTrue(finish == data)
+
     def testHelp(self):
         result = self.RunTool('--help', logFile='help')
         #self.DisplayFile('help')
         self.assertTrue(result == 0)
 
-    def compressionTestCycle(self, data):
+    def compressionTestCycle(self, data, *options):
         path = self.GetTmpFilePath('input')
         self.WriteTmpFile('input', data)
         result = self.RunTool(
             '-e',
             '-o', self.GetTmpFilePath('output1'),
-            self.GetTmpFilePath('input')
+            self.GetTmpFilePath('input'),
+            *options
             )
         self.assertTrue(result == 0)
         result = self.RunTool(
@@ -48,16 +120,18 @@ class Tests(TestTools.BaseToolsTest):
             self.GetTmpFilePath('output1')
             )
         self.assertTrue(result == 0)
-        start = self.ReadTmpFile('input')
-        finish = self.ReadTmpFile('output2')
-        startEqualsFinish = start == finish
-        if not startEqualsFinish:
-            print
-            print 'Original data did not match decompress(compress(data))'
-            self.DisplayBinaryData('original data', start)
-            self.DisplayBinaryData('after compression', self.ReadTmpFile('output1'))
-            self.DisplayBinaryData('after decomression', finish)
-        self.assertTrue(startEqualsFinish)
+        self.checkDecoded('decompress(compress(data))', data, 'output1', 'output2')
+        result = self.RunHarness('-td', 'output1', 'output3')
+        self.assertTrue(result == 0)
+        self.checkDecoded('TianoDecompress(compress(data))', data, 'output1', 'output3')
+
+    def efiCompressionTestCycle(self, data, mode):
+        self.WriteTmpFile('input', data)
+        result = self.RunHarness(mode, 'input', 'output1')
+        self.assertTrue(result == 0)
+        result = self.RunHarness('-ed', 'output1', 'output2')
+        self.assertTrue(result == 0)
+        self.checkDecoded('EfiDecompress(EfiCompress(data))', data, 'output1', 'output2')
 
     def testRandomDataCycles(self):
         for i in range(8):
@@ -65,6 +139,64 @@ class Tests(TestTools.BaseToolsTest):
             self.compressionTestCycle(data)
             self.CleanUpTmpDir()
 
+    def GetCorpus(self):
+        #
+        # Inputs that exercise the match finder: empty and tiny inputs,
+        # runs, short periods, long repeats at varying distances, and data
+        # larger than the 512KB window so that the window slides.
+        #
+        random.seed(0)
+        text = ''.join(
+            [random.choice(('EFI_STATUS ', 'Status', ' = ', 'gBS->', ';\n', 'Index', '  '))
+             for x in xrange(40000)
+            ])
+        block = self.GetRandomString(4096)
+        return [
+            '',
+            'a',
+            'abc',
+            '\0' * 100000,
+            '\xff' * 3 + '\0' * 70000 + '\xff' * 3,
+            'ab' * 50000,
+            block * 40 + self.GetRandomString(1000) + block,
+            text,
+            (text + block) * 4,
+            self.GetRandomString(600 * 1024),
+            ]
+
+    def testCorpusCycles(self):
+        for data in self.GetCorpus():
+            self.compressionTestCycle(data)
+            self.CleanUpTmpDir()
+
+    def testCorpusCyclesFast(self):
+        for data in self.GetCorpus():
+            self.compressionTestCycle(data, '--fast')
+            self.CleanUpTmpDir()
+
+    def testEfiCorpusCycles(self):
+        for data in self.GetCorpus():
+            self.efiCompressionTestCycle(data, '-ec')
+            self.CleanUpTmpDir()
+
+    def testEfiCorpusCyclesFast(self):
+        for data in self.GetCorpus():
+            self.efiCompressionTestCycle(data, '-ef')
+            self.CleanUpTmpDir()
+
+    def testKnownGoodStream(self):
+        self.WriteTmpFile('input', KnownGoodTiano)
+        result = self.RunTool(
+            '-d',
+            '-o', self.GetTmpFilePath('output1'),
+            self.GetTmpFilePath('input')
+            )
+        self.assertTrue(result == 0)
+        self.checkDecoded('the known-good decoding', KnownGoodData, 'input', 'output1')
+        result = self.RunHarness('-td', 'input', 'output2')
+        self.assertTrue(result == 0)
+        self.checkDecoded('the known-good decoding', KnownGoodData, 'input', 'output2')
+
 TheTestSuite = TestTools.MakeTheTestSuite(locals())
 
 if __name__ == '__main__':
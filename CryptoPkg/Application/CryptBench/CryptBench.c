@@ -0,0 +1,385 @@
+/** @file
+  Shell application that measures the throughput of the crypto library.
+
+  Every primitive is run over the same buffer twice: once through the portable
+  OpenSSL C implementation and once through BaseCryptLib, which uses the
+  CPU-accelerated transforms when the processor supports them.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/BaseCryptLib.h>
+
+#include <OpenSslSupport.h>
+#include <openssl/sha.h>
+#include <openssl/aes.h>
+
+#define BENCH_BUFFER_SIZE   SIZE_64KB
+#define BENCH_SECONDS       1
+
+/**
+  Process one buffer with a crypto primitive.
+
+  @param[in, out]  Buffer      Data to hash, or to encrypt or decrypt in place.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+typedef
+VOID
+(*BENCH_FUNCTION) (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  );
+
+typedef struct {
+  CHAR16          *Name;
+  BENCH_FUNCTION  Portable;
+  BENCH_FUNCTION  Library;
+} BENCH_ENTRY;
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 mBenchAesKey[16] = {
+  0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 mBenchAesIvec[16] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+UINT8  mBenchDigest[SHA512_DIGEST_SIZE];
+
+/**
+  Hash the buffer with SHA-1 through the portable OpenSSL code.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+PortableSha1 (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  SHA_CTX  Context;
+
+  SHA1_Init (&Context);
+  SHA1_Update (&Context, Buffer, BufferSize);
+  SHA1_Final (mBenchDigest, &Context);
+}
+
+/**
+  Hash the buffer with SHA-1 through BaseCryptLib.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+LibrarySha1 (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  VOID  *HashContext;
+
+  HashContext = AllocatePool (Sha1GetContextSize ());
+  if (HashContext == NULL) {
+    return;
+  }
+  Sha1Init (HashContext);
+  Sha1Update (HashContext, Buffer, BufferSize);
+  Sha1Final (HashContext, mBenchDigest);
+  FreePool (HashContext);
+}
+
+/**
+  Hash the buffer with SHA-256 through the portable OpenSSL code.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+PortableSha256 (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  SHA256_CTX  Context;
+
+  SHA256_Init (&Context);
+  SHA256_Update (&Context, Buffer, BufferSize);
+  SHA256_Final (mBenchDigest, &Context);
+}
+
+/**
+  Hash the buffer with SHA-256 through BaseCryptLib.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+LibrarySha256 (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  VOID  *HashContext;
+
+  HashContext = AllocatePool (Sha256GetContextSize ());
+  if (HashContext == NULL) {
+    return;
+  }
+  Sha256Init (HashContext);
+  Sha256Update (HashContext, Buffer, BufferSize);
+  Sha256Final (HashContext, mBenchDigest);
+  FreePool (HashContext);
+}
+
+/**
+  Hash the buffer with SHA-512 through the portable OpenSSL code.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+PortableSha512 (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  SHA512_CTX  Context;
+
+  SHA512_Init (&Context);
+  SHA512_Update (&Context, Buffer, BufferSize);
+  SHA512_Final (mBenchDigest, &Context);
+}
+
+/**
+  Hash the buffer with SHA-512 through BaseCryptLib.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+LibrarySha512 (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  VOID  *HashContext;
+
+  HashContext = AllocatePool (Sha512GetContextSize ());
+  if (HashContext == NULL) {
+    return;
+  }
+  Sha512Init (HashContext);
+  Sha512Update (HashContext, Buffer, BufferSize);
+  Sha512Final (HashContext, mBenchDigest);
+  FreePool (HashContext);
+}
+
+/**
+  Encrypt the buffer in place with AES-128-CBC through the portable OpenSSL code.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+PortableAesCbcEncrypt (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  AES_KEY  AesKey;
+  UINT8    Ivec[AES_BLOCK_SIZE];
+
+  AES_set_encrypt_key (mBenchAesKey, 128, &AesKey);
+  CopyMem (Ivec, mBenchAesIvec, AES_BLOCK_SIZE);
+  AES_cbc_encrypt (Buffer, Buffer, BufferSize, &AesKey, Ivec, AES_ENCRYPT);
+}
+
+/**
+  Decrypt the buffer in place with AES-128-CBC through the portable OpenSSL code.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+PortableAesCbcDecrypt (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  AES_KEY  AesKey;
+  UINT8    Ivec[AES_BLOCK_SIZE];
+
+  AES_set_decrypt_key (mBenchAesKey, 128, &AesKey);
+  CopyMem (Ivec, mBenchAesIvec, AES_BLOCK_SIZE);
+  AES_cbc_encrypt (Buffer, Buffer, BufferSize, &AesKey, Ivec, AES_DECRYPT);
+}
+
+/**
+  Encrypt the buffer in place with AES-128-CBC through BaseCryptLib.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+LibraryAesCbcEncrypt (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  VOID  *AesContext;
+
+  AesContext = AllocatePool (AesGetContextSize ());
+  if (AesContext == NULL) {
+    return;
+  }
+  AesInit (AesContext, mBenchAesKey, 128);
+  AesCbcEncrypt (AesContext, Buffer, BufferSize, mBenchAesIvec, Buffer);
+  FreePool (AesContext);
+}
+
+/**
+  Decrypt the buffer in place with AES-128-CBC through BaseCryptLib.
+
+  @param[in, out]  Buffer      Data to process.
+  @param[in]       BufferSize  Size of Buffer in bytes.
+
+**/
+VOID
+LibraryAesCbcDecrypt (
+  IN OUT UINT8  *Buffer,
+  IN     UINTN  BufferSize
+  )
+{
+  VOID  *AesContext;
+
+  AesContext = AllocatePool (AesGetContextSize ());
+  if (AesContext == NULL) {
+    return;
+  }
+  AesInit (AesContext, mBenchAesKey, 128);
+  AesCbcDecrypt (AesContext, Buffer, BufferSize, mBenchAesIvec, Buffer);
+  FreePool (AesContext);
+}
+
+GLOBAL_REMOVE_IF_UNREFERENCED BENCH_ENTRY mBenchTable[] = {
+  { L"SHA-1",           PortableSha1,          LibrarySha1          },
+  { L"SHA-256",         PortableSha256,        LibrarySha256        },
+  { L"SHA-512",         PortableSha512,        LibrarySha512        },
+  { L"AES-128-CBC Enc", PortableAesCbcEncrypt, LibraryAesCbcEncrypt },
+  { L"AES-128-CBC Dec", PortableAesCbcDecrypt, LibraryAesCbcDecrypt }
+};
+
+/**
+  Run a crypto primitive over the buffer for BENCH_SECONDS seconds.
+
+  The time is measured with a UEFI timer event, so the benchmark does not
+  depend on a platform TimerLib.
+
+  @param[in]  Function  The primitive to measure.
+  @param[in]  Buffer    Buffer of BENCH_BUFFER_SIZE bytes.
+
+  @return The throughput in MB (10^6 bytes) per second, or 0 if the timer
+          event could not be set.
+
+**/
+UINT64
+MeasureThroughput (
+  IN BENCH_FUNCTION  Function,
+  IN UINT8           *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  EFI_EVENT   TimerEvent;
+  UINT64      Bytes;
+
+  Status = gBS->CreateEvent (EVT_TIMER, 0, NULL, NULL, &TimerEvent);
+  if (EFI_ERROR (Status)) {
+    return 0;
+  }
+
+  Bytes  = 0;
+  Status = gBS->SetTimer (TimerEvent, TimerRelative, EFI_TIMER_PERIOD_SECONDS (BENCH_SECONDS));
+  if (!EFI_ERROR (Status)) {
+    //
+    // The buffer is small, so the last pass only runs a little past the timer.
+    //
+    do {
+      Function (Buffer, BENCH_BUFFER_SIZE);
+      Bytes += BENCH_BUFFER_SIZE;
+    } while (gBS->CheckEvent (TimerEvent) == EFI_NOT_READY);
+  }
+  gBS->CloseEvent (TimerEvent);
+
+  return DivU64x32 (Bytes, BENCH_SECONDS * 1000000);
+}
+
+/**
+  Entry Point of Cryptographic Benchmark Utility.
+
+  @param  ImageHandle  The image handle of the UEFI Application.
+  @param  SystemTable  A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS           The entry point is executed successfully.
+  @retval EFI_OUT_OF_RESOURCES  The benchmark buffer could not be allocated.
+
+**/
+EFI_STATUS
+EFIAPI
+CryptBenchMain (
+  IN     EFI_HANDLE                 ImageHandle,
+  IN     EFI_SYSTEM_TABLE           *SystemTable
+  )
+{
+  UINT8   *Buffer;
+  UINTN   Index;
+
+  Buffer = AllocatePool (BENCH_BUFFER_SIZE);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  for (Index = 0; Index < BENCH_BUFFER_SIZE; Index++) {
+    Buffer[Index] = (UINT8) Index;
+  }
+
+  Print (L"\nUEFI-OpenSSL Wrapper Cryptosystem Throughput (%d KB buffer, %d s each): \n", BENCH_BUFFER_SIZE / SIZE_1KB, BENCH_SECONDS);
+  Print (L"--------------------------------------------------------- \n");
+  Print (L"%-16s %16s %16s\n", L"", L"Portable (MB/s)", L"BaseCryptLib (MB/s)");
+
+  for (Index = 0; Index < sizeof (mBenchTable) / sizeof (mBenchTable[0]); Index++) {
+    Print (
+      L"%-16s %16ld %16ld\n",
+      mBenchTable[Index].Name,
+      MeasureThroughput (mBenchTable[Index].Portable, Buffer),
+      MeasureThroughput (mBenchTable[Index].Library, Buffer)
+      );
+  }
+
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/** @file
+  CPU-accelerated crypto transform Wrapper Implementation which does not
+  provide real capabilities. The callers always fall back to the portable
+  OpenSSL implementation.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "InternalCryptLib.h"
+
+/**
+  Process whole 64-byte blocks with the CPU-accelerated SHA-1 transform.
+
+  Return FALSE to indicate this interface is not supported.
+
+  @param[in, out]  State       The five 32-bit SHA-1 chaining values.
+  @param[in]       Data        Pointer to the message blocks.
+  @param[in]       BlockCount  Number of 64-byte blocks at Data.
+
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+InternalSha1AccelBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  )
+{
+  return FALSE;
+}
+
+/**
+  Process whole 64-byte blocks with the CPU-accelerated SHA-256 transform.
+
+  Return FALSE to indicate this interface is not supported.
+
+  @param[in, out]  State       The eight 32-bit SHA-256 chaining values.
+  @param[in]       Data        Pointer to the message blocks.
+  @param[in]       BlockCount  Number of 64-byte blocks at Data.
+
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+InternalSha256AccelBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  )
+{
+  return FALSE;
+}
+
+/**
+  Check whether the CPU-accelerated AES transforms can be used.
+
+  Return FALSE to indicate this interface is not supported.
+
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+InternalAesAccelSupported (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Encrypt or decrypt whole AES blocks with the CPU-accelerated transform.
+
+  ASSERT because InternalAesAccelSupported() never returns TRUE.
+
+  @param[in]   Mode        One of the AES_ACCEL_xxx operations.
+  @param[in]   RoundKeys   Rounds + 1 round keys in FIPS-197 byte order.
+  @param[in]   Rounds      Number of AES rounds (10, 12 or 14).
+  @param[in]   Input       Pointer to the input blocks.
+  @param[in]   InputSize   Size of Input in bytes, a multiple of 16.
+  @param[in]   Ivec        Initialization vector for the CBC operations.
+  @param[out]  Output      Pointer to the output blocks.
+
+**/
+VOID
+InternalAesAccelCrypt (
+  IN  UINTN        Mode,
+  IN  CONST UINT8  *RoundKeys,
+  IN  UINTN        Rounds,
+  IN  CONST UINT8  *Input,
+  IN  UINTN        InputSize,
+  IN  CONST UINT8  *Ivec,
+  OUT UINT8        *Output
+  )
+{
+  ASSERT (FALSE);
+}
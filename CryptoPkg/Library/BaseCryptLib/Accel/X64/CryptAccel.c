@@ -0,0 +1,261 @@
+/** @file
+  CPU-accelerated SHA-1, SHA-256 and AES block transforms for X64.
+
+  The Intel SHA Extensions and AES New Instructions are used when CPUID reports
+  them and SSE is enabled in CR4. Otherwise every function returns FALSE and the
+  callers fall back to the portable OpenSSL implementation.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "InternalCryptLib.h"
+
+//
+// CPUID.01H:ECX feature bits
+//
+#define CPUID_FEATURE_SSSE3       BIT9
+#define CPUID_FEATURE_SSE41       BIT19
+#define CPUID_FEATURE_AESNI       BIT25
+//
+// CPUID.(EAX=07H,ECX=0):EBX feature bits
+//
+#define CPUID_EXT_FEATURE_SHA     BIT29
+//
+// CR4.OSFXSR: the firmware has enabled SSE instructions
+//
+#define CR4_OSFXSR                BIT9
+
+#define CRYPT_ACCEL_SHA           BIT0
+#define CRYPT_ACCEL_AES           BIT1
+#define CRYPT_ACCEL_DETECTED      BIT31
+
+//
+// Cached result of InternalGetAccelFeatures(). Zero until the first call.
+//
+STATIC UINT32  mCryptAccelFeatures = 0;
+
+VOID
+EFIAPI
+InternalSha1ShaNiBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+VOID
+EFIAPI
+InternalSha256ShaNiBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+VOID
+EFIAPI
+InternalAesNiEcbEncrypt (
+  IN  CONST UINT8  *RoundKeys,
+  IN  UINTN        Rounds,
+  IN  CONST UINT8  *Input,
+  OUT UINT8        *Output,
+  IN  UINTN        BlockCount
+  );
+
+VOID
+EFIAPI
+InternalAesNiEcbDecrypt (
+  IN  CONST UINT8  *RoundKeys,
+  IN  UINTN        Rounds,
+  IN  CONST UINT8  *Input,
+  OUT UINT8        *Output,
+  IN  UINTN        BlockCount
+  );
+
+VOID
+EFIAPI
+InternalAesNiCbcEncrypt (
+  IN  CONST UINT8  *RoundKeys,
+  IN  UINTN        Rounds,
+  IN  CONST UINT8  *Input,
+  OUT UINT8        *Output,
+  IN  UINTN        BlockCount,
+  IN  CONST UINT8  *Ivec
+  );
+
+VOID
+EFIAPI
+InternalAesNiCbcDecrypt (
+  IN  CONST UINT8  *RoundKeys,
+  IN  UINTN        Rounds,
+  IN  CONST UINT8  *Input,
+  OUT UINT8        *Output,
+  IN  UINTN        BlockCount,
+  IN  CONST UINT8  *Ivec
+  );
+
+/**
+  Detect the crypto instruction set extensions usable by this library.
+
+  CR4 and CPUID are only read on the first call; CPUID may trap to the
+  hypervisor, so the result is cached for the hash and cipher fast paths.
+
+  @return A bit mask of CRYPT_ACCEL_SHA and CRYPT_ACCEL_AES.
+
+**/
+UINT32
+InternalGetAccelFeatures (
+  VOID
+  )
+{
+  UINT32  MaxLeaf;
+  UINT32  Ebx;
+  UINT32  Ecx;
+  UINT32  Features;
+
+  if ((mCryptAccelFeatures & CRYPT_ACCEL_DETECTED) != 0) {
+    return mCryptAccelFeatures & ~CRYPT_ACCEL_DETECTED;
+  }
+
+  Features = 0;
+  if ((AsmReadCr4 () & CR4_OSFXSR) != 0) {
+    AsmCpuid (0, &MaxLeaf, NULL, NULL, NULL);
+    AsmCpuid (1, NULL, NULL, &Ecx, NULL);
+    if ((Ecx & (CPUID_FEATURE_SSSE3 | CPUID_FEATURE_SSE41)) == (CPUID_FEATURE_SSSE3 | CPUID_FEATURE_SSE41)) {
+      if ((Ecx & CPUID_FEATURE_AESNI) != 0) {
+        Features |= CRYPT_ACCEL_AES;
+      }
+      if (MaxLeaf >= 7) {
+        AsmCpuidEx (7, 0, NULL, &Ebx, NULL, NULL);
+        if ((Ebx & CPUID_EXT_FEATURE_SHA) != 0) {
+          Features |= CRYPT_ACCEL_SHA;
+        }
+      }
+    }
+  }
+
+  mCryptAccelFeatures = Features | CRYPT_ACCEL_DETECTED;
+  return Features;
+}
+
+/**
+  Process whole 64-byte blocks with the CPU-accelerated SHA-1 transform.
+
+  @param[in, out]  State       The five 32-bit SHA-1 chaining values.
+  @param[in]       Data        Pointer to the message blocks.
+  @param[in]       BlockCount  Number of 64-byte blocks at Data.
+
+  @retval TRUE   The blocks were processed and State was updated.
+  @retval FALSE  No accelerated implementation is available; State is untouched.
+
+**/
+BOOLEAN
+InternalSha1AccelBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  )
+{
+  if ((InternalGetAccelFeatures () & CRYPT_ACCEL_SHA) == 0) {
+    return FALSE;
+  }
+
+  InternalSha1ShaNiBlocks (State, Data, BlockCount);
+  return TRUE;
+}
+
+/**
+  Process whole 64-byte blocks with the CPU-accelerated SHA-256 transform.
+
+  @param[in, out]  State       The eight 32-bit SHA-256 chaining values.
+  @param[in]       Data        Pointer to the message blocks.
+  @param[in]       BlockCount  Number of 64-byte blocks at Data.
+
+  @retval TRUE   The blocks were processed and State was updated.
+  @retval FALSE  No accelerated implementation is available; State is untouched.
+
+**/
+BOOLEAN
+InternalSha256AccelBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  )
+{
+  if ((InternalGetAccelFeatures () & CRYPT_ACCEL_SHA) == 0) {
+    return FALSE;
+  }
+
+  InternalSha256ShaNiBlocks (State, Data, BlockCount);
+  return TRUE;
+}
+
+/**
+  Check whether the CPU-accelerated AES transforms can be used.
+
+  @retval TRUE   InternalAesAccelCrypt() can be used.
+  @retval FALSE  No accelerated implementation is available.
+
+**/
+BOOLEAN
+InternalAesAccelSupported (
+  VOID
+  )
+{
+  return (BOOLEAN) ((InternalGetAccelFeatures () & CRYPT_ACCEL_AES) != 0);
+}
+
+/**
+  Encrypt or decrypt whole AES blocks with the CPU-accelerated transform.
+
+  Must only be called after InternalAesAccelSupported() returned TRUE.
+
+  @param[in]   Mode        One of the AES_ACCEL_xxx operations.
+  @param[in]   RoundKeys   Rounds + 1 round keys in FIPS-197 byte order. Decryption
+                           uses the equivalent inverse cipher key schedule.
+  @param[in]   Rounds      Number of AES rounds (10, 12 or 14).
+  @param[in]   Input       Pointer to the input blocks.
+  @param[in]   InputSize   Size of Input in bytes, a multiple of 16.
+  @param[in]   Ivec        Initialization vector for the CBC operations.
+  @param[out]  Output      Pointer to the output blocks. May be the same as Input.
+
+**/
+VOID
+InternalAesAccelCrypt (
+  IN  UINTN        Mode,
+  IN  CONST UINT8  *RoundKeys,
+  IN  UINTN        Rounds,
+  IN  CONST UINT8  *Input,
+  IN  UINTN        InputSize,
+  IN  CONST UINT8  *Ivec,
+  OUT UINT8        *Output
+  )
+{
+  switch (Mode) {
+  case AES_ACCEL_ECB_ENCRYPT:
+    InternalAesNiEcbEncrypt (RoundKeys, Rounds, Input, Output, InputSize / 16);
+    break;
+
+  case AES_ACCEL_ECB_DECRYPT:
+    InternalAesNiEcbDecrypt (RoundKeys, Rounds, Input, Output, InputSize / 16);
+    break;
+
+  case AES_ACCEL_CBC_ENCRYPT:
+    InternalAesNiCbcEncrypt (RoundKeys, Rounds, Input, Output, InputSize / 16, Ivec);
+    break;
+
+  case AES_ACCEL_CBC_DECRYPT:
+    InternalAesNiCbcDecrypt (RoundKeys, Rounds, Input, Output, InputSize / 16, Ivec);
+    break;
+
+  default:
+    ASSERT (FALSE);
+    break;
+  }
+}
@@ -1,7 +1,7 @@
 /** @file
   AES Wrapper Implementation over OpenSSL.
 
-Copyright (c) 2010 - 2012, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -15,6 +15,40 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "InternalCryptLib.h"
 #include <openssl/aes.h>
 
+//
+// AES context. The OpenSSL key schedules come first; when the CPU-accelerated
+// transforms are usable, the same schedules are also kept in FIPS-197 byte order.
+//
+typedef struct {
+  AES_KEY  Key[2];
+  UINTN    AccelRounds;
+  UINT32   AccelKey[2][4 * (AES_MAXNR + 1)];
+} AES_CONTEXT;
+
+/**
+  Convert an OpenSSL AES key schedule to the byte order of the CPU-accelerated
+  transforms.
+
+  OpenSSL stores each 32-bit round key word as a big-endian value, while the
+  accelerated transforms consume the round keys as plain byte strings.
+
+  @param[in]   AesKey     OpenSSL encryption or decryption key schedule.
+  @param[out]  Schedule   Receives 4 * (AesKey->rounds + 1) round key words.
+
+**/
+VOID
+AesConvertKeySchedule (
+  IN  CONST AES_KEY  *AesKey,
+  OUT UINT32         *Schedule
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < (UINTN) (4 * (AesKey->rounds + 1)); Index++) {
+    Schedule[Index] = SwapBytes32 (AesKey->rd_key[Index]);
+  }
+}
+
 /**
   Retrieves the size, in bytes, of the context buffer required for AES operations.
 
@@ -29,9 +63,10 @@ AesGetContextSize (
 {
   //
   // AES uses different key contexts for encryption and decryption, so here memory
-  // for 2 copies of AES_KEY is allocated.
+  // for 2 copies of AES_KEY is allocated, plus their copies for the CPU-accelerated
+  // transforms.
   //
-  return (UINTN) (2 * sizeof (AES_KEY));
+  return (UINTN) (sizeof (AES_CONTEXT));
 }
 
 /**
@@ -62,7 +97,8 @@ AesInit (
   IN   UINTN        KeyLength
   )
 {
-  AES_KEY  *AesKey;
+  AES_KEY      *AesKey;
+  AES_CONTEXT  *AesCtx;
 
   //
   // Check input parameters.
@@ -81,6 +117,17 @@ AesInit (
   if (AES_set_decrypt_key (Key, (UINT32) KeyLength, AesKey + 1) != 0) {
     return FALSE;
   }
+
+  //
+  // Prepare the key schedules of the CPU-accelerated transforms if they can be used.
+  //
+  AesCtx = (AES_CONTEXT *) AesContext;
+  AesCtx->AccelRounds = 0;
+  if (InternalAesAccelSupported ()) {
+    AesConvertKeySchedule (&AesCtx->Key[0], AesCtx->AccelKey[0]);
+    AesConvertKeySchedule (&AesCtx->Key[1], AesCtx->AccelKey[1]);
+    AesCtx->AccelRounds = (UINTN) AesCtx->Key[0].rounds;
+  }
   return TRUE;
 }
 
@@ -117,7 +164,8 @@ AesEcbEncrypt (
   OUT  UINT8        *Output
   )
 {
-  AES_KEY  *AesKey;
+  AES_KEY      *AesKey;
+  AES_CONTEXT  *AesCtx;
 
   //
   // Check input parameters.
@@ -126,6 +174,12 @@ AesEcbEncrypt (
     return FALSE;
   }
   
+  AesCtx = (AES_CONTEXT *) AesContext;
+  if (AesCtx->AccelRounds != 0) {
+    InternalAesAccelCrypt (AES_ACCEL_ECB_ENCRYPT, (UINT8 *) AesCtx->AccelKey[0], AesCtx->AccelRounds, Input, InputSize, NULL, Output);
+    return TRUE;
+  }
+
   AesKey = (AES_KEY *) AesContext;
 
   //
@@ -174,7 +228,8 @@ AesEcbDecrypt (
   OUT  UINT8        *Output
   )
 {
-  AES_KEY  *AesKey;
+  AES_KEY      *AesKey;
+  AES_CONTEXT  *AesCtx;
 
   //
   // Check input parameters.
@@ -183,6 +238,12 @@ AesEcbDecrypt (
     return FALSE;
   }
 
+  AesCtx = (AES_CONTEXT *) AesContext;
+  if (AesCtx->AccelRounds != 0) {
+    InternalAesAccelCrypt (AES_ACCEL_ECB_DECRYPT, (UINT8 *) AesCtx->AccelKey[1], AesCtx->AccelRounds, Input, InputSize, NULL, Output);
+    return TRUE;
+  }
+
   AesKey = (AES_KEY *) AesContext;
 
   //
@@ -235,8 +296,9 @@ AesCbcEncrypt (
   OUT  UINT8        *Output
   )
 {
-  AES_KEY  *AesKey;
-  UINT8    IvecBuffer[AES_BLOCK_SIZE];
+  AES_KEY      *AesKey;
+  AES_CONTEXT  *AesCtx;
+  UINT8        IvecBuffer[AES_BLOCK_SIZE];
 
   //
   // Check input parameters.
@@ -249,6 +311,12 @@ AesCbcEncrypt (
     return FALSE;
   }
 
+  AesCtx = (AES_CONTEXT *) AesContext;
+  if (AesCtx->AccelRounds != 0) {
+    InternalAesAccelCrypt (AES_ACCEL_CBC_ENCRYPT, (UINT8 *) AesCtx->AccelKey[0], AesCtx->AccelRounds, Input, InputSize, Ivec, Output);
+    return TRUE;
+  }
+
   AesKey = (AES_KEY *) AesContext;
   CopyMem (IvecBuffer, Ivec, AES_BLOCK_SIZE);
 
@@ -297,8 +365,9 @@ AesCbcDecrypt (
   OUT  UINT8        *Output
   )
 {
-  AES_KEY  *AesKey;
-  UINT8    IvecBuffer[AES_BLOCK_SIZE];
+  AES_KEY      *AesKey;
+  AES_CONTEXT  *AesCtx;
+  UINT8        IvecBuffer[AES_BLOCK_SIZE];
 
   //
   // Check input parameters.
@@ -311,6 +380,12 @@ AesCbcDecrypt (
     return FALSE;
   }
 
+  AesCtx = (AES_CONTEXT *) AesContext;
+  if (AesCtx->AccelRounds != 0) {
+    InternalAesAccelCrypt (AES_ACCEL_CBC_DECRYPT, (UINT8 *) AesCtx->AccelKey[1], AesCtx->AccelRounds, Input, InputSize, Ivec, Output);
+    return TRUE;
+  }
+
   AesKey = (AES_KEY *) AesContext;
   CopyMem (IvecBuffer, Ivec, AES_BLOCK_SIZE);
 
@@ -1,7 +1,7 @@
 /** @file
   SHA-256 Digest Wrapper Implementation over OpenSSL.
 
-Copyright (c) 2009 - 2012, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -122,6 +122,12 @@ Sha256Update (
   IN      UINTN       DataSize
   )
 {
+  SHA256_CTX   *Context;
+  CONST UINT8  *Buffer;
+  UINTN        Size;
+  UINTN        BlockCount;
+  UINT64       BitCount;
+
   //
   // Check input parameters.
   //
@@ -136,10 +142,37 @@ Sha256Update (
     return FALSE;
   }
 
+  Context = (SHA256_CTX *) Sha256Context;
+  Buffer  = (CONST UINT8 *) Data;
+
+  //
+  // Whole blocks are handed to the CPU-accelerated transform when there is one.
+  // Complete a pending partial block first so that the blocks stay in order.
+  //
+  if (Context->num != 0 && DataSize >= SHA256_CBLOCK - Context->num) {
+    Size = SHA256_CBLOCK - Context->num;
+    if (SHA256_Update (Context, Buffer, Size) == 0) {
+      return FALSE;
+    }
+    Buffer   += Size;
+    DataSize -= Size;
+  }
+
+  BlockCount = DataSize / SHA256_CBLOCK;
+  if (Context->num == 0 && BlockCount != 0 && InternalSha256AccelBlocks ((UINT32 *) &Context->h[0], Buffer, BlockCount)) {
+    Size      = BlockCount * SHA256_CBLOCK;
+    BitCount  = LShiftU64 (Context->Nh, 32) | Context->Nl;
+    BitCount += LShiftU64 (Size, 3);
+    Context->Nl = (UINT32) BitCount;
+    Context->Nh = (UINT32) RShiftU64 (BitCount, 32);
+    Buffer   += Size;
+    DataSize -= Size;
+  }
+
   //
   // OpenSSL SHA-256 Hash Update
   //
-  return (BOOLEAN) (SHA256_Update ((SHA256_CTX *) Sha256Context, Data, DataSize));
+  return (BOOLEAN) (SHA256_Update (Context, Buffer, DataSize));
 }
 
 /**
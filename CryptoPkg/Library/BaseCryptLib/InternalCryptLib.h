@@ -1,7 +1,7 @@
 /** @file  
   Internal include file for BaseCryptLib.
 
-Copyright (c) 2010 - 2012, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -30,5 +30,143 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define OPENSSL_SYSNAME_UWIN
 #endif
 
+//
+// Number of verified signer/trust anchor pairs kept by a PKCS7_CHAIN_CACHE
+//
+#define PKCS7_CHAIN_CACHE_SIZE  16
+
+//
+// A signer certificate whose chain to a trusted certificate was verified,
+// identified by the SHA-256 fingerprints of both DER encodings.
+//
+typedef struct {
+  UINT8                    SignerHash[SHA256_DIGEST_SIZE];
+  UINT8                    AnchorHash[SHA256_DIGEST_SIZE];
+} PKCS7_CHAIN_CACHE_ENTRY;
+
+//
+// Verified certificate chains, replaced round-robin once full
+//
+typedef struct {
+  UINTN                    Count;
+  UINTN                    Next;
+  PKCS7_CHAIN_CACHE_ENTRY  Entry[PKCS7_CHAIN_CACHE_SIZE];
+} PKCS7_CHAIN_CACHE;
+
+//
+// Operations of InternalAesAccelCrypt()
+//
+#define AES_ACCEL_ECB_ENCRYPT   0
+#define AES_ACCEL_ECB_DECRYPT   1
+#define AES_ACCEL_CBC_ENCRYPT   2
+#define AES_ACCEL_CBC_DECRYPT   3
+
+/**
+  Process whole 64-byte blocks with the CPU-accelerated SHA-1 transform.
+
+  @param[in, out]  State       The five 32-bit SHA-1 chaining values.
+  @param[in]       Data        Pointer to the message blocks.
+  @param[in]       BlockCount  Number of 64-byte blocks at Data.
+
+  @retval TRUE   The blocks were processed and State was updated.
+  @retval FALSE  No accelerated implementation is available; State is untouched.
+
+**/
+BOOLEAN
+InternalSha1AccelBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+/**
+  Process whole 64-byte blocks with the CPU-accelerated SHA-256 transform.
+
+  @param[in, out]  State       The eight 32-bit SHA-256 chaining values.
+  @param[in]       Data        Pointer to the message blocks.
+  @param[in]       BlockCount  Number of 64-byte blocks at Data.
+
+  @retval TRUE   The blocks were processed and State was updated.
+  @retval FALSE  No accelerated implementation is available; State is untouched.
+
+**/
+BOOLEAN
+InternalSha256AccelBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockCount
+  );
+
+/**
+  Check whether the CPU-accelerated AES transforms can be used.
+
+  @retval TRUE   InternalAesAccelCrypt() can be used.
+  @retval FALSE  No accelerated implementation is available.
+
+**/
+BOOLEAN
+InternalAesAccelSupported (
+  VOID
+  );
+
+/**
+  Encrypt or decrypt whole AES blocks with the CPU-accelerated transform.
+
+  Must only be called after InternalAesAccelSupported() returned TRUE.
+
+  @param[in]   Mode        One of the AES_ACCEL_xxx operations.
+  @param[in]   RoundKeys   Rounds + 1 round keys in FIPS-197 byte order. Decryption
+                           uses the equivalent inverse cipher key schedule.
+  @param[in]   Rounds      Number of AES rounds (10, 12 or 14).
+  @param[in]   Input       Pointer to the input blocks.
+  @param[in]   InputSize   Size of Input in bytes, a multiple of 16.
+  @param[in]   Ivec        Initialization vector for the CBC operations.
+  @param[out]  Output      Pointer to the output blocks. May be the same as Input.
+
+**/
+VOID
+InternalAesAccelCrypt (
+  IN  UINTN        Mode,
+  IN  CONST UINT8  *RoundKeys,
+  IN  UINTN        Rounds,
+  IN  CONST UINT8  *Input,
+  IN  UINTN        InputSize,
+  IN  CONST UINT8  *Ivec,
+  OUT UINT8        *Output
+  );
+
+/**
+  Verifies the validility of a PKCS#7 signed data like Pkcs7Verify(), remembering
+  verified certificate chains.
+
+  When the single signer certificate of P7Data was already chained to TrustedCert by
+  an earlier call with the same ChainCache, only the signature over InData is checked.
+  Otherwise the full verification is done and a successful chain is added to ChainCache.
+
+  @param[in]       P7Data       Pointer to the PKCS#7 message to verify.
+  @param[in]       P7Length     Length of the PKCS#7 message in bytes.
+  @param[in]       TrustedCert  Pointer to a trusted/root certificate encoded in DER, which
+                                is used for certificate chain verification.
+  @param[in]       CertLength   Length of the trusted certificate in bytes.
+  @param[in]       InData       Pointer to the content to be verified.
+  @param[in]       DataLength   Length of InData in bytes.
+  @param[in, out]  ChainCache   Verified chains to consult and update. NULL to always do
+                                the full verification.
+
+  @retval  TRUE  The specified PKCS#7 signed data is valid.
+  @retval  FALSE Invalid PKCS#7 signed data.
+
+**/
+BOOLEAN
+Pkcs7VerifyWithChainCache (
+  IN     CONST UINT8        *P7Data,
+  IN     UINTN              P7Length,
+  IN     CONST UINT8        *TrustedCert,
+  IN     UINTN              CertLength,
+  IN     CONST UINT8        *InData,
+  IN     UINTN              DataLength,
+  IN OUT PKCS7_CHAIN_CACHE  *ChainCache  OPTIONAL
+  );
+
 #endif
 
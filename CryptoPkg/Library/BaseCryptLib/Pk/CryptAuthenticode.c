@@ -9,7 +9,7 @@
   AuthenticodeVerify() will get PE/COFF Authenticode and will do basic check for
   data structure.
 
-Copyright (c) 2011 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2011 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -33,6 +33,12 @@ UINT8 mSpcIndirectOidValue[] = {
   0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x02, 0x01, 0x04
   };
 
+//
+// Signer certificates already chained to a trusted certificate during this boot.
+// Images signed by the same signer only need their own signature checked.
+//
+PKCS7_CHAIN_CACHE mAuthenticodeChainCache;
+
 /**
   Verifies the validility of a PE/COFF Authenticode Signature as described in "Windows
   Authenticode Portable Executable Signature Format".
@@ -185,7 +191,15 @@ AuthenticodeVerify (
   //
   // Verifies the PKCS#7 Signed Data in PE/COFF Authenticode Signature
   //
-  Status = (BOOLEAN) Pkcs7Verify (OrigAuthData, DataSize, TrustedCert, CertSize, SpcIndirectDataContent, ContentSize);
+  Status = Pkcs7VerifyWithChainCache (
+             OrigAuthData,
+             DataSize,
+             TrustedCert,
+             CertSize,
+             SpcIndirectDataContent,
+             ContentSize,
+             &mAuthenticodeChainCache
+             );
 
 _Exit:
   //
@@ -10,7 +10,7 @@
   WrapPkcs7Data(), Pkcs7GetSigners(), Pkcs7Verify() will get UEFI Authenticated
   Variable and will do basic check for data structure.
 
-Copyright (c) 2009 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -27,6 +27,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 #include <openssl/pkcs7.h>
+#include <openssl/sha.h>
 
 UINT8 mOidValue[9] = { 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02 };
 
@@ -509,38 +510,94 @@ Pkcs7FreeSigners (
 }
 
 /**
-  Verifies the validility of a PKCS#7 signed data as described in "PKCS #7:
-  Cryptographic Message Syntax Standard". The input signed data could be wrapped
-  in a ContentInfo structure.
+  Look up a verified signer/trust anchor pair in a certificate chain cache.
 
-  If P7Data, TrustedCert or InData is NULL, then return FALSE.
-  If P7Length, CertLength or DataLength overflow, then return FAlSE.
+  @param[in]  ChainCache   Verified certificate chains.
+  @param[in]  SignerHash   SHA-256 fingerprint of the signer certificate.
+  @param[in]  AnchorHash   SHA-256 fingerprint of the trusted certificate.
 
-  Caution: This function may receive untrusted input.
-  UEFI Authenticated Variable is external input, so this function will do basic
-  check for PKCS#7 data structure.
+  @retval     TRUE         The signer was already chained to the trusted certificate.
+  @retval     FALSE        The pair is not in the cache.
 
-  @param[in]  P7Data       Pointer to the PKCS#7 message to verify.
-  @param[in]  P7Length     Length of the PKCS#7 message in bytes.
-  @param[in]  TrustedCert  Pointer to a trusted/root certificate encoded in DER, which
-                           is used for certificate chain verification.
-  @param[in]  CertLength   Length of the trusted certificate in bytes.
-  @param[in]  InData       Pointer to the content to be verified.
-  @param[in]  DataLength   Length of InData in bytes.
+**/
+BOOLEAN
+Pkcs7ChainCacheFind (
+  IN CONST PKCS7_CHAIN_CACHE  *ChainCache,
+  IN CONST UINT8              *SignerHash,
+  IN CONST UINT8              *AnchorHash
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ChainCache->Count; Index++) {
+    if ((CompareMem (ChainCache->Entry[Index].SignerHash, SignerHash, SHA256_DIGEST_SIZE) == 0) &&
+        (CompareMem (ChainCache->Entry[Index].AnchorHash, AnchorHash, SHA256_DIGEST_SIZE) == 0)) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Record a verified signer/trust anchor pair in a certificate chain cache. Once the
+  cache is full, the oldest pair is replaced.
+
+  @param[in, out]  ChainCache   Verified certificate chains.
+  @param[in]       SignerHash   SHA-256 fingerprint of the signer certificate.
+  @param[in]       AnchorHash   SHA-256 fingerprint of the trusted certificate.
+
+**/
+VOID
+Pkcs7ChainCacheAdd (
+  IN OUT PKCS7_CHAIN_CACHE  *ChainCache,
+  IN     CONST UINT8        *SignerHash,
+  IN     CONST UINT8        *AnchorHash
+  )
+{
+  PKCS7_CHAIN_CACHE_ENTRY  *Entry;
+
+  Entry = &ChainCache->Entry[ChainCache->Next];
+  CopyMem (Entry->SignerHash, SignerHash, SHA256_DIGEST_SIZE);
+  CopyMem (Entry->AnchorHash, AnchorHash, SHA256_DIGEST_SIZE);
+
+  ChainCache->Next = (ChainCache->Next + 1) % PKCS7_CHAIN_CACHE_SIZE;
+  if (ChainCache->Count < PKCS7_CHAIN_CACHE_SIZE) {
+    ChainCache->Count++;
+  }
+}
+
+/**
+  Verifies the validility of a PKCS#7 signed data like Pkcs7Verify(), remembering
+  verified certificate chains.
+
+  When the single signer certificate of P7Data was already chained to TrustedCert by
+  an earlier call with the same ChainCache, only the signature over InData is checked.
+  Otherwise the full verification is done and a successful chain is added to ChainCache.
+
+  @param[in]       P7Data       Pointer to the PKCS#7 message to verify.
+  @param[in]       P7Length     Length of the PKCS#7 message in bytes.
+  @param[in]       TrustedCert  Pointer to a trusted/root certificate encoded in DER, which
+                                is used for certificate chain verification.
+  @param[in]       CertLength   Length of the trusted certificate in bytes.
+  @param[in]       InData       Pointer to the content to be verified.
+  @param[in]       DataLength   Length of InData in bytes.
+  @param[in, out]  ChainCache   Verified chains to consult and update. NULL to always do
+                                the full verification.
 
   @retval  TRUE  The specified PKCS#7 signed data is valid.
   @retval  FALSE Invalid PKCS#7 signed data.
 
 **/
 BOOLEAN
-EFIAPI
-Pkcs7Verify (
-  IN  CONST UINT8  *P7Data,
-  IN  UINTN        P7Length,
-  IN  CONST UINT8  *TrustedCert,
-  IN  UINTN        CertLength,
-  IN  CONST UINT8  *InData,
-  IN  UINTN        DataLength
+Pkcs7VerifyWithChainCache (
+  IN     CONST UINT8        *P7Data,
+  IN     UINTN              P7Length,
+  IN     CONST UINT8        *TrustedCert,
+  IN     UINTN              CertLength,
+  IN     CONST UINT8        *InData,
+  IN     UINTN              DataLength,
+  IN OUT PKCS7_CHAIN_CACHE  *ChainCache  OPTIONAL
   )
 {
   PKCS7       *Pkcs7;
@@ -552,6 +609,11 @@ Pkcs7Verify (
   CONST UINT8 *Temp;
   UINTN       SignedDataSize;
   BOOLEAN     Wrapped;
+  STACK_OF(X509)  *Signers;
+  UINT8       SignerHash[SHA256_DIGEST_SIZE];
+  UINT8       AnchorHash[SHA256_DIGEST_SIZE];
+  UINT32      HashLength;
+  BOOLEAN     ChainVerified;
 
   //
   // Check input parameters.
@@ -565,6 +627,9 @@ Pkcs7Verify (
   DataBio   = NULL;
   Cert      = NULL;
   CertStore = NULL;
+  Signers   = NULL;
+
+  ChainVerified = FALSE;
 
   //
   // Register & Initialize necessary digest algorithms for PKCS#7 Handling
@@ -615,6 +680,35 @@ Pkcs7Verify (
     goto _Exit;
   }
 
+  //
+  // Look the signer up in the verified chain cache. Authenticode signatures carry a
+  // single signer, so only that case is cached.
+  //
+  if (ChainCache != NULL) {
+    Signers = PKCS7_get0_signers (Pkcs7, NULL, 0);
+    if ((Signers != NULL) && (sk_X509_num (Signers) == 1) &&
+        X509_digest (sk_X509_value (Signers, 0), EVP_sha256 (), SignerHash, &HashLength) &&
+        (SHA256 (TrustedCert, CertLength, AnchorHash) != NULL)) {
+      ChainVerified = Pkcs7ChainCacheFind (ChainCache, SignerHash, AnchorHash);
+    } else {
+      ChainCache = NULL;
+    }
+  }
+
+  if (ChainVerified) {
+    //
+    // The signer certificate was already chained to TrustedCert, so only the
+    // signature over the content is left to check.
+    //
+    DataBio = BIO_new (BIO_s_mem ());
+    if ((DataBio == NULL) || (BIO_write (DataBio, InData, (int) DataLength) <= 0)) {
+      goto _Exit;
+    }
+
+    Status = (BOOLEAN) PKCS7_verify (Pkcs7, NULL, NULL, DataBio, NULL, PKCS7_BINARY | PKCS7_NOVERIFY);
+    goto _Exit;
+  }
+
   //
   // Read DER-encoded root certificate and Construct X509 Certificate
   //
@@ -665,11 +759,17 @@ Pkcs7Verify (
   // Verifies the PKCS#7 signedData structure
   //
   Status = (BOOLEAN) PKCS7_verify (Pkcs7, NULL, CertStore, DataBio, NULL, PKCS7_BINARY);
+  if (Status && (ChainCache != NULL)) {
+    Pkcs7ChainCacheAdd (ChainCache, SignerHash, AnchorHash);
+  }
 
 _Exit:
   //
   // Release Resources
   //
+  if (Signers != NULL) {
+    sk_X509_free (Signers);
+  }
   BIO_free (DataBio);
   X509_free (Cert);
   X509_STORE_free (CertStore);
@@ -682,6 +782,44 @@ _Exit:
   return Status;
 }
 
+/**
+  Verifies the validility of a PKCS#7 signed data as described in "PKCS #7:
+  Cryptographic Message Syntax Standard". The input signed data could be wrapped
+  in a ContentInfo structure.
+
+  If P7Data, TrustedCert or InData is NULL, then return FALSE.
+  If P7Length, CertLength or DataLength overflow, then return FAlSE.
+
+  Caution: This function may receive untrusted input.
+  UEFI Authenticated Variable is external input, so this function will do basic
+  check for PKCS#7 data structure.
+
+  @param[in]  P7Data       Pointer to the PKCS#7 message to verify.
+  @param[in]  P7Length     Length of the PKCS#7 message in bytes.
+  @param[in]  TrustedCert  Pointer to a trusted/root certificate encoded in DER, which
+                           is used for certificate chain verification.
+  @param[in]  CertLength   Length of the trusted certificate in bytes.
+  @param[in]  InData       Pointer to the content to be verified.
+  @param[in]  DataLength   Length of InData in bytes.
+
+  @retval  TRUE  The specified PKCS#7 signed data is valid.
+  @retval  FALSE Invalid PKCS#7 signed data.
+
+**/
+BOOLEAN
+EFIAPI
+Pkcs7Verify (
+  IN  CONST UINT8  *P7Data,
+  IN  UINTN        P7Length,
+  IN  CONST UINT8  *TrustedCert,
+  IN  UINTN        CertLength,
+  IN  CONST UINT8  *InData,
+  IN  UINTN        DataLength
+  )
+{
+  return Pkcs7VerifyWithChainCache (P7Data, P7Length, TrustedCert, CertLength, InData, DataLength, NULL);
+}
+
 /**
   Extracts the attached content from a PKCS#7 signed data if existed. The input signed
   data could be wrapped in a ContentInfo structure.
@@ -0,0 +1,146 @@
+/** @file
+  Measures how long the SMBIOS protocol takes to add and remove many records.
+
+  Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <PiDxe.h>
+#include <Protocol/Smbios.h>
+#include <IndustryStandard/SmBios.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+
+#define SMBIOS_BENCHMARK_RECORDS      10000
+#define SMBIOS_BENCHMARK_STRINGS_SIZE 32
+
+typedef struct {
+  SMBIOS_TABLE_TYPE17   Type17;
+  CHAR8                 Strings[SMBIOS_BENCHMARK_STRINGS_SIZE];
+} SMBIOS_BENCHMARK_RECORD;
+
+/**
+  Print the time taken by a number of SMBIOS protocol calls.
+
+  @param[in] Operation      The name of the operation.
+  @param[in] Count          The number of calls made.
+  @param[in] StartTicker    The performance counter before the first call.
+  @param[in] EndTicker      The performance counter after the last call.
+
+**/
+VOID
+PrintElapsedTime (
+  IN CONST CHAR16   *Operation,
+  IN UINTN          Count,
+  IN UINT64         StartTicker,
+  IN UINT64         EndTicker
+  )
+{
+  UINT64    StartValue;
+  UINT64    EndValue;
+  UINT64    Ticks;
+  UINT64    NanoSeconds;
+
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (EndValue >= StartValue) {
+    Ticks = EndTicker - StartTicker;
+  } else {
+    Ticks = StartTicker - EndTicker;
+  }
+  NanoSeconds = GetTimeInNanoSecond (Ticks);
+
+  Print (
+    L"%s %d records: %ld us, %ld ns per record\n",
+    Operation,
+    Count,
+    DivU64x32 (NanoSeconds, 1000),
+    (Count == 0) ? 0 : DivU64x32 (NanoSeconds, (UINT32) Count)
+    );
+}
+
+/**
+  Add SMBIOS_BENCHMARK_RECORDS type 17 records, remove them again, and print
+  the time taken by each step.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       All records were added and removed.
+  @retval other             The SMBIOS protocol is missing or a call failed.
+
+**/
+EFI_STATUS
+EFIAPI
+SmbiosBenchmarkMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                Status;
+  EFI_SMBIOS_PROTOCOL       *Smbios;
+  SMBIOS_BENCHMARK_RECORD   Record;
+  EFI_SMBIOS_HANDLE         *Handles;
+  UINTN                     Length;
+  UINTN                     Count;
+  UINTN                     Index;
+  UINT64                    StartTicker;
+
+  Status = gBS->LocateProtocol (&gEfiSmbiosProtocolGuid, NULL, (VOID **) &Smbios);
+  if (EFI_ERROR (Status)) {
+    Print (L"SMBIOS protocol not found - %r\n", Status);
+    return Status;
+  }
+
+  Handles = AllocatePool (SMBIOS_BENCHMARK_RECORDS * sizeof (EFI_SMBIOS_HANDLE));
+  if (Handles == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ZeroMem (&Record, sizeof (Record));
+  Record.Type17.Hdr.Type        = EFI_SMBIOS_TYPE_MEMORY_DEVICE;
+  Record.Type17.Hdr.Length      = (UINT8) sizeof (SMBIOS_TABLE_TYPE17);
+  Record.Type17.DeviceLocator   = 1;
+  Record.Type17.BankLocator     = 2;
+  Record.Type17.Size            = 0x2000;
+  Record.Type17.MemoryType      = MemoryTypeDdr4;
+
+  StartTicker = GetPerformanceCounter ();
+  for (Count = 0; Count < SMBIOS_BENCHMARK_RECORDS; Count++) {
+    //
+    // Two strings, each NULL terminated, and the terminating NULL.
+    //
+    Length = AsciiSPrint (Record.Strings, sizeof (Record.Strings), "DIMM_%05d", Count);
+    AsciiStrCpyS (&Record.Strings[Length + 1], sizeof (Record.Strings) - Length - 2, "BANK");
+    Record.Strings[Length + 1 + sizeof ("BANK")] = '\0';
+
+    Handles[Count] = SMBIOS_HANDLE_PI_RESERVED;
+    Status = Smbios->Add (Smbios, NULL, &Handles[Count], (EFI_SMBIOS_TABLE_HEADER *) &Record);
+    if (EFI_ERROR (Status)) {
+      Print (L"Add failed after %d records - %r\n", Count, Status);
+      break;
+    }
+  }
+  PrintElapsedTime (L"Added", Count, StartTicker, GetPerformanceCounter ());
+
+  StartTicker = GetPerformanceCounter ();
+  for (Index = 0; Index < Count; Index++) {
+    Smbios->Remove (Smbios, Handles[Index]);
+  }
+  PrintElapsedTime (L"Removed", Count, StartTicker, GetPerformanceCounter ());
+
+  FreePool (Handles);
+  return Status;
+}
@@ -1,7 +1,7 @@
 /** @file
   The file for AHCI mode of ATA host controller.
 
-  Copyright (c) 2010 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -1094,6 +1094,624 @@ Exit:
   return Status;
 }
 
+/**
+  Get the number of NCQ commands which can be outstanding on a device.
+
+  @param[in]  Instance          The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]  Port              The number of port.
+  @param[in]  PortMultiplier    The port multiplier port number.
+
+  @return The queue depth usable with the device, it's limited by the command
+          slots of the AHCI HBA. 0 means NCQ isn't supported.
+
+**/
+UINT8
+EFIAPI
+AhciGetNcqQueueDepth (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  UINT16                        Port,
+  IN  UINT16                        PortMultiplier
+  )
+{
+  LIST_ENTRY                    *Node;
+  EFI_ATA_DEVICE_INFO           *DeviceInfo;
+  EFI_IDENTIFY_DATA             *IdentifyData;
+  UINT16                        SataCapabilities;
+  UINT8                         QueueDepth;
+
+  if ((Instance->Mode != EfiAtaAhciMode) || (Instance->AhciRegisters.AhciNcqCommandTable == NULL)) {
+    return 0;
+  }
+
+  Node = SearchDeviceInfoList (Instance, Port, PortMultiplier, EfiIdeHarddisk);
+  if (Node == NULL) {
+    return 0;
+  }
+
+  DeviceInfo   = ATA_ATAPI_DEVICE_INFO_FROM_THIS (Node);
+  IdentifyData = DeviceInfo->IdentifyData;
+
+  //
+  // Word 76 bit 8 reports the NCQ support, word 75 bits 4:0 the queue depth minus one.
+  //
+  SataCapabilities = IdentifyData->AtaData.serial_ata_capabilities;
+  if ((SataCapabilities == 0) || (SataCapabilities == 0xFFFF) || ((SataCapabilities & BIT8) == 0)) {
+    return 0;
+  }
+
+  QueueDepth = (UINT8) ((IdentifyData->AtaData.queue_depth & 0x1F) + 1);
+
+  return MIN (QueueDepth, Instance->AhciRegisters.MaxCommandSlotNumber);
+}
+
+/**
+  Build the command list entry and the NCQ command table of a command slot.
+
+  @param[in]  AhciRegisters       The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]  PortMultiplier      The port multiplier port number.
+  @param[in]  CommandFis          The control fis will be used for the transfer.
+  @param[in]  CommandSlot         The command slot will be used for the transfer.
+  @param[in]  Read                The transfer direction.
+  @param[in]  DataPhysicalAddr    The data buffer pci bus master address.
+  @param[in]  DataLength          The data count to be transferred.
+
+**/
+VOID
+EFIAPI
+AhciBuildNcqCommand (
+  IN     EFI_AHCI_REGISTERS         *AhciRegisters,
+  IN     UINT8                      PortMultiplier,
+  IN     EFI_AHCI_COMMAND_FIS       *CommandFis,
+  IN     UINT8                      CommandSlot,
+  IN     BOOLEAN                    Read,
+  IN     EFI_PHYSICAL_ADDRESS       DataPhysicalAddr,
+  IN     UINT32                     DataLength
+  )
+{
+  EFI_AHCI_NCQ_COMMAND_TABLE  *CommandTable;
+  EFI_AHCI_COMMAND_LIST       *CommandList;
+  UINT32                      PrdtNumber;
+  UINT32                      PrdtIndex;
+  UINTN                       RemainedData;
+  UINT64                      MemAddr;
+  DATA_64                     Data64;
+
+  PrdtNumber = (UINT32)DivU64x32 (((UINT64)DataLength + EFI_AHCI_MAX_DATA_PER_PRDT - 1), EFI_AHCI_MAX_DATA_PER_PRDT);
+  ASSERT (PrdtNumber <= EFI_AHCI_NCQ_MAX_PRDT);
+
+  CommandTable = &AhciRegisters->AhciNcqCommandTable[CommandSlot];
+  ZeroMem (CommandTable, sizeof (EFI_AHCI_NCQ_COMMAND_TABLE));
+  CopyMem (&CommandTable->CommandFis, CommandFis, sizeof (EFI_AHCI_COMMAND_FIS));
+
+  RemainedData = (UINTN) DataLength;
+  MemAddr      = DataPhysicalAddr;
+  for (PrdtIndex = 0; PrdtIndex < PrdtNumber; PrdtIndex++) {
+    if (RemainedData < EFI_AHCI_MAX_DATA_PER_PRDT) {
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = (UINT32)RemainedData - 1;
+    } else {
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = EFI_AHCI_MAX_DATA_PER_PRDT - 1;
+    }
+
+    Data64.Uint64 = MemAddr;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDba  = Data64.Uint32.Lower32;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbau = Data64.Uint32.Upper32;
+    RemainedData -= EFI_AHCI_MAX_DATA_PER_PRDT;
+    MemAddr      += EFI_AHCI_MAX_DATA_PER_PRDT;
+  }
+
+  if (PrdtNumber > 0) {
+    CommandTable->PrdtTable[PrdtNumber - 1].AhciPrdtIoc = 1;
+  }
+
+  CommandList = &AhciRegisters->AhciCmdList[CommandSlot];
+  ZeroMem (CommandList, sizeof (EFI_AHCI_COMMAND_LIST));
+  CommandList->AhciCmdCfl   = EFI_AHCI_FIS_REGISTER_H2D_LENGTH / 4;
+  CommandList->AhciCmdW     = Read ? 0 : 1;
+  CommandList->AhciCmdPmp   = PortMultiplier;
+  CommandList->AhciCmdPrdtl = PrdtNumber;
+
+  Data64.Uint64 = (UINT64)(UINTN) &AhciRegisters->AhciNcqCommandTablePciAddr[CommandSlot];
+  CommandList->AhciCmdCtba  = Data64.Uint32.Lower32;
+  CommandList->AhciCmdCtbau = Data64.Uint32.Upper32;
+}
+
+/**
+  Issue a READ/WRITE FPDMA QUEUED command in a free command slot. The port is
+  started by the first NCQ command issued to it.
+
+  @param[in]       Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]       Port                The number of port.
+  @param[in]       PortMultiplier      The port multiplier port number.
+  @param[in]       Packet              The EFI_ATA_PASS_THRU_COMMAND_PACKET of the command.
+  @param[out]      CommandSlot         The command slot, which is also the tag, of the command.
+  @param[out]      Map                 The mapping of the data buffer.
+
+  @retval EFI_SUCCESS         The command is issued.
+  @retval EFI_NOT_READY       All the command slots usable by the device are in use.
+  @retval EFI_BAD_BUFFER_SIZE The data buffer can't be mapped.
+  @retval Others              The port can't be started.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqStartTransfer (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE     *Instance,
+  IN     UINT8                            Port,
+  IN     UINT8                            PortMultiplier,
+  IN     EFI_ATA_PASS_THRU_COMMAND_PACKET *Packet,
+  OUT    UINT8                            *CommandSlot,
+  OUT    VOID                             **Map
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_PCI_IO_PROTOCOL           *PciIo;
+  EFI_AHCI_REGISTERS            *AhciRegisters;
+  EFI_PCI_IO_PROTOCOL_OPERATION Flag;
+  EFI_PHYSICAL_ADDRESS          PhyAddr;
+  EFI_AHCI_COMMAND_FIS          CFis;
+  BOOLEAN                       Read;
+  VOID                          *MemoryAddr;
+  UINT32                        DataCount;
+  UINTN                         MapLength;
+  UINT8                         QueueDepth;
+  UINT8                         Slot;
+  UINT32                        SlotBit;
+  UINT32                        Offset;
+
+  PciIo         = Instance->PciIo;
+  AhciRegisters = &Instance->AhciRegisters;
+
+  //
+  // The tag of a NCQ command is its command slot, so only the slots below
+  // the device queue depth are usable.
+  //
+  QueueDepth = AhciGetNcqQueueDepth (Instance, Port, PortMultiplier);
+  for (Slot = 1; Slot < QueueDepth; Slot++) {
+    if ((AhciRegisters->NcqSlotMap & ((UINT32) 1 << Slot)) == 0) {
+      break;
+    }
+  }
+
+  if (Slot >= QueueDepth) {
+    return EFI_NOT_READY;
+  }
+
+  SlotBit = (UINT32) 1 << Slot;
+
+  Read = (BOOLEAN) (Packet->InDataBuffer != NULL);
+  if (Read) {
+    Flag       = EfiPciIoOperationBusMasterWrite;
+    MemoryAddr = Packet->InDataBuffer;
+    DataCount  = Packet->InTransferLength;
+  } else {
+    Flag       = EfiPciIoOperationBusMasterRead;
+    MemoryAddr = Packet->OutDataBuffer;
+    DataCount  = Packet->OutTransferLength;
+  }
+
+  MapLength = DataCount;
+  Status = PciIo->Map (
+                    PciIo,
+                    Flag,
+                    MemoryAddr,
+                    &MapLength,
+                    &PhyAddr,
+                    Map
+                    );
+
+  if (EFI_ERROR (Status) || (DataCount != MapLength)) {
+    if (!EFI_ERROR (Status)) {
+      PciIo->Unmap (PciIo, *Map);
+    }
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  //
+  // The tag goes to bits 7:3 of the sector count. Bit 7 of the device register
+  // is FUA for the queued commands, so it doesn't take the 0xE0 used by the
+  // other commands.
+  //
+  AhciBuildCommandFis (&CFis, Packet->Acb);
+  CFis.AhciCFisSecCount = (UINT8) (Slot << 3);
+  CFis.AhciCFisDevHead  = (UINT8) (Packet->Acb->AtaDeviceHead | BIT6);
+  CFis.AhciCFisPmNum    = PortMultiplier;
+
+  AhciBuildNcqCommand (
+    AhciRegisters,
+    PortMultiplier,
+    &CFis,
+    Slot,
+    Read,
+    PhyAddr,
+    DataCount
+    );
+
+  if (AhciRegisters->NcqPortSlotMap[Port] == 0) {
+    ZeroMem (
+      (VOID *) ((UINTN) AhciRegisters->AhciRFis + Port * sizeof (EFI_AHCI_RECEIVED_FIS)),
+      sizeof (EFI_AHCI_RECEIVED_FIS)
+      );
+
+    Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CMD;
+    AhciAndReg (PciIo, Offset, (UINT32)~(EFI_AHCI_PORT_CMD_DLAE | EFI_AHCI_PORT_CMD_ATAPI));
+
+    Status = AhciStartPort (PciIo, Port, ATA_ATAPI_TIMEOUT);
+    if (EFI_ERROR (Status)) {
+      PciIo->Unmap (PciIo, *Map);
+      return Status;
+    }
+  }
+
+  AhciRegisters->NcqSlotMap           |= SlotBit;
+  AhciRegisters->NcqPortSlotMap[Port] |= SlotBit;
+  *CommandSlot = Slot;
+
+  //
+  // PxSACT must be set before PxCI for a queued command.
+  //
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_SACT;
+  AhciWriteReg (PciIo, Offset, SlotBit);
+
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CI;
+  AhciWriteReg (PciIo, Offset, SlotBit);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Check whether a NCQ command has completed. The device clears the PxSACT bit
+  of the command with a Set Device Bits FIS.
+
+  @param[in]  Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]  Port                The number of port.
+  @param[in]  CommandSlot         The command slot of the command.
+
+  @retval EFI_SUCCESS         The command completed.
+  @retval EFI_NOT_READY       The command is still outstanding.
+  @retval EFI_DEVICE_ERROR    The port reported an error, all the NCQ commands
+                              outstanding on it are aborted. The caller recovers
+                              the port with AhciNcqRecoverPort().
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqCheckTransfer (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  UINT8                         Port,
+  IN  UINT8                         CommandSlot
+  )
+{
+  EFI_PCI_IO_PROTOCOL   *PciIo;
+  UINT32                Offset;
+  UINT32                PortIs;
+  UINT32                Outstanding;
+
+  PciIo = Instance->PciIo;
+
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_IS;
+  PortIs = AhciReadReg (PciIo, Offset);
+  if ((PortIs & (EFI_AHCI_PORT_IS_TFES | EFI_AHCI_PORT_IS_HBFS | EFI_AHCI_PORT_IS_HBDS | EFI_AHCI_PORT_IS_IFS)) != 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  //
+  // Acknowledge the completion interrupts. The error bits are left to
+  // AhciNcqRecoverPort().
+  //
+  PortIs &= EFI_AHCI_PORT_IS_SDBS | EFI_AHCI_PORT_IS_DPS | EFI_AHCI_PORT_IS_DHRS;
+  if (PortIs != 0) {
+    AhciWriteReg (PciIo, Offset, PortIs);
+  }
+
+  Offset      = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_SACT;
+  Outstanding = AhciReadReg (PciIo, Offset);
+  Offset      = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CI;
+  Outstanding |= AhciReadReg (PciIo, Offset);
+
+  if ((Outstanding & ((UINT32) 1 << CommandSlot)) != 0) {
+    return EFI_NOT_READY;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Release the command slot and the data buffer mapping of a NCQ command. The
+  port is stopped when its last NCQ command is released.
+
+  @param[in]  Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]  Port                The number of port.
+  @param[in]  CommandSlot         The command slot of the command.
+  @param[in]  Map                 The mapping of the data buffer.
+
+**/
+VOID
+EFIAPI
+AhciNcqFinishTransfer (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  UINT8                         Port,
+  IN  UINT8                         CommandSlot,
+  IN  VOID                          *Map
+  )
+{
+  EFI_PCI_IO_PROTOCOL   *PciIo;
+  EFI_AHCI_REGISTERS    *AhciRegisters;
+  UINT32                SlotBit;
+
+  PciIo         = Instance->PciIo;
+  AhciRegisters = &Instance->AhciRegisters;
+  SlotBit       = (UINT32) 1 << CommandSlot;
+
+  PciIo->Unmap (PciIo, Map);
+
+  AhciRegisters->NcqSlotMap           &= ~SlotBit;
+  AhciRegisters->NcqPortSlotMap[Port] &= ~SlotBit;
+
+  if (AhciRegisters->NcqPortSlotMap[Port] == 0) {
+    AhciStopCommand (PciIo, Port, ATA_ATAPI_TIMEOUT);
+    AhciDisableFisReceive (PciIo, Port, ATA_ATAPI_TIMEOUT);
+  }
+}
+
+/**
+  Abort the NCQ commands outstanding on a port and bring the port back to a
+  state where new commands can be issued.
+
+  The port is stopped first, which clears PxCI and PxSACT, so the HBA no longer
+  touches the command tables or the data buffers. The command slots and
+  mappings of the tasks started on the port are then released. Task is left in
+  NonBlockingTaskList for the caller to complete. Every other task started on
+  the port is completed with an error: its status block reports the error, its
+  event is signaled if IsSigEvent is TRUE, and it is removed from the list and
+  freed. A device that reported an error has aborted all its queued commands
+  and waits for the NCQ Command Error log to be read. Any other device may
+  still hold the commands, so the port is reset. PxSERR and PxIS are cleared
+  last.
+
+  @param[in]  Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]  Port                The number of port.
+  @param[in]  PortMultiplier      The port multiplier port number.
+  @param[in]  Task                Optional. The task completed by the caller.
+  @param[in]  IsSigEvent          TRUE to signal the events of the failed tasks.
+
+**/
+VOID
+EFIAPI
+AhciNcqRecoverPort (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  UINT8                         Port,
+  IN  UINT8                         PortMultiplier,
+  IN  ATA_NONBLOCK_TASK             *Task,
+  IN  BOOLEAN                       IsSigEvent
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_PCI_IO_PROTOCOL           *PciIo;
+  EFI_AHCI_REGISTERS            *AhciRegisters;
+  LIST_ENTRY                    *Entry;
+  LIST_ENTRY                    *Next;
+  ATA_NONBLOCK_TASK             *Failed;
+  EFI_ATA_COMMAND_BLOCK         AtaCommandBlock;
+  EFI_ATA_STATUS_BLOCK          AtaStatusBlock;
+  UINT8                         ErrorLog[ATA_LOG_PAGE_SIZE];
+  UINT32                        Offset;
+  UINT32                        PortIs;
+  UINT32                        PortTfd;
+
+  PciIo         = Instance->PciIo;
+  AhciRegisters = &Instance->AhciRegisters;
+
+  AhciStopCommand (PciIo, Port, ATA_ATAPI_TIMEOUT);
+
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_IS;
+  PortIs = AhciReadReg (PciIo, Offset);
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_TFD;
+  PortTfd = AhciReadReg (PciIo, Offset);
+
+  //
+  // Fail every NCQ task outstanding on the port, now that the HBA is stopped.
+  //
+  for (Entry = GetFirstNode (&Instance->NonBlockingTaskList);
+       !IsNull (&Instance->NonBlockingTaskList, Entry);
+       Entry = Next) {
+    Next   = GetNextNode (&Instance->NonBlockingTaskList, Entry);
+    Failed = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
+    if (!Failed->IsNcq || !Failed->IsStart || (Failed->Port != Port)) {
+      continue;
+    }
+
+    AhciNcqFinishTransfer (Instance, Port, Failed->NcqSlot, Failed->Map);
+    Failed->IsStart = FALSE;
+    if (Failed == Task) {
+      continue;
+    }
+
+    RemoveEntryList (Entry);
+    if (IsSigEvent) {
+      Failed->Packet->Asb->AtaStatus = 0x01;
+      gBS->SignalEvent (Failed->Event);
+    }
+    FreePool (Failed);
+  }
+
+  Status = EFI_DEVICE_ERROR;
+  if (((PortIs & EFI_AHCI_PORT_IS_TFES) != 0) &&
+      ((PortTfd & (EFI_AHCI_PORT_TFD_BSY | EFI_AHCI_PORT_TFD_DRQ)) == 0)) {
+    ZeroMem (&AtaCommandBlock, sizeof (EFI_ATA_COMMAND_BLOCK));
+    ZeroMem (&AtaStatusBlock, sizeof (EFI_ATA_STATUS_BLOCK));
+
+    AtaCommandBlock.AtaCommand      = ATA_CMD_READ_LOG_EXT;
+    AtaCommandBlock.AtaSectorNumber = ATA_LOG_NCQ_COMMAND_ERROR;
+    AtaCommandBlock.AtaSectorCount  = 1;
+
+    Status = AhciPioTransfer (
+               PciIo,
+               AhciRegisters,
+               Port,
+               PortMultiplier,
+               NULL,
+               0,
+               TRUE,
+               &AtaCommandBlock,
+               &AtaStatusBlock,
+               ErrorLog,
+               sizeof (ErrorLog),
+               ATA_ATAPI_TIMEOUT,
+               NULL
+               );
+    if (!EFI_ERROR (Status) && ((ErrorLog[0] & ATA_LOG_NCQ_COMMAND_ERROR_NQ) == 0)) {
+      DEBUG ((
+        EFI_D_ERROR,
+        "AhciNcqRecoverPort: port %d NCQ command tag %d failed, Status = %x, Error = %x\n",
+        Port,
+        ErrorLog[0] & ATA_LOG_NCQ_COMMAND_ERROR_TAG_MASK,
+        ErrorLog[2],
+        ErrorLog[3]
+        ));
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    //
+    // The device didn't report the error, or its log can't be read, so its
+    // queue is in an unknown state.
+    //
+    DEBUG ((EFI_D_ERROR, "AhciNcqRecoverPort: reset port %d\n", Port));
+    AhciPortReset (PciIo, Port, ATA_ATAPI_TIMEOUT);
+  }
+
+  AhciClearPortStatus (PciIo, Port);
+}
+
+/**
+  Start a NCQ data transfer on specific port. In non-blocking mode, the commands
+  of several tasks are outstanding at the same time, each in its own command slot.
+
+  @param[in]       Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]       Port                The number of port.
+  @param[in]       PortMultiplier      The port multiplier port number.
+  @param[in, out]  Packet              The EFI_ATA_PASS_THRU_COMMAND_PACKET of the
+                                       READ/WRITE FPDMA QUEUED command.
+  @param[in]       Task                Optional. Pointer to the ATA_NONBLOCK_TASK
+                                       used by non-blocking mode.
+
+  @retval EFI_DEVICE_ERROR    The NCQ data transfer abort with error occurs.
+  @retval EFI_TIMEOUT         The operation is time out.
+  @retval EFI_NOT_READY       In non-blocking mode, the command is outstanding or
+                              waits for a free command slot.
+  @retval EFI_BAD_BUFFER_SIZE The data buffer can't be mapped.
+  @retval EFI_SUCCESS         The NCQ data transfer executes successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqTransfer (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE     *Instance,
+  IN     UINT8                            Port,
+  IN     UINT8                            PortMultiplier,
+  IN OUT EFI_ATA_PASS_THRU_COMMAND_PACKET *Packet,
+  IN     ATA_NONBLOCK_TASK                *Task
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_TPL                       OldTpl;
+  UINT8                         Slot;
+  VOID                          *Map;
+  UINT64                        Delay;
+  BOOLEAN                       InfiniteWait;
+
+  if (Task == NULL) {
+    //
+    // Before starting the Blocking BlockIO operation, push to finish all non-blocking
+    // BlockIO tasks, the command then has all the command slots to itself.
+    //
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    while (!IsListEmpty (&Instance->NonBlockingTaskList)) {
+      AsyncNonBlockingTransferRoutine (NULL, Instance);
+      //
+      // Stall for 100us.
+      //
+      MicroSecondDelay (100);
+    }
+    gBS->RestoreTPL (OldTpl);
+
+    Status = AhciNcqStartTransfer (Instance, Port, PortMultiplier, Packet, &Slot, &Map);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    InfiniteWait = (BOOLEAN) (Packet->Timeout == 0);
+    Delay        = DivU64x32 (Packet->Timeout, 1000) + 1;
+    do {
+      Status = AhciNcqCheckTransfer (Instance, Port, Slot);
+      if (Status != EFI_NOT_READY) {
+        break;
+      }
+      //
+      // Stall for 100 microseconds.
+      //
+      MicroSecondDelay (100);
+
+      Delay--;
+    } while (InfiniteWait || (Delay > 0));
+
+    if (Status == EFI_NOT_READY) {
+      Status = EFI_TIMEOUT;
+    }
+  } else {
+    if (!Task->IsStart) {
+      Status = AhciNcqStartTransfer (Instance, Port, PortMultiplier, Packet, &Task->NcqSlot, &Task->Map);
+      if (Status == EFI_NOT_READY) {
+        //
+        // Wait for a free command slot.
+        //
+        return Status;
+      }
+      if (EFI_ERROR (Status)) {
+        Packet->Asb->AtaStatus = 0x01;
+        return Status;
+      }
+      Task->IsStart = TRUE;
+    }
+
+    Task->RetryTimes--;
+    Status = AhciNcqCheckTransfer (Instance, Port, Task->NcqSlot);
+    if ((Status == EFI_NOT_READY) && !Task->InfiniteWait && (Task->RetryTimes == 0)) {
+      Status = EFI_TIMEOUT;
+    }
+    if (Status == EFI_NOT_READY) {
+      return Status;
+    }
+
+    Slot          = Task->NcqSlot;
+    Map           = Task->Map;
+  }
+
+  AhciDumpPortStatus (Instance->PciIo, Port, Packet->Asb);
+
+  if (EFI_ERROR (Status)) {
+    //
+    // The other commands on the port are aborted too. The port is stopped
+    // before any command slot or data buffer is released.
+    //
+    AhciNcqRecoverPort (Instance, Port, PortMultiplier, Task, TRUE);
+    if (Task == NULL) {
+      AhciNcqFinishTransfer (Instance, Port, Slot, Map);
+    }
+    if (Packet->Asb != NULL) {
+      Packet->Asb->AtaStatus |= 0x01;
+    }
+    return Status;
+  }
+
+  AhciNcqFinishTransfer (Instance, Port, Slot, Map);
+  if (Task != NULL) {
+    Task->IsStart = FALSE;
+  }
+
+  return Status;
+}
+
 /**
   Start a non data transfer on specific port.
 
@@ -1255,28 +1873,24 @@ AhciStopCommand (
 }
 
 /**
-  Start command for give slot on specific port.
+  Start the command list processing on specific port, no command is issued.
 
   @param  PciIo              The PCI IO protocol instance.
   @param  Port               The number of port.
-  @param  CommandSlot        The number of Command Slot.
   @param  Timeout            The timeout value of start, uses 100ns as a unit.
 
-  @retval EFI_DEVICE_ERROR   The command start unsuccessfully.
   @retval EFI_TIMEOUT        The operation is time out.
-  @retval EFI_SUCCESS        The command start successfully.
+  @retval EFI_SUCCESS        The command list processing is started.
 
 **/
 EFI_STATUS
 EFIAPI
-AhciStartCommand (
+AhciStartPort (
   IN  EFI_PCI_IO_PROTOCOL       *PciIo,
   IN  UINT8                     Port,
-  IN  UINT8                     CommandSlot,
   IN  UINT64                    Timeout
   )
 {
-  UINT32     CmdSlotBit;
   EFI_STATUS Status;
   UINT32     PortStatus;
   UINT32     StartCmd;
@@ -1289,8 +1903,6 @@ AhciStartCommand (
   //
   Capability = AhciReadReg(PciIo, EFI_AHCI_CAPABILITY_OFFSET);
 
-  CmdSlotBit = (UINT32) (1 << CommandSlot);
-
   AhciClearPortStatus (
     PciIo,
     Port
@@ -1337,6 +1949,42 @@ AhciStartCommand (
   Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CMD;
   AhciOrReg (PciIo, Offset, EFI_AHCI_PORT_CMD_ST | StartCmd);
 
+  return EFI_SUCCESS;
+}
+
+/**
+  Start command for give slot on specific port.
+
+  @param  PciIo              The PCI IO protocol instance.
+  @param  Port               The number of port.
+  @param  CommandSlot        The number of Command Slot.
+  @param  Timeout            The timeout value of start, uses 100ns as a unit.
+
+  @retval EFI_DEVICE_ERROR   The command start unsuccessfully.
+  @retval EFI_TIMEOUT        The operation is time out.
+  @retval EFI_SUCCESS        The command start successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciStartCommand (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  UINT8                     Port,
+  IN  UINT8                     CommandSlot,
+  IN  UINT64                    Timeout
+  )
+{
+  UINT32     CmdSlotBit;
+  EFI_STATUS Status;
+  UINT32     Offset;
+
+  CmdSlotBit = (UINT32) (1 << CommandSlot);
+
+  Status = AhciStartPort (PciIo, Port, Timeout);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   //
   // Setting the command
   //
@@ -1957,6 +2605,82 @@ AhciPacketCommandExecute (
   return Status;
 }
 
+/**
+  Allocate the command tables used by the NCQ commands, one for each command slot.
+
+  @param  PciIo                 The PCI IO protocol instance.
+  @param  AhciRegisters         The pointer to the EFI_AHCI_REGISTERS.
+  @param  Support64Bit          Whether the AHCI HBA supports 64bit addressing.
+
+  @retval EFI_SUCCESS           The NCQ command tables are allocated.
+  @retval EFI_OUT_OF_RESOURCES  The NCQ command tables can't be allocated.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciCreateNcqCommandTable (
+  IN     EFI_PCI_IO_PROTOCOL    *PciIo,
+  IN OUT EFI_AHCI_REGISTERS     *AhciRegisters,
+  IN     BOOLEAN                Support64Bit
+  )
+{
+  EFI_STATUS            Status;
+  UINTN                 Bytes;
+  VOID                  *Buffer;
+  UINT64                MaxNcqCommandTableSize;
+  EFI_PHYSICAL_ADDRESS  AhciNcqCommandTablePciAddr;
+
+  Buffer = NULL;
+  MaxNcqCommandTableSize = AhciRegisters->MaxCommandSlotNumber * sizeof (EFI_AHCI_NCQ_COMMAND_TABLE);
+
+  Status = PciIo->AllocateBuffer (
+                    PciIo,
+                    AllocateAnyPages,
+                    EfiBootServicesData,
+                    EFI_SIZE_TO_PAGES ((UINTN) MaxNcqCommandTableSize),
+                    &Buffer,
+                    0
+                    );
+
+  if (EFI_ERROR (Status)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ZeroMem (Buffer, (UINTN)MaxNcqCommandTableSize);
+
+  Bytes  = (UINTN)MaxNcqCommandTableSize;
+  Status = PciIo->Map (
+                    PciIo,
+                    EfiPciIoOperationBusMasterCommonBuffer,
+                    Buffer,
+                    &Bytes,
+                    &AhciNcqCommandTablePciAddr,
+                    &AhciRegisters->MapNcqCommandTable
+                    );
+
+  if (EFI_ERROR (Status) || (Bytes != MaxNcqCommandTableSize) ||
+      ((!Support64Bit) && (AhciNcqCommandTablePciAddr > 0x100000000ULL))) {
+    if (!EFI_ERROR (Status)) {
+      PciIo->Unmap (
+               PciIo,
+               AhciRegisters->MapNcqCommandTable
+               );
+    }
+    PciIo->FreeBuffer (
+             PciIo,
+             EFI_SIZE_TO_PAGES ((UINTN) MaxNcqCommandTableSize),
+             Buffer
+             );
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  AhciRegisters->AhciNcqCommandTable        = Buffer;
+  AhciRegisters->AhciNcqCommandTablePciAddr = (EFI_AHCI_NCQ_COMMAND_TABLE *)(UINTN)AhciNcqCommandTablePciAddr;
+  AhciRegisters->MaxNcqCommandTableSize     = MaxNcqCommandTableSize;
+
+  return EFI_SUCCESS;
+}
+
 /**
   Allocate transfer-related data struct which is used at AHCI mode.
 
@@ -2163,6 +2887,14 @@ AhciCreateTransferDescriptor (
     goto Error1;
   }
   AhciRegisters->AhciCommandTablePciAddr = (EFI_AHCI_COMMAND_TABLE *)(UINTN)AhciCommandTablePciAddr;
+  AhciRegisters->MaxCommandSlotNumber    = MaxCommandSlotNumber;
+
+  //
+  // NCQ is optional, the HBA is still usable without the NCQ command tables.
+  //
+  if (((Capability & EFI_AHCI_CAP_SNCQ) != 0) && (MaxCommandSlotNumber > 1)) {
+    AhciCreateNcqCommandTable (PciIo, AhciRegisters, Support64Bit);
+  }
 
   return EFI_SUCCESS;
   //
@@ -1,7 +1,7 @@
 /** @file
   Header file for AHCI mode of ATA host controller.
   
-  Copyright (c) 2010 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials                          
   are licensed and made available under the terms and conditions of the BSD License         
   which accompanies this distribution.  The full text of the license may be found at        
@@ -19,6 +19,7 @@
 #define EFI_AHCI_CAPABILITY_OFFSET             0x0000
 #define   EFI_AHCI_CAP_SAM                     BIT18
 #define   EFI_AHCI_CAP_SSS                     BIT27
+#define   EFI_AHCI_CAP_SNCQ                    BIT30
 #define   EFI_AHCI_CAP_S64A                    BIT31
 #define EFI_AHCI_GHC_OFFSET                    0x0004
 #define   EFI_AHCI_GHC_RESET                   BIT0
@@ -62,6 +63,22 @@ typedef union {
 //
 #define EFI_AHCI_MAX_DATA_PER_PRDT             0x400000
 
+//
+// The PRDT entries in each NCQ command table. It covers the largest NCQ transfer,
+// 65536 sectors of 4KB, as the data buffer is mapped contiguously.
+//
+#define EFI_AHCI_NCQ_MAX_PRDT                  64
+
+//
+// READ LOG EXT of the NCQ Command Error log, which ends the error state of a
+// device that aborted its queued commands.
+//
+#define ATA_CMD_READ_LOG_EXT                   0x2F
+#define ATA_LOG_NCQ_COMMAND_ERROR              0x10
+#define   ATA_LOG_NCQ_COMMAND_ERROR_NQ         BIT7
+#define   ATA_LOG_NCQ_COMMAND_ERROR_TAG_MASK   0x1F
+#define ATA_LOG_PAGE_SIZE                      512
+
 #define EFI_AHCI_FIS_REGISTER_H2D              0x27      //Register FIS - Host to Device
 #define   EFI_AHCI_FIS_REGISTER_H2D_LENGTH     20 
 #define EFI_AHCI_FIS_REGISTER_D2H              0x34      //Register FIS - Device to Host
@@ -267,6 +284,16 @@ typedef struct {
   EFI_AHCI_COMMAND_PRDT     PrdtTable[65535];     // The scatter/gather list for data transfer
 } EFI_AHCI_COMMAND_TABLE;
 
+//
+// Command table used by the NCQ commands, one for each command slot.
+//
+typedef struct {
+  EFI_AHCI_COMMAND_FIS      CommandFis;       // A software constructed FIS.
+  EFI_AHCI_ATAPI_COMMAND    AtapiCmd;         // 12 or 16 bytes ATAPI cmd.
+  UINT8                     Reserved[0x30];
+  EFI_AHCI_COMMAND_PRDT     PrdtTable[EFI_AHCI_NCQ_MAX_PRDT];
+} EFI_AHCI_NCQ_COMMAND_TABLE;
+
 //
 // Received FIS structure
 //
@@ -297,6 +324,17 @@ typedef struct {
   VOID                      *MapRFis;
   VOID                      *MapCmdList;
   VOID                      *MapCommandTable;
+  //
+  // For NCQ. The command list is shared by all ports, so a command slot is owned
+  // by one port at a time. Slot 0 is kept for the non-queued commands.
+  //
+  EFI_AHCI_NCQ_COMMAND_TABLE *AhciNcqCommandTable;
+  EFI_AHCI_NCQ_COMMAND_TABLE *AhciNcqCommandTablePciAddr;
+  UINT64                    MaxNcqCommandTableSize;
+  VOID                      *MapNcqCommandTable;
+  UINT8                     MaxCommandSlotNumber;
+  UINT32                    NcqSlotMap;
+  UINT32                    NcqPortSlotMap[EFI_AHCI_MAX_PORTS];
 } EFI_AHCI_REGISTERS;
 
 /**
@@ -346,6 +384,25 @@ AhciStartCommand (
   IN  UINT64                    Timeout
   );
 
+/**
+  Start the command list processing on specific port, no command is issued.
+
+  @param  PciIo              The PCI IO protocol instance.
+  @param  Port               The number of port.
+  @param  Timeout            The timeout value of start, uses 100ns as a unit.
+
+  @retval EFI_TIMEOUT        The operation is time out.
+  @retval EFI_SUCCESS        The command list processing is started.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciStartPort (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  UINT8                     Port,
+  IN  UINT64                    Timeout
+  );
+
 /**
   Stop command running for giving port
     
@@ -366,5 +423,25 @@ AhciStopCommand (
   IN  UINT64                    Timeout
   );
 
+/**
+  Do AHCI port reset.
+
+  @param  PciIo              The PCI IO protocol instance.
+  @param  Port               The number of port.
+  @param  Timeout            The timeout value of reset, uses 100ns as a unit.
+
+  @retval EFI_DEVICE_ERROR   The port reset unsuccessfully
+  @retval EFI_TIMEOUT        The reset operation is time out.
+  @retval EFI_SUCCESS        The port reset successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciPortReset (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  UINT8                     Port,
+  IN  UINT64                    Timeout
+  );
+
 #endif
 
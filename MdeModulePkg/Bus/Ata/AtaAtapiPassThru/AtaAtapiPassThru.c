@@ -2,7 +2,7 @@
   This file implements ATA_PASSTHRU_PROCTOCOL and EXT_SCSI_PASSTHRU_PROTOCOL interfaces
   for managed ATA controllers.
 
-  Copyright (c) 2010 - 2015, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -355,6 +355,15 @@ AtaPassThruPassThruExecute (
                      Task
                      );
           break;
+        case EFI_ATA_PASS_THRU_PROTOCOL_FPDMA:
+          Status = AhciNcqTransfer (
+                     Instance,
+                     (UINT8)Port,
+                     (UINT8)PortMultiplierPort,
+                     Packet,
+                     Task
+                     );
+          break;
         default :
           return EFI_UNSUPPORTED;
       }
@@ -394,13 +403,14 @@ AsyncNonBlockingTransferRoutine (
   //
   // Get the Taks from the Taks List and execute it, until there is
   // no task in the list or the device is busy with task (EFI_NOT_READY).
+  // NCQ tasks run side by side, each in its own command slot. Any other
+  // task waits for the tasks ahead of it and holds back the ones behind it.
   //
-  while (TRUE) {
-    if (!IsListEmpty (EntryHeader)) {
-      Entry = GetFirstNode (EntryHeader);
-      Task  = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
-    } else {
-      return;
+  Entry = GetFirstNode (EntryHeader);
+  while (!IsNull (EntryHeader, Entry)) {
+    Task = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
+    if (!Task->IsNcq && (Entry != GetFirstNode (EntryHeader))) {
+      break;
     }
 
     Status = AtaPassThruPassThruExecute (
@@ -422,12 +432,16 @@ AsyncNonBlockingTransferRoutine (
 
     //
     // For Non blocking mode, the Status of EFI_NOT_READY means the operation
-    // is not finished yet. Otherwise the operation is successful.
+    // is not finished yet. Otherwise the operation is successful. A NCQ task
+    // which isn't started is waiting for a free command slot.
     //
     if (Status == EFI_NOT_READY) {
-      break;
+      if (!Task->IsNcq || !Task->IsStart) {
+        break;
+      }
+      Entry = GetNextNode (EntryHeader, Entry);
     } else {
-      RemoveEntryList (&Task->Link);
+      Entry = RemoveEntryList (&Task->Link);
       gBS->SignalEvent (Task->Event);
       FreePool (Task);
     }
@@ -912,6 +926,17 @@ AtaAtapiPassThruStop (
 
   if (Instance->Mode == EfiAtaAhciMode) {
     AhciRegisters = &Instance->AhciRegisters;
+    if (AhciRegisters->AhciNcqCommandTable != NULL) {
+      PciIo->Unmap (
+               PciIo,
+               AhciRegisters->MapNcqCommandTable
+               );
+      PciIo->FreeBuffer (
+               PciIo,
+               EFI_SIZE_TO_PAGES ((UINTN) AhciRegisters->MaxNcqCommandTableSize),
+               AhciRegisters->AhciNcqCommandTable
+               );
+    }
     PciIo->Unmap (
              PciIo,
              AhciRegisters->MapCommandTable
@@ -1112,29 +1137,31 @@ DestroyAsynTaskList (
   )
 {
   LIST_ENTRY           *Entry;
-  LIST_ENTRY           *DelEntry;
   ATA_NONBLOCK_TASK    *Task;
   EFI_TPL              OldTpl;
 
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
-  if (!IsListEmpty (&Instance->NonBlockingTaskList)) {
+  //
+  // Free the Subtask list.
+  //
+  while (!IsListEmpty (&Instance->NonBlockingTaskList)) {
+    Entry = GetFirstNode (&Instance->NonBlockingTaskList);
+    Task  = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
+
     //
-    // Free the Subtask list.
+    // Abort the NCQ commands of the port before their buffers are released.
+    // The recovery also completes and frees the other tasks started on the
+    // port, so the list is walked again from its head.
     //
-    for (Entry = (&Instance->NonBlockingTaskList)->ForwardLink;
-        Entry != (&Instance->NonBlockingTaskList);
-       ) {
-      DelEntry = Entry;
-      Entry    = Entry->ForwardLink;
-      Task     = ATA_NON_BLOCK_TASK_FROM_ENTRY (DelEntry);
-
-      RemoveEntryList (DelEntry);
-      if (IsSigEvent) {
-        Task->Packet->Asb->AtaStatus = 0x01;
-        gBS->SignalEvent (Task->Event);
-      }
-      FreePool (Task);
+    if (Task->IsNcq && Task->IsStart) {
+      AhciNcqRecoverPort (Instance, (UINT8) Task->Port, (UINT8) Task->PortMultiplier, Task, IsSigEvent);
     }
+    RemoveEntryList (Entry);
+    if (IsSigEvent) {
+      Task->Packet->Asb->AtaStatus = 0x01;
+      gBS->SignalEvent (Task->Event);
+    }
+    FreePool (Task);
   }
   gBS->RestoreTPL (OldTpl);
 }
@@ -1335,6 +1362,18 @@ AtaPassThruPassThru (
     return EFI_BAD_BUFFER_SIZE;
   }
 
+  //
+  // The READ/WRITE FPDMA QUEUED commands need NCQ support from both the AHCI
+  // HBA and the device, and their data buffer must fit in a NCQ command table.
+  //
+  if (Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA) {
+    if ((AhciGetNcqQueueDepth (Instance, Port, PortMultiplierPort) < 2) ||
+        (Packet->InTransferLength > EFI_AHCI_NCQ_MAX_PRDT * EFI_AHCI_MAX_DATA_PER_PRDT) ||
+        (Packet->OutTransferLength > EFI_AHCI_NCQ_MAX_PRDT * EFI_AHCI_MAX_DATA_PER_PRDT)) {
+      return EFI_UNSUPPORTED;
+    }
+  }
+
   //
   // For non-blocking mode, queue the Task into the list.
   //
@@ -1350,6 +1389,7 @@ AtaPassThruPassThru (
     Task->Packet         = Packet;
     Task->Event          = Event;
     Task->IsStart        = FALSE;
+    Task->IsNcq          = (BOOLEAN) (Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA);
     Task->RetryTimes     = DivU64x32(Packet->Timeout, 1000) + 1;
     if (Packet->Timeout == 0) {
       Task->InfiniteWait = TRUE;
@@ -1363,6 +1403,19 @@ AtaPassThruPassThru (
 
     return EFI_SUCCESS;
   } else {
+    //
+    // A non-queued command can't be issued while NCQ commands are outstanding.
+    //
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    while ((Instance->Mode == EfiAtaAhciMode) && (Instance->AhciRegisters.NcqSlotMap != 0)) {
+      AsyncNonBlockingTransferRoutine (NULL, Instance);
+      //
+      // Stall for 100us.
+      //
+      MicroSecondDelay (100);
+    }
+    gBS->RestoreTPL (OldTpl);
+
     return AtaPassThruPassThruExecute (
              Port,
              PortMultiplierPort,
@@ -1,7 +1,7 @@
 /** @file
   Header file for ATA/ATAPI PASS THRU driver.
 
-  Copyright (c) 2010 - 2012, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -140,6 +140,8 @@ struct _ATA_NONBLOCK_TASK {
   VOID                              *TableMap;       // Pointer to PRD table map.
   EFI_ATA_DMA_PRD                   *MapBaseAddress; //  Pointer to range Base address for Map.
   UINTN                             PageCount;       //  The page numbers used by PCIO freebuffer.
+  BOOLEAN                           IsNcq;           //  READ/WRITE FPDMA QUEUED command.
+  UINT8                             NcqSlot;         //  Command slot of the NCQ command when started.
 };
 
 //
@@ -1150,6 +1152,106 @@ AhciDmaTransfer (
   IN     ATA_NONBLOCK_TASK            *Task
   );
 
+/**
+  Get the number of NCQ commands which can be outstanding on a device.
+
+  @param[in]  Instance          The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]  Port              The number of port.
+  @param[in]  PortMultiplier    The port multiplier port number.
+
+  @return The queue depth usable with the device, it's limited by the command
+          slots of the AHCI HBA. 0 means NCQ isn't supported.
+
+**/
+UINT8
+EFIAPI
+AhciGetNcqQueueDepth (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  UINT16                        Port,
+  IN  UINT16                        PortMultiplier
+  );
+
+/**
+  Release the command slot and the data buffer mapping of a NCQ command. The
+  port is stopped when its last NCQ command is released.
+
+  @param[in]  Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]  Port                The number of port.
+  @param[in]  CommandSlot         The command slot of the command.
+  @param[in]  Map                 The mapping of the data buffer.
+
+**/
+VOID
+EFIAPI
+AhciNcqFinishTransfer (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  UINT8                         Port,
+  IN  UINT8                         CommandSlot,
+  IN  VOID                          *Map
+  );
+
+/**
+  Abort the NCQ commands outstanding on a port and bring the port back to a
+  state where new commands can be issued.
+
+  The port is stopped first, which clears PxCI and PxSACT, so the HBA no longer
+  touches the command tables or the data buffers. The command slots and
+  mappings of the tasks started on the port are then released. Task is left in
+  NonBlockingTaskList for the caller to complete. Every other task started on
+  the port is completed with an error: its status block reports the error, its
+  event is signaled if IsSigEvent is TRUE, and it is removed from the list and
+  freed. A device that reported an error has aborted all its queued commands
+  and waits for the NCQ Command Error log to be read. Any other device may
+  still hold the commands, so the port is reset. PxSERR and PxIS are cleared
+  last.
+
+  @param[in]  Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]  Port                The number of port.
+  @param[in]  PortMultiplier      The port multiplier port number.
+  @param[in]  Task                Optional. The task completed by the caller.
+  @param[in]  IsSigEvent          TRUE to signal the events of the failed tasks.
+
+**/
+VOID
+EFIAPI
+AhciNcqRecoverPort (
+  IN  ATA_ATAPI_PASS_THRU_INSTANCE  *Instance,
+  IN  UINT8                         Port,
+  IN  UINT8                         PortMultiplier,
+  IN  ATA_NONBLOCK_TASK             *Task,
+  IN  BOOLEAN                       IsSigEvent
+  );
+
+/**
+  Start a NCQ data transfer on specific port. In non-blocking mode, the commands
+  of several tasks are outstanding at the same time, each in its own command slot.
+
+  @param[in]       Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]       Port                The number of port.
+  @param[in]       PortMultiplier      The port multiplier port number.
+  @param[in, out]  Packet              The EFI_ATA_PASS_THRU_COMMAND_PACKET of the
+                                       READ/WRITE FPDMA QUEUED command.
+  @param[in]       Task                Optional. Pointer to the ATA_NONBLOCK_TASK
+                                       used by non-blocking mode.
+
+  @retval EFI_DEVICE_ERROR    The NCQ data transfer abort with error occurs.
+  @retval EFI_TIMEOUT         The operation is time out.
+  @retval EFI_NOT_READY       In non-blocking mode, the command is outstanding or
+                              waits for a free command slot.
+  @retval EFI_BAD_BUFFER_SIZE The data buffer can't be mapped.
+  @retval EFI_SUCCESS         The NCQ data transfer executes successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqTransfer (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE     *Instance,
+  IN     UINT8                            Port,
+  IN     UINT8                            PortMultiplier,
+  IN OUT EFI_ATA_PASS_THRU_COMMAND_PACKET *Packet,
+  IN     ATA_NONBLOCK_TASK                *Task
+  );
+
 /**
   Start a PIO data transfer on specific port.
 
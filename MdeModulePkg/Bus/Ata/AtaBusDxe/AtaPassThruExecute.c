@@ -29,6 +29,8 @@
 #define ATA_CMD_TRUST_RECEIVE_DMA 0x5D
 #define ATA_CMD_TRUST_SEND        0x5E
 #define ATA_CMD_TRUST_SEND_DMA    0x5F
+#define ATA_CMD_READ_FPDMA_QUEUED   0x60
+#define ATA_CMD_WRITE_FPDMA_QUEUED  0x61
 
 //
 // Look up table (UdmaValid, IsWrite) for EFI_ATA_PASS_THRU_CMD_PROTOCOL
@@ -85,6 +87,14 @@ UINT8 mAtaTrustCommands[2][2] = {
 };
 
 
+//
+// Look up table (IsWrite) for NCQ ATA_CMD
+//
+UINT8 mAtaNcqCommands[2] = {
+  ATA_CMD_READ_FPDMA_QUEUED,          // NCQ read
+  ATA_CMD_WRITE_FPDMA_QUEUED          // NCQ write
+};
+
 //
 // Look up table (Lba48Bit) for maximum transfer block number
 //
@@ -304,6 +314,7 @@ IdentifyAtaDevice (
   EFI_LBA                           Capacity;
   UINT16                            PhyLogicSectorSupport;
   UINT16                            UdmaMode;
+  UINT16                            SataCapabilities;
 
   IdentifyData = AtaDevice->IdentifyData;
 
@@ -329,6 +340,16 @@ IdentifyAtaDevice (
     }
   }
 
+  //
+  // Check whether the WORD 76 (Serial ATA capabilities) reports Native Command
+  // Queuing. It's used for the non-blocking DMA transfers.
+  //
+  SataCapabilities = IdentifyData->serial_ata_capabilities;
+  if (AtaDevice->UdmaValid && (SataCapabilities != 0) && (SataCapabilities != 0xFFFF) &&
+      ((SataCapabilities & BIT8) != 0)) {
+    AtaDevice->NcqValid = TRUE;
+  }
+
   Capacity = GetAtapi6Capacity (AtaDevice);
   if (Capacity > MAX_28BIT_ADDRESSING_CAPACITY) {
     //
@@ -445,7 +466,8 @@ DiscoverAtaDevice (
 
   This function performs one ATA pass through transaction to transfer data from/to
   ATA device. It chooses the appropriate ATA command and protocol to invoke PassThru
-  interface of ATA pass through.
+  interface of ATA pass through. The non-blocking transfers use the NCQ commands
+  if the device supports them, so that several of them are outstanding at once.
 
   @param[in, out]  AtaDevice       The ATA child device involved for the operation.
   @param[in, out]  TaskPacket      Pointer to a Pass Thru Command Packet. Optional,
@@ -477,8 +499,10 @@ TransferAtaDevice (
   IN EFI_EVENT                            Event OPTIONAL
   )
 {
+  EFI_STATUS                        Status;
   EFI_ATA_COMMAND_BLOCK             *Acb;
   EFI_ATA_PASS_THRU_COMMAND_PACKET  *Packet;
+  BOOLEAN                           IsNcq;
 
   //
   // Ensure AtaDevice->UdmaValid, AtaDevice->Lba48Bit and IsWrite are valid boolean values
@@ -486,6 +510,7 @@ TransferAtaDevice (
   ASSERT ((UINTN) AtaDevice->UdmaValid < 2);
   ASSERT ((UINTN) AtaDevice->Lba48Bit < 2);
   ASSERT ((UINTN) IsWrite < 2);
+  IsNcq = (BOOLEAN) ((Event != NULL) && AtaDevice->NcqValid);
   //
   // Prepare for ATA command block.
   //
@@ -496,7 +521,20 @@ TransferAtaDevice (
   Acb->AtaCylinderHigh = (UINT8) RShiftU64 (StartLba, 16);
   Acb->AtaDeviceHead = (UINT8) (BIT7 | BIT6 | BIT5 | (AtaDevice->PortMultiplierPort << 4));
   Acb->AtaSectorCount = (UINT8) TransferLength;
-  if (AtaDevice->Lba48Bit) {
+  if (IsNcq) {
+    //
+    // READ/WRITE FPDMA QUEUED take the 48-bit LBA and the sector count in the
+    // feature registers. The host controller puts the tag in the sector count.
+    //
+    Acb->AtaCommand = mAtaNcqCommands[IsWrite];
+    Acb->AtaFeatures = (UINT8) TransferLength;
+    Acb->AtaFeaturesExp = (UINT8) (TransferLength >> 8);
+    Acb->AtaSectorNumberExp = (UINT8) RShiftU64 (StartLba, 24);
+    Acb->AtaCylinderLowExp = (UINT8) RShiftU64 (StartLba, 32);
+    Acb->AtaCylinderHighExp = (UINT8) RShiftU64 (StartLba, 40);
+    Acb->AtaDeviceHead = BIT6;
+    Acb->AtaSectorCount = 0;
+  } else if (AtaDevice->Lba48Bit) {
     Acb->AtaSectorNumberExp = (UINT8) RShiftU64 (StartLba, 24);
     Acb->AtaCylinderLowExp = (UINT8) RShiftU64 (StartLba, 32);
     Acb->AtaCylinderHighExp = (UINT8) RShiftU64 (StartLba, 40);
@@ -522,7 +560,7 @@ TransferAtaDevice (
     Packet->InTransferLength = TransferLength;
   }
 
-  Packet->Protocol = mAtaPassThruCmdProtocols[AtaDevice->UdmaValid][IsWrite];
+  Packet->Protocol = IsNcq ? EFI_ATA_PASS_THRU_PROTOCOL_FPDMA : mAtaPassThruCmdProtocols[AtaDevice->UdmaValid][IsWrite];
   Packet->Length = EFI_ATA_PASS_THRU_LENGTH_SECTOR_COUNT;
   //
   // |------------------------|-----------------|------------------------|-----------------|
@@ -557,7 +595,22 @@ TransferAtaDevice (
     Packet->Timeout  = EFI_TIMER_PERIOD_SECONDS (DivU64x32 (MultU64x32 (TransferLength, AtaDevice->BlockMedia.BlockSize), 3300000) + 31);
   }
 
-  return AtaDevicePassThru (AtaDevice, TaskPacket, Event);
+  Status = AtaDevicePassThru (AtaDevice, TaskPacket, Event);
+  if (IsNcq && (Status == EFI_UNSUPPORTED)) {
+    //
+    // The host controller can't queue commands, use the DMA commands from now on.
+    //
+    AtaDevice->NcqValid = FALSE;
+    if (TaskPacket->Asb != NULL) {
+      FreeAlignedBuffer (TaskPacket->Asb, sizeof (EFI_ATA_STATUS_BLOCK));
+    }
+    if (TaskPacket->Acb != NULL) {
+      FreePool (TaskPacket->Acb);
+    }
+    return TransferAtaDevice (AtaDevice, TaskPacket, Buffer, StartLba, TransferLength, IsWrite, Event);
+  }
+
+  return Status;
 }
 
 /**
@@ -812,7 +865,10 @@ AccessAtaDevice(
   if ((Token != NULL) && (Token->Event != NULL)) {
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
 
-    if (!IsListEmpty (&AtaDevice->AtaSubTaskList)) {
+    //
+    // With NCQ, the sub tasks of several tokens are outstanding at the same time.
+    //
+    if (!AtaDevice->NcqValid && !IsListEmpty (&AtaDevice->AtaSubTaskList)) {
       AtaTask = AllocateZeroPool (sizeof (ATA_BUS_ASYN_TASK));
       if (AtaTask == NULL) {
         gBS->RestoreTPL (OldTpl);
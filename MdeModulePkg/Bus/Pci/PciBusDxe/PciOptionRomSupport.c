@@ -1,7 +1,7 @@
 /** @file
   PCI Rom supporting funtions implementation for PCI Bus module.
 
-Copyright (c) 2006 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -14,6 +14,164 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "PciBus.h"
 
+//
+// Option ROM images already read from a device. A device with the same IDs and
+// the same ROM image layout shares the image instead of reading its ROM BAR again.
+//
+typedef struct {
+  UINT16      VendorId;
+  UINT16      DeviceId;
+  UINT8       RevisionId;
+  UINT32      HeaderHash;
+  UINT64      RomImageSize;
+  UINT8       *Image;
+} PCI_OPROM_CACHE_ENTRY;
+
+//
+// Number of bytes at the end of the ROM image read back to verify a cached image.
+//
+#define PCI_OPROM_CACHE_VERIFY_SIZE   512
+
+UINTN                      mNumberOfCachedOpRoms    = 0;
+UINTN                      mMaxNumberOfCachedOpRoms = 0;
+PCI_OPROM_CACHE_ENTRY      *mOpRomCache             = NULL;
+
+/**
+  Fold a buffer into the FNV-1a hash of the option ROM headers.
+
+  @param Hash     The hash so far.
+  @param Buffer   The buffer to hash.
+  @param Length   The length of the buffer.
+
+  @return The updated hash.
+**/
+UINT32
+OpRomCacheHash (
+  IN UINT32          Hash,
+  IN VOID            *Buffer,
+  IN UINTN           Length
+  )
+{
+  UINT8              *Byte;
+
+  for (Byte = (UINT8 *) Buffer; Length > 0; Length--, Byte++) {
+    Hash = (Hash ^ *Byte) * 0x01000193;
+  }
+  return Hash;
+}
+
+/**
+  Find an option ROM image read from an identical device.
+
+  The image is only used when the bytes at its end match the ones read from
+  this device's ROM BAR. The rest of the image body is not compared, so sharing
+  is only done when the platform enables PcdPciOpRomSharing.
+
+  @param PciDevice     Pci device instance.
+  @param RomBar        Base address of Option Rom, with ROM decode enabled.
+  @param HeaderHash    Hash of the ROM headers and PCI data structures of this device.
+  @param RomImageSize  Size of the ROM image of this device.
+
+  @return The cached image, or NULL when there is none.
+**/
+UINT8 *
+OpRomCacheLookup (
+  IN PCI_IO_DEVICE   *PciDevice,
+  IN UINT32          RomBar,
+  IN UINT32          HeaderHash,
+  IN UINT64          RomImageSize
+  )
+{
+  UINTN              Index;
+  UINT32             VerifySize;
+  UINT8              *VerifyBuffer;
+  UINT8              *Image;
+  EFI_STATUS         Status;
+
+  if (!FeaturePcdGet (PcdPciOpRomSharing)) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < mNumberOfCachedOpRoms; Index++) {
+    if ((mOpRomCache[Index].VendorId     == PciDevice->Pci.Hdr.VendorId) &&
+        (mOpRomCache[Index].DeviceId     == PciDevice->Pci.Hdr.DeviceId) &&
+        (mOpRomCache[Index].RevisionId   == PciDevice->Pci.Hdr.RevisionID) &&
+        (mOpRomCache[Index].HeaderHash   == HeaderHash) &&
+        (mOpRomCache[Index].RomImageSize == RomImageSize)) {
+      break;
+    }
+  }
+  if (Index == mNumberOfCachedOpRoms) {
+    return NULL;
+  }
+
+  VerifySize   = (UINT32) MIN (RomImageSize, PCI_OPROM_CACHE_VERIFY_SIZE);
+  VerifyBuffer = AllocatePool (VerifySize);
+  if (VerifyBuffer == NULL) {
+    return NULL;
+  }
+
+  Status = PciDevice->PciRootBridgeIo->Mem.Read (
+                                             PciDevice->PciRootBridgeIo,
+                                             EfiPciWidthUint8,
+                                             RomBar + (UINT32) RomImageSize - VerifySize,
+                                             VerifySize,
+                                             VerifyBuffer
+                                             );
+  Image = mOpRomCache[Index].Image;
+  if (EFI_ERROR (Status) ||
+      (CompareMem (VerifyBuffer, Image + (UINTN) RomImageSize - VerifySize, VerifySize) != 0)) {
+    Image = NULL;
+  }
+
+  FreePool (VerifyBuffer);
+  return Image;
+}
+
+/**
+  Remember an option ROM image read from a device.
+
+  @param PciDevice     Pci device instance.
+  @param HeaderHash    Hash of the ROM headers and PCI data structures.
+  @param RomImageSize  Size of the ROM image.
+  @param Image         The ROM image in memory.
+**/
+VOID
+OpRomCacheAdd (
+  IN PCI_IO_DEVICE   *PciDevice,
+  IN UINT32          HeaderHash,
+  IN UINT64          RomImageSize,
+  IN UINT8           *Image
+  )
+{
+  PCI_OPROM_CACHE_ENTRY  *TempCache;
+
+  if (!FeaturePcdGet (PcdPciOpRomSharing)) {
+    return;
+  }
+
+  if (mNumberOfCachedOpRoms >= mMaxNumberOfCachedOpRoms) {
+    TempCache = ReallocatePool (
+                  mMaxNumberOfCachedOpRoms * sizeof (PCI_OPROM_CACHE_ENTRY),
+                  (mMaxNumberOfCachedOpRoms + 0x10) * sizeof (PCI_OPROM_CACHE_ENTRY),
+                  mOpRomCache
+                  );
+    if (TempCache == NULL) {
+      return;
+    }
+    mOpRomCache               = TempCache;
+    mMaxNumberOfCachedOpRoms += 0x10;
+  }
+
+  mOpRomCache[mNumberOfCachedOpRoms].VendorId     = PciDevice->Pci.Hdr.VendorId;
+  mOpRomCache[mNumberOfCachedOpRoms].DeviceId     = PciDevice->Pci.Hdr.DeviceId;
+  mOpRomCache[mNumberOfCachedOpRoms].RevisionId   = PciDevice->Pci.Hdr.RevisionID;
+  mOpRomCache[mNumberOfCachedOpRoms].HeaderHash   = HeaderHash;
+  mOpRomCache[mNumberOfCachedOpRoms].RomImageSize = RomImageSize;
+  mOpRomCache[mNumberOfCachedOpRoms].Image        = Image;
+  mNumberOfCachedOpRoms++;
+}
+
 /**
   Load the EFI Image from Option ROM
 
@@ -369,6 +527,11 @@ ContainEfiImage (
 /**
   Load Option Rom image for specified PCI device.
 
+  Only the ROM headers and PCI data structures are read to size the image. When
+  PcdPciOpRomSharing is TRUE and an identical device already had the same image
+  read, the image is shared after its last bytes are checked, and the slow read
+  through the ROM BAR is skipped.
+
   @param PciDevice Pci device instance.
   @param RomBase   Base address of Option Rom.
 
@@ -388,6 +551,7 @@ LoadOpRomImage (
   UINT32                    RomBarOffset;
   UINT32                    RomBar;
   EFI_STATUS                RetStatus;
+  EFI_STATUS                Status;
   BOOLEAN                   FirstCheck;
   UINT8                     *Image;
   PCI_EXPANSION_ROM_HEADER  *RomHeader;
@@ -397,6 +561,7 @@ LoadOpRomImage (
   UINT32                    LegacyImageLength;
   UINT8                     *RomInMemory;
   UINT8                     CodeType;
+  UINT32                    HeaderHash;
 
   RomSize       = PciDevice->RomSize;
 
@@ -404,6 +569,7 @@ LoadOpRomImage (
   RomImageSize  = 0;
   RomInMemory   = NULL;
   CodeType      = 0xFF;
+  HeaderHash    = 0x811c9dc5;
 
   //
   // Get the RomBarIndex
@@ -495,6 +661,8 @@ LoadOpRomImage (
     if (RomImageSize + RomPcir->ImageLength * 512 > RomSize) {
       break;
     }
+    HeaderHash = OpRomCacheHash (HeaderHash, RomHeader, sizeof (PCI_EXPANSION_ROM_HEADER));
+    HeaderHash = OpRomCacheHash (HeaderHash, RomPcir, sizeof (PCI_DATA_STRUCTURE));
     if (RomPcir->CodeType == PCI_CODE_TYPE_PCAT_IMAGE) {
       CodeType = PCI_CODE_TYPE_PCAT_IMAGE;
       LegacyImageLength = ((UINT32)((EFI_LEGACY_EXPANSION_ROM_HEADER *)RomHeader)->Size512) * 512;
@@ -514,6 +682,18 @@ LoadOpRomImage (
 
   if (RomImageSize > 0) {
     RetStatus = EFI_SUCCESS;
+    Image     = OpRomCacheLookup (PciDevice, RomBar, HeaderHash, RomImageSize);
+  } else {
+    Image     = NULL;
+  }
+
+  if (Image != NULL) {
+    DEBUG ((
+      EFI_D_INFO, "PciBus: Option ROM of %02x|%02x|%02x shared with an identical device\n",
+      PciDevice->BusNumber, PciDevice->DeviceNumber, PciDevice->FunctionNumber
+      ));
+    RomInMemory = Image;
+  } else if (RomImageSize > 0) {
     Image     = AllocatePool ((UINT32) RomImageSize);
     if (Image == NULL) {
       RomDecode (PciDevice, RomBarIndex, RomBar, FALSE);
@@ -523,16 +703,20 @@ LoadOpRomImage (
     }
 
     //
-    // Copy Rom image into memory
+    // Copy Rom image into memory. Only an image that was read completely is
+    // offered to identical devices.
     //
-    PciDevice->PciRootBridgeIo->Mem.Read (
-                                      PciDevice->PciRootBridgeIo,
-                                      EfiPciWidthUint8,
-                                      RomBar,
-                                      (UINT32) RomImageSize,
-                                      Image
-                                      );
+    Status = PciDevice->PciRootBridgeIo->Mem.Read (
+                                               PciDevice->PciRootBridgeIo,
+                                               EfiPciWidthUint8,
+                                               RomBar,
+                                               (UINT32) RomImageSize,
+                                               Image
+                                               );
     RomInMemory = Image;
+    if (!EFI_ERROR (Status)) {
+      OpRomCacheAdd (PciDevice, HeaderHash, RomImageSize, Image);
+    }
   }
 
   RomDecode (PciDevice, RomBarIndex, RomBar, FALSE);
@@ -203,10 +203,11 @@ XhcReset (
       goto ON_EXIT;
     }
     //
-    // Clean up the asynchronous transfers, currently only
-    // interrupt supports asynchronous operation.
+    // Clean up the asynchronous interrupt transfers and
+    // the queued bulk transfers.
     //
     XhciDelAllAsyncIntTransfers (Xhc);
+    XhciDelAllAsyncBulkTransfers (Xhc);
     XhcFreeSched (Xhc);
 
     XhcInitSched (Xhc);
@@ -1248,6 +1249,11 @@ XhcBulkTransfer (
     if (EFI_ERROR (RecoveryStatus)) {
       DEBUG ((EFI_D_ERROR, "XhcBulkTransfer: XhcRecoverHaltedEndpoint failed\n"));
     }
+    //
+    // The recovery skips whatever is left on the ring, including
+    // any bulk transfers queued to this endpoint.
+    //
+    XhcFailAsyncBulkTransfers (Xhc, Urb->Ring);
     Status = EFI_DEVICE_ERROR;
   }
 
@@ -1425,6 +1431,201 @@ ON_EXIT:
 }
 
 
+/**
+  Queues a bulk transfer to a bulk endpoint of a USB device and returns
+  without waiting for it to complete. The transfer is completed by the
+  asynchronous monitor, which invokes CallBackFunction.
+
+  @param  This                  This EDKII_USB_HC_ASYNC_BULK_PROTOCOL instance.
+  @param  DeviceAddress         Target device address.
+  @param  EndPointAddress       Endpoint number and its direction in bit 7.
+  @param  DeviceSpeed           Device speed, Low speed device doesn't support bulk
+                                transfer.
+  @param  MaximumPacketLength   Maximum packet size the endpoint is capable of
+                                sending or receiving.
+  @param  Data                  The buffer of data to transmit from or receive into.
+  @param  DataLength            The length of the data buffer.
+  @param  Translator            A pointer to the transaction translator data.
+  @param  CallBackFunction      The function to call when the transfer finishes.
+  @param  Context               Context to CallBackFunction.
+
+  @retval EFI_SUCCESS           The transfer was queued.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_OUT_OF_RESOURCES  The endpoint has no room for another transfer, or
+                                the request failed due to a lack of resources.
+  @retval EFI_DEVICE_ERROR      The transfer failed due to host controller error.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcAsyncBulkTransfer (
+  IN     EDKII_USB_HC_ASYNC_BULK_PROTOCOL    *This,
+  IN     UINT8                               DeviceAddress,
+  IN     UINT8                               EndPointAddress,
+  IN     UINT8                               DeviceSpeed,
+  IN     UINTN                               MaximumPacketLength,
+  IN OUT VOID                                *Data,
+  IN     UINTN                               DataLength,
+  IN     EFI_USB2_HC_TRANSACTION_TRANSLATOR  *Translator,
+  IN     EFI_ASYNC_USB_TRANSFER_CALLBACK     CallBackFunction,
+  IN     VOID                                *Context OPTIONAL
+  )
+{
+  USB_XHCI_INSTANCE       *Xhc;
+  URB                     *Urb;
+  TRANSFER_RING           *Ring;
+  UINT8                   SlotId;
+  UINT8                   Dci;
+  UINTN                   TrbNum;
+  EFI_STATUS              Status;
+  EFI_TPL                 OldTpl;
+
+  //
+  // Validate the parameters
+  //
+  if ((Data == NULL) || (DataLength == 0) || (CallBackFunction == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((DeviceSpeed == EFI_USB_SPEED_LOW) ||
+      ((DeviceSpeed == EFI_USB_SPEED_FULL) && (MaximumPacketLength > 64)) ||
+      ((EFI_USB_SPEED_HIGH == DeviceSpeed) && (MaximumPacketLength > 512)) ||
+      ((EFI_USB_SPEED_SUPER == DeviceSpeed) && (MaximumPacketLength > 1024))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl = gBS->RaiseTPL (XHC_TPL);
+
+  Xhc    = XHC_FROM_ASYNC_BULK_THIS (This);
+  Status = EFI_DEVICE_ERROR;
+
+  if (XhcIsHalt (Xhc) || XhcIsSysError (Xhc)) {
+    DEBUG ((EFI_D_ERROR, "XhcAsyncBulkTransfer: HC is halted\n"));
+    goto ON_EXIT;
+  }
+
+  //
+  // Check if the device is still enabled before every transaction.
+  //
+  SlotId = XhcBusDevAddrToSlotId (Xhc, DeviceAddress);
+  if (SlotId == 0) {
+    goto ON_EXIT;
+  }
+
+  Dci  = XhcEndpointToDci ((UINT8) (EndPointAddress & 0x0F), (UINT8) (XHCI_IS_DATAIN (EndPointAddress) ? EfiUsbDataIn : EfiUsbDataOut));
+  Ring = (TRANSFER_RING *) (UINTN) Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1];
+  if (Ring == NULL) {
+    Status = EFI_INVALID_PARAMETER;
+    goto ON_EXIT;
+  }
+
+  //
+  // Every 64KB of data takes one normal TRB. Keep the transfers queued
+  // on the endpoint within their share of the ring.
+  //
+  TrbNum = (DataLength + 0xFFFF) / 0x10000;
+  if (XhcAsyncBulkTrbsOnRing (Xhc, Ring) + TrbNum > XHC_ASYNC_BULK_MAX_TRB) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ON_EXIT;
+  }
+
+  Urb = XhcCreateUrb (
+          Xhc,
+          DeviceAddress,
+          EndPointAddress,
+          DeviceSpeed,
+          MaximumPacketLength,
+          XHC_BULK_TRANSFER,
+          NULL,
+          Data,
+          DataLength,
+          CallBackFunction,
+          Context
+          );
+
+  if (Urb == NULL) {
+    DEBUG ((EFI_D_ERROR, "XhcAsyncBulkTransfer: failed to create URB\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ON_EXIT;
+  }
+
+  //
+  // Queue behind the transfers already on the endpoint, they complete in order.
+  //
+  InsertTailList (&Xhc->AsyncBulkTransfers, &Urb->UrbList);
+  XhcRingDoorBell (Xhc, SlotId, Dci);
+  Status = EFI_SUCCESS;
+
+ON_EXIT:
+  Xhc->PciIo->Flush (Xhc->PciIo);
+  gBS->RestoreTPL (OldTpl);
+
+  return Status;
+}
+
+/**
+  Cancels all the bulk transfers still queued to an endpoint of a USB device.
+
+  @param  This                  This EDKII_USB_HC_ASYNC_BULK_PROTOCOL instance.
+  @param  DeviceAddress         Target device address.
+  @param  EndPointAddress       Endpoint number and its direction in bit 7.
+
+  @retval EFI_SUCCESS           The queued transfers, if any, were cancelled.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_DEVICE_ERROR      The endpoint could not be stopped.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcCancelAsyncBulkTransfer (
+  IN     EDKII_USB_HC_ASYNC_BULK_PROTOCOL    *This,
+  IN     UINT8                               DeviceAddress,
+  IN     UINT8                               EndPointAddress
+  )
+{
+  USB_XHCI_INSTANCE       *Xhc;
+  EFI_STATUS              Status;
+  EFI_TPL                 OldTpl;
+
+  if ((EndPointAddress & 0x0F) == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl = gBS->RaiseTPL (XHC_TPL);
+
+  Xhc    = XHC_FROM_ASYNC_BULK_THIS (This);
+  Status = XhciDelAsyncBulkTransfers (Xhc, DeviceAddress, EndPointAddress);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "XhcCancelAsyncBulkTransfer: failed to stop endpoint, Status = %r\n", Status));
+    Status = EFI_DEVICE_ERROR;
+  }
+
+  gBS->RestoreTPL (OldTpl);
+
+  return Status;
+}
+
+/**
+  Retires the queued bulk transfers that have finished and invokes their
+  callbacks before returning.
+
+  @param  This                  This EDKII_USB_HC_ASYNC_BULK_PROTOCOL instance.
+
+  @retval EFI_SUCCESS           The finished transfers, if any, were retired.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcPollAsyncBulkTransfer (
+  IN     EDKII_USB_HC_ASYNC_BULK_PROTOCOL    *This
+  )
+{
+  XhcRetireAsyncBulkTransfers (XHC_FROM_ASYNC_BULK_THIS (This));
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Submits synchronous interrupt transfer to an interrupt endpoint
   of a USB device.
@@ -1782,8 +1983,12 @@ XhcCreateUsbHc (
   Xhc->DevicePath            = DevicePath;
   Xhc->OriginalPciAttributes = OriginalPciAttributes;
   CopyMem (&Xhc->Usb2Hc, &gXhciUsb2HcTemplate, sizeof (EFI_USB2_HC_PROTOCOL));
+  Xhc->UsbHcAsyncBulk.AsyncBulkTransfer       = XhcAsyncBulkTransfer;
+  Xhc->UsbHcAsyncBulk.CancelAsyncBulkTransfer = XhcCancelAsyncBulkTransfer;
+  Xhc->UsbHcAsyncBulk.PollAsyncBulkTransfer   = XhcPollAsyncBulkTransfer;
 
   InitializeListHead (&Xhc->AsyncIntTransfers);
+  InitializeListHead (&Xhc->AsyncBulkTransfers);
 
   //
   // Be caution that the Offset passed to XhcReadCapReg() should be Dword align
@@ -2054,11 +2259,13 @@ XhcDriverBindingStart (
     FALSE
     );
 
-  Status = gBS->InstallProtocolInterface (
+  Status = gBS->InstallMultipleProtocolInterfaces (
                   &Controller,
                   &gEfiUsb2HcProtocolGuid,
-                  EFI_NATIVE_INTERFACE,
-                  &Xhc->Usb2Hc
+                  &Xhc->Usb2Hc,
+                  &gEdkiiUsbHcAsyncBulkProtocolGuid,
+                  &Xhc->UsbHcAsyncBulk,
+                  NULL
                   );
   if (EFI_ERROR (Status)) {
     DEBUG ((EFI_D_ERROR, "XhcDriverBindingStart: failed to install USB2_HC Protocol\n"));
@@ -2143,19 +2350,22 @@ XhcDriverBindingStop (
     return Status;
   }
 
-  Status = gBS->UninstallProtocolInterface (
+  Xhc   = XHC_FROM_THIS (Usb2Hc);
+  PciIo = Xhc->PciIo;
+
+  Status = gBS->UninstallMultipleProtocolInterfaces (
                   Controller,
                   &gEfiUsb2HcProtocolGuid,
-                  Usb2Hc
+                  Usb2Hc,
+                  &gEdkiiUsbHcAsyncBulkProtocolGuid,
+                  &Xhc->UsbHcAsyncBulk,
+                  NULL
                   );
 
   if (EFI_ERROR (Status)) {
     return Status;
   }
 
-  Xhc   = XHC_FROM_THIS (Usb2Hc);
-  PciIo = Xhc->PciIo;
-
   //
   // Stop AsyncRequest Polling timer then stop the XHCI driver
   // and uninstall the XHCI protocl.
@@ -2189,6 +2399,7 @@ XhcDriverBindingStop (
   XhcHaltHC (Xhc, XHC_GENERIC_TIMEOUT);
   XhcClearBiosOwnership (Xhc);
   XhciDelAllAsyncIntTransfers (Xhc);
+  XhciDelAllAsyncBulkTransfers (Xhc);
   XhcFreeSched (Xhc);
 
   if (Xhc->ControllerNameTable) {
@@ -19,6 +19,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Uefi.h>
 
 #include <Protocol/Usb2HostController.h>
+#include <Protocol/UsbHcAsyncBulk.h>
 #include <Protocol/PciIo.h>
 
 #include <Guid/EventGroup.h>
@@ -79,6 +80,11 @@ typedef struct _USB_DEV_CONTEXT      USB_DEV_CONTEXT;
 
 #define CMD_RING_TRB_NUMBER          0x100
 #define TR_RING_TRB_NUMBER           0x100
+//
+// At most half of an endpoint's transfer ring is given to queued bulk
+// transfers, so synchronous transfers to the endpoint always find room.
+//
+#define XHC_ASYNC_BULK_MAX_TRB       (TR_RING_TRB_NUMBER / 2)
 #define ERST_NUMBER                  0x01
 #define EVENT_RING_TRB_NUMBER        0x200
 
@@ -109,6 +115,7 @@ typedef struct _USB_DEV_CONTEXT      USB_DEV_CONTEXT;
 
 #define XHCI_INSTANCE_SIG              SIGNATURE_32 ('x', 'h', 'c', 'i')
 #define XHC_FROM_THIS(a)               CR(a, USB_XHCI_INSTANCE, Usb2Hc, XHCI_INSTANCE_SIG)
+#define XHC_FROM_ASYNC_BULK_THIS(a)    CR(a, USB_XHCI_INSTANCE, UsbHcAsyncBulk, XHCI_INSTANCE_SIG)
 
 #define USB_DESC_TYPE_HUB              0x29
 #define USB_DESC_TYPE_HUB_SUPER_SPEED  0x2a
@@ -213,6 +220,7 @@ struct _USB_XHCI_INSTANCE {
   USBHC_MEM_POOL            *MemPool;
 
   EFI_USB2_HC_PROTOCOL      Usb2Hc;
+  EDKII_USB_HC_ASYNC_BULK_PROTOCOL UsbHcAsyncBulk;
 
   EFI_DEVICE_PATH_PROTOCOL  *DevicePath;
 
@@ -223,6 +231,7 @@ struct _USB_XHCI_INSTANCE {
   EFI_EVENT                 ExitBootServiceEvent;
   EFI_EVENT                 PollTimer;
   LIST_ENTRY                AsyncIntTransfers;
+  LIST_ENTRY                AsyncBulkTransfers;
 
   UINT8                     CapLength;    ///< Capability Register Length
   XHC_HCSPARAMS1            HcSParams1;   ///< Structural Parameters 1
@@ -611,6 +620,81 @@ XhcAsyncInterruptTransfer (
   IN     VOID                                *Context OPTIONAL
   );
 
+/**
+  Queues a bulk transfer to a bulk endpoint of a USB device and returns
+  without waiting for it to complete. The transfer is completed by the
+  asynchronous monitor, which invokes CallBackFunction.
+
+  @param  This                  This EDKII_USB_HC_ASYNC_BULK_PROTOCOL instance.
+  @param  DeviceAddress         Target device address.
+  @param  EndPointAddress       Endpoint number and its direction in bit 7.
+  @param  DeviceSpeed           Device speed, Low speed device doesn't support bulk
+                                transfer.
+  @param  MaximumPacketLength   Maximum packet size the endpoint is capable of
+                                sending or receiving.
+  @param  Data                  The buffer of data to transmit from or receive into.
+  @param  DataLength            The length of the data buffer.
+  @param  Translator            A pointer to the transaction translator data.
+  @param  CallBackFunction      The function to call when the transfer finishes.
+  @param  Context               Context to CallBackFunction.
+
+  @retval EFI_SUCCESS           The transfer was queued.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_OUT_OF_RESOURCES  The endpoint has no room for another transfer, or
+                                the request failed due to a lack of resources.
+  @retval EFI_DEVICE_ERROR      The transfer failed due to host controller error.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcAsyncBulkTransfer (
+  IN     EDKII_USB_HC_ASYNC_BULK_PROTOCOL    *This,
+  IN     UINT8                               DeviceAddress,
+  IN     UINT8                               EndPointAddress,
+  IN     UINT8                               DeviceSpeed,
+  IN     UINTN                               MaximumPacketLength,
+  IN OUT VOID                                *Data,
+  IN     UINTN                               DataLength,
+  IN     EFI_USB2_HC_TRANSACTION_TRANSLATOR  *Translator,
+  IN     EFI_ASYNC_USB_TRANSFER_CALLBACK     CallBackFunction,
+  IN     VOID                                *Context OPTIONAL
+  );
+
+/**
+  Cancels all the bulk transfers still queued to an endpoint of a USB device.
+
+  @param  This                  This EDKII_USB_HC_ASYNC_BULK_PROTOCOL instance.
+  @param  DeviceAddress         Target device address.
+  @param  EndPointAddress       Endpoint number and its direction in bit 7.
+
+  @retval EFI_SUCCESS           The queued transfers, if any, were cancelled.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_DEVICE_ERROR      The endpoint could not be stopped.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcCancelAsyncBulkTransfer (
+  IN     EDKII_USB_HC_ASYNC_BULK_PROTOCOL    *This,
+  IN     UINT8                               DeviceAddress,
+  IN     UINT8                               EndPointAddress
+  );
+
+/**
+  Retires the queued bulk transfers that have finished and invokes their
+  callbacks before returning.
+
+  @param  This                  This EDKII_USB_HC_ASYNC_BULK_PROTOCOL instance.
+
+  @retval EFI_SUCCESS           The finished transfers, if any, were retired.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcPollAsyncBulkTransfer (
+  IN     EDKII_USB_HC_ASYNC_BULK_PROTOCOL    *This
+  );
+
 /**
   Submits synchronous interrupt transfer to an interrupt endpoint
   of a USB device.
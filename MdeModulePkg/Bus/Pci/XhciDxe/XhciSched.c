@@ -623,6 +623,47 @@ XhcInitSched (
   DEBUG ((EFI_D_INFO, "XhcInitSched:XHC_EVENTRING=0x%x\n", Xhc->EventRing.EventRingSeg0));
 }
 
+/**
+  Move the dequeue pointer of a stopped endpoint to the current enqueue pointer
+  of its transfer ring, so that the TRBs left on the ring are skipped.
+
+  @param  Xhc                   The XHCI Instance.
+  @param  SlotId                The slot id of the target device.
+  @param  Dci                   The device context index of the endpoint.
+  @param  Ring                  The transfer ring of the endpoint.
+
+  @retval EFI_SUCCESS           The dequeue pointer is updated.
+  @retval Others                Failed to update the dequeue pointer.
+
+**/
+EFI_STATUS
+XhcSetTrDequeuePointer (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  UINT8               SlotId,
+  IN  UINT8               Dci,
+  IN  TRANSFER_RING       *Ring
+  )
+{
+  EVT_TRB_COMMAND_COMPLETION  *EvtTrb;
+  CMD_SET_TR_DEQ_POINTER      CmdSetTRDeq;
+  EFI_PHYSICAL_ADDRESS        PhyAddr;
+
+  ZeroMem (&CmdSetTRDeq, sizeof (CmdSetTRDeq));
+  PhyAddr = UsbHcGetPciAddrForHostAddr (Xhc->MemPool, Ring->RingEnqueue, sizeof (CMD_SET_TR_DEQ_POINTER));
+  CmdSetTRDeq.PtrLo    = XHC_LOW_32BIT (PhyAddr) | Ring->RingPCS;
+  CmdSetTRDeq.PtrHi    = XHC_HIGH_32BIT (PhyAddr);
+  CmdSetTRDeq.CycleBit = 1;
+  CmdSetTRDeq.Type     = TRB_TYPE_SET_TR_DEQUE;
+  CmdSetTRDeq.Endpoint = Dci;
+  CmdSetTRDeq.SlotId   = SlotId;
+  return XhcCmdTransfer (
+           Xhc,
+           (TRB_TEMPLATE *) (UINTN) &CmdSetTRDeq,
+           XHC_GENERIC_TIMEOUT,
+           (TRB_TEMPLATE **) (UINTN) &EvtTrb
+           );
+}
+
 /**
   System software shall use a Reset Endpoint Command (section 4.11.4.7) to remove the Halted
   condition in the xHC. After the successful completion of the Reset Endpoint Command, the Endpoint
@@ -647,10 +688,8 @@ XhcRecoverHaltedEndpoint (
   EFI_STATUS                  Status;
   EVT_TRB_COMMAND_COMPLETION  *EvtTrb;
   CMD_TRB_RESET_ENDPOINT      CmdTrbResetED;
-  CMD_SET_TR_DEQ_POINTER      CmdSetTRDeq;
   UINT8                       Dci;
   UINT8                       SlotId;
-  EFI_PHYSICAL_ADDRESS        PhyAddr;
 
   Status = EFI_SUCCESS;
   SlotId = XhcBusDevAddrToSlotId (Xhc, Urb->Ep.BusAddr);
@@ -684,20 +723,7 @@ XhcRecoverHaltedEndpoint (
   //
   // 2)Set dequeue pointer
   //
-  ZeroMem (&CmdSetTRDeq, sizeof (CmdSetTRDeq));
-  PhyAddr = UsbHcGetPciAddrForHostAddr (Xhc->MemPool, Urb->Ring->RingEnqueue, sizeof (CMD_SET_TR_DEQ_POINTER));
-  CmdSetTRDeq.PtrLo    = XHC_LOW_32BIT (PhyAddr) | Urb->Ring->RingPCS;
-  CmdSetTRDeq.PtrHi    = XHC_HIGH_32BIT (PhyAddr);
-  CmdSetTRDeq.CycleBit = 1;
-  CmdSetTRDeq.Type     = TRB_TYPE_SET_TR_DEQUE;
-  CmdSetTRDeq.Endpoint = Dci;
-  CmdSetTRDeq.SlotId   = SlotId;
-  Status = XhcCmdTransfer (
-             Xhc,
-             (TRB_TEMPLATE *) (UINTN) &CmdSetTRDeq,
-             XHC_GENERIC_TIMEOUT,
-             (TRB_TEMPLATE **) (UINTN) &EvtTrb
-             );
+  Status = XhcSetTrDequeuePointer (Xhc, SlotId, Dci, Urb->Ring);
   if (EFI_ERROR(Status)) {
     DEBUG ((EFI_D_ERROR, "XhcRecoverHaltedEndpoint: Set Dequeue Pointer Failed, Status = %r\n", Status));
     goto Done;
@@ -943,47 +969,120 @@ XhcFreeSched (
 }
 
 /**
-  Check if the Trb is a transaction of the URBs in XHCI's asynchronous transfer list.
+  Check if the Trb is one of the TRBs the URB placed on its transfer ring.
 
-  @param Xhc    The XHCI Instance.
+  @param Trb    The TRB to be checked.
+  @param Urb    The URB to be checked.
+
+  @retval TRUE  The Trb belongs to the URB.
+  @retval FALSE The Trb doesn't belong to the URB.
+
+**/
+BOOLEAN
+IsUrbTrb (
+  IN  TRB_TEMPLATE        *Trb,
+  IN  URB                 *Urb
+  )
+{
+  TRB_TEMPLATE            *CheckedTrb;
+  UINTN                   Index;
+
+  CheckedTrb = Urb->TrbStart;
+  for (Index = 0; Index < Urb->TrbNum; Index++) {
+    if (Trb == CheckedTrb) {
+      return TRUE;
+    }
+    CheckedTrb++;
+    //
+    // The TRBs of a transfer descriptor continue at the start of the ring
+    // after the link TRB.
+    //
+    if (((UINTN)CheckedTrb >= ((UINTN) Urb->Ring->RingSeg0 + sizeof (TRB_TEMPLATE) * Urb->Ring->TrbNumber)) ||
+        ((UINT8) CheckedTrb->Type == TRB_TYPE_LINK)) {
+      CheckedTrb = (TRB_TEMPLATE*) Urb->Ring->RingSeg0;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Check if the Trb is a transaction of the URBs in one of XHCI's asynchronous
+  transfer lists.
+
+  @param List   The asynchronous transfer list to search.
   @param Trb    The TRB to be checked.
   @param Urb    The pointer to the matched Urb.
 
-  @retval TRUE  The Trb is matched with a transaction of the URBs in the async list.
-  @retval FALSE The Trb is not matched with any URBs in the async list.
+  @retval TRUE  The Trb is matched with a transaction of the URBs in the list.
+  @retval FALSE The Trb is not matched with any URBs in the list.
 
 **/
 BOOLEAN
-IsAsyncIntTrb (
-  IN  USB_XHCI_INSTANCE   *Xhc,
+IsAsyncTrb (
+  IN  LIST_ENTRY          *List,
   IN  TRB_TEMPLATE        *Trb,
   OUT URB                 **Urb
   )
 {
   LIST_ENTRY              *Entry;
   LIST_ENTRY              *Next;
-  TRB_TEMPLATE            *CheckedTrb;
   URB                     *CheckedUrb;
-  UINTN                   Index;
 
-  EFI_LIST_FOR_EACH_SAFE (Entry, Next, &Xhc->AsyncIntTransfers) {
+  EFI_LIST_FOR_EACH_SAFE (Entry, Next, List) {
     CheckedUrb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
-    CheckedTrb = CheckedUrb->TrbStart;
-    for (Index = 0; Index < CheckedUrb->TrbNum; Index++) {
-      if (Trb == CheckedTrb) {
-        *Urb = CheckedUrb;
-        return TRUE;
-      }
-      CheckedTrb++;
-      if ((UINTN)CheckedTrb >= ((UINTN) CheckedUrb->Ring->RingSeg0 + sizeof (TRB_TEMPLATE) * CheckedUrb->Ring->TrbNumber)) {
-        CheckedTrb = (TRB_TEMPLATE*) CheckedUrb->Ring->RingSeg0;
-      }
+    if (IsUrbTrb (Trb, CheckedUrb)) {
+      *Urb = CheckedUrb;
+      return TRUE;
     }
   }
 
   return FALSE;
 }
 
+/**
+  Check if the Trb is a transaction of the URBs in XHCI's asynchronous transfer list.
+
+  @param Xhc    The XHCI Instance.
+  @param Trb    The TRB to be checked.
+  @param Urb    The pointer to the matched Urb.
+
+  @retval TRUE  The Trb is matched with a transaction of the URBs in the async list.
+  @retval FALSE The Trb is not matched with any URBs in the async list.
+
+**/
+BOOLEAN
+IsAsyncIntTrb (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  TRB_TEMPLATE        *Trb,
+  OUT URB                 **Urb
+  )
+{
+  return IsAsyncTrb (&Xhc->AsyncIntTransfers, Trb, Urb);
+}
+
+/**
+  Check if the Trb is a transaction of the URBs queued by asynchronous bulk
+  transfers.
+
+  @param Xhc    The XHCI Instance.
+  @param Trb    The TRB to be checked.
+  @param Urb    The pointer to the matched Urb.
+
+  @retval TRUE  The Trb is matched with a queued bulk transfer.
+  @retval FALSE The Trb is not matched with any queued bulk transfer.
+
+**/
+BOOLEAN
+IsAsyncBulkTrb (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  TRB_TEMPLATE        *Trb,
+  OUT URB                 **Urb
+  )
+{
+  return IsAsyncTrb (&Xhc->AsyncBulkTransfers, Trb, Urb);
+}
+
 /**
   Check if the Trb is a transaction of the URB.
 
@@ -1092,11 +1191,17 @@ XhcCheckUrbResult (
     // the urb is current checked one or in the XHCI's async transfer list.
     // This way is used to avoid that those completed async transfer events don't get
     // handled in time and are flushed by newer coming events.
+    // Queued bulk transfers share their endpoint ring with the checked urb, so
+    // match them by their own TRBs before falling back to the whole ring.
     //
-    if (IsTransferRingTrb (TRBPtr, Urb)) {
+    if (IsUrbTrb (TRBPtr, Urb)) {
       CheckedUrb = Urb;
     } else if (IsAsyncIntTrb (Xhc, TRBPtr, &AsyncUrb)) {    
       CheckedUrb = AsyncUrb;
+    } else if (IsAsyncBulkTrb (Xhc, TRBPtr, &AsyncUrb)) {
+      CheckedUrb = AsyncUrb;
+    } else if (IsTransferRingTrb (TRBPtr, Urb)) {
+      CheckedUrb = Urb;
     } else {
       continue;
     }
@@ -1325,6 +1430,205 @@ XhciDelAllAsyncIntTransfers (
   }
 }
 
+/**
+  Count the TRBs that queued bulk transfers still occupy on a transfer ring.
+
+  @param  Xhc                   The XHCI Instance.
+  @param  Ring                  The transfer ring.
+
+  @return The number of TRBs in use by queued bulk transfers.
+
+**/
+UINTN
+XhcAsyncBulkTrbsOnRing (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN TRANSFER_RING        *Ring
+  )
+{
+  LIST_ENTRY              *Entry;
+  URB                     *Urb;
+  UINTN                   TrbNum;
+
+  TrbNum = 0;
+  for (Entry = Xhc->AsyncBulkTransfers.ForwardLink; Entry != &Xhc->AsyncBulkTransfers; Entry = Entry->ForwardLink) {
+    Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+    if ((Urb->Ring == Ring) && !Urb->Finished) {
+      TrbNum += Urb->TrbNum;
+    }
+  }
+
+  return TrbNum;
+}
+
+/**
+  Finish all the queued bulk transfers on a transfer ring with an error. This
+  is used once the endpoint has been moved past the TRBs left on its ring, so
+  those transfers will never complete. The results are reported to the callers
+  by the next run of the asynchronous monitor.
+
+  @param  Xhc                   The XHCI Instance.
+  @param  Ring                  The transfer ring.
+
+**/
+VOID
+XhcFailAsyncBulkTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN TRANSFER_RING        *Ring
+  )
+{
+  LIST_ENTRY              *Entry;
+  URB                     *Urb;
+
+  for (Entry = Xhc->AsyncBulkTransfers.ForwardLink; Entry != &Xhc->AsyncBulkTransfers; Entry = Entry->ForwardLink) {
+    Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+    if ((Urb->Ring == Ring) && !Urb->Finished) {
+      Urb->Result  |= EFI_USB_ERR_SYSTEM;
+      Urb->Finished = TRUE;
+    }
+  }
+}
+
+/**
+  Cancel the queued bulk transfers for the device and endpoint. The endpoint
+  is stopped and moved past the cancelled TRBs. The callbacks of the cancelled
+  transfers are not invoked.
+
+  @param  Xhc                   The XHCI Instance.
+  @param  BusAddr               The logical device address assigned by UsbBus driver.
+  @param  EpNum                 The endpoint of the target.
+
+  @retval EFI_SUCCESS           The queued transfers, if any, are removed.
+  @retval Others                Failed to stop the endpoint.
+
+**/
+EFI_STATUS
+XhciDelAsyncBulkTransfers (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  UINT8               BusAddr,
+  IN  UINT8               EpNum
+  )
+{
+  LIST_ENTRY              *Entry;
+  LIST_ENTRY              *Next;
+  LIST_ENTRY              Cancelled;
+  URB                     *Urb;
+  TRANSFER_RING           *Ring;
+  EFI_USB_DATA_DIRECTION  Direction;
+  UINT8                   SlotId;
+  UINT8                   Dci;
+  EFI_STATUS              Status;
+
+  Direction = ((EpNum & 0x80) != 0) ? EfiUsbDataIn : EfiUsbDataOut;
+  EpNum    &= 0x0F;
+  Ring      = NULL;
+  Status    = EFI_SUCCESS;
+
+  InitializeListHead (&Cancelled);
+  EFI_LIST_FOR_EACH_SAFE (Entry, Next, &Xhc->AsyncBulkTransfers) {
+    Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+    if ((Urb->Ep.BusAddr == BusAddr) &&
+        (Urb->Ep.EpAddr == EpNum) &&
+        (Urb->Ep.Direction == Direction)) {
+      if (!Urb->Finished) {
+        Ring = Urb->Ring;
+      }
+      RemoveEntryList (&Urb->UrbList);
+      InsertTailList (&Cancelled, &Urb->UrbList);
+    }
+  }
+
+  //
+  // Some of the cancelled transfers were still on the ring, stop the endpoint
+  // and skip them. The next transfer rings the doorbell to restart it.
+  //
+  SlotId = XhcBusDevAddrToSlotId (Xhc, BusAddr);
+  if ((Ring != NULL) && (SlotId != 0)) {
+    Dci    = XhcEndpointToDci (EpNum, (UINT8) Direction);
+    Status = XhcStopEndpoint (Xhc, SlotId, Dci);
+    if (!EFI_ERROR (Status)) {
+      Status = XhcSetTrDequeuePointer (Xhc, SlotId, Dci, Ring);
+    }
+  }
+
+  //
+  // The HC no longer processes the cancelled TRBs, release their data buffers.
+  //
+  while (!IsListEmpty (&Cancelled)) {
+    Urb = EFI_LIST_CONTAINER (Cancelled.ForwardLink, URB, UrbList);
+    RemoveEntryList (&Urb->UrbList);
+    XhcFreeUrb (Xhc, Urb);
+  }
+
+  return Status;
+}
+
+/**
+  Remove all the queued bulk transfers, without invoking their callbacks. The
+  endpoints still processing them are stopped before their buffers are freed.
+
+  @param  Xhc    The XHCI Instance.
+
+**/
+VOID
+XhciDelAllAsyncBulkTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc
+  )
+{
+  LIST_ENTRY              *Entry;
+  LIST_ENTRY              *Next;
+  LIST_ENTRY              Cancelled;
+  URB                     *Urb;
+  URB                     *Other;
+  UINT8                   SlotId;
+  UINT8                   Dci;
+  EFI_STATUS              Status;
+
+  InitializeListHead (&Cancelled);
+  EFI_LIST_FOR_EACH_SAFE (Entry, Next, &Xhc->AsyncBulkTransfers) {
+    Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+    RemoveEntryList (&Urb->UrbList);
+    InsertTailList (&Cancelled, &Urb->UrbList);
+  }
+
+  //
+  // Stop every endpoint that still has cancelled TRBs on its ring, unless the
+  // whole HC is already halted. The other transfers on that ring are then
+  // marked finished so the endpoint is stopped only once.
+  //
+  for (Entry = Cancelled.ForwardLink; Entry != &Cancelled; Entry = Entry->ForwardLink) {
+    Urb    = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+    SlotId = XhcBusDevAddrToSlotId (Xhc, Urb->Ep.BusAddr);
+    if (Urb->Finished || (SlotId == 0) || XhcIsHalt (Xhc)) {
+      continue;
+    }
+
+    Dci    = XhcEndpointToDci (Urb->Ep.EpAddr, (UINT8) Urb->Ep.Direction);
+    Status = XhcStopEndpoint (Xhc, SlotId, Dci);
+    if (!EFI_ERROR (Status)) {
+      Status = XhcSetTrDequeuePointer (Xhc, SlotId, Dci, Urb->Ring);
+    }
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_ERROR, "XhciDelAllAsyncBulkTransfers: failed to stop endpoint, Status = %r\n", Status));
+    }
+
+    for (Next = Entry; Next != &Cancelled; Next = Next->ForwardLink) {
+      Other = EFI_LIST_CONTAINER (Next, URB, UrbList);
+      if (Other->Ring == Urb->Ring) {
+        Other->Finished = TRUE;
+      }
+    }
+  }
+
+  //
+  // The HC no longer processes the cancelled TRBs, release their data buffers.
+  //
+  while (!IsListEmpty (&Cancelled)) {
+    Urb = EFI_LIST_CONTAINER (Cancelled.ForwardLink, URB, UrbList);
+    RemoveEntryList (&Urb->UrbList);
+    XhcFreeUrb (Xhc, Urb);
+  }
+}
+
 /**
   Update the queue head for next round of asynchronous transfer
 
@@ -1407,6 +1711,92 @@ ON_ERROR:
   return EFI_DEVICE_ERROR;
 }
 
+/**
+  Retire the queued bulk transfers that have finished and invoke their
+  callbacks. This is called by the asynchronous monitor, and directly by
+  callers that wait for their bulk transfers at a TPL that blocks the monitor.
+
+  @param  Xhc                   The XHCI Instance.
+
+**/
+VOID
+XhcRetireAsyncBulkTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc
+  )
+{
+  LIST_ENTRY              *Entry;
+  LIST_ENTRY              *Next;
+  LIST_ENTRY              Finished;
+  URB                     *Urb;
+  EFI_STATUS              Status;
+  EFI_TPL                 OldTpl;
+
+  OldTpl = gBS->RaiseTPL (XHC_TPL);
+
+  //
+  // The finished transfers are moved to a local list first, as the callbacks
+  // may queue or cancel other transfers.
+  //
+  InitializeListHead (&Finished);
+  EFI_LIST_FOR_EACH_SAFE (Entry, Next, &Xhc->AsyncBulkTransfers) {
+    Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+
+    //
+    // The device is gone, its transfers can never complete.
+    //
+    if (XhcBusDevAddrToSlotId (Xhc, Urb->Ep.BusAddr) == 0) {
+      Urb->Result  |= EFI_USB_ERR_SYSTEM;
+      Urb->Finished = TRUE;
+    }
+
+    XhcCheckUrbResult (Xhc, Urb);
+    if (!Urb->Finished) {
+      continue;
+    }
+
+    //
+    // Any transfer error halts the endpoint. Recover it, which also skips the
+    // TRBs of the transfers queued behind this one, and fail those transfers
+    // too. EFI_USB_ERR_SYSTEM alone means the transfer was failed by software
+    // or the HC stopped, so there is nothing to recover.
+    //
+    if ((Urb->Result != EFI_USB_NOERROR) && (Urb->Result != EFI_USB_ERR_SYSTEM) &&
+        (XhcBusDevAddrToSlotId (Xhc, Urb->Ep.BusAddr) != 0)) {
+      Status = XhcRecoverHaltedEndpoint (Xhc, Urb);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((EFI_D_ERROR, "XhcRetireAsyncBulkTransfers: XhcRecoverHaltedEndpoint failed\n"));
+      }
+      XhcFailAsyncBulkTransfers (Xhc, Urb->Ring);
+    }
+
+    RemoveEntryList (&Urb->UrbList);
+    InsertTailList (&Finished, &Urb->UrbList);
+  }
+
+  while (!IsListEmpty (&Finished)) {
+    Urb = EFI_LIST_CONTAINER (Finished.ForwardLink, URB, UrbList);
+    RemoveEntryList (&Urb->UrbList);
+
+    //
+    // Unmap the data first, so that the caller sees what the device wrote.
+    //
+    if (Urb->DataMap != NULL) {
+      Xhc->PciIo->Unmap (Xhc->PciIo, Urb->DataMap);
+      Urb->DataMap = NULL;
+    }
+
+    if (Urb->Callback != NULL) {
+      gBS->RestoreTPL (OldTpl);
+      (Urb->Callback) (Urb->Data, Urb->Completed, Urb->Context, Urb->Result);
+      OldTpl = gBS->RaiseTPL (XHC_TPL);
+    }
+
+    XhcFreeUrb (Xhc, Urb);
+  }
+
+  gBS->RestoreTPL (OldTpl);
+}
+
 /**
   Interrupt transfer periodic check handler.
 
@@ -1509,7 +1899,10 @@ XhcMonitorAsyncRequests (
 
     XhcUpdateAsyncRequest (Xhc, Urb);
   }
+
   gBS->RestoreTPL (OldTpl);
+
+  XhcRetireAsyncBulkTransfers (Xhc);
 }
 
 /**
@@ -850,6 +850,82 @@ XhciDelAllAsyncIntTransfers (
   IN USB_XHCI_INSTANCE    *Xhc
   );
 
+/**
+  Count the TRBs that queued bulk transfers still occupy on a transfer ring.
+
+  @param  Xhc                   The XHCI Instance.
+  @param  Ring                  The transfer ring.
+
+  @return The number of TRBs in use by queued bulk transfers.
+
+**/
+UINTN
+XhcAsyncBulkTrbsOnRing (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN TRANSFER_RING        *Ring
+  );
+
+/**
+  Finish all the queued bulk transfers on a transfer ring with an error. This
+  is used once the endpoint has been moved past the TRBs left on its ring, so
+  those transfers will never complete. The results are reported to the callers
+  by the next run of the asynchronous monitor.
+
+  @param  Xhc                   The XHCI Instance.
+  @param  Ring                  The transfer ring.
+
+**/
+VOID
+XhcFailAsyncBulkTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN TRANSFER_RING        *Ring
+  );
+
+/**
+  Cancel the queued bulk transfers for the device and endpoint. The endpoint
+  is stopped and moved past the cancelled TRBs. The callbacks of the cancelled
+  transfers are not invoked.
+
+  @param  Xhc                   The XHCI Instance.
+  @param  BusAddr               The logical device address assigned by UsbBus driver.
+  @param  EpNum                 The endpoint of the target.
+
+  @retval EFI_SUCCESS           The queued transfers, if any, are removed.
+  @retval Others                Failed to stop the endpoint.
+
+**/
+EFI_STATUS
+XhciDelAsyncBulkTransfers (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  UINT8               BusAddr,
+  IN  UINT8               EpNum
+  );
+
+/**
+  Retire the queued bulk transfers that have finished and invoke their
+  callbacks. This is called by the asynchronous monitor, and directly by
+  callers that wait for their bulk transfers at a TPL that blocks the monitor.
+
+  @param  Xhc                   The XHCI Instance.
+
+**/
+VOID
+XhcRetireAsyncBulkTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc
+  );
+
+/**
+  Remove all the queued bulk transfers, without invoking their callbacks. The
+  endpoints still processing them are stopped before their buffers are freed.
+
+  @param  Xhc    The XHCI Instance.
+
+**/
+VOID
+XhciDelAllAsyncBulkTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc
+  );
+
 /**
   Set Bios Ownership
 
@@ -1296,6 +1372,46 @@ CreateEventRing (
   OUT EVENT_RING            *EventRing
   );
 
+/**
+  Move the dequeue pointer of a stopped endpoint to the current enqueue pointer
+  of its transfer ring, so that the TRBs left on the ring are skipped.
+
+  @param  Xhc                   The XHCI Instance.
+  @param  SlotId                The slot id of the target device.
+  @param  Dci                   The device context index of the endpoint.
+  @param  Ring                  The transfer ring of the endpoint.
+
+  @retval EFI_SUCCESS           The dequeue pointer is updated.
+  @retval Others                Failed to update the dequeue pointer.
+
+**/
+EFI_STATUS
+XhcSetTrDequeuePointer (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  UINT8               SlotId,
+  IN  UINT8               Dci,
+  IN  TRANSFER_RING       *Ring
+  );
+
+/**
+  Stop endpoint through XHCI's Stop_Endpoint cmd.
+
+  @param  Xhc                   The XHCI Instance.
+  @param  SlotId                The slot id to be configured.
+  @param  Dci                   The device context index of endpoint.
+
+  @retval EFI_SUCCESS           Stop endpoint successfully.
+  @retval Others                Failed to stop endpoint.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcStopEndpoint (
+  IN USB_XHCI_INSTANCE      *Xhc,
+  IN UINT8                  SlotId,
+  IN UINT8                  Dci
+  );
+
 /**
   System software shall use a Reset Endpoint Command (section 4.11.4.7) to remove the Halted
   condition in the xHC. After the successful completion of the Reset Endpoint Command, the Endpoint
@@ -239,7 +239,14 @@ ScsiDiskDriverBindingStart (
   ScsiDiskDevice->BlkIo.ReadBlocks     = ScsiDiskReadBlocks;
   ScsiDiskDevice->BlkIo.WriteBlocks    = ScsiDiskWriteBlocks;
   ScsiDiskDevice->BlkIo.FlushBlocks    = ScsiDiskFlushBlocks;
+  ScsiDiskDevice->BlkIo2.Media         = &ScsiDiskDevice->BlkIoMedia;
+  ScsiDiskDevice->BlkIo2.Reset         = ScsiDiskResetEx;
+  ScsiDiskDevice->BlkIo2.ReadBlocksEx  = ScsiDiskReadBlocksEx;
+  ScsiDiskDevice->BlkIo2.WriteBlocksEx = ScsiDiskWriteBlocksEx;
+  ScsiDiskDevice->BlkIo2.FlushBlocksEx = ScsiDiskFlushBlocksEx;
   ScsiDiskDevice->Handle               = Controller;
+  InitializeListHead (&ScsiDiskDevice->AsyncRequestQueue);
+  InitializeListHead (&ScsiDiskDevice->AsyncCommandQueue);
 
   ScsiIo->GetDeviceType (ScsiIo, &(ScsiDiskDevice->DeviceType));
   switch (ScsiDiskDevice->DeviceType) {
@@ -304,10 +311,13 @@ ScsiDiskDriverBindingStart (
     //
     if (DetermineInstallBlockIo(Controller)) {
       InitializeInstallDiskInfo(ScsiDiskDevice, Controller);
+      ScsiDiskDevice->NonBlockingIo = DetermineNonBlockingIo (Controller);
       Status = gBS->InstallMultipleProtocolInterfaces (
                       &Controller,
                       &gEfiBlockIoProtocolGuid,
                       &ScsiDiskDevice->BlkIo,
+                      &gEfiBlockIo2ProtocolGuid,
+                      &ScsiDiskDevice->BlkIo2,
                       &gEfiDiskInfoProtocolGuid,
                       &ScsiDiskDevice->DiskInfo,
                       NULL
@@ -377,6 +387,8 @@ ScsiDiskDriverBindingStop (
   EFI_BLOCK_IO_PROTOCOL *BlkIo;
   SCSI_DISK_DEV         *ScsiDiskDevice;
   EFI_STATUS            Status;
+  EFI_TPL               OldTpl;
+  UINTN                 CommandsInFlight;
 
   Status = gBS->OpenProtocol (
                   Controller,
@@ -391,10 +403,26 @@ ScsiDiskDriverBindingStop (
   }
 
   ScsiDiskDevice = SCSI_DISK_DEV_FROM_THIS (BlkIo);
+
+  //
+  // Drop the BlockIo2 commands that have not been issued yet. The ones in
+  // flight still reference the device, so it cannot go away before the
+  // pass thru completes them.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  ScsiDiskAbortAsyncCommands (ScsiDiskDevice);
+  CommandsInFlight = ScsiDiskDevice->AsyncCommandsInFlight;
+  gBS->RestoreTPL (OldTpl);
+  if (CommandsInFlight != 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
   Status = gBS->UninstallMultipleProtocolInterfaces (
                   Controller,
                   &gEfiBlockIoProtocolGuid,
                   &ScsiDiskDevice->BlkIo,
+                  &gEfiBlockIo2ProtocolGuid,
+                  &ScsiDiskDevice->BlkIo2,
                   &gEfiDiskInfoProtocolGuid,
                   &ScsiDiskDevice->DiskInfo,
                   NULL
@@ -522,6 +550,12 @@ ScsiDiskReadBlocks (
             &ScsiDiskDevice->BlkIo,
             &ScsiDiskDevice->BlkIo
             );
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIo2ProtocolGuid,
+            &ScsiDiskDevice->BlkIo2,
+            &ScsiDiskDevice->BlkIo2
+            );
       Status = EFI_MEDIA_CHANGED;
       goto Done;
     }
@@ -640,6 +674,12 @@ ScsiDiskWriteBlocks (
             &ScsiDiskDevice->BlkIo,
             &ScsiDiskDevice->BlkIo
             );
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIo2ProtocolGuid,
+            &ScsiDiskDevice->BlkIo2,
+            &ScsiDiskDevice->BlkIo2
+            );
       Status = EFI_MEDIA_CHANGED;
       goto Done;
     }
@@ -724,6 +764,698 @@ ScsiDiskFlushBlocks (
   return EFI_SUCCESS;
 }
 
+/**
+  Reset SCSI Disk through the BlockIo2 instance.
+
+  Commands of outstanding BlockIo2 requests that have not been issued yet
+  are dropped and their requests complete with EFI_ABORTED.
+
+  @param  This                 The pointer of EFI_BLOCK_IO2_PROTOCOL
+  @param  ExtendedVerification The flag about if extend verificate
+
+  @retval EFI_SUCCESS          The device was reset.
+  @retval EFI_DEVICE_ERROR     The device is not functioning properly and could
+                               not be reset.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskResetEx (
+  IN  EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN  BOOLEAN                 ExtendedVerification
+  )
+{
+  EFI_TPL       OldTpl;
+  SCSI_DISK_DEV *ScsiDiskDevice;
+  EFI_STATUS    Status;
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+  ScsiDiskDevice = SCSI_DISK_DEV_FROM_BLKIO2 (This);
+  ScsiDiskAbortAsyncCommands (ScsiDiskDevice);
+
+  Status = ScsiDiskReset (&ScsiDiskDevice->BlkIo, ExtendedVerification);
+
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  The function is to Read Block from SCSI Disk, non-blocking if Token->Event
+  is not NULL.
+
+  @param  This       The pointer of EFI_BLOCK_IO2_PROTOCOL.
+  @param  MediaId    The Id of Media detected
+  @param  Lba        The logic block address
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of Buffer
+  @param  Buffer     The buffer to fill the read out data
+
+  @retval EFI_SUCCESS           The read request was queued if Token->Event is
+                                not NULL, or the data was read out otherwise.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN     UINT32                  MediaId,
+  IN     EFI_LBA                 Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token,
+  IN     UINTN                   BufferSize,
+  OUT    VOID                    *Buffer
+  )
+{
+  SCSI_DISK_DEV       *ScsiDiskDevice;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  EFI_STATUS          Status;
+  UINTN               BlockSize;
+  UINTN               NumberOfBlocks;
+  BOOLEAN             MediaChange;
+  EFI_TPL             OldTpl;
+
+  ScsiDiskDevice = SCSI_DISK_DEV_FROM_BLKIO2 (This);
+
+  if ((Token == NULL) || (Token->Event == NULL)) {
+    return ScsiDiskReadBlocks (&ScsiDiskDevice->BlkIo, MediaId, Lba, BufferSize, Buffer);
+  }
+
+  MediaChange    = FALSE;
+  OldTpl         = gBS->RaiseTPL (TPL_CALLBACK);
+
+  if (!IS_DEVICE_FIXED(ScsiDiskDevice)) {
+
+    Status = ScsiDiskDetectMedia (ScsiDiskDevice, FALSE, &MediaChange);
+    if (EFI_ERROR (Status)) {
+      Status = EFI_DEVICE_ERROR;
+      goto Done;
+    }
+
+    if (MediaChange) {
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIoProtocolGuid,
+            &ScsiDiskDevice->BlkIo,
+            &ScsiDiskDevice->BlkIo
+            );
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIo2ProtocolGuid,
+            &ScsiDiskDevice->BlkIo2,
+            &ScsiDiskDevice->BlkIo2
+            );
+      Status = EFI_MEDIA_CHANGED;
+      goto Done;
+    }
+  }
+  //
+  // Get the intrinsic block size
+  //
+  Media           = ScsiDiskDevice->BlkIo2.Media;
+  BlockSize       = Media->BlockSize;
+
+  NumberOfBlocks  = BufferSize / BlockSize;
+
+  if (!(Media->MediaPresent)) {
+    Status = EFI_NO_MEDIA;
+    goto Done;
+  }
+
+  if (MediaId != Media->MediaId) {
+    Status = EFI_MEDIA_CHANGED;
+    goto Done;
+  }
+
+  if (Buffer == NULL) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  if (BufferSize == 0) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+    Status = EFI_SUCCESS;
+    goto Done;
+  }
+
+  if (BufferSize % BlockSize != 0) {
+    Status = EFI_BAD_BUFFER_SIZE;
+    goto Done;
+  }
+
+  if (Lba > Media->LastBlock) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  if ((Lba + NumberOfBlocks - 1) > Media->LastBlock) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  if ((Media->IoAlign > 1) && (((UINTN) Buffer & (Media->IoAlign - 1)) != 0)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  //
+  // If the pass thru can't execute commands non-blocking, read the data out
+  // right away and signal the token before returning.
+  //
+  if (!ScsiDiskDevice->NonBlockingIo) {
+    Token->TransactionStatus = ScsiDiskReadSectors (ScsiDiskDevice, Buffer, Lba, NumberOfBlocks);
+    gBS->SignalEvent (Token->Event);
+    Status = EFI_SUCCESS;
+    goto Done;
+  }
+
+  Status = ScsiDiskAsyncTransfer (ScsiDiskDevice, FALSE, Buffer, Lba, NumberOfBlocks, Token);
+
+Done:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  The function is to Write Block to SCSI Disk, non-blocking if Token->Event
+  is not NULL.
+
+  @param  This       The pointer of EFI_BLOCK_IO2_PROTOCOL.
+  @param  MediaId    The Id of Media detected
+  @param  Lba        The logic block address
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of Buffer
+  @param  Buffer     The buffer of data to be written into SCSI Disk
+
+  @retval EFI_SUCCESS           The write request was queued if Token->Event is
+                                not NULL, or the data was written otherwise.
+  @retval EFI_WRITE_PROTECTED   The device can not be written to.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN     UINT32                  MediaId,
+  IN     EFI_LBA                 Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token,
+  IN     UINTN                   BufferSize,
+  IN     VOID                    *Buffer
+  )
+{
+  SCSI_DISK_DEV       *ScsiDiskDevice;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  EFI_STATUS          Status;
+  UINTN               BlockSize;
+  UINTN               NumberOfBlocks;
+  BOOLEAN             MediaChange;
+  EFI_TPL             OldTpl;
+
+  ScsiDiskDevice = SCSI_DISK_DEV_FROM_BLKIO2 (This);
+
+  if ((Token == NULL) || (Token->Event == NULL)) {
+    return ScsiDiskWriteBlocks (&ScsiDiskDevice->BlkIo, MediaId, Lba, BufferSize, Buffer);
+  }
+
+  MediaChange    = FALSE;
+  OldTpl         = gBS->RaiseTPL (TPL_CALLBACK);
+
+  if (!IS_DEVICE_FIXED(ScsiDiskDevice)) {
+
+    Status = ScsiDiskDetectMedia (ScsiDiskDevice, FALSE, &MediaChange);
+    if (EFI_ERROR (Status)) {
+      Status = EFI_DEVICE_ERROR;
+      goto Done;
+    }
+
+    if (MediaChange) {
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIoProtocolGuid,
+            &ScsiDiskDevice->BlkIo,
+            &ScsiDiskDevice->BlkIo
+            );
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIo2ProtocolGuid,
+            &ScsiDiskDevice->BlkIo2,
+            &ScsiDiskDevice->BlkIo2
+            );
+      Status = EFI_MEDIA_CHANGED;
+      goto Done;
+    }
+  }
+  //
+  // Get the intrinsic block size
+  //
+  Media           = ScsiDiskDevice->BlkIo2.Media;
+  BlockSize       = Media->BlockSize;
+
+  NumberOfBlocks  = BufferSize / BlockSize;
+
+  if (!(Media->MediaPresent)) {
+    Status = EFI_NO_MEDIA;
+    goto Done;
+  }
+
+  if (MediaId != Media->MediaId) {
+    Status = EFI_MEDIA_CHANGED;
+    goto Done;
+  }
+
+  if (BufferSize == 0) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+    Status = EFI_SUCCESS;
+    goto Done;
+  }
+
+  if (Buffer == NULL) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  if (BufferSize % BlockSize != 0) {
+    Status = EFI_BAD_BUFFER_SIZE;
+    goto Done;
+  }
+
+  if (Lba > Media->LastBlock) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  if ((Lba + NumberOfBlocks - 1) > Media->LastBlock) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  if ((Media->IoAlign > 1) && (((UINTN) Buffer & (Media->IoAlign - 1)) != 0)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  //
+  // If the pass thru can't execute commands non-blocking, write the data
+  // right away and signal the token before returning.
+  //
+  if (!ScsiDiskDevice->NonBlockingIo) {
+    Token->TransactionStatus = ScsiDiskWriteSectors (ScsiDiskDevice, Buffer, Lba, NumberOfBlocks);
+    gBS->SignalEvent (Token->Event);
+    Status = EFI_SUCCESS;
+    goto Done;
+  }
+
+  Status = ScsiDiskAsyncTransfer (ScsiDiskDevice, TRUE, Buffer, Lba, NumberOfBlocks, Token);
+
+Done:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  Flush Block to Disk through the BlockIo2 instance.
+
+  Writes are not cached by this driver, so the token is signaled directly.
+
+  @param  This              The pointer of EFI_BLOCK_IO2_PROTOCOL
+  @param  Token             A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS       All outstanding data was written to the device
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token
+  )
+{
+  if ((Token != NULL) && (Token->Event != NULL)) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Split a BlockIo2 read/write request into READ/WRITE (10)/(16) commands and
+  queue them for non-blocking execution.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  Write           TRUE for a write request, FALSE for a read request
+  @param  Buffer          The data buffer of the request
+  @param  Lba             Logic block address
+  @param  NumberOfBlocks  The number of blocks to transfer
+  @param  Token           The BlockIo2 token signaled when the request completes
+
+  @retval EFI_SUCCESS           The request was queued.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+
+**/
+EFI_STATUS
+ScsiDiskAsyncTransfer (
+  IN  SCSI_DISK_DEV         *ScsiDiskDevice,
+  IN  BOOLEAN               Write,
+  IN  VOID                  *Buffer,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 NumberOfBlocks,
+  IN  EFI_BLOCK_IO2_TOKEN   *Token
+  )
+{
+  SCSI_BLKIO2_REQUEST             *Request;
+  SCSI_ASYNC_COMMAND              *Command;
+  LIST_ENTRY                      CommandList;
+  UINT8                           *PtrBuffer;
+  UINT32                          BlockSize;
+  UINT32                          ByteCount;
+  UINT32                          MaxBlock;
+  UINT32                          SectorCount;
+
+  BlockSize = ScsiDiskDevice->BlkIo.Media->BlockSize;
+
+  //
+  // Keep each command small enough that a large request spreads over several
+  // commands in flight, but never beyond what Read(10)/Read(16) can carry.
+  //
+  MaxBlock = SCSI_DISK_ASYNC_TRANSFER_SIZE / BlockSize;
+  if (MaxBlock == 0) {
+    MaxBlock = 1;
+  }
+  if (!ScsiDiskDevice->Cdb16Byte) {
+    MaxBlock = MIN (MaxBlock, 0xFFFF);
+  }
+
+  Request = AllocateZeroPool (sizeof (SCSI_BLKIO2_REQUEST));
+  if (Request == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Request->Signature = SCSI_BLKIO2_REQUEST_SIGNATURE;
+  Request->Token     = Token;
+  Request->Status    = EFI_SUCCESS;
+
+  InitializeListHead (&CommandList);
+  PtrBuffer = Buffer;
+
+  while (NumberOfBlocks > 0) {
+    SectorCount = (UINT32) MIN (NumberOfBlocks, MaxBlock);
+    ByteCount   = SectorCount * BlockSize;
+
+    Command = AllocateZeroPool (sizeof (SCSI_ASYNC_COMMAND));
+    if (Command == NULL) {
+      while (!IsListEmpty (&CommandList)) {
+        Command = SCSI_ASYNC_COMMAND_FROM_LINK (GetFirstNode (&CommandList));
+        RemoveEntryList (&Command->Link);
+        FreePool (Command);
+      }
+      FreePool (Request);
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Command->Signature      = SCSI_ASYNC_COMMAND_SIGNATURE;
+    Command->ScsiDiskDevice = ScsiDiskDevice;
+    Command->Request        = Request;
+    Command->Write          = Write;
+    Command->Buffer         = PtrBuffer;
+    Command->Lba            = Lba;
+    Command->SectorCount    = SectorCount;
+    ScsiDiskInitAsyncCommand (Command);
+
+    InsertTailList (&CommandList, &Command->Link);
+    Request->CommandsLeft++;
+
+    Lba            += SectorCount;
+    PtrBuffer      += ByteCount;
+    NumberOfBlocks -= SectorCount;
+  }
+
+  InsertTailList (&ScsiDiskDevice->AsyncRequestQueue, &Request->Link);
+  while (!IsListEmpty (&CommandList)) {
+    Command = SCSI_ASYNC_COMMAND_FROM_LINK (GetFirstNode (&CommandList));
+    RemoveEntryList (&Command->Link);
+    InsertTailList (&ScsiDiskDevice->AsyncCommandQueue, &Command->Link);
+  }
+
+  ScsiDiskIssueAsyncCommands (ScsiDiskDevice, TRUE);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Build the READ/WRITE (10)/(16) CDB and the request packet of a BlockIo2
+  command from its buffer, LBA and sector count.
+
+  @param  Command  The pointer of SCSI_ASYNC_COMMAND
+
+**/
+VOID
+ScsiDiskInitAsyncCommand (
+  IN OUT SCSI_ASYNC_COMMAND  *Command
+  )
+{
+  EFI_SCSI_IO_SCSI_REQUEST_PACKET *Packet;
+  UINT32                          ByteCount;
+
+  ByteCount = Command->SectorCount * Command->ScsiDiskDevice->BlkIo.Media->BlockSize;
+
+  //
+  // The timeout follows the same rule as ScsiDiskReadSectors().
+  //
+  Packet = &Command->Packet;
+  ZeroMem (Packet, sizeof (EFI_SCSI_IO_SCSI_REQUEST_PACKET));
+  ZeroMem (Command->Cdb, sizeof (Command->Cdb));
+  Packet->Timeout         = EFI_TIMER_PERIOD_SECONDS (ByteCount / 2100000 + 31);
+  Packet->SenseData       = &Command->SenseData;
+  Packet->SenseDataLength = (UINT8) sizeof (EFI_SCSI_SENSE_DATA);
+  Packet->Cdb             = Command->Cdb;
+  if (Command->Write) {
+    Packet->OutDataBuffer     = Command->Buffer;
+    Packet->OutTransferLength = ByteCount;
+    Packet->DataDirection     = EFI_SCSI_DATA_OUT;
+  } else {
+    Packet->InDataBuffer      = Command->Buffer;
+    Packet->InTransferLength  = ByteCount;
+    Packet->DataDirection     = EFI_SCSI_DATA_IN;
+  }
+
+  if (!Command->ScsiDiskDevice->Cdb16Byte) {
+    Command->Cdb[0] = Command->Write ? EFI_SCSI_OP_WRITE10 : EFI_SCSI_OP_READ10;
+    WriteUnaligned32 ((UINT32 *) &Command->Cdb[2], SwapBytes32 ((UINT32) Command->Lba));
+    WriteUnaligned16 ((UINT16 *) &Command->Cdb[7], SwapBytes16 ((UINT16) Command->SectorCount));
+    Packet->CdbLength = SCSI_DISK_CDB_LENGTH_TEN;
+  } else {
+    Command->Cdb[0] = Command->Write ? EFI_SCSI_OP_WRITE16 : EFI_SCSI_OP_READ16;
+    WriteUnaligned64 ((UINT64 *) &Command->Cdb[2], SwapBytes64 (Command->Lba));
+    WriteUnaligned32 ((UINT32 *) &Command->Cdb[10], SwapBytes32 (Command->SectorCount));
+    Packet->CdbLength = SCSI_DISK_CDB_LENGTH_SIXTEEN;
+  }
+}
+
+/**
+  Issue queued BlockIo2 commands until SCSI_DISK_MAX_ASYNC_COMMANDS of them
+  are in flight or the queue is empty.
+
+  A command the pass thru does not accept is carried out through the blocking
+  path if CanBlock is TRUE. Otherwise it fails with EFI_DEVICE_ERROR.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  CanBlock        FALSE when called from a notification function
+
+**/
+VOID
+ScsiDiskIssueAsyncCommands (
+  IN  SCSI_DISK_DEV         *ScsiDiskDevice,
+  IN  BOOLEAN               CanBlock
+  )
+{
+  SCSI_ASYNC_COMMAND  *Command;
+  EFI_STATUS          Status;
+
+  while (!IsListEmpty (&ScsiDiskDevice->AsyncCommandQueue) &&
+         (ScsiDiskDevice->AsyncCommandsInFlight < SCSI_DISK_MAX_ASYNC_COMMANDS)) {
+    Command = SCSI_ASYNC_COMMAND_FROM_LINK (GetFirstNode (&ScsiDiskDevice->AsyncCommandQueue));
+    RemoveEntryList (&Command->Link);
+
+    Status = gBS->CreateEvent (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    ScsiDiskAsyncCommandNotify,
+                    Command,
+                    &Command->Event
+                    );
+    if (!EFI_ERROR (Status)) {
+      Status = ScsiDiskDevice->ScsiIo->ExecuteScsiCommand (
+                                         ScsiDiskDevice->ScsiIo,
+                                         &Command->Packet,
+                                         Command->Event
+                                         );
+      if (!EFI_ERROR (Status)) {
+        ScsiDiskDevice->AsyncCommandsInFlight++;
+        continue;
+      }
+
+      gBS->CloseEvent (Command->Event);
+      Command->Event = NULL;
+
+      if ((Status == EFI_NOT_READY) && (ScsiDiskDevice->AsyncCommandsInFlight != 0)) {
+        //
+        // The pass thru queue is full; try again when one of ours completes.
+        //
+        InsertHeadList (&ScsiDiskDevice->AsyncCommandQueue, &Command->Link);
+        break;
+      }
+    }
+
+    //
+    // The command can't be executed non-blocking. Outside of a notification
+    // function, run it through the blocking path which also carries the
+    // retry and backoff handling. A notification function must not wait for
+    // the device, so the command fails there.
+    //
+    if (CanBlock) {
+      if (Command->Write) {
+        Status = ScsiDiskWriteSectors (ScsiDiskDevice, Command->Buffer, Command->Lba, Command->SectorCount);
+      } else {
+        Status = ScsiDiskReadSectors (ScsiDiskDevice, Command->Buffer, Command->Lba, Command->SectorCount);
+      }
+    } else {
+      DEBUG ((EFI_D_ERROR, "ScsiDiskIssueAsyncCommands: Lba 0x%lx can't be issued - %r\n", Command->Lba, Status));
+    }
+    if (EFI_ERROR (Status)) {
+      Command->Request->Status = EFI_DEVICE_ERROR;
+    }
+    ScsiDiskCompleteAsyncCommand (Command);
+  }
+}
+
+/**
+  Notification function of a BlockIo2 command, called when the pass thru
+  completes it.
+
+  @param  Event    The event of the command.
+  @param  Context  The pointer of SCSI_ASYNC_COMMAND.
+
+**/
+VOID
+EFIAPI
+ScsiDiskAsyncCommandNotify (
+  IN  EFI_EVENT             Event,
+  IN  VOID                  *Context
+  )
+{
+  SCSI_ASYNC_COMMAND              *Command;
+  SCSI_DISK_DEV                   *ScsiDiskDevice;
+  EFI_SCSI_IO_SCSI_REQUEST_PACKET *Packet;
+  UINT32                          ByteCount;
+  UINT32                          TransferLength;
+  UINTN                           SenseCounts;
+
+  Command        = (SCSI_ASYNC_COMMAND *) Context;
+  ScsiDiskDevice = Command->ScsiDiskDevice;
+  Packet         = &Command->Packet;
+
+  gBS->CloseEvent (Event);
+  Command->Event = NULL;
+  ScsiDiskDevice->AsyncCommandsInFlight--;
+
+  ByteCount      = Command->SectorCount * ScsiDiskDevice->BlkIo.Media->BlockSize;
+  TransferLength = Command->Write ? Packet->OutTransferLength : Packet->InTransferLength;
+
+  if ((Packet->HostAdapterStatus != EFI_SCSI_IO_STATUS_HOST_ADAPTER_OK) ||
+      (Packet->TargetStatus != EFI_SCSI_IO_STATUS_TARGET_GOOD) ||
+      (TransferLength != ByteCount)) {
+    DEBUG ((EFI_D_WARN, "ScsiDiskAsyncCommandNotify: Lba 0x%lx failed (%x/%x)\n",
+      Command->Lba, Packet->HostAdapterStatus, Packet->TargetStatus));
+
+    //
+    // Retrying can't help when the media is gone or the device reports a
+    // media or hardware error.
+    //
+    SenseCounts = Packet->SenseDataLength / sizeof (EFI_SCSI_SENSE_DATA);
+    if ((Command->RetryCount < SCSI_DISK_MAX_ASYNC_RETRY) &&
+        !ScsiDiskIsNoMedia (&Command->SenseData, SenseCounts) &&
+        !ScsiDiskIsMediaError (&Command->SenseData, SenseCounts) &&
+        !ScsiDiskIsHardwareError (&Command->SenseData, SenseCounts)) {
+      //
+      // Queue the command again ahead of the others. This runs at TPL_CALLBACK,
+      // so it must not go through the blocking path and wait for the device.
+      //
+      Command->RetryCount++;
+      ScsiDiskInitAsyncCommand (Command);
+      InsertHeadList (&ScsiDiskDevice->AsyncCommandQueue, &Command->Link);
+      ScsiDiskIssueAsyncCommands (ScsiDiskDevice, FALSE);
+      return;
+    }
+
+    Command->Request->Status = EFI_DEVICE_ERROR;
+  }
+
+  ScsiDiskCompleteAsyncCommand (Command);
+  ScsiDiskIssueAsyncCommands (ScsiDiskDevice, FALSE);
+}
+
+/**
+  Account a finished BlockIo2 command to its request and free it. The token
+  of the request is signaled when its last command finishes.
+
+  @param  Command  The pointer of SCSI_ASYNC_COMMAND
+
+**/
+VOID
+ScsiDiskCompleteAsyncCommand (
+  IN  SCSI_ASYNC_COMMAND    *Command
+  )
+{
+  SCSI_BLKIO2_REQUEST *Request;
+
+  Request = Command->Request;
+  FreePool (Command);
+
+  ASSERT (Request->CommandsLeft > 0);
+  Request->CommandsLeft--;
+  if (Request->CommandsLeft == 0) {
+    RemoveEntryList (&Request->Link);
+    Request->Token->TransactionStatus = Request->Status;
+    gBS->SignalEvent (Request->Token->Event);
+    FreePool (Request);
+  }
+}
+
+/**
+  Drop the BlockIo2 commands that have not been issued yet, and complete the
+  requests left without commands with EFI_ABORTED.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskAbortAsyncCommands (
+  IN  SCSI_DISK_DEV         *ScsiDiskDevice
+  )
+{
+  SCSI_ASYNC_COMMAND  *Command;
+
+  while (!IsListEmpty (&ScsiDiskDevice->AsyncCommandQueue)) {
+    Command = SCSI_ASYNC_COMMAND_FROM_LINK (GetFirstNode (&ScsiDiskDevice->AsyncCommandQueue));
+    RemoveEntryList (&Command->Link);
+    Command->Request->Status = EFI_ABORTED;
+    ScsiDiskCompleteAsyncCommand (Command);
+  }
+}
+
 
 /**
   Detect Device and read out capacity ,if error occurs, parse the sense key.
@@ -2974,6 +3706,35 @@ DetermineInstallBlockIo (
   return FALSE;
 }
 
+/**
+  Determine if the SCSI commands of the device can be executed non-blocking.
+
+  Only the Extended SCSI Pass Thru Protocol is considered, since the SCSI bus
+  driver passes the Event of ExecuteScsiCommand() straight through to it.
+
+  @param  ChildHandle  Child Handle to retrieve Parent information.
+
+  @retval  TRUE    Non-blocking I/O is supported.
+  @retval  FALSE   Non-blocking I/O is not supported.
+
+**/
+BOOLEAN
+DetermineNonBlockingIo (
+  IN  EFI_HANDLE      ChildHandle
+  )
+{
+  EFI_EXT_SCSI_PASS_THRU_PROTOCOL       *ExtScsiPassThru;
+
+  ExtScsiPassThru = (EFI_EXT_SCSI_PASS_THRU_PROTOCOL *)GetParentProtocol (&gEfiExtScsiPassThruProtocolGuid, ChildHandle);
+  if (ExtScsiPassThru != NULL) {
+    if ((ExtScsiPassThru->Mode->Attributes & EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_NONBLOCKIO) != 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 /**
   Search protocol database and check to see if the protocol
   specified by ProtocolGuid is present on a ControllerHandle and opened by
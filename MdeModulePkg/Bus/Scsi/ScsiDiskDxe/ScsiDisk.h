@@ -22,6 +22,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/ScsiIo.h>
 #include <Protocol/ComponentName.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/DriverBinding.h>
 #include <Protocol/ScsiPassThruExt.h>
 #include <Protocol/ScsiPassThru.h>
@@ -50,6 +51,7 @@ typedef struct {
   EFI_HANDLE                Handle;
 
   EFI_BLOCK_IO_PROTOCOL     BlkIo;
+  EFI_BLOCK_IO2_PROTOCOL    BlkIo2;
   EFI_BLOCK_IO_MEDIA        BlkIoMedia;
   EFI_SCSI_IO_PROTOCOL      *ScsiIo;
   UINT8                     DeviceType;
@@ -75,12 +77,87 @@ typedef struct {
   // The flag indicates if 16-byte command can be used
   //
   BOOLEAN                   Cdb16Byte;
+
+  //
+  // The flag indicates if the underlying pass thru honors the Event of
+  // ExecuteScsiCommand(), so that BlockIo2 requests can be pipelined
+  //
+  BOOLEAN                   NonBlockingIo;
+
+  //
+  // BlockIo2 requests (SCSI_BLKIO2_REQUEST) not completed yet, and the
+  // commands (SCSI_ASYNC_COMMAND) split from them that wait to be issued
+  //
+  LIST_ENTRY                AsyncRequestQueue;
+  LIST_ENTRY                AsyncCommandQueue;
+  UINTN                     AsyncCommandsInFlight;
 } SCSI_DISK_DEV;
 
 #define SCSI_DISK_DEV_FROM_THIS(a)  CR (a, SCSI_DISK_DEV, BlkIo, SCSI_DISK_DEV_SIGNATURE)
+#define SCSI_DISK_DEV_FROM_BLKIO2(a)  CR (a, SCSI_DISK_DEV, BlkIo2, SCSI_DISK_DEV_SIGNATURE)
 
 #define SCSI_DISK_DEV_FROM_DISKINFO(a) CR (a, SCSI_DISK_DEV, DiskInfo, SCSI_DISK_DEV_SIGNATURE)
 
+//
+// BlockIo2 requests are split into commands of at most this many bytes, and
+// at most SCSI_DISK_MAX_ASYNC_COMMANDS of them are kept in flight per device
+//
+#define SCSI_DISK_ASYNC_TRANSFER_SIZE  SIZE_1MB
+#define SCSI_DISK_MAX_ASYNC_COMMANDS   8
+
+//
+// A failed BlockIo2 command is issued again at most this many times
+//
+#define SCSI_DISK_MAX_ASYNC_RETRY      3
+
+#define SCSI_DISK_CDB_LENGTH_TEN       10
+#define SCSI_DISK_CDB_LENGTH_SIXTEEN   16
+
+//
+// One non-blocking BlockIo2 read/write request
+//
+#define SCSI_BLKIO2_REQUEST_SIGNATURE SIGNATURE_32 ('s', 'b', '2', 'r')
+
+typedef struct {
+  UINT32                    Signature;
+  LIST_ENTRY                Link;
+
+  EFI_BLOCK_IO2_TOKEN       *Token;
+  //
+  // Number of commands of this request that have not completed
+  //
+  UINTN                     CommandsLeft;
+  EFI_STATUS                Status;
+} SCSI_BLKIO2_REQUEST;
+
+#define SCSI_BLKIO2_REQUEST_FROM_LINK(a) CR (a, SCSI_BLKIO2_REQUEST, Link, SCSI_BLKIO2_REQUEST_SIGNATURE)
+
+//
+// One READ/WRITE (10)/(16) command issued on behalf of a BlockIo2 request
+//
+#define SCSI_ASYNC_COMMAND_SIGNATURE SIGNATURE_32 ('s', 'a', 'c', 'd')
+
+typedef struct {
+  UINT32                          Signature;
+  LIST_ENTRY                      Link;
+
+  SCSI_DISK_DEV                   *ScsiDiskDevice;
+  SCSI_BLKIO2_REQUEST             *Request;
+  EFI_EVENT                       Event;
+
+  BOOLEAN                         Write;
+  UINT8                           *Buffer;
+  EFI_LBA                         Lba;
+  UINT32                          SectorCount;
+  UINT8                           RetryCount;
+
+  EFI_SCSI_IO_SCSI_REQUEST_PACKET Packet;
+  UINT8                           Cdb[SCSI_DISK_CDB_LENGTH_SIXTEEN];
+  EFI_SCSI_SENSE_DATA             SenseData;
+} SCSI_ASYNC_COMMAND;
+
+#define SCSI_ASYNC_COMMAND_FROM_LINK(a) CR (a, SCSI_ASYNC_COMMAND, Link, SCSI_ASYNC_COMMAND_SIGNATURE)
+
 //
 // Global Variables
 //
@@ -410,6 +487,213 @@ ScsiDiskFlushBlocks (
   );
 
 
+/**
+  Reset SCSI Disk through the BlockIo2 instance.
+
+  Commands of outstanding BlockIo2 requests that have not been issued yet
+  are dropped and their requests complete with EFI_ABORTED.
+
+  @param  This                 The pointer of EFI_BLOCK_IO2_PROTOCOL
+  @param  ExtendedVerification The flag about if extend verificate
+
+  @retval EFI_SUCCESS          The device was reset.
+  @retval EFI_DEVICE_ERROR     The device is not functioning properly and could
+                               not be reset.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskResetEx (
+  IN  EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN  BOOLEAN                 ExtendedVerification
+  );
+
+
+/**
+  The function is to Read Block from SCSI Disk, non-blocking if Token->Event
+  is not NULL.
+
+  @param  This       The pointer of EFI_BLOCK_IO2_PROTOCOL.
+  @param  MediaId    The Id of Media detected
+  @param  Lba        The logic block address
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of Buffer
+  @param  Buffer     The buffer to fill the read out data
+
+  @retval EFI_SUCCESS           The read request was queued if Token->Event is
+                                not NULL, or the data was read out otherwise.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN     UINT32                  MediaId,
+  IN     EFI_LBA                 Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token,
+  IN     UINTN                   BufferSize,
+  OUT    VOID                    *Buffer
+  );
+
+
+/**
+  The function is to Write Block to SCSI Disk, non-blocking if Token->Event
+  is not NULL.
+
+  @param  This       The pointer of EFI_BLOCK_IO2_PROTOCOL.
+  @param  MediaId    The Id of Media detected
+  @param  Lba        The logic block address
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of Buffer
+  @param  Buffer     The buffer of data to be written into SCSI Disk
+
+  @retval EFI_SUCCESS           The write request was queued if Token->Event is
+                                not NULL, or the data was written otherwise.
+  @retval EFI_WRITE_PROTECTED   The device can not be written to.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN     UINT32                  MediaId,
+  IN     EFI_LBA                 Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token,
+  IN     UINTN                   BufferSize,
+  IN     VOID                    *Buffer
+  );
+
+
+/**
+  Flush Block to Disk through the BlockIo2 instance.
+
+  Writes are not cached by this driver, so the token is signaled directly.
+
+  @param  This              The pointer of EFI_BLOCK_IO2_PROTOCOL
+  @param  Token             A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS       All outstanding data was written to the device
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token
+  );
+
+
+/**
+  Split a BlockIo2 read/write request into READ/WRITE (10)/(16) commands and
+  queue them for non-blocking execution.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  Write           TRUE for a write request, FALSE for a read request
+  @param  Buffer          The data buffer of the request
+  @param  Lba             Logic block address
+  @param  NumberOfBlocks  The number of blocks to transfer
+  @param  Token           The BlockIo2 token signaled when the request completes
+
+  @retval EFI_SUCCESS           The request was queued.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+
+**/
+EFI_STATUS
+ScsiDiskAsyncTransfer (
+  IN  SCSI_DISK_DEV         *ScsiDiskDevice,
+  IN  BOOLEAN               Write,
+  IN  VOID                  *Buffer,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 NumberOfBlocks,
+  IN  EFI_BLOCK_IO2_TOKEN   *Token
+  );
+
+
+/**
+  Build the READ/WRITE (10)/(16) CDB and the request packet of a BlockIo2
+  command from its buffer, LBA and sector count.
+
+  @param  Command  The pointer of SCSI_ASYNC_COMMAND
+
+**/
+VOID
+ScsiDiskInitAsyncCommand (
+  IN OUT SCSI_ASYNC_COMMAND  *Command
+  );
+
+
+/**
+  Issue queued BlockIo2 commands until SCSI_DISK_MAX_ASYNC_COMMANDS of them
+  are in flight or the queue is empty.
+
+  A command the pass thru does not accept is carried out through the blocking
+  path if CanBlock is TRUE. Otherwise it fails with EFI_DEVICE_ERROR.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  CanBlock        FALSE when called from a notification function
+
+**/
+VOID
+ScsiDiskIssueAsyncCommands (
+  IN  SCSI_DISK_DEV         *ScsiDiskDevice,
+  IN  BOOLEAN               CanBlock
+  );
+
+
+/**
+  Notification function of a BlockIo2 command, called when the pass thru
+  completes it.
+
+  @param  Event    The event of the command.
+  @param  Context  The pointer of SCSI_ASYNC_COMMAND.
+
+**/
+VOID
+EFIAPI
+ScsiDiskAsyncCommandNotify (
+  IN  EFI_EVENT             Event,
+  IN  VOID                  *Context
+  );
+
+
+/**
+  Account a finished BlockIo2 command to its request and free it. The token
+  of the request is signaled when its last command finishes.
+
+  @param  Command  The pointer of SCSI_ASYNC_COMMAND
+
+**/
+VOID
+ScsiDiskCompleteAsyncCommand (
+  IN  SCSI_ASYNC_COMMAND    *Command
+  );
+
+
+/**
+  Drop the BlockIo2 commands that have not been issued yet, and complete the
+  requests left without commands with EFI_ABORTED.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskAbortAsyncCommands (
+  IN  SCSI_DISK_DEV         *ScsiDiskDevice
+  );
+
+
 /**
   Provides inquiry information for the controller type.
   
@@ -967,6 +1251,23 @@ DetermineInstallBlockIo (
   IN  EFI_HANDLE      ChildHandle
   );
 
+/**
+  Determine if the SCSI commands of the device can be executed non-blocking.
+
+  Only the Extended SCSI Pass Thru Protocol is considered, since the SCSI bus
+  driver passes the Event of ExecuteScsiCommand() straight through to it.
+
+  @param  ChildHandle  Child Handle to retrieve Parent information.
+
+  @retval  TRUE    Non-blocking I/O is supported.
+  @retval  FALSE   Non-blocking I/O is not supported.
+
+**/
+BOOLEAN
+DetermineNonBlockingIo (
+  IN  EFI_HANDLE      ChildHandle
+  );
+
 /**
   Initialize the installation of DiskInfo protocol.
 
@@ -2,7 +2,7 @@
 
     Usb Bus Driver Binding and Bus IO Protocol.
 
-Copyright (c) 2004 - 2013, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2004 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -31,6 +31,12 @@ EFI_USB_IO_PROTOCOL mUsbIoProtocol = {
   UsbIoPortReset
 };
 
+EDKII_USB_IO_ASYNC_BULK_PROTOCOL mUsbIoAsyncBulkProtocol = {
+  UsbIoAsyncBulkTransfer,
+  UsbIoCancelAsyncBulkTransfer,
+  UsbIoPollAsyncBulkTransfer
+};
+
 EFI_DRIVER_BINDING_PROTOCOL mUsbBusDriverBinding = {
   UsbBusControllerDriverSupported,
   UsbBusControllerDriverStart,
@@ -880,6 +886,150 @@ ON_EXIT:
 }
 
 
+/**
+  Queue a bulk transfer to the device endpoint without waiting for it
+  to complete.
+
+  @param  This                   The USB IO asynchronous bulk instance.
+  @param  DeviceEndpoint         The device endpoint.
+  @param  Data                   The data to transfer.
+  @param  DataLength             The length of the data to transfer.
+  @param  Callback               Function to call when the transfer finishes.
+  @param  Context                Context to the callback function.
+
+  @retval EFI_SUCCESS            The bulk transfer is queued.
+  @retval EFI_INVALID_PARAMETER  Some parameters are invalid.
+  @retval Others                 Failed to queue the transfer.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoAsyncBulkTransfer (
+  IN     EDKII_USB_IO_ASYNC_BULK_PROTOCOL  *This,
+  IN     UINT8                             DeviceEndpoint,
+  IN OUT VOID                              *Data,
+  IN     UINTN                             DataLength,
+  IN     EFI_ASYNC_USB_TRANSFER_CALLBACK   Callback,
+  IN     VOID                              *Context OPTIONAL
+  )
+{
+  USB_DEVICE              *Dev;
+  USB_INTERFACE           *UsbIf;
+  USB_ENDPOINT_DESC       *EpDesc;
+  EFI_TPL                 OldTpl;
+  EFI_STATUS              Status;
+
+  if ((USB_ENDPOINT_ADDR (DeviceEndpoint) == 0) || (USB_ENDPOINT_ADDR (DeviceEndpoint) > 15) ||
+      (Callback == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl  = gBS->RaiseTPL (USB_BUS_TPL);
+
+  UsbIf   = USB_INTERFACE_FROM_ASYNC_BULK (This);
+  Dev     = UsbIf->Device;
+
+  EpDesc  = UsbGetEndpointDesc (UsbIf, DeviceEndpoint);
+
+  if ((EpDesc == NULL) || (USB_ENDPOINT_TYPE (&EpDesc->Desc) != USB_ENDPOINT_BULK)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto ON_EXIT;
+  }
+
+  Status = Dev->Bus->AsyncBulkHc->AsyncBulkTransfer (
+                                    Dev->Bus->AsyncBulkHc,
+                                    Dev->Address,
+                                    DeviceEndpoint,
+                                    Dev->Speed,
+                                    EpDesc->Desc.MaxPacketSize,
+                                    Data,
+                                    DataLength,
+                                    &Dev->Translator,
+                                    Callback,
+                                    Context
+                                    );
+
+ON_EXIT:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+
+/**
+  Cancel the bulk transfers still queued to the device endpoint.
+
+  @param  This                   The USB IO asynchronous bulk instance.
+  @param  DeviceEndpoint         The device endpoint.
+
+  @retval EFI_SUCCESS            The queued transfers, if any, are cancelled.
+  @retval EFI_INVALID_PARAMETER  Some parameters are invalid.
+  @retval Others                 Failed to stop the endpoint.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoCancelAsyncBulkTransfer (
+  IN     EDKII_USB_IO_ASYNC_BULK_PROTOCOL  *This,
+  IN     UINT8                             DeviceEndpoint
+  )
+{
+  USB_DEVICE              *Dev;
+  USB_INTERFACE           *UsbIf;
+  USB_ENDPOINT_DESC       *EpDesc;
+  EFI_TPL                 OldTpl;
+  EFI_STATUS              Status;
+
+  if ((USB_ENDPOINT_ADDR (DeviceEndpoint) == 0) || (USB_ENDPOINT_ADDR (DeviceEndpoint) > 15)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl  = gBS->RaiseTPL (USB_BUS_TPL);
+
+  UsbIf   = USB_INTERFACE_FROM_ASYNC_BULK (This);
+  Dev     = UsbIf->Device;
+
+  EpDesc  = UsbGetEndpointDesc (UsbIf, DeviceEndpoint);
+
+  if ((EpDesc == NULL) || (USB_ENDPOINT_TYPE (&EpDesc->Desc) != USB_ENDPOINT_BULK)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto ON_EXIT;
+  }
+
+  Status = Dev->Bus->AsyncBulkHc->CancelAsyncBulkTransfer (
+                                    Dev->Bus->AsyncBulkHc,
+                                    Dev->Address,
+                                    DeviceEndpoint
+                                    );
+
+ON_EXIT:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+
+/**
+  Retire the queued bulk transfers that have finished and invoke
+  their callbacks.
+
+  @param  This                   The USB IO asynchronous bulk instance.
+
+  @retval EFI_SUCCESS            The finished transfers, if any, are retired.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoPollAsyncBulkTransfer (
+  IN     EDKII_USB_IO_ASYNC_BULK_PROTOCOL  *This
+  )
+{
+  USB_INTERFACE           *UsbIf;
+
+  UsbIf = USB_INTERFACE_FROM_ASYNC_BULK (This);
+
+  return UsbIf->Device->Bus->AsyncBulkHc->PollAsyncBulkTransfer (UsbIf->Device->Bus->AsyncBulkHc);
+}
+
+
 /**
   Install Usb Bus Protocol on host controller, and start the Usb bus.
 
@@ -974,6 +1124,22 @@ UsbBusBuildProtocol (
     if (UsbBus->Usb2Hc->MajorRevision == 0x3) {
       UsbBus->MaxDevices = 256;
     }
+
+    //
+    // Host controllers that can queue bulk transfers let the class
+    // drivers pipeline their bulk traffic. It is optional.
+    //
+    Status = gBS->OpenProtocol (
+                    Controller,
+                    &gEdkiiUsbHcAsyncBulkProtocolGuid,
+                    (VOID **) &(UsbBus->AsyncBulkHc),
+                    This->DriverBindingHandle,
+                    Controller,
+                    EFI_OPEN_PROTOCOL_GET_PROTOCOL
+                    );
+    if (EFI_ERROR (Status)) {
+      UsbBus->AsyncBulkHc = NULL;
+    }
   }
 
   UsbHcReset (UsbBus, EFI_USB_HC_RESET_GLOBAL);
@@ -2,7 +2,7 @@
 
     Usb Bus Driver Binding and Bus IO Protocol.
 
-Copyright (c) 2004 - 2012, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2004 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -22,6 +22,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/Usb2HostController.h>
 #include <Protocol/UsbHostController.h>
 #include <Protocol/UsbIo.h>
+#include <Protocol/UsbHcAsyncBulk.h>
+#include <Protocol/UsbIoAsyncBulk.h>
 #include <Protocol/DevicePath.h>
 
 #include <Library/BaseLib.h>
@@ -150,6 +152,9 @@ typedef struct _USB_HUB_API    USB_HUB_API;
 #define USB_INTERFACE_FROM_USBIO(a) \
           CR(a, USB_INTERFACE, UsbIo, USB_INTERFACE_SIGNATURE)
 
+#define USB_INTERFACE_FROM_ASYNC_BULK(a) \
+          CR(a, USB_INTERFACE, AsyncBulk, USB_INTERFACE_SIGNATURE)
+
 #define USB_BUS_FROM_THIS(a) \
           CR(a, USB_BUS, BusId, USB_BUS_SIGNATURE)
 
@@ -218,6 +223,11 @@ struct _USB_INTERFACE {
   EFI_DEVICE_PATH_PROTOCOL  *DevicePath;
   BOOLEAN                   IsManaged;
 
+  //
+  // Only installed when the host controller can queue bulk transfers
+  //
+  EDKII_USB_IO_ASYNC_BULK_PROTOCOL AsyncBulk;
+
   //
   // Hub device special data
   //
@@ -254,6 +264,7 @@ struct _USB_BUS {
   EFI_DEVICE_PATH_PROTOCOL  *DevicePath;
   EFI_USB2_HC_PROTOCOL      *Usb2Hc;
   EFI_USB_HC_PROTOCOL       *UsbHc;
+  EDKII_USB_HC_ASYNC_BULK_PROTOCOL *AsyncBulkHc;
 
   //
   // Recorded the max supported usb devices.
@@ -663,6 +674,66 @@ UsbIoPortReset (
   IN EFI_USB_IO_PROTOCOL  *This
   );
 
+/**
+  Queue a bulk transfer to the device endpoint without waiting for it
+  to complete.
+
+  @param  This                   The USB IO asynchronous bulk instance.
+  @param  DeviceEndpoint         The device endpoint.
+  @param  Data                   The data to transfer.
+  @param  DataLength             The length of the data to transfer.
+  @param  Callback               Function to call when the transfer finishes.
+  @param  Context                Context to the callback function.
+
+  @retval EFI_SUCCESS            The bulk transfer is queued.
+  @retval EFI_INVALID_PARAMETER  Some parameters are invalid.
+  @retval Others                 Failed to queue the transfer.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoAsyncBulkTransfer (
+  IN     EDKII_USB_IO_ASYNC_BULK_PROTOCOL  *This,
+  IN     UINT8                             DeviceEndpoint,
+  IN OUT VOID                              *Data,
+  IN     UINTN                             DataLength,
+  IN     EFI_ASYNC_USB_TRANSFER_CALLBACK   Callback,
+  IN     VOID                              *Context OPTIONAL
+  );
+
+/**
+  Cancel the bulk transfers still queued to the device endpoint.
+
+  @param  This                   The USB IO asynchronous bulk instance.
+  @param  DeviceEndpoint         The device endpoint.
+
+  @retval EFI_SUCCESS            The queued transfers, if any, are cancelled.
+  @retval EFI_INVALID_PARAMETER  Some parameters are invalid.
+  @retval Others                 Failed to stop the endpoint.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoCancelAsyncBulkTransfer (
+  IN     EDKII_USB_IO_ASYNC_BULK_PROTOCOL  *This,
+  IN     UINT8                             DeviceEndpoint
+  );
+
+/**
+  Retire the queued bulk transfers that have finished and invoke
+  their callbacks.
+
+  @param  This                   The USB IO asynchronous bulk instance.
+
+  @retval EFI_SUCCESS            The finished transfers, if any, are retired.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoPollAsyncBulkTransfer (
+  IN     EDKII_USB_IO_ASYNC_BULK_PROTOCOL  *This
+  );
+
 /**
   Install Usb Bus Protocol on host controller, and start the Usb bus.
 
@@ -763,6 +834,7 @@ UsbBusControllerDriverStop (
   );
 
 extern EFI_USB_IO_PROTOCOL            mUsbIoProtocol;
+extern EDKII_USB_IO_ASYNC_BULK_PROTOCOL mUsbIoAsyncBulkProtocol;
 extern EFI_DRIVER_BINDING_PROTOCOL    mUsbBusDriverBinding;
 extern EFI_COMPONENT_NAME_PROTOCOL    mUsbBusComponentName;
 extern EFI_COMPONENT_NAME2_PROTOCOL   mUsbBusComponentName2;
@@ -2,7 +2,7 @@
 
     Usb bus enumeration support.
 
-Copyright (c) 2007 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2007 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -61,6 +61,14 @@ UsbFreeInterface (
 {
   UsbCloseHostProtoByChild (UsbIf->Device->Bus, UsbIf->Handle);
 
+  if (UsbIf->AsyncBulk.AsyncBulkTransfer != NULL) {
+    gBS->UninstallProtocolInterface (
+           UsbIf->Handle,
+           &gEdkiiUsbIoAsyncBulkProtocolGuid,
+           &UsbIf->AsyncBulk
+           );
+  }
+
   gBS->UninstallMultipleProtocolInterfaces (
          UsbIf->Handle,
          &gEfiDevicePathProtocolGuid,
@@ -172,6 +180,30 @@ UsbCreateInterface (
     goto ON_ERROR;
   }
 
+  //
+  // Let the class drivers queue bulk transfers if the host controller
+  // supports it. The interface works without it.
+  //
+  if (Device->Bus->AsyncBulkHc != NULL) {
+    CopyMem (
+      &(UsbIf->AsyncBulk),
+      &mUsbIoAsyncBulkProtocol,
+      sizeof (EDKII_USB_IO_ASYNC_BULK_PROTOCOL)
+      );
+
+    Status = gBS->InstallProtocolInterface (
+                    &UsbIf->Handle,
+                    &gEdkiiUsbIoAsyncBulkProtocolGuid,
+                    EFI_NATIVE_INTERFACE,
+                    &UsbIf->AsyncBulk
+                    );
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_WARN, "UsbCreateInterface: failed to install async bulk - %r\n", Status));
+      ZeroMem (&(UsbIf->AsyncBulk), sizeof (EDKII_USB_IO_ASYNC_BULK_PROTOCOL));
+    }
+  }
+
   return UsbIf;
 
 ON_ERROR:
@@ -2,7 +2,7 @@
   Implementation of the USB mass storage Bulk-Only Transport protocol,
   according to USB Mass Storage Class Bulk-Only Transport, Revision 1.0.
 
-Copyright (c) 2007 - 2011, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2007 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -130,6 +130,42 @@ ON_ERROR:
   return Status;
 }
 
+/**
+  Fill in the Command Block Wrapper for a command.
+
+  @param  UsbBot                The USB BOT device
+  @param  Cmd                   The command to transfer to device
+  @param  CmdLen                The length of the command
+  @param  DataDir               The direction of the data
+  @param  TransLen              The expected length of the data
+  @param  Lun                   The number of logic unit
+  @param  Cbw                   The Command Block Wrapper to fill in
+
+**/
+VOID
+UsbBotFillCbw (
+  IN  USB_BOT_PROTOCOL        *UsbBot,
+  IN  UINT8                   *Cmd,
+  IN  UINT8                   CmdLen,
+  IN  EFI_USB_DATA_DIRECTION  DataDir,
+  IN  UINT32                  TransLen,
+  IN  UINT8                   Lun,
+  OUT USB_BOT_CBW             *Cbw
+  )
+{
+  ASSERT ((CmdLen > 0) && (CmdLen <= USB_BOT_MAX_CMDLEN));
+
+  Cbw->Signature = USB_BOT_CBW_SIGNATURE;
+  Cbw->Tag       = UsbBot->CbwTag;
+  Cbw->DataLen   = TransLen;
+  Cbw->Flag      = (UINT8) ((DataDir == EfiUsbDataIn) ? BIT7 : 0);
+  Cbw->Lun       = Lun;
+  Cbw->CmdLen    = CmdLen;
+
+  ZeroMem (Cbw->CmdBlock, USB_BOT_MAX_CMDLEN);
+  CopyMem (Cbw->CmdBlock, Cmd, CmdLen);
+}
+
 /**
   Send the command to the device using Bulk-Out endpoint.
 
@@ -165,20 +201,10 @@ UsbBotSendCommand (
   UINTN                     DataLen;
   UINTN                     Timeout;
 
-  ASSERT ((CmdLen > 0) && (CmdLen <= USB_BOT_MAX_CMDLEN));
-
   //
   // Fill in the Command Block Wrapper.
   //
-  Cbw.Signature = USB_BOT_CBW_SIGNATURE;
-  Cbw.Tag       = UsbBot->CbwTag;
-  Cbw.DataLen   = TransLen;
-  Cbw.Flag      = (UINT8) ((DataDir == EfiUsbDataIn) ? BIT7 : 0);
-  Cbw.Lun       = Lun;
-  Cbw.CmdLen    = CmdLen;
-
-  ZeroMem (Cbw.CmdBlock, USB_BOT_MAX_CMDLEN);
-  CopyMem (Cbw.CmdBlock, Cmd, CmdLen);
+  UsbBotFillCbw (UsbBot, Cmd, CmdLen, DataDir, TransLen, Lun, &Cbw);
 
   Result  = 0;
   DataLen = sizeof (USB_BOT_CBW);
@@ -376,6 +402,229 @@ UsbBotGetStatus (
 }
 
 
+/**
+  Record the completion of one phase of a pipelined BOT command.
+
+  @param  Data                  The data buffer of the transfer.
+  @param  DataLength            The number of bytes transferred.
+  @param  Context               The USB_BOT_ASYNC_PHASE of the transfer.
+  @param  Result                The USB transfer result.
+
+  @retval EFI_SUCCESS           The completion is recorded.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbBotAsyncPhaseDone (
+  IN VOID                     *Data,
+  IN UINTN                    DataLength,
+  IN VOID                     *Context,
+  IN UINT32                   Result
+  )
+{
+  USB_BOT_ASYNC_PHASE       *Phase;
+
+  Phase         = (USB_BOT_ASYNC_PHASE *) Context;
+  Phase->Length = DataLength;
+  Phase->Result = Result;
+  Phase->Done   = TRUE;
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Execute a data-in command with its three BOT phases queued together.
+
+  The data and status transfers are queued to the Bulk-In endpoint before the
+  CBW is sent, so the host controller moves from one phase to the next without
+  waiting for the driver. The transfers are polled, as the caller runs at a
+  TPL that blocks the host controller's own completion monitor. The error
+  handling follows UsbBotExecCommand().
+
+  @param  UsbBot                The USB BOT device
+  @param  Cmd                   The high level command
+  @param  CmdLen                The command length
+  @param  Data                  The buffer to hold data
+  @param  DataLen               The length of the data
+  @param  Lun                   The number of logic unit
+  @param  Timeout               The time to wait command
+  @param  CmdStatus             The CSW status of the command
+
+  @retval EFI_SUCCESS           The CSW status is retrieved in CmdStatus.
+  @retval EFI_NOT_STARTED       The transfers could not be queued and nothing
+                                was sent to the device.
+  @retval Other                 Failed to execute the command.
+
+**/
+EFI_STATUS
+UsbBotExecAsyncCommand (
+  IN  USB_BOT_PROTOCOL        *UsbBot,
+  IN  UINT8                   *Cmd,
+  IN  UINT8                   CmdLen,
+  IN  VOID                    *Data,
+  IN  UINT32                  DataLen,
+  IN  UINT8                   Lun,
+  IN  UINT32                  Timeout,
+  OUT UINT8                   *CmdStatus
+  )
+{
+  EDKII_USB_IO_ASYNC_BULK_PROTOCOL *AsyncBulk;
+  USB_BOT_CBW               Cbw;
+  USB_BOT_CSW               Csw;
+  USB_BOT_ASYNC_PHASE       CommandPhase;
+  USB_BOT_ASYNC_PHASE       DataPhase;
+  USB_BOT_ASYNC_PHASE       StatusPhase;
+  UINT8                     InEndpoint;
+  UINT8                     OutEndpoint;
+  UINTN                     Elapsed;
+  UINTN                     TotalTimeout;
+  EFI_STATUS                Status;
+
+  *CmdStatus  = USB_BOT_COMMAND_ERROR;
+  AsyncBulk   = UsbBot->AsyncBulk;
+  InEndpoint  = UsbBot->BulkInEndpoint->EndpointAddress;
+  OutEndpoint = UsbBot->BulkOutEndpoint->EndpointAddress;
+
+  UsbBotFillCbw (UsbBot, Cmd, CmdLen, EfiUsbDataIn, DataLen, Lun, &Cbw);
+  ZeroMem (&Csw, sizeof (USB_BOT_CSW));
+  ZeroMem (&CommandPhase, sizeof (USB_BOT_ASYNC_PHASE));
+  ZeroMem (&DataPhase, sizeof (USB_BOT_ASYNC_PHASE));
+  ZeroMem (&StatusPhase, sizeof (USB_BOT_ASYNC_PHASE));
+
+  //
+  // Queue the data and status phases first. The device sends nothing on the
+  // Bulk-In endpoint until it has received the CBW.
+  //
+  Status = AsyncBulk->AsyncBulkTransfer (
+                        AsyncBulk,
+                        InEndpoint,
+                        Data,
+                        DataLen,
+                        UsbBotAsyncPhaseDone,
+                        &DataPhase
+                        );
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_STARTED;
+  }
+
+  Status = AsyncBulk->AsyncBulkTransfer (
+                        AsyncBulk,
+                        InEndpoint,
+                        &Csw,
+                        sizeof (USB_BOT_CSW),
+                        UsbBotAsyncPhaseDone,
+                        &StatusPhase
+                        );
+  if (!EFI_ERROR (Status)) {
+    Status = AsyncBulk->AsyncBulkTransfer (
+                          AsyncBulk,
+                          OutEndpoint,
+                          &Cbw,
+                          sizeof (USB_BOT_CBW),
+                          UsbBotAsyncPhaseDone,
+                          &CommandPhase
+                          );
+  }
+  if (EFI_ERROR (Status)) {
+    //
+    // Nothing has reached the device yet. If the queued transfers cannot be
+    // removed, the endpoint state is unknown and the command must not be
+    // retried synchronously.
+    //
+    if (EFI_ERROR (AsyncBulk->CancelAsyncBulkTransfer (AsyncBulk, InEndpoint))) {
+      return EFI_DEVICE_ERROR;
+    }
+    return EFI_NOT_STARTED;
+  }
+
+  //
+  // Wait for the CSW, or for the first phase that fails. A failed data phase
+  // also fails the status phase queued behind it.
+  //
+  TotalTimeout = USB_BOT_SEND_CBW_TIMEOUT + Timeout + USB_BOT_RECV_CSW_TIMEOUT;
+  for (Elapsed = 0; ; Elapsed += USB_BOT_ASYNC_POLL_INTERVAL) {
+    AsyncBulk->PollAsyncBulkTransfer (AsyncBulk);
+
+    if ((CommandPhase.Done && (CommandPhase.Result != EFI_USB_NOERROR)) ||
+        (DataPhase.Done && (DataPhase.Result != EFI_USB_NOERROR)) ||
+        StatusPhase.Done ||
+        (Elapsed >= TotalTimeout)) {
+      break;
+    }
+
+    gBS->Stall (USB_BOT_ASYNC_POLL_INTERVAL);
+  }
+
+  if (!StatusPhase.Done || (StatusPhase.Result != EFI_USB_NOERROR)) {
+    //
+    // Remove whatever is still queued before touching the buffers it uses.
+    //
+    Status = AsyncBulk->CancelAsyncBulkTransfer (AsyncBulk, OutEndpoint);
+    if (!EFI_ERROR (Status)) {
+      Status = AsyncBulk->CancelAsyncBulkTransfer (AsyncBulk, InEndpoint);
+    }
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_ERROR, "UsbBotExecAsyncCommand: failed to cancel transfers (%r)\n", Status));
+      UsbBot->CbwTag++;
+      return EFI_DEVICE_ERROR;
+    }
+  }
+
+  if (!CommandPhase.Done || (CommandPhase.Result != EFI_USB_NOERROR)) {
+    //
+    // The device rejected the command, as in UsbBotSendCommand().
+    //
+    DEBUG ((EFI_D_ERROR, "UsbBotExecAsyncCommand: CBW failed, Result = %x\n", CommandPhase.Result));
+    if (!CommandPhase.Done) {
+      return EFI_TIMEOUT;
+    }
+    return USB_IS_ERROR (CommandPhase.Result, EFI_USB_ERR_NAK) ? EFI_NOT_READY : EFI_DEVICE_ERROR;
+  }
+
+  if (!DataPhase.Done) {
+    //
+    // The data phase timed out, as in UsbBotDataTransfer().
+    //
+    DEBUG ((EFI_D_ERROR, "UsbBotExecAsyncCommand: data phase timed out\n"));
+    UsbBotResetDevice (UsbBot, FALSE);
+    UsbBot->CbwTag++;
+    return EFI_TIMEOUT;
+  }
+
+  if ((DataPhase.Result != EFI_USB_NOERROR) || (StatusPhase.Result != EFI_USB_NOERROR) ||
+      !StatusPhase.Done) {
+    //
+    // Clear a stalled Bulk-In endpoint, then read the CSW synchronously,
+    // which retries as the synchronous status phase does.
+    //
+    if (USB_IS_ERROR (DataPhase.Result, EFI_USB_ERR_STALL) ||
+        USB_IS_ERROR (StatusPhase.Result, EFI_USB_ERR_STALL)) {
+      DEBUG ((EFI_D_INFO, "UsbBotExecAsyncCommand: DataIn Stall\n"));
+      UsbClearEndpointStall (UsbBot->UsbIo, InEndpoint);
+    }
+    return UsbBotGetStatus (UsbBot, DataLen, CmdStatus);
+  }
+
+  //
+  // Interpret the CSW as UsbBotGetStatus() does.
+  //
+  Status = EFI_SUCCESS;
+  if ((Csw.Signature != USB_BOT_CSW_SIGNATURE) || (Csw.CmdStatus == USB_BOT_COMMAND_ERROR)) {
+    //
+    // CSW is invalid or reports a phase error, so perform reset recovery
+    //
+    Status = UsbBotResetDevice (UsbBot, FALSE);
+  } else {
+    *CmdStatus = Csw.CmdStatus;
+  }
+
+  UsbBot->CbwTag++;
+
+  return Status;
+}
+
+
 /**
   Call the USB Mass Storage Class BOT protocol to issue
   the command/data/status circle to execute the commands.
@@ -416,6 +665,26 @@ UsbBotExecCommand (
   *CmdStatus  = USB_MASS_CMD_FAIL;
   UsbBot      = (USB_BOT_PROTOCOL *) Context;
 
+  //
+  // Queue all three phases of a data-in command together when the
+  // USB bus supports it, and fall back if they cannot be queued.
+  //
+  if ((UsbBot->AsyncBulk != NULL) && (DataDir == EfiUsbDataIn) && (DataLen != 0)) {
+    Status = UsbBotExecAsyncCommand (UsbBot, Cmd, CmdLen, Data, DataLen, Lun, Timeout, &Result);
+    if (Status != EFI_NOT_STARTED) {
+      if (EFI_ERROR (Status)) {
+        DEBUG ((EFI_D_ERROR, "UsbBotExecCommand: UsbBotExecAsyncCommand (%r)\n", Status));
+        return Status;
+      }
+
+      if (Result == 0) {
+        *CmdStatus = USB_MASS_CMD_SUCCESS;
+      }
+
+      return EFI_SUCCESS;
+    }
+  }
+
   //
   // Send the command to the device. Return immediately if device
   // rejects the command.
@@ -3,7 +3,7 @@
   based on the "Universal Serial Bus Mass Storage Class Bulk-Only
   Transport" Revision 1.0, September 31, 1999.
 
-Copyright (c) 2007 - 2011, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2007 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -53,6 +53,11 @@ extern USB_MASS_TRANSPORT mUsbBotTransport;
 #define USB_BOT_RECV_CSW_TIMEOUT     (3 * USB_MASS_1_SECOND)
 #define USB_BOT_RESET_DEVICE_TIMEOUT (3 * USB_MASS_1_SECOND)
 
+//
+// Interval to poll the queued transfers of a pipelined command, in microseconds
+//
+#define USB_BOT_ASYNC_POLL_INTERVAL  50
+
 #pragma pack(1)
 ///
 /// The CBW (Command Block Wrapper) structures used by the USB BOT protocol.
@@ -87,8 +92,21 @@ typedef struct {
   EFI_USB_ENDPOINT_DESCRIPTOR   *BulkOutEndpoint;
   UINT32                        CbwTag;
   EFI_USB_IO_PROTOCOL           *UsbIo;
+  //
+  // Optional, used to queue the command, data and status phases together
+  //
+  EDKII_USB_IO_ASYNC_BULK_PROTOCOL *AsyncBulk;
 } USB_BOT_PROTOCOL;
 
+///
+/// The completion state of one phase of a pipelined BOT command.
+///
+typedef struct {
+  BOOLEAN                       Done;
+  UINT32                        Result;   ///< EFI_USB_ERR_x of the transfer
+  UINTN                         Length;   ///< Number of bytes transferred
+} USB_BOT_ASYNC_PHASE;
+
 /**
   Initializes USB BOT protocol.
 
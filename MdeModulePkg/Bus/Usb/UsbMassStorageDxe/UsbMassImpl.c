@@ -1,7 +1,7 @@
 /** @file
   USB Mass Storage Driver that manages USB Mass Storage Device and produces Block I/O Protocol.
 
-Copyright (c) 2007 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2007 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -391,6 +391,7 @@ UsbMassInitTransport (
   )
 {
   EFI_USB_IO_PROTOCOL           *UsbIo;
+  EDKII_USB_IO_ASYNC_BULK_PROTOCOL *AsyncBulk;
   EFI_USB_INTERFACE_DESCRIPTOR  Interface;
   UINT8                         Index;
   EFI_STATUS                    Status;
@@ -441,6 +442,21 @@ UsbMassInitTransport (
   //
   if ((*Transport)->Protocol == USB_MASS_STORE_BOT) {
     (*Transport)->GetMaxLun (*Context, MaxLun);
+
+    //
+    // If the USB bus can queue bulk transfers, the BOT transport
+    // pipelines the phases of its data-in commands.
+    //
+    if (!EFI_ERROR (gBS->OpenProtocol (
+                           Controller,
+                           &gEdkiiUsbIoAsyncBulkProtocolGuid,
+                           (VOID **) &AsyncBulk,
+                           This->DriverBindingHandle,
+                           Controller,
+                           EFI_OPEN_PROTOCOL_GET_PROTOCOL
+                           ))) {
+      ((USB_BOT_PROTOCOL *) *Context)->AsyncBulk = AsyncBulk;
+    }
   }
 
 ON_EXIT:
@@ -0,0 +1,139 @@
+/** @file
+
+  EDKII USB Host Controller Asynchronous Bulk Transfer Protocol.
+
+  This protocol is installed by a USB host controller driver, next to its
+  EFI_USB2_HC_PROTOCOL, when it can keep several bulk transfer descriptors
+  queued on one endpoint and complete them without the caller polling. It
+  lets a USB bus or class driver pipeline bulk traffic to a device. A caller
+  running at a TPL that blocks the host controller's own completion monitor
+  retires the transfers itself through PollAsyncBulkTransfer().
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                            
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __EDKII_USB_HC_ASYNC_BULK_PROTOCOL_H__
+#define __EDKII_USB_HC_ASYNC_BULK_PROTOCOL_H__
+
+#include <Protocol/Usb2HostController.h>
+
+//
+// USB Host Controller Asynchronous Bulk Transfer Protocol GUID value
+//
+#define EDKII_USB_HC_ASYNC_BULK_PROTOCOL_GUID \
+    { \
+      0x3025c59c, 0xd3b, 0x4a25, { 0x87, 0x81, 0xc8, 0x52, 0x2c, 0xb1, 0xd2, 0x7a } \
+    }
+
+//
+// Forward reference for pure ANSI compatability
+//
+typedef struct _EDKII_USB_HC_ASYNC_BULK_PROTOCOL  EDKII_USB_HC_ASYNC_BULK_PROTOCOL;
+
+/**
+  Queues a bulk transfer to a bulk endpoint of a USB device and returns
+  without waiting for it to complete.
+
+  Transfers queued to the same endpoint are executed in the order they were
+  submitted. When a transfer finishes, CallBackFunction is invoked with the
+  caller's Data buffer, the number of bytes actually transferred and the
+  EFI_USB_ERR_x result of the transfer. The callback runs at TPL_CALLBACK from
+  the host controller's periodic monitor, or at the caller's TPL from
+  PollAsyncBulkTransfer(). The caller must not touch Data until then.
+
+  @param  This                  The protocol instance pointer.
+  @param  DeviceAddress         Target device address.
+  @param  EndPointAddress       Endpoint number and its direction in bit 7.
+  @param  DeviceSpeed           Device speed, Low speed device doesn't support bulk
+                                transfer.
+  @param  MaximumPacketLength   Maximum packet size the endpoint is capable of
+                                sending or receiving.
+  @param  Data                  The buffer of data to transmit from or receive into.
+  @param  DataLength            The length of the data buffer.
+  @param  Translator            A pointer to the transaction translator data.
+  @param  CallBackFunction      The function to call when the transfer finishes.
+  @param  Context               Context to CallBackFunction.
+
+  @retval EFI_SUCCESS           The transfer was queued.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_OUT_OF_RESOURCES  The endpoint has no room for another transfer, or
+                                the request failed due to a lack of resources.
+  @retval EFI_DEVICE_ERROR      The transfer failed due to host controller error.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_HC_ASYNC_BULK_TRANSFER)(
+  IN     EDKII_USB_HC_ASYNC_BULK_PROTOCOL    *This,
+  IN     UINT8                               DeviceAddress,
+  IN     UINT8                               EndPointAddress,
+  IN     UINT8                               DeviceSpeed,
+  IN     UINTN                               MaximumPacketLength,
+  IN OUT VOID                                *Data,
+  IN     UINTN                               DataLength,
+  IN     EFI_USB2_HC_TRANSACTION_TRANSLATOR  *Translator,
+  IN     EFI_ASYNC_USB_TRANSFER_CALLBACK     CallBackFunction,
+  IN     VOID                                *Context OPTIONAL
+  );
+
+/**
+  Cancels all the bulk transfers still queued to an endpoint of a USB device.
+  The callbacks of the cancelled transfers are not invoked.
+
+  @param  This                  The protocol instance pointer.
+  @param  DeviceAddress         Target device address.
+  @param  EndPointAddress       Endpoint number and its direction in bit 7.
+
+  @retval EFI_SUCCESS           The queued transfers, if any, were cancelled.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_DEVICE_ERROR      The endpoint could not be stopped.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_HC_CANCEL_ASYNC_BULK_TRANSFER)(
+  IN     EDKII_USB_HC_ASYNC_BULK_PROTOCOL    *This,
+  IN     UINT8                               DeviceAddress,
+  IN     UINT8                               EndPointAddress
+  );
+
+/**
+  Retires the queued bulk transfers that have finished and invokes their
+  callbacks before returning.
+
+  The host controller driver normally retires transfers from a periodic timer
+  at TPL_CALLBACK. A caller that waits for its transfers at a higher TPL blocks
+  that timer, and calls this function in its wait loop instead.
+
+  @param  This                  The protocol instance pointer.
+
+  @retval EFI_SUCCESS           The finished transfers, if any, were retired.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_HC_POLL_ASYNC_BULK_TRANSFER)(
+  IN     EDKII_USB_HC_ASYNC_BULK_PROTOCOL    *This
+  );
+
+///
+/// This protocol lets USB bus and class drivers queue bulk transfers on a
+/// host controller without waiting for each one to finish.
+///
+struct _EDKII_USB_HC_ASYNC_BULK_PROTOCOL {
+  EDKII_USB_HC_ASYNC_BULK_TRANSFER          AsyncBulkTransfer;
+  EDKII_USB_HC_CANCEL_ASYNC_BULK_TRANSFER   CancelAsyncBulkTransfer;
+  EDKII_USB_HC_POLL_ASYNC_BULK_TRANSFER     PollAsyncBulkTransfer;
+};
+
+extern EFI_GUID gEdkiiUsbHcAsyncBulkProtocolGuid;
+
+#endif
@@ -0,0 +1,124 @@
+/** @file
+
+  EDKII USB I/O Asynchronous Bulk Transfer Protocol.
+
+  This protocol is installed by the USB bus driver on a USB interface handle,
+  next to its EFI_USB_IO_PROTOCOL, when the host controller produces the
+  EDKII_USB_HC_ASYNC_BULK_PROTOCOL. It lets a USB class driver queue several
+  bulk transfers to the interface, for example the command, data and status
+  phases of a mass storage request, and collect their results as they finish.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                            
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __EDKII_USB_IO_ASYNC_BULK_PROTOCOL_H__
+#define __EDKII_USB_IO_ASYNC_BULK_PROTOCOL_H__
+
+#include <Protocol/UsbIo.h>
+
+//
+// USB I/O Asynchronous Bulk Transfer Protocol GUID value
+//
+#define EDKII_USB_IO_ASYNC_BULK_PROTOCOL_GUID \
+    { \
+      0x6c359bb1, 0xd81f, 0x4b94, { 0xad, 0x45, 0x5c, 0xf1, 0xc0, 0xa3, 0x7d, 0xf4 } \
+    }
+
+//
+// Forward reference for pure ANSI compatability
+//
+typedef struct _EDKII_USB_IO_ASYNC_BULK_PROTOCOL  EDKII_USB_IO_ASYNC_BULK_PROTOCOL;
+
+/**
+  Queues a bulk transfer to a bulk endpoint of the USB interface and returns
+  without waiting for it to complete.
+
+  Transfers queued to the same endpoint are executed in the order they were
+  submitted. When a transfer finishes, Callback is invoked with the caller's
+  Data buffer, the number of bytes actually transferred and the EFI_USB_ERR_x
+  result of the transfer. The callback runs at TPL_CALLBACK, or at the caller's
+  TPL from PollAsyncBulkTransfer(). The caller must not touch Data until then.
+
+  @param  This                  The protocol instance pointer.
+  @param  DeviceEndpoint        The destination bulk endpoint of the interface.
+  @param  Data                  The buffer of data to transmit from or receive into.
+  @param  DataLength            The length of the data buffer.
+  @param  Callback              The function to call when the transfer finishes.
+  @param  Context               Context to Callback.
+
+  @retval EFI_SUCCESS           The transfer was queued.
+  @retval EFI_INVALID_PARAMETER DeviceEndpoint is not a bulk endpoint of the
+                                interface, or Callback is NULL.
+  @retval EFI_OUT_OF_RESOURCES  The endpoint has no room for another transfer, or
+                                the request failed due to a lack of resources.
+  @retval EFI_DEVICE_ERROR      The transfer failed due to host controller error.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_IO_ASYNC_BULK_TRANSFER)(
+  IN     EDKII_USB_IO_ASYNC_BULK_PROTOCOL    *This,
+  IN     UINT8                               DeviceEndpoint,
+  IN OUT VOID                                *Data,
+  IN     UINTN                               DataLength,
+  IN     EFI_ASYNC_USB_TRANSFER_CALLBACK     Callback,
+  IN     VOID                                *Context OPTIONAL
+  );
+
+/**
+  Cancels all the bulk transfers still queued to an endpoint of the USB
+  interface. The callbacks of the cancelled transfers are not invoked.
+
+  @param  This                  The protocol instance pointer.
+  @param  DeviceEndpoint        The bulk endpoint of the interface.
+
+  @retval EFI_SUCCESS           The queued transfers, if any, were cancelled.
+  @retval EFI_INVALID_PARAMETER DeviceEndpoint is not a bulk endpoint of the
+                                interface.
+  @retval EFI_DEVICE_ERROR      The endpoint could not be stopped.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_IO_CANCEL_ASYNC_BULK_TRANSFER)(
+  IN     EDKII_USB_IO_ASYNC_BULK_PROTOCOL    *This,
+  IN     UINT8                               DeviceEndpoint
+  );
+
+/**
+  Retires the queued bulk transfers that have finished and invokes their
+  callbacks before returning. A caller that waits for its transfers at a TPL
+  above TPL_CALLBACK must call this in its wait loop.
+
+  @param  This                  The protocol instance pointer.
+
+  @retval EFI_SUCCESS           The finished transfers, if any, were retired.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_IO_POLL_ASYNC_BULK_TRANSFER)(
+  IN     EDKII_USB_IO_ASYNC_BULK_PROTOCOL    *This
+  );
+
+///
+/// This protocol lets USB class drivers queue bulk transfers to an interface
+/// without waiting for each one to finish.
+///
+struct _EDKII_USB_IO_ASYNC_BULK_PROTOCOL {
+  EDKII_USB_IO_ASYNC_BULK_TRANSFER          AsyncBulkTransfer;
+  EDKII_USB_IO_CANCEL_ASYNC_BULK_TRANSFER   CancelAsyncBulkTransfer;
+  EDKII_USB_IO_POLL_ASYNC_BULK_TRANSFER     PollAsyncBulkTransfer;
+};
+
+extern EFI_GUID gEdkiiUsbIoAsyncBulkProtocolGuid;
+
+#endif
@@ -28,14 +28,20 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 //
 // The data structure to hold global performance data.
 //
-GAUGE_DATA_HEADER    *mGaugeData;
+GAUGE_DATA_HEADER    mGaugeData;
 
 //
-// The current maximum number of logging entries. If current number of 
-// entries exceeds this value, it will re-allocate a larger array and
-// migration the old data to the larger array.
+// The chunks holding the gauge entries. Entry N lives in chunk
+// (N >> GAUGE_CHUNK_SHIFT) at position (N & GAUGE_CHUNK_MASK). Only this
+// table of pointers is re-allocated when it fills up; entries never move.
 //
-UINT32               mMaxGaugeRecords;
+GAUGE_DATA_CHUNK     **mGaugeChunks;
+UINT32               mMaxGaugeChunks;
+
+//
+// Heads of the chains of open entries, indexed by key hash.
+//
+UINT32               mOpenGaugeBuckets[OPEN_GAUGE_HASH_BUCKETS];
 
 //
 // The handle to install Performance Protocol instance.
@@ -61,12 +67,156 @@ PERFORMANCE_EX_PROTOCOL mPerformanceExInterface = {
   };
 
 /**
-  Searches in the gauge array with keyword Handle, Token, Module and Identifier.
+  Returns the gauge entry at the given index of the gauge log.
+
+  @param  Index                   The index of the entry, less than the number of entries.
+
+  @return The pointer to the gauge entry.
+
+**/
+GAUGE_DATA_ENTRY_EX *
+InternalGetGaugeEntry (
+  IN UINT32                     Index
+  )
+{
+  return &mGaugeChunks[Index >> GAUGE_CHUNK_SHIFT]->Entry[Index & GAUGE_CHUNK_MASK];
+}
+
+/**
+  Computes the hash of the key of a gauge entry.
+
+  Token and Module are hashed up to DXE_PERFORMANCE_STRING_LENGTH characters,
+  the length they are truncated to when they are recorded.
+
+  @param  Handle                  The handle recorded in the gauge entry.
+  @param  Token                   Pointer to a Null-terminated ASCII string
+                                  that identifies the component being measured.
+  @param  Module                  Pointer to a Null-terminated ASCII string
+                                  that identifies the module being measured.
+  @param  Identifier              32-bit identifier.
+
+  @return The hash of the key.
+
+**/
+UINT32
+InternalGaugeHash (
+  IN EFI_PHYSICAL_ADDRESS       Handle,
+  IN CONST CHAR8                *Token,   OPTIONAL
+  IN CONST CHAR8                *Module,  OPTIONAL
+  IN UINT32                     Identifier
+  )
+{
+  UINT32                    Hash;
+  UINTN                     Index;
+
+  //
+  // FNV-1a. A separator is mixed in between the strings so that moving
+  // characters from Token to Module changes the hash.
+  //
+  Hash = 2166136261U;
+  if (Token != NULL) {
+    for (Index = 0; Index < DXE_PERFORMANCE_STRING_LENGTH && Token[Index] != '\0'; Index++) {
+      Hash = (Hash ^ (UINT8) Token[Index]) * 16777619U;
+    }
+  }
+  Hash = (Hash ^ 0xFF) * 16777619U;
+  if (Module != NULL) {
+    for (Index = 0; Index < DXE_PERFORMANCE_STRING_LENGTH && Module[Index] != '\0'; Index++) {
+      Hash = (Hash ^ (UINT8) Module[Index]) * 16777619U;
+    }
+  }
+  Hash = (Hash ^ (UINT32) Handle) * 16777619U;
+  Hash = (Hash ^ (UINT32) RShiftU64 (Handle, 32)) * 16777619U;
+  Hash = (Hash ^ Identifier) * 16777619U;
+
+  return Hash;
+}
+
+/**
+  Appends a zeroed entry to the end of the gauge log.
+
+  A new chunk is allocated when the last one is full. Existing entries are
+  never moved.
+
+  @param  Hash                    The hash of the key of the new entry.
+
+  @retval GAUGE_INDEX_NONE        There are not enough resources to grow the log.
+  @retval Others                  The index of the new entry.
+
+**/
+UINT32
+InternalAppendGaugeEntry (
+  IN UINT32                     Hash
+  )
+{
+  UINT32                    Index;
+  UINT32                    ChunkIndex;
+  GAUGE_DATA_CHUNK          **NewChunks;
+  GAUGE_DATA_CHUNK          *Chunk;
+
+  Index      = mGaugeData.NumberOfEntries;
+  ChunkIndex = Index >> GAUGE_CHUNK_SHIFT;
+
+  if ((Index & GAUGE_CHUNK_MASK) == 0) {
+    if (ChunkIndex >= mMaxGaugeChunks) {
+      NewChunks = ReallocatePool (
+                    sizeof (GAUGE_DATA_CHUNK *) * mMaxGaugeChunks,
+                    sizeof (GAUGE_DATA_CHUNK *) * mMaxGaugeChunks * 2,
+                    mGaugeChunks
+                    );
+      if (NewChunks == NULL) {
+        return GAUGE_INDEX_NONE;
+      }
+      mGaugeChunks     = NewChunks;
+      mMaxGaugeChunks *= 2;
+    }
+
+    mGaugeChunks[ChunkIndex] = AllocateZeroPool (sizeof (GAUGE_DATA_CHUNK));
+    if (mGaugeChunks[ChunkIndex] == NULL) {
+      return GAUGE_INDEX_NONE;
+    }
+  }
+
+  Chunk = mGaugeChunks[ChunkIndex];
+  Chunk->Hash[Index & GAUGE_CHUNK_MASK]     = Hash;
+  Chunk->NextOpen[Index & GAUGE_CHUNK_MASK] = GAUGE_INDEX_NONE;
+
+  mGaugeData.NumberOfEntries++;
+
+  return Index;
+}
+
+/**
+  Chains a gauge entry that has not been ended into the open entry hash table.
+
+  The entry is put at the head of its chain, so the most recent open entry
+  with a given key is always found first.
+
+  @param  Index                   The index of the gauge entry.
+
+**/
+VOID
+InternalLinkOpenGaugeEntry (
+  IN UINT32                     Index
+  )
+{
+  GAUGE_DATA_CHUNK          *Chunk;
+  UINT32                    Bucket;
+
+  Chunk  = mGaugeChunks[Index >> GAUGE_CHUNK_SHIFT];
+  Bucket = Chunk->Hash[Index & GAUGE_CHUNK_MASK] & (OPEN_GAUGE_HASH_BUCKETS - 1);
+
+  Chunk->NextOpen[Index & GAUGE_CHUNK_MASK] = mOpenGaugeBuckets[Bucket];
+  mOpenGaugeBuckets[Bucket]                 = Index;
+}
+
+/**
+  Searches for the open gauge entry with keyword Handle, Token, Module and Identifier.
 
-  This internal function searches for the gauge entry in the gauge array.
-  If there is an entry that exactly matches the given keywords
-  and its end time stamp is zero, then the index of that gauge entry is returned;
-  otherwise, the the number of gauge entries in the array is returned.
+  This internal function looks up the most recent gauge entry that exactly
+  matches the given keywords and whose end time stamp is zero, in the hash
+  table of open entries. The entry found is taken off the hash table, since
+  the caller is about to end it.
 
   @param  Handle                  Pointer to environment specific context used
                                   to identify the component being measured.
@@ -76,7 +226,8 @@ PERFORMANCE_EX_PROTOCOL mPerformanceExInterface = {
                                   that identifies the module being measured.
   @param  Identifier              32-bit identifier.
 
-  @retval The index of gauge entry in the array.
+  @retval The index of gauge entry in the array, or the number of gauge
+          entries if there is no such entry.
 
 **/
 UINT32
@@ -87,10 +238,13 @@ InternalSearchForGaugeEntry (
   IN UINT32                     Identifier
   )
 {
+  UINT32                    Hash;
+  UINT32                    *Link;
   UINT32                    Index;
-  UINT32                    Index2;
-  UINT32                    NumberOfEntries;
-  GAUGE_DATA_ENTRY_EX       *GaugeEntryExArray;
+  GAUGE_DATA_CHUNK          *Chunk;
+  GAUGE_DATA_ENTRY_EX       *GaugeEntryEx;
+
+  Hash = InternalGaugeHash ((EFI_PHYSICAL_ADDRESS) (UINTN) Handle, Token, Module, Identifier);
 
   if (Token == NULL) {
     Token = "";
@@ -99,24 +253,23 @@ InternalSearchForGaugeEntry (
     Module = "";
   }
 
-  NumberOfEntries = mGaugeData->NumberOfEntries;
-  GaugeEntryExArray = (GAUGE_DATA_ENTRY_EX *) (mGaugeData + 1);
-
-  Index2 = 0;
-
-  for (Index = 0; Index < NumberOfEntries; Index++) {
-    Index2 = NumberOfEntries - 1 - Index;
-    if (GaugeEntryExArray[Index2].EndTimeStamp == 0 &&
-        (GaugeEntryExArray[Index2].Handle == (EFI_PHYSICAL_ADDRESS) (UINTN) Handle) &&
-        AsciiStrnCmp (GaugeEntryExArray[Index2].Token, Token, DXE_PERFORMANCE_STRING_LENGTH) == 0 &&
-        AsciiStrnCmp (GaugeEntryExArray[Index2].Module, Module, DXE_PERFORMANCE_STRING_LENGTH) == 0 &&
-        (GaugeEntryExArray[Index2].Identifier == Identifier)) {
-      Index = Index2;
-      break;
+  Link = &mOpenGaugeBuckets[Hash & (OPEN_GAUGE_HASH_BUCKETS - 1)];
+  while (*Link != GAUGE_INDEX_NONE) {
+    Index        = *Link;
+    Chunk        = mGaugeChunks[Index >> GAUGE_CHUNK_SHIFT];
+    GaugeEntryEx = &Chunk->Entry[Index & GAUGE_CHUNK_MASK];
+    if (Chunk->Hash[Index & GAUGE_CHUNK_MASK] == Hash &&
+        (GaugeEntryEx->Handle == (EFI_PHYSICAL_ADDRESS) (UINTN) Handle) &&
+        AsciiStrnCmp (GaugeEntryEx->Token, Token, DXE_PERFORMANCE_STRING_LENGTH) == 0 &&
+        AsciiStrnCmp (GaugeEntryEx->Module, Module, DXE_PERFORMANCE_STRING_LENGTH) == 0 &&
+        (GaugeEntryEx->Identifier == Identifier)) {
+      *Link = Chunk->NextOpen[Index & GAUGE_CHUNK_MASK];
+      return Index;
     }
+    Link = &Chunk->NextOpen[Index & GAUGE_CHUNK_MASK];
   }
 
-  return Index;
+  return mGaugeData.NumberOfEntries;
 }
 
 /**
@@ -154,58 +307,35 @@ StartGaugeEx (
   IN UINT32       Identifier
   )
 {
-  GAUGE_DATA_ENTRY_EX       *GaugeEntryExArray;
-  UINTN                     GaugeDataSize;
-  GAUGE_DATA_HEADER         *NewGaugeData;
-  UINTN                     OldGaugeDataSize;
-  GAUGE_DATA_HEADER         *OldGaugeData;
+  GAUGE_DATA_ENTRY_EX       *GaugeEntryEx;
   UINT32                    Index;
 
-  Index = mGaugeData->NumberOfEntries;
-  if (Index >= mMaxGaugeRecords) {
-    //
-    // Try to enlarge the scale of gauge array.
-    //
-    OldGaugeData      = mGaugeData;
-    OldGaugeDataSize  = sizeof (GAUGE_DATA_HEADER) + sizeof (GAUGE_DATA_ENTRY_EX) * mMaxGaugeRecords;
-
-    GaugeDataSize     = sizeof (GAUGE_DATA_HEADER) + sizeof (GAUGE_DATA_ENTRY_EX) * mMaxGaugeRecords * 2;
-
-    NewGaugeData = AllocateZeroPool (GaugeDataSize);
-    if (NewGaugeData == NULL) {
-      return EFI_OUT_OF_RESOURCES;
-    }
-
-    mGaugeData = NewGaugeData;
-    mMaxGaugeRecords *= 2;
-
-    //
-    // Initialize new data array and migrate old data one.
-    //
-    mGaugeData = CopyMem (mGaugeData, OldGaugeData, OldGaugeDataSize);
-
-    FreePool (OldGaugeData);
+  Index = InternalAppendGaugeEntry (
+            InternalGaugeHash ((EFI_PHYSICAL_ADDRESS) (UINTN) Handle, Token, Module, Identifier)
+            );
+  if (Index == GAUGE_INDEX_NONE) {
+    return EFI_OUT_OF_RESOURCES;
   }
 
-  GaugeEntryExArray               = (GAUGE_DATA_ENTRY_EX *) (mGaugeData + 1);
-  GaugeEntryExArray[Index].Handle = (EFI_PHYSICAL_ADDRESS) (UINTN) Handle;
+  GaugeEntryEx         = InternalGetGaugeEntry (Index);
+  GaugeEntryEx->Handle = (EFI_PHYSICAL_ADDRESS) (UINTN) Handle;
 
   if (Token != NULL) {
-    AsciiStrnCpyS (GaugeEntryExArray[Index].Token, DXE_PERFORMANCE_STRING_SIZE, Token, DXE_PERFORMANCE_STRING_LENGTH);
+    AsciiStrnCpyS (GaugeEntryEx->Token, DXE_PERFORMANCE_STRING_SIZE, Token, DXE_PERFORMANCE_STRING_LENGTH);
   }
   if (Module != NULL) {
-    AsciiStrnCpyS (GaugeEntryExArray[Index].Module, DXE_PERFORMANCE_STRING_SIZE, Module, DXE_PERFORMANCE_STRING_LENGTH);
+    AsciiStrnCpyS (GaugeEntryEx->Module, DXE_PERFORMANCE_STRING_SIZE, Module, DXE_PERFORMANCE_STRING_LENGTH);
   }
 
-  GaugeEntryExArray[Index].EndTimeStamp = 0;
-  GaugeEntryExArray[Index].Identifier = Identifier;
+  GaugeEntryEx->EndTimeStamp = 0;
+  GaugeEntryEx->Identifier = Identifier;
 
   if (TimeStamp == 0) {
     TimeStamp = GetPerformanceCounter ();
   }
-  GaugeEntryExArray[Index].StartTimeStamp = TimeStamp;
+  GaugeEntryEx->StartTimeStamp = TimeStamp;
 
-  mGaugeData->NumberOfEntries++;
+  InternalLinkOpenGaugeEntry (Index);
 
   return EFI_SUCCESS;
 }
@@ -246,7 +376,6 @@ EndGaugeEx (
   IN UINT32       Identifier
   )
 {
-  GAUGE_DATA_ENTRY_EX *GaugeEntryExArray;
   UINT32              Index;
 
   if (TimeStamp == 0) {
@@ -254,11 +383,10 @@ EndGaugeEx (
   }
 
   Index = InternalSearchForGaugeEntry (Handle, Token, Module, Identifier);
-  if (Index >= mGaugeData->NumberOfEntries) {
+  if (Index >= mGaugeData.NumberOfEntries) {
     return EFI_NOT_FOUND;
   }
-  GaugeEntryExArray = (GAUGE_DATA_ENTRY_EX *) (mGaugeData + 1);
-  GaugeEntryExArray[Index].EndTimeStamp = TimeStamp;
+  InternalGetGaugeEntry (Index)->EndTimeStamp = TimeStamp;
 
   return EFI_SUCCESS;
 }
@@ -291,9 +419,8 @@ GetGaugeEx (
   )
 {
   UINTN               NumberOfEntries;
-  GAUGE_DATA_ENTRY_EX *GaugeEntryExArray;
 
-  NumberOfEntries = (UINTN) (mGaugeData->NumberOfEntries);
+  NumberOfEntries = (UINTN) (mGaugeData.NumberOfEntries);
   if (LogEntryKey > NumberOfEntries) {
     return EFI_INVALID_PARAMETER;
   }
@@ -301,12 +428,10 @@ GetGaugeEx (
     return EFI_NOT_FOUND;
   }
 
-  GaugeEntryExArray = (GAUGE_DATA_ENTRY_EX *) (mGaugeData + 1);
-
   if (GaugeDataEntryEx == NULL) {
     return EFI_INVALID_PARAMETER;
   }
-  *GaugeDataEntryEx = &GaugeEntryExArray[LogEntryKey];
+  *GaugeDataEntryEx = InternalGetGaugeEntry ((UINT32) LogEntryKey);
 
   return EFI_SUCCESS;
 }
@@ -445,40 +570,57 @@ InternalGetPeiPerformance (
   PEI_PERFORMANCE_LOG_HEADER        *LogHob;
   PEI_PERFORMANCE_LOG_ENTRY         *LogEntryArray;
   UINT32                            *LogIdArray;
-  GAUGE_DATA_ENTRY_EX               *GaugeEntryExArray;
+  GAUGE_DATA_ENTRY_EX               *GaugeEntryEx;
   UINT32                            Index;
-  UINT32                            NumberOfEntries;
-
-  NumberOfEntries = 0;
-  GaugeEntryExArray = (GAUGE_DATA_ENTRY_EX *) (mGaugeData + 1);
+  UINT32                            GaugeIndex;
+  UINT32                            Identifier;
 
   //
   // Dump PEI Log Entries to DXE Guage Data structure.
   //
   GuidHob = GetFirstGuidHob (&gPerformanceProtocolGuid);
+  if (GuidHob == NULL) {
+    return;
+  }
+
+  LogHob          = GET_GUID_HOB_DATA (GuidHob);
+  LogEntryArray   = (PEI_PERFORMANCE_LOG_ENTRY *) (LogHob + 1);
+
+  LogIdArray      = NULL;
+  GuidHob = GetFirstGuidHob (&gPerformanceExProtocolGuid);
   if (GuidHob != NULL) {
-    LogHob          = GET_GUID_HOB_DATA (GuidHob);
-    LogEntryArray   = (PEI_PERFORMANCE_LOG_ENTRY *) (LogHob + 1);
-
-    NumberOfEntries = LogHob->NumberOfEntries;
-    for (Index = 0; Index < NumberOfEntries; Index++) {
-      GaugeEntryExArray[Index].Handle         = LogEntryArray[Index].Handle;
-      AsciiStrCpyS (GaugeEntryExArray[Index].Token,  DXE_PERFORMANCE_STRING_SIZE, LogEntryArray[Index].Token);
-      AsciiStrCpyS (GaugeEntryExArray[Index].Module, DXE_PERFORMANCE_STRING_SIZE, LogEntryArray[Index].Module);
-      GaugeEntryExArray[Index].StartTimeStamp = LogEntryArray[Index].StartTimeStamp;
-      GaugeEntryExArray[Index].EndTimeStamp   = LogEntryArray[Index].EndTimeStamp;
-      GaugeEntryExArray[Index].Identifier     = 0;
+    LogIdArray    = GET_GUID_HOB_DATA (GuidHob);
+  }
+
+  for (Index = 0; Index < LogHob->NumberOfEntries; Index++) {
+    Identifier = (LogIdArray != NULL) ? LogIdArray[Index] : 0;
+    GaugeIndex = InternalAppendGaugeEntry (
+                   InternalGaugeHash (
+                     LogEntryArray[Index].Handle,
+                     LogEntryArray[Index].Token,
+                     LogEntryArray[Index].Module,
+                     Identifier
+                     )
+                   );
+    if (GaugeIndex == GAUGE_INDEX_NONE) {
+      break;
     }
 
-    GuidHob = GetFirstGuidHob (&gPerformanceExProtocolGuid);
-    if (GuidHob != NULL) {
-      LogIdArray    = GET_GUID_HOB_DATA (GuidHob);
-      for (Index = 0; Index < NumberOfEntries; Index++) {
-        GaugeEntryExArray[Index].Identifier   = LogIdArray[Index];
-      }
+    GaugeEntryEx                 = InternalGetGaugeEntry (GaugeIndex);
+    GaugeEntryEx->Handle         = LogEntryArray[Index].Handle;
+    AsciiStrCpyS (GaugeEntryEx->Token,  DXE_PERFORMANCE_STRING_SIZE, LogEntryArray[Index].Token);
+    AsciiStrCpyS (GaugeEntryEx->Module, DXE_PERFORMANCE_STRING_SIZE, LogEntryArray[Index].Module);
+    GaugeEntryEx->StartTimeStamp = LogEntryArray[Index].StartTimeStamp;
+    GaugeEntryEx->EndTimeStamp   = LogEntryArray[Index].EndTimeStamp;
+    GaugeEntryEx->Identifier     = Identifier;
+
+    //
+    // A PEI measurement may still be ended in DXE.
+    //
+    if (GaugeEntryEx->EndTimeStamp == 0) {
+      InternalLinkOpenGaugeEntry (GaugeIndex);
     }
   }
-  mGaugeData->NumberOfEntries = NumberOfEntries;
 }
 
 /**
@@ -522,10 +664,15 @@ DxeCorePerformanceLibConstructor (
                   );
   ASSERT_EFI_ERROR (Status);
 
-  mMaxGaugeRecords = INIT_DXE_GAUGE_DATA_ENTRIES + PcdGet8 (PcdMaxPeiPerformanceLogEntries);
+  //
+  // Reserve enough chunk pointers for the usual number of records; further
+  // ones are added as the log grows.
+  //
+  mMaxGaugeChunks = (INIT_DXE_GAUGE_DATA_ENTRIES + PcdGet8 (PcdMaxPeiPerformanceLogEntries) + GAUGE_CHUNK_MASK) >> GAUGE_CHUNK_SHIFT;
+  mGaugeChunks    = AllocateZeroPool (sizeof (GAUGE_DATA_CHUNK *) * mMaxGaugeChunks);
+  ASSERT (mGaugeChunks != NULL);
 
-  mGaugeData = AllocateZeroPool (sizeof (GAUGE_DATA_HEADER) + (sizeof (GAUGE_DATA_ENTRY_EX) * mMaxGaugeRecords));
-  ASSERT (mGaugeData != NULL);
+  SetMem (mOpenGaugeBuckets, sizeof (mOpenGaugeBuckets), 0xFF);
 
   InternalGetPeiPerformance ();
 
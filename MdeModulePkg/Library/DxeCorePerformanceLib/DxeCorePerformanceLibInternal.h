@@ -33,6 +33,32 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/MemoryAllocationLib.h>
 
+//
+// The gauge log is kept in fixed-size chunks that are never moved, so that
+// growing the log only allocates a new chunk.
+//
+#define GAUGE_CHUNK_SHIFT               9
+#define GAUGE_CHUNK_ENTRIES             (1 << GAUGE_CHUNK_SHIFT)
+#define GAUGE_CHUNK_MASK                (GAUGE_CHUNK_ENTRIES - 1)
+
+//
+// Records that have not been ended yet are chained into a hash table keyed
+// by Handle, Token, Module and Identifier, so EndGaugeEx() does not have to
+// scan the log. The number of buckets must be a power of 2.
+//
+#define OPEN_GAUGE_HASH_BUCKETS         256
+#define GAUGE_INDEX_NONE                MAX_UINT32
+
+typedef struct {
+  GAUGE_DATA_ENTRY_EX   Entry[GAUGE_CHUNK_ENTRIES];
+  //
+  // Hash of the key of each entry, and the index of the next open entry in
+  // the same bucket while the entry itself is open.
+  //
+  UINT32                Hash[GAUGE_CHUNK_ENTRIES];
+  UINT32                NextOpen[GAUGE_CHUNK_ENTRIES];
+} GAUGE_DATA_CHUNK;
+
 //
 // Interface declarations for PerformanceEx Protocol.
 //
@@ -1,7 +1,7 @@
 /** @file
   Library functions which relates with booting.
 
-Copyright (c) 2011 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2011 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -33,6 +33,11 @@ LIST_ENTRY mPlatformBootDescriptionHandlers = INITIALIZE_LIST_HEAD_VARIABLE (mPl
 ///
 EFI_GUID mBmHardDriveBootVariableGuid = { 0xfab7e9e1, 0x39dd, 0x4f2b, { 0x84, 0x08, 0xe2, 0x0e, 0x90, 0x6c, 0xb6, 0xde } };
 EFI_GUID mBmAutoCreateBootOptionGuid  = { 0x8108ac4e, 0x9f11, 0x4d59, { 0x85, 0x0e, 0xe2, 0x1a, 0x52, 0x2c, 0x59, 0xb2 } };
+///
+/// This GUID is used for an EFI Variable that stores the full device path
+/// of the last boot option which needed its device path expanded.
+///
+EFI_GUID mBmFastBootVariableGuid      = { 0x5c6a8a19, 0x2e0b, 0x4f6d, { 0x9b, 0x3e, 0x71, 0xd4, 0x0a, 0x86, 0xc2, 0x5f } };
 
 /**
   The function registers the legacy boot support capabilities.
@@ -1528,6 +1533,208 @@ BmGetLoadOptionBuffer (
   return FileBuffer;
 }
 
+/**
+  Check whether the device reached by the recorded full device path is still
+  the one the short-form boot option describes.
+
+  The partition signature and the media device path are part of the full device
+  path, so only the USB Class and USB WWID short-form device paths need the USB
+  device to be matched again.
+
+  @param FilePath  The short-form device path of the boot option.
+  @param FullPath  The recorded full device path.
+
+  @retval TRUE     The full device path can be used for the boot option.
+  @retval FALSE    The device has changed.
+**/
+BOOLEAN
+BmIsFastBootPathValid (
+  IN EFI_DEVICE_PATH_PROTOCOL         *FilePath,
+  IN EFI_DEVICE_PATH_PROTOCOL         *FullPath
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_DEVICE_PATH_PROTOCOL            *Node;
+  EFI_DEVICE_PATH_PROTOCOL            *UsbNode;
+  EFI_HANDLE                          Handle;
+  EFI_USB_IO_PROTOCOL                 *UsbIo;
+
+  for (UsbNode = FilePath; !IsDevicePathEnd (UsbNode); UsbNode = NextDevicePathNode (UsbNode)) {
+    if ((DevicePathType (UsbNode) == MESSAGING_DEVICE_PATH) &&
+        ((DevicePathSubType (UsbNode) == MSG_USB_CLASS_DP) || (DevicePathSubType (UsbNode) == MSG_USB_WWID_DP))) {
+      break;
+    }
+  }
+  if (IsDevicePathEnd (UsbNode)) {
+    return TRUE;
+  }
+
+  Node   = FullPath;
+  Status = gBS->LocateDevicePath (&gEfiUsbIoProtocolGuid, &Node, &Handle);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+  Status = gBS->HandleProtocol (Handle, &gEfiUsbIoProtocolGuid, (VOID **) &UsbIo);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  return (BOOLEAN) (BmMatchUsbClass (UsbIo, (USB_CLASS_DEVICE_PATH *) UsbNode) ||
+                    BmMatchUsbWwid (UsbIo, (USB_WWID_DEVICE_PATH *) UsbNode));
+}
+
+/**
+  Get the load option by the full device path recorded when the same boot option
+  was last booted.
+
+  Only the controllers along the recorded device path are connected, so neither
+  a connect all nor a search for the partition or the USB device is needed.
+  The record is deleted when it no longer leads to the load option.
+
+  @param FilePath  The device path pointing to a load option.
+                   It could be a short-form device path.
+  @param FullPath  Return the full device path of the load option.
+                   Caller is responsible to free it.
+  @param FileSize  Return the load option size.
+
+  @return The load option buffer, or NULL when the caller needs to expand
+          FilePath the normal way. Caller is responsible to free the memory.
+**/
+VOID *
+BmGetLoadOptionBufferByFastBootPath (
+  IN  EFI_DEVICE_PATH_PROTOCOL        *FilePath,
+  OUT EFI_DEVICE_PATH_PROTOCOL        **FullPath,
+  OUT UINTN                           *FileSize
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL            *CachedDevicePath;
+  UINTN                               CachedDevicePathSize;
+  EFI_DEVICE_PATH_PROTOCOL            *Walker;
+  EFI_DEVICE_PATH_PROTOCOL            *ShortPath;
+  EFI_DEVICE_PATH_PROTOCOL            *RecordedPath;
+  UINTN                               Size;
+  VOID                                *FileBuffer;
+  UINT32                              AuthenticationStatus;
+
+  *FullPath  = NULL;
+  *FileSize  = 0;
+  FileBuffer = NULL;
+
+  if (!FeaturePcdGet (PcdBootManagerFastBootPath)) {
+    return NULL;
+  }
+
+  GetVariable2 (L"FastBootPath", &mBmFastBootVariableGuid, (VOID **) &CachedDevicePath, &CachedDevicePathSize);
+  if (CachedDevicePath == NULL) {
+    return NULL;
+  }
+
+  //
+  // The variable holds two instances: the short-form device path of the boot option
+  // and the full device path it was expanded to.
+  //
+  ShortPath    = NULL;
+  RecordedPath = NULL;
+  if (IsDevicePathValid (CachedDevicePath, CachedDevicePathSize)) {
+    Walker       = CachedDevicePath;
+    ShortPath    = GetNextDevicePathInstance (&Walker, &Size);
+    RecordedPath = GetNextDevicePathInstance (&Walker, &Size);
+  }
+  FreePool (CachedDevicePath);
+
+  if ((ShortPath != NULL) && (RecordedPath != NULL) &&
+      (GetDevicePathSize (ShortPath) == GetDevicePathSize (FilePath)) &&
+      (CompareMem (ShortPath, FilePath, GetDevicePathSize (FilePath)) == 0)) {
+    EfiBootManagerConnectDevicePath (RecordedPath, NULL);
+    if (BmIsFastBootPathValid (FilePath, RecordedPath)) {
+      FileBuffer = GetFileBufferByFilePath (TRUE, RecordedPath, FileSize, &AuthenticationStatus);
+    }
+
+    if (FileBuffer != NULL) {
+      *FullPath    = RecordedPath;
+      RecordedPath = NULL;
+    } else {
+      DEBUG ((EFI_D_INFO, "[Bds] Fast boot path is stale, expanding the boot option device path.\n"));
+      *FileSize = 0;
+      gRT->SetVariable (L"FastBootPath", &mBmFastBootVariableGuid, 0, 0, NULL);
+    }
+  }
+
+  if (ShortPath != NULL) {
+    FreePool (ShortPath);
+  }
+  if (RecordedPath != NULL) {
+    FreePool (RecordedPath);
+  }
+  return FileBuffer;
+}
+
+/**
+  Record the full device path a short-form boot option was expanded to, so the
+  next boot of the same boot option only needs to connect that device path.
+
+  Nothing is recorded when the device path didn't need expanding or the load
+  option came from a LoadFile instance, and the variable is only written when
+  its content changes.
+
+  @param FilePath  The device path of the boot option.
+  @param FullPath  The full device path of the load option.
+**/
+VOID
+BmSaveFastBootPath (
+  IN EFI_DEVICE_PATH_PROTOCOL         *FilePath,
+  IN EFI_DEVICE_PATH_PROTOCOL         *FullPath
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_DEVICE_PATH_PROTOCOL            *Node;
+  EFI_HANDLE                          Handle;
+  EFI_DEVICE_PATH_PROTOCOL            *NewDevicePath;
+  EFI_DEVICE_PATH_PROTOCOL            *CachedDevicePath;
+  UINTN                               CachedDevicePathSize;
+
+  if (!FeaturePcdGet (PcdBootManagerFastBootPath)) {
+    return;
+  }
+
+  if ((GetDevicePathSize (FilePath) == GetDevicePathSize (FullPath)) &&
+      (CompareMem (FilePath, FullPath, GetDevicePathSize (FullPath)) == 0)) {
+    return;
+  }
+
+  Node   = FullPath;
+  Status = gBS->LocateDevicePath (&gEfiLoadFileProtocolGuid, &Node, &Handle);
+  if (!EFI_ERROR (Status)) {
+    return;
+  }
+
+  NewDevicePath = AppendDevicePathInstance (FilePath, FullPath);
+  if (NewDevicePath == NULL) {
+    return;
+  }
+
+  GetVariable2 (L"FastBootPath", &mBmFastBootVariableGuid, (VOID **) &CachedDevicePath, &CachedDevicePathSize);
+  if ((CachedDevicePath == NULL) ||
+      (CachedDevicePathSize != GetDevicePathSize (NewDevicePath)) ||
+      (CompareMem (CachedDevicePath, NewDevicePath, CachedDevicePathSize) != 0)) {
+    //
+    // Failing to save only impacts performance next time booting the boot option
+    //
+    gRT->SetVariable (
+           L"FastBootPath",
+           &mBmFastBootVariableGuid,
+           EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_NON_VOLATILE,
+           GetDevicePathSize (NewDevicePath),
+           NewDevicePath
+           );
+  }
+
+  if (CachedDevicePath != NULL) {
+    FreePool (CachedDevicePath);
+  }
+  FreePool (NewDevicePath);
+}
+
 /**
   Attempt to boot the EFI boot option. This routine sets L"BootCurent" and
   also signals the EFI ready to boot event. If the device path for the option
@@ -1645,7 +1852,10 @@ EfiBootManagerBoot (
   ImageHandle = NULL;
   if (DevicePathType (BootOption->FilePath) != BBS_DEVICE_PATH) {
     Status     = EFI_NOT_FOUND;
-    FileBuffer = BmGetLoadOptionBuffer (BootOption->FilePath, &FilePath, &FileSize);
+    FileBuffer = BmGetLoadOptionBufferByFastBootPath (BootOption->FilePath, &FilePath, &FileSize);
+    if (FileBuffer == NULL) {
+      FileBuffer = BmGetLoadOptionBuffer (BootOption->FilePath, &FilePath, &FileSize);
+    }
     DEBUG_CODE (
       if (FileBuffer != NULL && CompareMem (BootOption->FilePath, FilePath, GetDevicePathSize (FilePath)) != 0) {
         DEBUG ((EFI_D_INFO, "[Bds] DevicePath expand: "));
@@ -1665,6 +1875,9 @@ EfiBootManagerBoot (
                       FileSize,
                       &ImageHandle
                       );
+      if (!EFI_ERROR (Status)) {
+        BmSaveFastBootPath (BootOption->FilePath, FilePath);
+      }
     }
     if (FileBuffer != NULL) {
       FreePool (FileBuffer);
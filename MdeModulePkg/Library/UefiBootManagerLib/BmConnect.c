@@ -1,7 +1,7 @@
 /** @file
   Library functions which relate with connecting the device.
 
-Copyright (c) 2011 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2011 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -14,39 +14,261 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "InternalBm.h"
 
+///
+/// One entry of the connect timeline kept by BmConnectAllDriversToAllControllers.
+///
+typedef struct {
+  EFI_HANDLE                Controller;
+  UINT64                    StartTime;   ///< Nanoseconds from the start of the pass.
+  UINT64                    Duration;    ///< Nanoseconds spent connecting the controller and its children.
+  EFI_STATUS                Status;
+} BM_CONNECT_TIMELINE_ENTRY;
+
+/**
+  Return the nanoseconds elapsed since a performance counter value.
+
+  @param  StartTicker    The performance counter value at the start.
+
+  @return The elapsed time in nanoseconds.
+**/
+UINT64
+BmGetElapsedTime (
+  IN UINT64                 StartTicker
+  )
+{
+  UINT64                    Ticker;
+  UINT64                    StartValue;
+  UINT64                    EndValue;
+
+  Ticker = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (EndValue >= StartValue) {
+    return GetTimeInNanoSecond (Ticker - StartTicker);
+  } else {
+    return GetTimeInNanoSecond (StartTicker - Ticker);
+  }
+}
+
+/**
+  Mark the handles in the snapshot which are children or grandchildren of
+  the controller.
+
+  A recursive ConnectController() on the controller already connects all of
+  them, so BmConnectAllDriversToAllControllers doesn't connect them again.
+
+  @param  Controller     The controller handle.
+  @param  HandleBuffer   The snapshot of all the handles.
+  @param  HandleCount    The number of handles in the snapshot.
+  @param  Connected      Array of flags for the handles in the snapshot.
+**/
+VOID
+BmMarkChildHandles (
+  IN EFI_HANDLE             Controller,
+  IN EFI_HANDLE             *HandleBuffer,
+  IN UINTN                  HandleCount,
+  IN OUT BOOLEAN            *Connected
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_GUID                            **ProtocolBuffer;
+  UINTN                               ProtocolCount;
+  UINTN                               ProtocolIndex;
+  EFI_OPEN_PROTOCOL_INFORMATION_ENTRY *OpenInfo;
+  UINTN                               OpenInfoCount;
+  UINTN                               OpenInfoIndex;
+  UINTN                               Index;
+
+  Status = gBS->ProtocolsPerHandle (Controller, &ProtocolBuffer, &ProtocolCount);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  for (ProtocolIndex = 0; ProtocolIndex < ProtocolCount; ProtocolIndex++) {
+    Status = gBS->OpenProtocolInformation (
+                    Controller,
+                    ProtocolBuffer[ProtocolIndex],
+                    &OpenInfo,
+                    &OpenInfoCount
+                    );
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+
+    for (OpenInfoIndex = 0; OpenInfoIndex < OpenInfoCount; OpenInfoIndex++) {
+      if ((OpenInfo[OpenInfoIndex].Attributes & EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) == 0) {
+        continue;
+      }
+      for (Index = 0; Index < HandleCount; Index++) {
+        if ((HandleBuffer[Index] == OpenInfo[OpenInfoIndex].ControllerHandle) && !Connected[Index]) {
+          Connected[Index] = TRUE;
+          BmMarkChildHandles (HandleBuffer[Index], HandleBuffer, HandleCount, Connected);
+          break;
+        }
+      }
+    }
+
+    FreePool (OpenInfo);
+  }
+
+  FreePool (ProtocolBuffer);
+}
+
+/**
+  Compare two timeline entries so the slowest controller sorts first.
+
+  @param  Left    Pointer to the first entry.
+  @param  Right   Pointer to the second entry.
+
+  @retval <0      Left is slower than Right.
+  @retval 0       Both took the same time.
+  @retval >0      Left is faster than Right.
+**/
+INTN
+EFIAPI
+BmCompareConnectTimelineEntry (
+  IN CONST VOID             *Left,
+  IN CONST VOID             *Right
+  )
+{
+  UINT64                    LeftDuration;
+  UINT64                    RightDuration;
+
+  LeftDuration  = ((BM_CONNECT_TIMELINE_ENTRY *) Left)->Duration;
+  RightDuration = ((BM_CONNECT_TIMELINE_ENTRY *) Right)->Duration;
+  if (LeftDuration == RightDuration) {
+    return 0;
+  }
+  return (LeftDuration > RightDuration) ? -1 : 1;
+}
+
+/**
+  Print the controllers of one connect pass, slowest first.
+
+  Controllers which took less than 1ms are only counted.
+
+  @param  Pass           The pass number.
+  @param  Timeline       The timeline entries.
+  @param  TimelineCount  The number of timeline entries.
+  @param  SkippedCount   The number of handles already connected through their parent.
+**/
+VOID
+BmDumpConnectTimeline (
+  IN UINTN                      Pass,
+  IN BM_CONNECT_TIMELINE_ENTRY  *Timeline,
+  IN UINTN                      TimelineCount,
+  IN UINTN                      SkippedCount
+  )
+{
+  UINTN                         Index;
+  CHAR16                        *DevicePathStr;
+
+  PerformQuickSort (Timeline, TimelineCount, sizeof (BM_CONNECT_TIMELINE_ENTRY), BmCompareConnectTimelineEntry);
+
+  DEBUG ((EFI_D_INFO, "[Bds]ConnectAll pass %d: %d controllers connected, %d covered by their parent\n", Pass, TimelineCount, SkippedCount));
+  for (Index = 0; (Index < TimelineCount) && (Timeline[Index].Duration >= 1000000); Index++) {
+    DevicePathStr = ConvertDevicePathToText (DevicePathFromHandle (Timeline[Index].Controller), FALSE, FALSE);
+    DEBUG ((
+      EFI_D_INFO, "[Bds]  +%ldus %ldus %r %s\n",
+      DivU64x32 (Timeline[Index].StartTime, 1000), DivU64x32 (Timeline[Index].Duration, 1000),
+      Timeline[Index].Status, (DevicePathStr != NULL) ? DevicePathStr : L"<no device path>"
+      ));
+    if (DevicePathStr != NULL) {
+      FreePool (DevicePathStr);
+    }
+  }
+}
+
 /**
   Connect all the drivers to all the controllers.
 
   This function makes sure all the current system drivers manage the correspoinding
   controllers if have. And at the same time, makes sure all the system controllers
   have driver to manage it if have.
+
+  Handles are connected recursively in creation order, so parents come before
+  their children. A child handle that its parent's recursive connect already
+  visited is not connected again, which saves a full sweep of the driver
+  bindings' Supported() for every such handle. The time spent on each
+  controller subtree is kept and dumped in DEBUG builds to help find slow devices.
 **/
 VOID
 BmConnectAllDriversToAllControllers (
   VOID
   )
 {
-  EFI_STATUS  Status;
-  UINTN       HandleCount;
-  EFI_HANDLE  *HandleBuffer;
-  UINTN       Index;
-
+  EFI_STATUS                Status;
+  UINTN                     HandleCount;
+  EFI_HANDLE                *HandleBuffer;
+  UINTN                     Index;
+  BOOLEAN                   *Connected;
+  BM_CONNECT_TIMELINE_ENTRY *Timeline;
+  UINTN                     TimelineCount;
+  UINT64                    PassTicker;
+  UINT64                    Ticker;
+  UINTN                     Pass;
+
+  Pass = 0;
   do {
     //
     // Connect All EFI 1.10 drivers following EFI 1.10 algorithm
     //
-    gBS->LocateHandleBuffer (
-           AllHandles,
-           NULL,
-           NULL,
-           &HandleCount,
-           &HandleBuffer
-           );
+    Status = gBS->LocateHandleBuffer (
+                    AllHandles,
+                    NULL,
+                    NULL,
+                    &HandleCount,
+                    &HandleBuffer
+                    );
+    if (EFI_ERROR (Status)) {
+      HandleCount  = 0;
+      HandleBuffer = NULL;
+    }
+
+    Connected = AllocateZeroPool (HandleCount * sizeof (BOOLEAN));
+    Timeline  = AllocatePool (HandleCount * sizeof (BM_CONNECT_TIMELINE_ENTRY));
+    TimelineCount = 0;
+    PassTicker    = GetPerformanceCounter ();
 
     for (Index = 0; Index < HandleCount; Index++) {
-      gBS->ConnectController (HandleBuffer[Index], NULL, NULL, TRUE);
+      if ((Connected != NULL) && Connected[Index]) {
+        continue;
+      }
+
+      Ticker = GetPerformanceCounter ();
+      Status = gBS->ConnectController (HandleBuffer[Index], NULL, NULL, TRUE);
+      if (Timeline != NULL) {
+        Timeline[TimelineCount].Controller = HandleBuffer[Index];
+        Timeline[TimelineCount].Duration   = BmGetElapsedTime (Ticker);
+        Timeline[TimelineCount].StartTime  = BmGetElapsedTime (PassTicker) - Timeline[TimelineCount].Duration;
+        Timeline[TimelineCount].Status     = Status;
+        TimelineCount++;
+      }
+
+      //
+      // The children are known to be connected only when the recursive connect
+      // completed. EFI_NOT_FOUND only means no new driver was started on the
+      // controller, and the recursion still visits its children. On any other
+      // status the children may not have been reached, so they are connected in
+      // their own turn.
+      //
+      if ((Connected != NULL) && ((Status == EFI_SUCCESS) || (Status == EFI_NOT_FOUND))) {
+        BmMarkChildHandles (HandleBuffer[Index], HandleBuffer, HandleCount, Connected);
+      }
     }
 
+    DEBUG_CODE (
+      if (Timeline != NULL) {
+        BmDumpConnectTimeline (Pass, Timeline, TimelineCount, HandleCount - TimelineCount);
+      }
+    );
+    Pass++;
+
+    if (Connected != NULL) {
+      FreePool (Connected);
+    }
+    if (Timeline != NULL) {
+      FreePool (Timeline);
+    }
     if (HandleBuffer != NULL) {
       FreePool (HandleBuffer);
     }
@@ -9,7 +9,17 @@
     Aligned  - A read of N contiguous sectors.
     OverRun  - The last byte is not on a sector boundary.
 
-Copyright (c) 2006 - 2014, Intel Corporation. All rights reserved.<BR>
+  When PcdDiskIoCacheBlockNum is not zero, blocking reads of a single block
+  on fixed media are served from a per-media LRU sector cache. A miss that
+  continues the previous read reads ahead into the cache. Writes invalidate
+  the cached blocks they cover.
+
+  The cache belongs to one DiskIo instance and only sees the writes made
+  through it. Writes made through BlockIo or BlockIo2, or through the DiskIo
+  instance of a parent or child partition, are not seen, and reads can return
+  stale data afterwards. The cache is therefore disabled by default.
+
+Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -54,6 +64,283 @@ DISK_IO_PRIVATE_DATA        gDiskIoPrivateDataTemplate = {
   }
 };
 
+/**
+  Free the sector cache of the Disk IO instance.
+
+  @param Instance  Pointer to the DISK_IO_PRIVATE_DATA.
+**/
+VOID
+DiskIoCacheFree (
+  IN DISK_IO_PRIVATE_DATA  *Instance
+  )
+{
+  if (Instance->CacheEntries != NULL) {
+    FreePool (Instance->CacheEntries);
+    Instance->CacheEntries = NULL;
+  }
+  if (Instance->CacheBuffer != NULL) {
+    FreePool (Instance->CacheBuffer);
+    Instance->CacheBuffer = NULL;
+  }
+  InitializeListHead (&Instance->CacheLru);
+  Instance->CacheBlockNum = 0;
+}
+
+/**
+  Allocate the sector cache of the Disk IO instance.
+
+  The cache holds PcdDiskIoCacheBlockNum blocks. A PCD value of 0 disables it.
+  Removable media is never cached: a cache hit does not reach BlockIo, so a
+  media change or removal would go unnoticed and the old media's data would be
+  returned. If the cache cannot be allocated the instance runs uncached.
+
+  @param Instance  Pointer to the DISK_IO_PRIVATE_DATA.
+**/
+VOID
+DiskIoCacheInitialize (
+  IN DISK_IO_PRIVATE_DATA  *Instance
+  )
+{
+  UINT32                   BlockSize;
+  UINT32                   Index;
+
+  InitializeListHead (&Instance->CacheLru);
+  Instance->CacheBlockNum = PcdGet32 (PcdDiskIoCacheBlockNum);
+  Instance->CacheMediaId  = Instance->BlockIo->Media->MediaId;
+  Instance->CacheNextLba  = 0;
+  if (Instance->BlockIo->Media->RemovableMedia) {
+    Instance->CacheBlockNum = 0;
+  }
+  if (Instance->CacheBlockNum == 0) {
+    return;
+  }
+
+  BlockSize = Instance->BlockIo->Media->BlockSize;
+  Instance->CacheEntries = AllocateZeroPool (Instance->CacheBlockNum * sizeof (DISK_IO_CACHE_ENTRY));
+  Instance->CacheBuffer  = AllocatePool (Instance->CacheBlockNum * BlockSize);
+  if ((Instance->CacheEntries == NULL) || (Instance->CacheBuffer == NULL)) {
+    DEBUG ((EFI_D_WARN, "DiskIo: Not enough memory for a %d block sector cache, running uncached\n", PcdGet32 (PcdDiskIoCacheBlockNum)));
+    DiskIoCacheFree (Instance);
+    return;
+  }
+
+  for (Index = 0; Index < Instance->CacheBlockNum; Index++) {
+    Instance->CacheEntries[Index].Signature = DISK_IO_CACHE_ENTRY_SIGNATURE;
+    Instance->CacheEntries[Index].Valid     = FALSE;
+    Instance->CacheEntries[Index].Data      = Instance->CacheBuffer + Index * BlockSize;
+    InsertTailList (&Instance->CacheLru, &Instance->CacheEntries[Index].Link);
+  }
+}
+
+/**
+  Drop every cached block if the media has changed since the cache was filled.
+
+  @param Instance  Pointer to the DISK_IO_PRIVATE_DATA.
+  @param MediaId   ID of the medium being accessed.
+**/
+VOID
+DiskIoCacheCheckMedia (
+  IN DISK_IO_PRIVATE_DATA  *Instance,
+  IN UINT32                MediaId
+  )
+{
+  UINT32                   Index;
+
+  if (Instance->CacheMediaId == MediaId) {
+    return;
+  }
+
+  for (Index = 0; Index < Instance->CacheBlockNum; Index++) {
+    Instance->CacheEntries[Index].Valid = FALSE;
+  }
+  Instance->CacheMediaId = MediaId;
+  Instance->CacheNextLba = 0;
+}
+
+/**
+  Find a block in the sector cache.
+
+  @param Instance  Pointer to the DISK_IO_PRIVATE_DATA.
+  @param Lba       The block to find.
+
+  @return The cache entry holding the block, or NULL when the block is not cached.
+**/
+DISK_IO_CACHE_ENTRY *
+DiskIoCacheLookup (
+  IN DISK_IO_PRIVATE_DATA  *Instance,
+  IN EFI_LBA               Lba
+  )
+{
+  LIST_ENTRY               *Link;
+  DISK_IO_CACHE_ENTRY      *Entry;
+
+  for (Link = GetFirstNode (&Instance->CacheLru); !IsNull (&Instance->CacheLru, Link); Link = GetNextNode (&Instance->CacheLru, Link)) {
+    Entry = CR (Link, DISK_IO_CACHE_ENTRY, Link, DISK_IO_CACHE_ENTRY_SIGNATURE);
+    if (!Entry->Valid) {
+      //
+      // Invalid entries are kept at the end of the LRU list.
+      //
+      break;
+    }
+    if (Entry->Lba == Lba) {
+      return Entry;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Store one block in the sector cache, evicting the least recently used block.
+
+  @param Instance  Pointer to the DISK_IO_PRIVATE_DATA.
+  @param Lba       The block number.
+  @param Data      The block data.
+**/
+VOID
+DiskIoCacheInsert (
+  IN DISK_IO_PRIVATE_DATA  *Instance,
+  IN EFI_LBA               Lba,
+  IN UINT8                 *Data
+  )
+{
+  DISK_IO_CACHE_ENTRY      *Entry;
+
+  Entry = DiskIoCacheLookup (Instance, Lba);
+  if (Entry == NULL) {
+    Entry = CR (GetPreviousNode (&Instance->CacheLru, &Instance->CacheLru), DISK_IO_CACHE_ENTRY, Link, DISK_IO_CACHE_ENTRY_SIGNATURE);
+  }
+
+  CopyMem (Entry->Data, Data, Instance->BlockIo->Media->BlockSize);
+  Entry->Lba   = Lba;
+  Entry->Valid = TRUE;
+  RemoveEntryList (&Entry->Link);
+  InsertHeadList (&Instance->CacheLru, &Entry->Link);
+}
+
+/**
+  Invalidate the cached blocks that a write is about to change.
+
+  @param Instance        Pointer to the DISK_IO_PRIVATE_DATA.
+  @param Lba             The first block written.
+  @param NumberOfBlocks  The number of blocks written.
+**/
+VOID
+DiskIoCacheInvalidate (
+  IN DISK_IO_PRIVATE_DATA  *Instance,
+  IN EFI_LBA               Lba,
+  IN UINTN                 NumberOfBlocks
+  )
+{
+  UINT32                   Index;
+  DISK_IO_CACHE_ENTRY      *Entry;
+
+  for (Index = 0; Index < Instance->CacheBlockNum; Index++) {
+    Entry = &Instance->CacheEntries[Index];
+    if (Entry->Valid && (Entry->Lba >= Lba) && (Entry->Lba - Lba < NumberOfBlocks)) {
+      Entry->Valid = FALSE;
+      RemoveEntryList (&Entry->Link);
+      InsertTailList (&Instance->CacheLru, &Entry->Link);
+    }
+  }
+}
+
+/**
+  Read part of one block through the sector cache.
+
+  On a miss that continues the previous blocking read, the following blocks are
+  read ahead into the cache using the shared working buffer.
+
+  @param Instance  Pointer to the DISK_IO_PRIVATE_DATA.
+  @param MediaId   ID of the medium to read.
+  @param Lba       The block to read.
+  @param Offset    The starting byte offset within the block.
+  @param Length    The number of bytes to read.
+  @param Buffer    A pointer to the destination buffer for the data.
+
+  @return The status returned by the BlockIo ReadBlocks.
+**/
+EFI_STATUS
+DiskIoCacheRead (
+  IN DISK_IO_PRIVATE_DATA  *Instance,
+  IN UINT32                MediaId,
+  IN EFI_LBA               Lba,
+  IN UINT32                Offset,
+  IN UINTN                 Length,
+  OUT UINT8                *Buffer
+  )
+{
+  EFI_STATUS               Status;
+  EFI_BLOCK_IO_MEDIA       *Media;
+  DISK_IO_CACHE_ENTRY      *Entry;
+  UINTN                    NumberOfBlocks;
+  UINTN                    Index;
+
+  Media = Instance->BlockIo->Media;
+  DiskIoCacheCheckMedia (Instance, MediaId);
+
+  Entry = DiskIoCacheLookup (Instance, Lba);
+  if (Entry != NULL) {
+    Instance->CacheHits++;
+    RemoveEntryList (&Entry->Link);
+    InsertHeadList (&Instance->CacheLru, &Entry->Link);
+    CopyMem (Buffer, Entry->Data + Offset, Length);
+    Instance->CacheNextLba = Lba + 1;
+    return EFI_SUCCESS;
+  }
+
+  Instance->CacheMisses++;
+  NumberOfBlocks = 1;
+  if ((Lba == Instance->CacheNextLba) && (Lba < Media->LastBlock)) {
+    //
+    // Sequential access: fill up to half of the cache, bounded by the working buffer and the media.
+    //
+    NumberOfBlocks = MIN (Instance->CacheBlockNum / 2, PcdGet32 (PcdDiskIoDataBufferBlockNum));
+    NumberOfBlocks = (UINTN) MIN ((UINT64) NumberOfBlocks, Media->LastBlock - Lba + 1);
+    NumberOfBlocks = MAX (NumberOfBlocks, 1);
+  }
+
+  Instance->BlockIoReads++;
+  Status = Instance->BlockIo->ReadBlocks (
+                                Instance->BlockIo,
+                                MediaId,
+                                Lba,
+                                NumberOfBlocks * Media->BlockSize,
+                                Instance->SharedWorkingBuffer
+                                );
+  if (EFI_ERROR (Status) && (NumberOfBlocks > 1)) {
+    //
+    // Do not let a failure in the read-ahead range fail the requested block.
+    //
+    NumberOfBlocks = 1;
+    Instance->BlockIoReads++;
+    Status = Instance->BlockIo->ReadBlocks (
+                                  Instance->BlockIo,
+                                  MediaId,
+                                  Lba,
+                                  Media->BlockSize,
+                                  Instance->SharedWorkingBuffer
+                                  );
+  }
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Insert the read-ahead blocks first so the requested block ends up most recently used.
+  //
+  for (Index = NumberOfBlocks; Index > 0; Index--) {
+    DiskIoCacheInsert (Instance, Lba + Index - 1, Instance->SharedWorkingBuffer + (Index - 1) * Media->BlockSize);
+  }
+
+  //
+  // Buffer may be the shared working buffer itself (read-modify-write), so copy with overlap handling.
+  //
+  CopyMem (Buffer, Instance->SharedWorkingBuffer + Offset, Length);
+  Instance->CacheNextLba = Lba + 1;
+  return EFI_SUCCESS;
+}
+
 /**
   Test to see if this driver supports ControllerHandle. 
 
@@ -191,6 +478,8 @@ DiskIoDriverBindingStart (
     goto ErrorExit;
   }
 
+  DiskIoCacheInitialize (Instance);
+
   //
   // Install protocol interfaces for the Disk IO device.
   //
@@ -219,6 +508,7 @@ ErrorExit:
     }
 
     if (Instance != NULL) {
+      DiskIoCacheFree (Instance);
       FreePool (Instance);
     }
 
@@ -322,6 +612,20 @@ DiskIoDriverBindingStop (
       EfiReleaseLock (&Instance->TaskQueueLock);
     } while (!AllTaskDone);
 
+    DEBUG ((
+      EFI_D_INFO,
+      "DiskIo: BlockIo reads/writes = %ld/%ld, cache hits/misses = %ld/%ld\n",
+      Instance->BlockIoReads, Instance->BlockIoWrites, Instance->CacheHits, Instance->CacheMisses
+      ));
+    if (Instance->CacheHits + Instance->CacheMisses != 0) {
+      DEBUG ((
+        EFI_D_INFO,
+        "DiskIo: cache hit rate = %ld%%\n",
+        DivU64x64Remainder (MultU64x32 (Instance->CacheHits, 100), Instance->CacheHits + Instance->CacheMisses, NULL)
+        ));
+    }
+    DiskIoCacheFree (Instance);
+
     FreeAlignedPages (
       Instance->SharedWorkingBuffer,
       EFI_SIZE_TO_PAGES (PcdGet32 (PcdDiskIoDataBufferBlockNum) * Instance->BlockIo->Media->BlockSize)
@@ -898,6 +1202,15 @@ DiskIo2ReadWriteDisk (
         CopyMem (Subtask->WorkingBuffer + Subtask->Offset, Subtask->Buffer, Subtask->Length);
       }
 
+      if (Instance->CacheBlockNum != 0) {
+        DiskIoCacheInvalidate (
+          Instance,
+          Subtask->Lba,
+          (Subtask->Length % Media->BlockSize == 0) ? Subtask->Length / Media->BlockSize : 1
+          );
+      }
+
+      Instance->BlockIoWrites++;
       if (SubtaskBlocking) {
         Status = BlockIo->WriteBlocks (
                             BlockIo,
@@ -921,7 +1234,14 @@ DiskIo2ReadWriteDisk (
       //
       // Read
       //
-      if (SubtaskBlocking) {
+      if (SubtaskBlocking && (Instance->CacheBlockNum != 0) &&
+          (Subtask->Length != 0) && (Subtask->Length <= Media->BlockSize)) {
+        //
+        // Partial or single block read: serve it from the sector cache.
+        //
+        Status = DiskIoCacheRead (Instance, MediaId, Subtask->Lba, Subtask->Offset, Subtask->Length, Subtask->Buffer);
+      } else if (SubtaskBlocking) {
+        Instance->BlockIoReads++;
         Status = BlockIo->ReadBlocks (
                             BlockIo,
                             MediaId,
@@ -932,7 +1252,9 @@ DiskIo2ReadWriteDisk (
         if (!EFI_ERROR (Status) && (Subtask->WorkingBuffer != NULL)) {
           CopyMem (Subtask->Buffer, Subtask->WorkingBuffer + Subtask->Offset, Subtask->Length);
         }
+        Instance->CacheNextLba = Subtask->Lba + DivU64x32 (Subtask->Length + Media->BlockSize - 1, Media->BlockSize);
       } else {
+        Instance->BlockIoReads++;
         Status = BlockIo2->ReadBlocksEx (
                              BlockIo2,
                              MediaId,
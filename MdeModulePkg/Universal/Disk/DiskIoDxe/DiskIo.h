@@ -29,6 +29,16 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/PcdLib.h>
+
+#define DISK_IO_CACHE_ENTRY_SIGNATURE SIGNATURE_32 ('d', 'i', 'c', 'e')
+typedef struct {
+  UINT32                          Signature;
+  LIST_ENTRY                      Link;     /// < link in the LRU list, most recently used first
+  BOOLEAN                         Valid;
+  EFI_LBA                         Lba;
+  UINT8                           *Data;    /// < one block of data
+} DISK_IO_CACHE_ENTRY;
 
 #define DISK_IO_PRIVATE_DATA_SIGNATURE  SIGNATURE_32 ('d', 's', 'k', 'I')
 typedef struct {
@@ -43,6 +53,25 @@ typedef struct {
 
   EFI_LOCK                        TaskQueueLock;
   LIST_ENTRY                      TaskQueue;
+
+  //
+  // Sector cache for blocking reads, sized by PcdDiskIoCacheBlockNum.
+  // CacheBlockNum is 0 when the cache is disabled.
+  //
+  UINT32                          CacheBlockNum;
+  DISK_IO_CACHE_ENTRY             *CacheEntries;
+  UINT8                           *CacheBuffer;
+  LIST_ENTRY                      CacheLru;
+  UINT32                          CacheMediaId;
+  EFI_LBA                         CacheNextLba;  /// < LBA following the last blocking read, for read-ahead detection
+
+  //
+  // Statistics reported when the driver is stopped.
+  //
+  UINT64                          CacheHits;
+  UINT64                          CacheMisses;
+  UINT64                          BlockIoReads;
+  UINT64                          BlockIoWrites;
 } DISK_IO_PRIVATE_DATA;
 #define DISK_IO_PRIVATE_DATA_FROM_DISK_IO(a)  CR (a, DISK_IO_PRIVATE_DATA, DiskIo,  DISK_IO_PRIVATE_DATA_SIGNATURE)
 #define DISK_IO_PRIVATE_DATA_FROM_DISK_IO2(a) CR (a, DISK_IO_PRIVATE_DATA, DiskIo2, DISK_IO_PRIVATE_DATA_SIGNATURE)
@@ -246,7 +246,7 @@ GetSmbiosStructureSize (
 
   Determin whether an SmbiosHandle has already in use.
 
-  @param Head        Pointer to the beginning of SMBIOS structure.
+  @param Private     The SMBIOS instance.
   @param Handle      A unique handle will be assigned to the SMBIOS record.
 
   @retval TRUE       Smbios handle already in use.
@@ -256,21 +256,37 @@ GetSmbiosStructureSize (
 BOOLEAN
 EFIAPI
 CheckSmbiosHandleExistance (
-  IN  LIST_ENTRY           *Head,
+  IN  SMBIOS_INSTANCE      *Private,
   IN  EFI_SMBIOS_HANDLE    Handle
   )
 {
-  LIST_ENTRY              *Link;
-  SMBIOS_HANDLE_ENTRY     *HandleEntry;
-  
-  for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
-    HandleEntry = SMBIOS_HANDLE_ENTRY_FROM_LINK(Link);
-    if (HandleEntry->SmbiosHandle == Handle) {
-      return TRUE;
+  return (BOOLEAN) ((Private->AllocatedHandleBitmap[Handle / 8] & (1 << (Handle % 8))) != 0);
+}
+
+/**
+
+  Mark an SmbiosHandle as in use or as free.
+
+  @param Private     The SMBIOS instance.
+  @param Handle      The SMBIOS handle.
+  @param InUse       TRUE if the handle is now in use, FALSE if it is now free.
+
+**/
+VOID
+SetSmbiosHandleInUse (
+  IN  SMBIOS_INSTANCE      *Private,
+  IN  EFI_SMBIOS_HANDLE    Handle,
+  IN  BOOLEAN              InUse
+  )
+{
+  if (InUse) {
+    Private->AllocatedHandleBitmap[Handle / 8] |= (UINT8) (1 << (Handle % 8));
+  } else {
+    Private->AllocatedHandleBitmap[Handle / 8] &= (UINT8) ~(1 << (Handle % 8));
+    if (Handle < Private->FreeHandleHint) {
+      Private->FreeHandleHint = Handle;
     }
   }
-
-  return FALSE;
 }
 
 /**
@@ -313,7 +329,6 @@ GetAvailableSmbiosHandle (
   IN OUT   EFI_SMBIOS_HANDLE     *Handle
   )
 {
-  LIST_ENTRY              *Head;
   SMBIOS_INSTANCE         *Private;
   EFI_SMBIOS_HANDLE       MaxSmbiosHandle;
   EFI_SMBIOS_HANDLE       AvailableHandle;
@@ -321,9 +336,17 @@ GetAvailableSmbiosHandle (
   GetMaxSmbiosHandle(This, &MaxSmbiosHandle);
 
   Private = SMBIOS_INSTANCE_FROM_THIS (This);
-  Head = &Private->AllocatedHandleListHead;
-  for (AvailableHandle = 0; AvailableHandle < MaxSmbiosHandle; AvailableHandle++) {
-    if (!CheckSmbiosHandleExistance(Head, AvailableHandle)) {
+  //
+  // The lowest free handle is returned. Start from the hint, and skip
+  // eight handles at a time while the bitmap bytes are full.
+  //
+  for (AvailableHandle = Private->FreeHandleHint; AvailableHandle < MaxSmbiosHandle; AvailableHandle++) {
+    if (((AvailableHandle % 8) == 0) && (Private->AllocatedHandleBitmap[AvailableHandle / 8] == 0xFF)) {
+      AvailableHandle += 7;
+      continue;
+    }
+    if (!CheckSmbiosHandleExistance(Private, AvailableHandle)) {
+      Private->FreeHandleHint = AvailableHandle;
       *Handle = AvailableHandle;
       return EFI_SUCCESS;
     }
@@ -367,11 +390,9 @@ SmbiosAdd (
   UINTN                       StructureSize;
   UINTN                       NumberOfStrings;
   EFI_STATUS                  Status;
-  LIST_ENTRY                  *Head;
   SMBIOS_INSTANCE             *Private;
   EFI_SMBIOS_ENTRY            *SmbiosEntry;
   EFI_SMBIOS_HANDLE           MaxSmbiosHandle;
-  SMBIOS_HANDLE_ENTRY         *HandleEntry;
   EFI_SMBIOS_RECORD_HEADER    *InternalRecord;
   BOOLEAN                     Smbios32BitTable;
   BOOLEAN                     Smbios64BitTable;
@@ -384,8 +405,7 @@ SmbiosAdd (
   //
   // Check whether SmbiosHandle is already in use
   //
-  Head = &Private->AllocatedHandleListHead;
-  if (*SmbiosHandle != SMBIOS_HANDLE_PI_RESERVED && CheckSmbiosHandleExistance(Head, *SmbiosHandle)) {
+  if (*SmbiosHandle != SMBIOS_HANDLE_PI_RESERVED && CheckSmbiosHandleExistance(Private, *SmbiosHandle)) {
     return EFI_ALREADY_STARTED;
   }
 
@@ -476,18 +496,11 @@ SmbiosAdd (
     EfiReleaseLock (&Private->DataLock);
     return EFI_OUT_OF_RESOURCES;
   }
-  HandleEntry = AllocateZeroPool (sizeof(SMBIOS_HANDLE_ENTRY));
-  if (HandleEntry == NULL) {
-    EfiReleaseLock (&Private->DataLock);
-    return EFI_OUT_OF_RESOURCES;
-  }
 
   //
-  // Build Handle Entry and insert into linked list
+  // Mark the handle as allocated
   //
-  HandleEntry->Signature     = SMBIOS_HANDLE_ENTRY_SIGNATURE;
-  HandleEntry->SmbiosHandle  = *SmbiosHandle;
-  InsertTailList(&Private->AllocatedHandleListHead, &HandleEntry->Link);
+  SetSmbiosHandleInUse (Private, *SmbiosHandle, TRUE);
 
   InternalRecord  = (EFI_SMBIOS_RECORD_HEADER *) (SmbiosEntry + 1);
   Raw     = (VOID *) (InternalRecord + 1);
@@ -515,11 +528,11 @@ SmbiosAdd (
 
   //
   // Some UEFI drivers (such as network) need some information in SMBIOS table.
-  // Here we create SMBIOS table and publish it in
+  // Here we append the record to SMBIOS table and publish it in
   // configuration table, so other UEFI drivers can get SMBIOS table from
   // configuration table without depending on PI SMBIOS protocol.
   //
-  SmbiosTableConstruction (Smbios32BitTable, Smbios64BitTable);
+  SmbiosTableAppend (SmbiosEntry);
   
   //
   // Leave critical section
@@ -803,7 +816,6 @@ SmbiosRemove (
   EFI_SMBIOS_HANDLE          MaxSmbiosHandle;
   SMBIOS_INSTANCE            *Private;
   EFI_SMBIOS_ENTRY           *SmbiosEntry;
-  SMBIOS_HANDLE_ENTRY        *HandleEntry;
   EFI_SMBIOS_TABLE_HEADER    *Record;
 
   //
@@ -834,17 +846,9 @@ SmbiosRemove (
       //
       RemoveEntryList(Link);
       // 
-      // Remove this handle from AllocatedHandleList
+      // Mark this handle as free
       //
-      Head = &Private->AllocatedHandleListHead;
-      for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
-        HandleEntry = SMBIOS_HANDLE_ENTRY_FROM_LINK(Link);
-        if (HandleEntry->SmbiosHandle == SmbiosHandle) {
-          RemoveEntryList(Link);
-          FreePool(HandleEntry);
-          break;
-        }
-      }
+      SetSmbiosHandleInUse (Private, SmbiosHandle, FALSE);
       //
       // Some UEFI drivers (such as network) need some information in SMBIOS table.
       // Here we create SMBIOS table and publish it in
@@ -1040,7 +1044,7 @@ SmbiosCreateTable (
 {
   UINT8                           *BufferPointer;
   UINTN                           RecordSize;
-  UINTN                           NumOfStr;
+  UINTN                           Pages;
   EFI_STATUS                      Status;
   EFI_SMBIOS_HANDLE               SmbiosHandle;
   EFI_SMBIOS_PROTOCOL             *SmbiosProtocol;
@@ -1111,7 +1115,7 @@ SmbiosCreateTable (
     Status = GetNextSmbiosRecord (SmbiosProtocol, &CurrentSmbiosEntry, &SmbiosRecord);
                                
     if ((Status == EFI_SUCCESS) && (CurrentSmbiosEntry->Smbios32BitTable)) {
-      GetSmbiosStructureSize(SmbiosProtocol, SmbiosRecord, &RecordSize, &NumOfStr);
+      RecordSize = CurrentSmbiosEntry->RecordHeader->RecordSize - CurrentSmbiosEntry->RecordHeader->HeaderSize;
       //
       // Record NumberOfSmbiosStructures, TableLength and MaxStructureSize
       //
@@ -1156,11 +1160,20 @@ SmbiosCreateTable (
       mPreAllocatedPages = 0;
     }
     
+    //
+    // Leave room for the records added later, so that SmbiosAppendToTable()
+    // can copy them in place. The 32-bit table never exceeds
+    // SMBIOS_TABLE_MAX_LENGTH bytes.
+    //
+    Pages = MIN (
+              EFI_SIZE_TO_PAGES ((UINTN) EntryPointStructure->TableLength) * 2,
+              EFI_SIZE_TO_PAGES (SMBIOS_TABLE_MAX_LENGTH)
+              );
     PhysicalAddress = 0xffffffff;
     Status = gBS->AllocatePages (
                     AllocateMaxAddress,
                     EfiRuntimeServicesData,
-                    EFI_SIZE_TO_PAGES (EntryPointStructure->TableLength),
+                    Pages,
                     &PhysicalAddress
                     );
     if (EFI_ERROR (Status)) {
@@ -1169,7 +1182,7 @@ SmbiosCreateTable (
       return EFI_OUT_OF_RESOURCES;
     } else {
       EntryPointStructure->TableAddress = (UINT32) PhysicalAddress;
-      mPreAllocatedPages = EFI_SIZE_TO_PAGES (EntryPointStructure->TableLength);
+      mPreAllocatedPages = Pages;
     }
   }
   
@@ -1183,7 +1196,7 @@ SmbiosCreateTable (
     Status = GetNextSmbiosRecord (SmbiosProtocol, &CurrentSmbiosEntry, &SmbiosRecord);
 
     if ((Status == EFI_SUCCESS) && (CurrentSmbiosEntry->Smbios32BitTable)) {
-      GetSmbiosStructureSize(SmbiosProtocol, SmbiosRecord, &RecordSize, &NumOfStr);
+      RecordSize = CurrentSmbiosEntry->RecordHeader->RecordSize - CurrentSmbiosEntry->RecordHeader->HeaderSize;
       CopyMem (BufferPointer, SmbiosRecord, RecordSize);
       BufferPointer = BufferPointer + RecordSize;
     }
@@ -1231,7 +1244,7 @@ SmbiosCreate64BitTable (
 {
   UINT8                           *BufferPointer;
   UINTN                           RecordSize;
-  UINTN                           NumOfStr;
+  UINTN                           Pages;
   EFI_STATUS                      Status;
   EFI_SMBIOS_HANDLE               SmbiosHandle;
   EFI_SMBIOS_PROTOCOL             *SmbiosProtocol;
@@ -1287,7 +1300,7 @@ SmbiosCreate64BitTable (
     Status = GetNextSmbiosRecord (SmbiosProtocol, &CurrentSmbiosEntry, &SmbiosRecord);
                                
     if ((Status == EFI_SUCCESS) && (CurrentSmbiosEntry->Smbios64BitTable)) {
-      GetSmbiosStructureSize(SmbiosProtocol, SmbiosRecord, &RecordSize, &NumOfStr);
+      RecordSize = CurrentSmbiosEntry->RecordHeader->RecordSize - CurrentSmbiosEntry->RecordHeader->HeaderSize;
       //
       // Record TableMaximumSize
       //
@@ -1324,10 +1337,15 @@ SmbiosCreate64BitTable (
       mPre64BitAllocatedPages = 0;
     }
 
+    //
+    // Leave room for the records added later, so that SmbiosAppendTo64BitTable()
+    // can copy them in place.
+    //
+    Pages = EFI_SIZE_TO_PAGES ((UINTN) Smbios30EntryPointStructure->TableMaximumSize) * 2;
     Status = gBS->AllocatePages (
                     AllocateAnyPages,
                     EfiRuntimeServicesData,
-                    EFI_SIZE_TO_PAGES (Smbios30EntryPointStructure->TableMaximumSize),
+                    Pages,
                     &PhysicalAddress
                     );
     if (EFI_ERROR (Status)) {
@@ -1336,7 +1354,7 @@ SmbiosCreate64BitTable (
       return EFI_OUT_OF_RESOURCES;
     } else {
       Smbios30EntryPointStructure->TableAddress = PhysicalAddress;
-      mPre64BitAllocatedPages = EFI_SIZE_TO_PAGES (Smbios30EntryPointStructure->TableMaximumSize);
+      mPre64BitAllocatedPages = Pages;
     }
   }
 
@@ -1353,7 +1371,7 @@ SmbiosCreate64BitTable (
       //
       // This record can be added to 64-bit table
       //
-      GetSmbiosStructureSize(SmbiosProtocol, SmbiosRecord, &RecordSize, &NumOfStr);
+      RecordSize = CurrentSmbiosEntry->RecordHeader->RecordSize - CurrentSmbiosEntry->RecordHeader->HeaderSize;
       CopyMem (BufferPointer, SmbiosRecord, RecordSize);
       BufferPointer = BufferPointer + RecordSize;
     }
@@ -1379,6 +1397,106 @@ SmbiosCreate64BitTable (
   return EFI_SUCCESS;
 }
 
+/**
+  Append an SMBIOS record to the 32-bit table in place.
+
+  The record is copied over the End-Of-Table structure, which is moved to
+  follow it.
+
+  @param  SmbiosRecord          The SMBIOS record, including its strings.
+  @param  RecordSize            The size of the SMBIOS record.
+
+  @retval EFI_SUCCESS           The record was appended to the table.
+  @retval EFI_NOT_READY         The table has not been created yet.
+  @retval EFI_BUFFER_TOO_SMALL  The table buffer has no room left for the record.
+
+**/
+EFI_STATUS
+SmbiosAppendToTable (
+  IN EFI_SMBIOS_TABLE_HEADER      *SmbiosRecord,
+  IN UINTN                        RecordSize
+  )
+{
+  UINT8                           *BufferPointer;
+
+  if ((EntryPointStructure == NULL) || (EntryPointStructure->TableAddress == 0)) {
+    return EFI_NOT_READY;
+  }
+  if (EntryPointStructure->TableLength + RecordSize > EFI_PAGES_TO_SIZE (mPreAllocatedPages)) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  BufferPointer = (UINT8 *) (UINTN) EntryPointStructure->TableAddress +
+                  EntryPointStructure->TableLength - sizeof (EFI_SMBIOS_TABLE_END_STRUCTURE);
+  CopyMem (BufferPointer + RecordSize, BufferPointer, sizeof (EFI_SMBIOS_TABLE_END_STRUCTURE));
+  CopyMem (BufferPointer, SmbiosRecord, RecordSize);
+
+  EntryPointStructure->NumberOfSmbiosStructures++;
+  EntryPointStructure->TableLength = (UINT16) (EntryPointStructure->TableLength + RecordSize);
+  if (RecordSize > EntryPointStructure->MaxStructureSize) {
+    EntryPointStructure->MaxStructureSize = (UINT16) RecordSize;
+  }
+
+  //
+  // Fixup checksums in the Entry Point Structure
+  //
+  EntryPointStructure->IntermediateChecksum = 0;
+  EntryPointStructure->EntryPointStructureChecksum = 0;
+
+  EntryPointStructure->IntermediateChecksum =
+    CalculateCheckSum8 ((UINT8 *) EntryPointStructure + 0x10, EntryPointStructure->EntryPointLength - 0x10);
+  EntryPointStructure->EntryPointStructureChecksum =
+    CalculateCheckSum8 ((UINT8 *) EntryPointStructure, EntryPointStructure->EntryPointLength);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Append an SMBIOS record to the 64-bit table in place.
+
+  The record is copied over the End-Of-Table structure, which is moved to
+  follow it.
+
+  @param  SmbiosRecord          The SMBIOS record, including its strings.
+  @param  RecordSize            The size of the SMBIOS record.
+
+  @retval EFI_SUCCESS           The record was appended to the table.
+  @retval EFI_NOT_READY         The table has not been created yet.
+  @retval EFI_BUFFER_TOO_SMALL  The table buffer has no room left for the record.
+
+**/
+EFI_STATUS
+SmbiosAppendTo64BitTable (
+  IN EFI_SMBIOS_TABLE_HEADER      *SmbiosRecord,
+  IN UINTN                        RecordSize
+  )
+{
+  UINT8                           *BufferPointer;
+
+  if ((Smbios30EntryPointStructure == NULL) || (Smbios30EntryPointStructure->TableAddress == 0)) {
+    return EFI_NOT_READY;
+  }
+  if (Smbios30EntryPointStructure->TableMaximumSize + RecordSize > EFI_PAGES_TO_SIZE (mPre64BitAllocatedPages)) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  BufferPointer = (UINT8 *) (UINTN) Smbios30EntryPointStructure->TableAddress +
+                  Smbios30EntryPointStructure->TableMaximumSize - sizeof (EFI_SMBIOS_TABLE_END_STRUCTURE);
+  CopyMem (BufferPointer + RecordSize, BufferPointer, sizeof (EFI_SMBIOS_TABLE_END_STRUCTURE));
+  CopyMem (BufferPointer, SmbiosRecord, RecordSize);
+
+  Smbios30EntryPointStructure->TableMaximumSize = (UINT32) (Smbios30EntryPointStructure->TableMaximumSize + RecordSize);
+
+  //
+  // Fixup checksums in the Entry Point Structure
+  //
+  Smbios30EntryPointStructure->EntryPointStructureChecksum = 0;
+  Smbios30EntryPointStructure->EntryPointStructureChecksum =
+    CalculateCheckSum8 ((UINT8 *) Smbios30EntryPointStructure, Smbios30EntryPointStructure->EntryPointLength);
+
+  return EFI_SUCCESS;
+}
+
 /**
   Create Smbios Table and installs the Smbios Table to the System Table.
   
@@ -1412,6 +1530,51 @@ SmbiosTableConstruction (
   }
 }
 
+/**
+  Add the record of an SMBIOS entry that was just appended to the record list
+  to the SMBIOS tables, and installs the tables to the System Table.
+
+  The record is copied to the end of a table when the table buffer has room
+  left for it, otherwise that table is constructed again.
+
+  @param  SmbiosEntry         The SMBIOS entry that was appended.
+
+**/
+VOID
+EFIAPI
+SmbiosTableAppend (
+  IN EFI_SMBIOS_ENTRY   *SmbiosEntry
+  )
+{
+  EFI_SMBIOS_TABLE_HEADER   *SmbiosRecord;
+  UINTN                     RecordSize;
+  BOOLEAN                   Construct32BitTable;
+  BOOLEAN                   Construct64BitTable;
+
+  SmbiosRecord = (EFI_SMBIOS_TABLE_HEADER *) (SmbiosEntry->RecordHeader + 1);
+  RecordSize   = SmbiosEntry->RecordHeader->RecordSize - SmbiosEntry->RecordHeader->HeaderSize;
+
+  Construct32BitTable = FALSE;
+  if (SmbiosEntry->Smbios32BitTable) {
+    if (EFI_ERROR (SmbiosAppendToTable (SmbiosRecord, RecordSize))) {
+      Construct32BitTable = TRUE;
+    } else {
+      gBS->InstallConfigurationTable (&gEfiSmbiosTableGuid, EntryPointStructure);
+    }
+  }
+
+  Construct64BitTable = FALSE;
+  if (SmbiosEntry->Smbios64BitTable) {
+    if (EFI_ERROR (SmbiosAppendTo64BitTable (SmbiosRecord, RecordSize))) {
+      Construct64BitTable = TRUE;
+    } else {
+      gBS->InstallConfigurationTable (&gEfiSmbios3TableGuid, Smbios30EntryPointStructure);
+    }
+  }
+
+  SmbiosTableConstruction (Construct32BitTable, Construct64BitTable);
+}
+
 /**
 
   Driver to produce Smbios protocol and pre-allocate 1 page for the final SMBIOS table. 
@@ -1441,7 +1604,7 @@ SmbiosDriverEntryPoint (
   mPrivateData.Smbios.MinorVersion      = (UINT8) (PcdGet16 (PcdSmbiosVersion) & 0x00ff);
 
   InitializeListHead (&mPrivateData.DataListHead);
-  InitializeListHead (&mPrivateData.AllocatedHandleListHead);
+  mPrivateData.FreeHandleHint           = 0;
   EfiInitializeLock (&mPrivateData.DataLock, TPL_NOTIFY);
   
   //
@@ -43,6 +43,11 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 //
 #define SMBIOS_3_0_TABLE_MAX_LENGTH 0xFFFFFFFF
 
+//
+// Size in bytes of the bitmap of allocated SMBIOS handles, one bit per handle.
+//
+#define SMBIOS_HANDLE_BITMAP_SIZE   ((MAX_UINT16 + 1) / 8)
+
 #define SMBIOS_INSTANCE_SIGNATURE SIGNATURE_32 ('S', 'B', 'i', 's')
 typedef struct {
   UINT32                Signature;
@@ -60,9 +65,13 @@ typedef struct {
   //
   LIST_ENTRY            DataListHead;
   //
-  // List of allocated SMBIOS handle.
+  // Bitmap of allocated SMBIOS handles.
   //
-  LIST_ENTRY            AllocatedHandleListHead;
+  UINT8                 AllocatedHandleBitmap[SMBIOS_HANDLE_BITMAP_SIZE];
+  //
+  // No handle below this one is free.
+  //
+  EFI_SMBIOS_HANDLE     FreeHandleHint;
 } SMBIOS_INSTANCE;
 
 #define SMBIOS_INSTANCE_FROM_THIS(this)  CR (this, SMBIOS_INSTANCE, Smbios, SMBIOS_INSTANCE_SIGNATURE)
@@ -103,23 +112,6 @@ typedef struct {
 
 #define SMBIOS_ENTRY_FROM_LINK(link)  CR (link, EFI_SMBIOS_ENTRY, Link, EFI_SMBIOS_ENTRY_SIGNATURE)
 
-//
-// Private data to contain the Smbios handle that already allocated.
-//
-#define SMBIOS_HANDLE_ENTRY_SIGNATURE  SIGNATURE_32 ('S', 'h', 'r', 'd')
-
-typedef struct {
-  UINT32               Signature;
-  LIST_ENTRY           Link;
-  //
-  // Filter driver will register what record guid filter should be used.
-  //
-  EFI_SMBIOS_HANDLE    SmbiosHandle;
-
-} SMBIOS_HANDLE_ENTRY;
-
-#define SMBIOS_HANDLE_ENTRY_FROM_LINK(link)  CR (link, SMBIOS_HANDLE_ENTRY, Link, SMBIOS_HANDLE_ENTRY_SIGNATURE)
-
 typedef struct {
   EFI_SMBIOS_TABLE_HEADER  Header;
   UINT8                    Tailing[2];
@@ -139,4 +131,20 @@ SmbiosTableConstruction (
   BOOLEAN     Smbios64BitTable
   );
 
+/**
+  Add the record of an SMBIOS entry that was just appended to the record list
+  to the SMBIOS tables, and installs the tables to the System Table.
+
+  The record is copied to the end of a table when the table buffer has room
+  left for it, otherwise that table is constructed again.
+
+  @param  SmbiosEntry         The SMBIOS entry that was appended.
+
+**/
+VOID
+EFIAPI
+SmbiosTableAppend (
+  IN EFI_SMBIOS_ENTRY   *SmbiosEntry
+  );
+
 #endif
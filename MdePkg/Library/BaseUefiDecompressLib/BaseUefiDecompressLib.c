@@ -38,44 +38,37 @@ FillBuf (
   )
 {
   //
-  // Left shift NumOfBits of bits in advance
+  // Split requests wider than 16 bits (priming mBitBuf, or a position code
+  // together with its extra bits) so the shifts below stay in range.
   //
-  Sd->mBitBuf = (UINT32) (Sd->mBitBuf << NumOfBits);
-
-  //
-  // Copy data needed in bytes into mSbuBitBuf
-  //
-  while (NumOfBits > Sd->mBitCount) {
-
-    Sd->mBitBuf |= (UINT32) (Sd->mSubBitBuf << (NumOfBits = (UINT16) (NumOfBits - Sd->mBitCount)));
-
-    if (Sd->mCompSize > 0) {
-      //
-      // Get 1 byte into SubBitBuf
-      //
-      Sd->mCompSize--;
-      Sd->mSubBitBuf  = Sd->mSrcBase[Sd->mInBuf++];
-      Sd->mBitCount   = 8;
-
-    } else {
-      //
-      // No more bits from the source, just pad zero bit.
-      //
-      Sd->mSubBitBuf  = 0;
-      Sd->mBitCount   = 8;
+  if (NumOfBits > 16) {
+    FillBuf (Sd, (UINT16) (NumOfBits - 16));
+    NumOfBits = 16;
+  }
 
-    }
+  if (Sd->mBitCount < NumOfBits) {
+    //
+    // Top up mSubBitBuf until less than one byte of it is free, so most
+    // calls are satisfied without touching the source at all. Once the
+    // source is exhausted, pad with zero bits.
+    //
+    do {
+      Sd->mSubBitBuf <<= 8;
+      if (Sd->mCompSize > 0) {
+        Sd->mCompSize--;
+        Sd->mSubBitBuf |= Sd->mSrcBase[Sd->mInBuf++];
+      }
+      Sd->mBitCount = (UINT16) (Sd->mBitCount + 8);
+    } while (Sd->mBitCount <= (sizeof (UINTN) - 1) * 8);
   }
 
   //
-  // Calculate additional bit count read to update mBitCount
+  // Shift mBitBuf left and move the top NumOfBits of the valid bits in
+  // mSubBitBuf into the vacated low bits.
   //
   Sd->mBitCount = (UINT16) (Sd->mBitCount - NumOfBits);
-  
-  //
-  // Copy NumOfBits of bits from mSubBitBuf into mBitBuf
-  //
-  Sd->mBitBuf |= Sd->mSubBitBuf >> Sd->mBitCount;
+  Sd->mBitBuf   = (Sd->mBitBuf << NumOfBits) |
+                  ((UINT32) (Sd->mSubBitBuf >> Sd->mBitCount) & ((1U << NumOfBits) - 1));
 }
 
 /**
@@ -273,6 +266,7 @@ DecodeP (
   )
 {
   UINT16  Val;
+  UINT16  Len;
   UINT32  Mask;
   UINT32  Pos;
 
@@ -292,12 +286,23 @@ DecodeP (
       Mask >>= 1;
     } while (Val >= MAXNP);
   }
+  Len = Sd->mPTLen[Val];
+  Pos = Val;
+  if (Val > 1 && Len + Val - 1 <= BITBUFSIZ) {
+    //
+    // The extra bits of the position follow its code in mBitBuf, so
+    // take both with a single advance.
+    //
+    Pos = (UINT32) ((1U << (Val - 1)) + ((Sd->mBitBuf << Len) >> (BITBUFSIZ - (Val - 1))));
+    FillBuf (Sd, (UINT16) (Len + Val - 1));
+    return Pos;
+  }
+
   //
   // Advance what we have read
   //
-  FillBuf (Sd, Sd->mPTLen[Val]);
+  FillBuf (Sd, Len);
 
-  Pos = Val;
   if (Val > 1) {
     Pos = (UINT32) ((1U << (Val - 1)) + GetBits (Sd, (UINT16) (Val - 1)));
   }
@@ -573,6 +578,8 @@ Decode (
   UINT16  BytesRemain;
   UINT32  DataIdx;
   UINT16  CharC;
+  UINT8   *Dst;
+  UINT32  OutBuf;
 
   BytesRemain = (UINT16) (-1);
 
@@ -617,16 +624,27 @@ Decode (
       DataIdx     = Sd->mOutBuf - DecodeP (Sd) - 1;
 
       //
-      // Write BytesRemain of bytes into mDstBase
+      // Write BytesRemain of bytes into mDstBase, stopping at the end of
+      // the destination buffer.
       //
-      BytesRemain--;
-      while ((INT16) (BytesRemain) >= 0) {
-        Sd->mDstBase[Sd->mOutBuf++] = Sd->mDstBase[DataIdx++];
-        if (Sd->mOutBuf >= Sd->mOrigSize) {
-          goto Done;
-        }
+      if (BytesRemain > Sd->mOrigSize - Sd->mOutBuf) {
+        BytesRemain = (UINT16) (Sd->mOrigSize - Sd->mOutBuf);
+      }
+
+      //
+      // Copy through locals: the destination is a byte pointer, so storing
+      // through it would otherwise force Sd to be reloaded for every byte.
+      // The string may overlap the bytes it produces, so copy it forward.
+      //
+      Dst    = Sd->mDstBase;
+      OutBuf = Sd->mOutBuf;
+      while (BytesRemain-- > 0) {
+        Dst[OutBuf++] = Dst[DataIdx++];
+      }
+      Sd->mOutBuf = OutBuf;
 
-        BytesRemain--;
+      if (Sd->mOutBuf >= Sd->mOrigSize) {
+        goto Done;
       }
     }
   }
@@ -47,7 +47,7 @@ typedef struct {
 
   UINT16  mBitCount;
   UINT32  mBitBuf;
-  UINT32  mSubBitBuf;
+  UINTN   mSubBitBuf; // Bits read ahead of mBitBuf; the low mBitCount bits are valid
   UINT16  mBlockSize;
   UINT32  mCompSize;
   UINT32  mOrigSize;
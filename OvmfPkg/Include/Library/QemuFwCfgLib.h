@@ -59,6 +59,29 @@ typedef enum {
 
 } FIRMWARE_CONFIG_ITEM;
 
+//
+// Feature bits reported in QemuFwCfgItemInterfaceVersion
+//
+#define FW_CFG_F_DMA BIT1
+
+//
+// Communication structure for the DMA interface. All fields are big endian.
+// The guest writes the address of the structure to the DMA address register,
+// and the host clears Control (or sets FW_CFG_DMA_CTL_ERROR in it) when the
+// transfer is complete.
+//
+#pragma pack (1)
+typedef struct {
+  UINT32 Control;
+  UINT32 Length;
+  UINT64 Address;
+} FW_CFG_DMA_ACCESS;
+#pragma pack ()
+
+#define FW_CFG_DMA_CTL_ERROR  BIT0
+#define FW_CFG_DMA_CTL_READ   BIT1
+#define FW_CFG_DMA_CTL_WRITE  BIT4
+
 
 /**
   Returns a boolean indicating if the firmware configuration interface
@@ -221,6 +244,22 @@ InternalQemuFwCfgIsAvailable (
   );
 
 
+/**
+  Returns a boolean indicating if the firmware configuration DMA interface is
+  available for library-internal purposes.
+
+  This function never changes fw_cfg state.
+
+  @retval    TRUE   The DMA interface is available internally.
+  @retval    FALSE  The DMA interface is not available internally.
+**/
+BOOLEAN
+EFIAPI
+InternalQemuFwCfgDmaIsAvailable (
+  VOID
+  );
+
+
 /**
   Determine if S3 support is explicitly enabled.
 
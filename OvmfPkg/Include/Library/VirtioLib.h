@@ -111,10 +111,10 @@ VirtioPrepare (
   This function implements the following section from virtio-0.9.5:
   - 2.4.1.1 Placing Buffers into the Descriptor Table
 
-  Free space is taken as granted, since the individual drivers support only
-  synchronous requests and host side status is processed in lock-step with
-  request submission. It is the calling driver's responsibility to verify the
-  ring size in advance.
+  Free space is taken as granted: synchronous drivers process host side status
+  in lock-step with request submission, and drivers with several requests in
+  flight append only to the descriptor slot they own. It is the calling
+  driver's responsibility to verify the ring size in advance.
 
   The caller is responsible for initializing *Indices with VirtioPrepare()
   first.
@@ -182,4 +182,41 @@ VirtioFlush (
   IN     DESC_INDICES           *Indices
   );
 
+
+/**
+
+  Notify the host about the descriptor chain just built, without waiting for
+  the host to process it.
+
+  Drivers that keep several descriptor chains in flight use this function and
+  collect the results from the used ring themselves. Such drivers must build
+  each chain at a head index that no other in-flight chain occupies, instead
+  of at the index VirtioPrepare() returns.
+
+  @param[in] VirtIo       The target virtio device to notify.
+
+  @param[in] VirtQueueId  Identifies the queue for the target device.
+
+  @param[in,out] Ring     The virtio ring with descriptors to submit.
+
+  @param[in] Indices      Indices->NextDescIdx is not accessed.
+                          Indices->HeadDescIdx identifies the head descriptor
+                          of the descriptor chain.
+
+
+  @return              Error code from VirtIo->SetQueueNotify() if it fails.
+
+  @retval EFI_SUCCESS  Otherwise, the descriptor chain is available to the
+                       host.
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioSubmit (
+  IN     VIRTIO_DEVICE_PROTOCOL *VirtIo,
+  IN     UINT16                 VirtQueueId,
+  IN OUT VRING                  *Ring,
+  IN     DESC_INDICES           *Indices
+  );
+
 #endif // _VIRTIO_LIB_H_
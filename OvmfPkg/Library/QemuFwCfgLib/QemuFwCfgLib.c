@@ -96,9 +96,92 @@ QemuFwCfgSelectItem (
 }
 
 
+/**
+  Transfer an array of bytes using the DMA interface.
+
+  The host processes the request synchronously: it has cleared the control
+  field of the access structure (or set the error bit in it) by the time we
+  poll it, but we don't rely on that.
+
+  @param[in]     Size     Size in bytes to transfer.
+
+  @param[in,out] Buffer   Buffer to read data into or write data from. Ignored,
+                          and may be NULL, if Size is zero.
+
+  @param[in]     Control  One of the following:
+                          FW_CFG_DMA_CTL_WRITE - write to fw_cfg from Buffer.
+                          FW_CFG_DMA_CTL_READ  - read from fw_cfg into Buffer.
+
+  @retval RETURN_SUCCESS       The bytes were transferred.
+  @retval RETURN_DEVICE_ERROR  The host reported an error. The item offset has
+                               still moved past the bytes, and after a read
+                               the contents of Buffer are undefined.
+
+**/
+STATIC
+RETURN_STATUS
+InternalQemuFwCfgDmaBytes (
+  IN     UINT32   Size,
+  IN OUT VOID     *Buffer OPTIONAL,
+  IN     UINT32   Control
+  )
+{
+  volatile FW_CFG_DMA_ACCESS Access;
+  UINT32                     AccessHigh;
+  UINT32                     AccessLow;
+  UINT32                     Status;
+
+  if (Size == 0) {
+    return RETURN_SUCCESS;
+  }
+
+  Access.Control = SwapBytes32 (Control);
+  Access.Length  = SwapBytes32 (Size);
+  Access.Address = SwapBytes64 ((UINTN) Buffer);
+
+  //
+  // Delimit the transfer from (a) modifications to Access, (b) in case of a
+  // write, from writes to Buffer by the caller.
+  //
+  MemoryFence ();
+
+  //
+  // Start the transfer. Writing the low half of the address triggers it.
+  //
+  AccessHigh = (UINT32) RShiftU64 ((UINTN) &Access, 32);
+  AccessLow  = (UINT32) (UINTN) &Access;
+  IoWrite32 (0x514, SwapBytes32 (AccessHigh));
+  IoWrite32 (0x518, SwapBytes32 (AccessLow));
+
+  //
+  // Don't look at Access.Control before starting the transfer.
+  //
+  MemoryFence ();
+
+  do {
+    Status = SwapBytes32 (Access.Control);
+  } while ((Status != 0) && ((Status & FW_CFG_DMA_CTL_ERROR) == 0));
+
+  //
+  // After a read, the caller will want to use Buffer.
+  //
+  MemoryFence ();
+
+  if ((Status & FW_CFG_DMA_CTL_ERROR) != 0) {
+    DEBUG ((EFI_D_ERROR, "QemuFwCfg DMA transfer of 0x%x bytes failed\n", Size));
+    return RETURN_DEVICE_ERROR;
+  }
+  return RETURN_SUCCESS;
+}
+
+
 /**
   Reads firmware configuration bytes into a buffer
 
+  The DMA interface is used if the host offers it, otherwise the bytes are
+  read one by one through the data port. The bytes of a failed DMA transfer
+  are returned as zeros, as when the interface is not available at all.
+
   @param[in] Size - Size in bytes to read
   @param[in] Buffer - Buffer to store data into  (OPTIONAL if Size is 0)
 
@@ -110,10 +193,56 @@ InternalQemuFwCfgReadBytes (
   IN VOID                   *Buffer  OPTIONAL
   )
 {
+  UINT32 Chunk;
+
+  if (InternalQemuFwCfgDmaIsAvailable ()) {
+    while (Size > 0) {
+      Chunk = (UINT32) MIN (Size, MAX_UINT32);
+      if (RETURN_ERROR (InternalQemuFwCfgDmaBytes (Chunk, Buffer, FW_CFG_DMA_CTL_READ))) {
+        ZeroMem (Buffer, Chunk);
+      }
+      Buffer = (UINT8 *) Buffer + Chunk;
+      Size  -= Chunk;
+    }
+    return;
+  }
   IoReadFifo8 (0x511, Size, Buffer);
 }
 
 
+/**
+  Writes firmware configuration bytes from a buffer
+
+  The DMA interface is used if the host offers it, otherwise the bytes are
+  written one by one through the data port. A failed DMA transfer is only
+  reported in the debug log, because writes have no error path.
+
+  @param[in] Size - Size in bytes to write
+  @param[in] Buffer - Buffer to read data from  (OPTIONAL if Size is 0)
+
+**/
+STATIC
+VOID
+InternalQemuFwCfgWriteBytes (
+  IN UINTN                  Size,
+  IN VOID                   *Buffer  OPTIONAL
+  )
+{
+  UINT32 Chunk;
+
+  if (InternalQemuFwCfgDmaIsAvailable ()) {
+    while (Size > 0) {
+      Chunk = (UINT32) MIN (Size, MAX_UINT32);
+      InternalQemuFwCfgDmaBytes (Chunk, Buffer, FW_CFG_DMA_CTL_WRITE);
+      Buffer = (UINT8 *) Buffer + Chunk;
+      Size  -= Chunk;
+    }
+    return;
+  }
+  IoWriteFifo8 (0x511, Size, Buffer);
+}
+
+
 /**
   Reads firmware configuration bytes into a buffer
 
@@ -158,7 +287,7 @@ QemuFwCfgWriteBytes (
   )
 {
   if (InternalQemuFwCfgIsAvailable ()) {
-    IoWriteFifo8 (0x511, Size, Buffer);
+    InternalQemuFwCfgWriteBytes (Size, Buffer);
   }
 }
 
@@ -18,6 +18,7 @@
 #include <Library/QemuFwCfgLib.h>
 
 STATIC BOOLEAN mQemuFwCfgSupported = FALSE;
+STATIC BOOLEAN mQemuFwCfgDmaSupported = FALSE;
 
 
 /**
@@ -68,7 +69,12 @@ QemuFwCfgInitialize (
     return RETURN_SUCCESS;
   }
 
-  DEBUG ((EFI_D_INFO, "QemuFwCfg interface is supported.\n"));
+  if ((Revision & FW_CFG_F_DMA) != 0) {
+    mQemuFwCfgDmaSupported = TRUE;
+    DEBUG ((EFI_D_INFO, "QemuFwCfg interface (DMA) is supported.\n"));
+  } else {
+    DEBUG ((EFI_D_INFO, "QemuFwCfg interface is supported.\n"));
+  }
   return RETURN_SUCCESS;
 }
 
@@ -90,3 +96,22 @@ InternalQemuFwCfgIsAvailable (
 {
   return mQemuFwCfgSupported;
 }
+
+
+/**
+  Returns a boolean indicating if the firmware configuration DMA interface is
+  available for library-internal purposes.
+
+  This function never changes fw_cfg state.
+
+  @retval    TRUE   The DMA interface is available internally.
+  @retval    FALSE  The DMA interface is not available internally.
+**/
+BOOLEAN
+EFIAPI
+InternalQemuFwCfgDmaIsAvailable (
+  VOID
+  )
+{
+  return mQemuFwCfgDmaSupported;
+}
@@ -79,3 +79,27 @@ InternalQemuFwCfgIsAvailable (
   //
   return TRUE;
 }
+
+
+/**
+  Returns a boolean indicating if the firmware configuration DMA interface is
+  available for library-internal purposes.
+
+  This function never changes fw_cfg state.
+
+  @retval    TRUE   The DMA interface is available internally.
+  @retval    FALSE  The DMA interface is not available internally.
+**/
+BOOLEAN
+EFIAPI
+InternalQemuFwCfgDmaIsAvailable (
+  VOID
+  )
+{
+  //
+  // SEC has no writable globals to remember the result of probing, and
+  // probing would change fw_cfg state. SEC transfers only a few bytes, so
+  // the data port is good enough.
+  //
+  return FALSE;
+}
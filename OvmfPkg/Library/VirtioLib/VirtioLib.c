@@ -169,8 +169,11 @@ VirtioPrepare (
   //
   // Prepare for virtio-0.9.5, 2.4.1 Supplying Buffers to the Device.
   //
-  // Since we support only one in-flight descriptor chain, we can always build
-  // that chain starting at entry #0 of the descriptor table.
+  // Synchronous drivers keep only one descriptor chain in flight, so the chain
+  // is built starting at entry #0 of the descriptor table. Drivers that keep
+  // several chains in flight partition the descriptor table into per-request
+  // slots, and move HeadDescIdx / NextDescIdx to the first descriptor of their
+  // slot after this function returns.
   //
   Indices->HeadDescIdx = 0;
   Indices->NextDescIdx = Indices->HeadDescIdx;
@@ -184,10 +187,10 @@ VirtioPrepare (
   This function implements the following section from virtio-0.9.5:
   - 2.4.1.1 Placing Buffers into the Descriptor Table
 
-  Free space is taken as granted, since the individual drivers support only
-  synchronous requests and host side status is processed in lock-step with
-  request submission. It is the calling driver's responsibility to verify the
-  ring size in advance.
+  Free space is taken as granted: synchronous drivers process host side status
+  in lock-step with request submission, and drivers with several requests in
+  flight append only to the descriptor slot they own. It is the calling
+  driver's responsibility to verify the ring size in advance.
 
   The caller is responsible for initializing *Indices with VirtioPrepare()
   first.
@@ -268,32 +271,11 @@ VirtioFlush (
   EFI_STATUS Status;
   UINTN      PollPeriodUsecs;
 
-  //
-  // virtio-0.9.5, 2.4.1.2 Updating the Available Ring
-  //
-  // It is not exactly clear from the wording of the virtio-0.9.5
-  // specification, but each entry in the Available Ring references only the
-  // head descriptor of any given descriptor chain.
-  //
-  NextAvailIdx = *Ring->Avail.Idx;
-  Ring->Avail.Ring[NextAvailIdx++ % Ring->QueueSize] =
-    Indices->HeadDescIdx % Ring->QueueSize;
-
-  //
-  // virtio-0.9.5, 2.4.1.3 Updating the Index Field
-  //
-  MemoryFence();
-  *Ring->Avail.Idx = NextAvailIdx;
-
-  //
-  // virtio-0.9.5, 2.4.1.4 Notifying the Device -- gratuitous notifications are
-  // OK.
-  //
-  MemoryFence();
-  Status = VirtIo->SetQueueNotify (VirtIo, VirtQueueId);
+  Status = VirtioSubmit (VirtIo, VirtQueueId, Ring, Indices);
   if (EFI_ERROR (Status)) {
     return Status;
   }
+  NextAvailIdx = *Ring->Avail.Idx;
 
   //
   // virtio-0.9.5, 2.4.2 Receiving Used Buffers From the Device
@@ -317,3 +299,67 @@ VirtioFlush (
   MemoryFence();
   return EFI_SUCCESS;
 }
+
+
+/**
+
+  Notify the host about the descriptor chain just built, without waiting for
+  the host to process it.
+
+  Drivers that keep several descriptor chains in flight use this function and
+  collect the results from the used ring themselves. Such drivers must build
+  each chain at a head index that no other in-flight chain occupies, instead
+  of at the index VirtioPrepare() returns.
+
+  @param[in] VirtIo       The target virtio device to notify.
+
+  @param[in] VirtQueueId  Identifies the queue for the target device.
+
+  @param[in,out] Ring     The virtio ring with descriptors to submit.
+
+  @param[in] Indices      Indices->NextDescIdx is not accessed.
+                          Indices->HeadDescIdx identifies the head descriptor
+                          of the descriptor chain.
+
+
+  @return              Error code from VirtIo->SetQueueNotify() if it fails.
+
+  @retval EFI_SUCCESS  Otherwise, the descriptor chain is available to the
+                       host.
+
+**/
+EFI_STATUS
+EFIAPI
+VirtioSubmit (
+  IN     VIRTIO_DEVICE_PROTOCOL *VirtIo,
+  IN     UINT16                 VirtQueueId,
+  IN OUT VRING                  *Ring,
+  IN     DESC_INDICES           *Indices
+  )
+{
+  UINT16     NextAvailIdx;
+
+  //
+  // virtio-0.9.5, 2.4.1.2 Updating the Available Ring
+  //
+  // It is not exactly clear from the wording of the virtio-0.9.5
+  // specification, but each entry in the Available Ring references only the
+  // head descriptor of any given descriptor chain.
+  //
+  NextAvailIdx = *Ring->Avail.Idx;
+  Ring->Avail.Ring[NextAvailIdx++ % Ring->QueueSize] =
+    Indices->HeadDescIdx % Ring->QueueSize;
+
+  //
+  // virtio-0.9.5, 2.4.1.3 Updating the Index Field
+  //
+  MemoryFence();
+  *Ring->Avail.Idx = NextAvailIdx;
+
+  //
+  // virtio-0.9.5, 2.4.1.4 Notifying the Device -- gratuitous notifications are
+  // OK.
+  //
+  MemoryFence();
+  return VirtIo->SetQueueNotify (VirtIo, VirtQueueId);
+}
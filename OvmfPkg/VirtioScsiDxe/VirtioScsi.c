@@ -7,16 +7,17 @@
 
   - No hotplug / hot-unplug.
 
-  - Although EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru() could be a good match
-    for multiple in-flight virtio-scsi requests, we stick to synchronous
-    requests for now.
+  - EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru() supports non-blocking requests.
+    Up to VSCSI_MAX_REQUESTS requests (blocking or not) can be in flight at the
+    same time; the results of non-blocking ones are collected by a periodic
+    timer, since the host is not asked for interrupts.
 
   - Timeouts are not supported for EFI_EXT_SCSI_PASS_THRU_PROTOCOL.PassThru().
 
   - Only one channel is supported. (At the time of this writing, host-side
     virtio-scsi supports a single channel too.)
 
-  - Only one request queue is used (for the one synchronous request).
+  - Only one request queue is used.
 
   - The ResetChannel() and ResetTargetLun() functions of
     EFI_EXT_SCSI_PASS_THRU_PROTOCOL are not supported (which is allowed by the
@@ -387,6 +388,114 @@ ParseResponse (
 }
 
 
+/**
+
+  Fill in the Extended SCSI Pass Thru Protocol packet of a request that the
+  host never processed, faking a host adapter error.
+
+  EFI_NOT_READY would save us the effort, but it would also suggest that the
+  caller retry.
+
+  @param[out] Packet  The Extended SCSI Pass Thru Protocol packet to fail.
+
+**/
+STATIC
+VOID
+EFIAPI
+FailPacket (
+  OUT EFI_EXT_SCSI_PASS_THRU_SCSI_REQUEST_PACKET *Packet
+  )
+{
+  Packet->InTransferLength  = 0;
+  Packet->OutTransferLength = 0;
+  Packet->HostAdapterStatus = EFI_EXT_SCSI_STATUS_HOST_ADAPTER_OTHER;
+  Packet->TargetStatus      = EFI_EXT_SCSI_STATUS_TARGET_GOOD;
+  Packet->SenseDataLength   = 0;
+}
+
+
+/**
+
+  Collect the requests the host has returned on the used ring since the last
+  call.
+
+  The results of blocking requests are stored in their slots, for
+  VirtioScsiPassThru() to pick up. Non-blocking requests are completed
+  directly: their slots are released and their events are signaled.
+
+  The caller must be running at TPL_NOTIFY.
+
+  @param[in,out] Dev  The virtio-scsi host device.
+
+**/
+STATIC
+VOID
+EFIAPI
+VirtioScsiReapRequests (
+  IN OUT VSCSI_DEV *Dev
+  )
+{
+  UINT16        UsedIdx;
+  UINT32        HeadDescIdx;
+  VSCSI_REQUEST *Req;
+  EFI_STATUS    Status;
+
+  //
+  // virtio-0.9.5, 2.4.2 Receiving Used Buffers From the Device
+  //
+  MemoryFence();
+  UsedIdx = *Dev->Ring.Used.Idx;
+  MemoryFence();
+
+  while (Dev->LastUsedIdx != UsedIdx) {
+    HeadDescIdx = Dev->Ring.Used.UsedElem[Dev->LastUsedIdx % Dev->Ring.QueueSize].Id;
+    Dev->LastUsedIdx++;
+
+    ASSERT (HeadDescIdx / VSCSI_DESC_PER_REQUEST < Dev->NumRequests);
+    Req = &Dev->Requests[HeadDescIdx / VSCSI_DESC_PER_REQUEST];
+    ASSERT (Req->InUse && !Req->Done);
+
+    Status = ParseResponse (Req->Packet, &Req->Response);
+    if (Req->Event == NULL) {
+      Req->Status = Status;
+      Req->Done   = TRUE;
+      continue;
+    }
+
+    //
+    // The status of a non-blocking request is conveyed in its packet.
+    //
+    Req->InUse = FALSE;
+    gBS->SignalEvent (Req->Event);
+    if (--Dev->PendingEvents == 0) {
+      gBS->SetTimer (Dev->PollTimer, TimerCancel, 0);
+    }
+  }
+}
+
+
+/**
+
+  Timer notification function collecting the results of non-blocking
+  requests.
+
+  @param[in] Event    The poll timer event.
+
+  @param[in] Context  The VSCSI_DEV the timer belongs to.
+
+**/
+STATIC
+VOID
+EFIAPI
+VirtioScsiPollRequests (
+  IN EFI_EVENT Event,
+  IN VOID      *Context
+  )
+{
+  VirtioScsiReapRequests ((VSCSI_DEV *) Context);
+}
+
+
 //
 // The next seven functions implement EFI_EXT_SCSI_PASS_THRU_PROTOCOL
 // for the virtio-scsi HBA. Refer to UEFI Spec 2.3.1 + Errata C, sections
@@ -407,38 +516,72 @@ VirtioScsiPassThru (
   VSCSI_DEV                 *Dev;
   UINT16                    TargetValue;
   EFI_STATUS                Status;
-  volatile VIRTIO_SCSI_REQ  Request;
-  volatile VIRTIO_SCSI_RESP Response;
+  UINT16                    Slot;
+  VSCSI_REQUEST             *Req;
   DESC_INDICES              Indices;
-
-  ZeroMem ((VOID*) &Request, sizeof (Request));
-  ZeroMem ((VOID*) &Response, sizeof (Response));
+  EFI_TPL                   OldTpl;
+  UINTN                     PollPeriodUsecs;
 
   Dev = VIRTIO_SCSI_FROM_PASS_THRU (This);
   CopyMem (&TargetValue, Target, sizeof TargetValue);
 
-  Status = PopulateRequest (Dev, TargetValue, Lun, Packet, &Request);
+  //
+  // Claim a free request slot. If all of them are in flight, a non-blocking
+  // request is refused, while a blocking one waits for a slot to drain.
+  //
+  PollPeriodUsecs = 1;
+  for (;;) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    VirtioScsiReapRequests (Dev);
+    for (Slot = 0; Slot < Dev->NumRequests; ++Slot) {
+      if (!Dev->Requests[Slot].InUse) {
+        break;
+      }
+    }
+    if (Slot < Dev->NumRequests) {
+      break;
+    }
+    gBS->RestoreTPL (OldTpl);
+
+    if (Event != NULL) {
+      return EFI_NOT_READY;
+    }
+    gBS->Stall (PollPeriodUsecs);
+    if (PollPeriodUsecs < 1024) {
+      PollPeriodUsecs *= 2;
+    }
+  }
+
+  //
+  // We're at TPL_NOTIFY here, holding off VirtioScsiPollRequests().
+  //
+  Req = &Dev->Requests[Slot];
+  ZeroMem ((VOID*) &Req->Request, sizeof Req->Request);
+  ZeroMem ((VOID*) &Req->Response, sizeof Req->Response);
+
+  Status = PopulateRequest (Dev, TargetValue, Lun, Packet, &Req->Request);
   if (EFI_ERROR (Status)) {
+    gBS->RestoreTPL (OldTpl);
     return Status;
   }
 
-  VirtioPrepare (&Dev->Ring, &Indices);
-
   //
-  // preset a host status for ourselves that we do not accept as success
+  // VirtioPrepare() starts every chain at descriptor #0; our chain starts at
+  // the first descriptor owned by the slot instead.
   //
-  Response.Response = VIRTIO_SCSI_S_FAILURE;
+  VirtioPrepare (&Dev->Ring, &Indices);
+  Indices.HeadDescIdx = (UINT16) (Slot * VSCSI_DESC_PER_REQUEST);
+  Indices.NextDescIdx = Indices.HeadDescIdx;
 
   //
-  // ensured by VirtioScsiInit() -- this predicate, in combination with the
-  // lock-step progress, ensures we don't have to track free descriptors.
+  // preset a host status for ourselves that we do not accept as success
   //
-  ASSERT (Dev->Ring.QueueSize >= 4);
+  Req->Response.Response = VIRTIO_SCSI_S_FAILURE;
 
   //
   // enqueue Request
   //
-  VirtioAppendDesc (&Dev->Ring, (UINTN) &Request, sizeof Request,
+  VirtioAppendDesc (&Dev->Ring, (UINTN) &Req->Request, sizeof Req->Request,
     VRING_DESC_F_NEXT, &Indices);
 
   //
@@ -452,7 +595,7 @@ VirtioScsiPassThru (
   //
   // enqueue Response, to be written by the host
   //
-  VirtioAppendDesc (&Dev->Ring, (UINTN) &Response, sizeof Response,
+  VirtioAppendDesc (&Dev->Ring, (UINTN) &Req->Response, sizeof Req->Response,
     VRING_DESC_F_WRITE | (Packet->InTransferLength > 0 ?
                           VRING_DESC_F_NEXT : 0),
     &Indices);
@@ -465,21 +608,51 @@ VirtioScsiPassThru (
       Packet->InTransferLength, VRING_DESC_F_WRITE, &Indices);
   }
 
+  //
   // If kicking the host fails, we must fake a host adapter error.
-  // EFI_NOT_READY would save us the effort, but it would also suggest that the
-  // caller retry.
   //
-  if (VirtioFlush (Dev->VirtIo, VIRTIO_SCSI_REQUEST_QUEUE, &Dev->Ring,
+  if (VirtioSubmit (Dev->VirtIo, VIRTIO_SCSI_REQUEST_QUEUE, &Dev->Ring,
         &Indices) != EFI_SUCCESS) {
-    Packet->InTransferLength  = 0;
-    Packet->OutTransferLength = 0;
-    Packet->HostAdapterStatus = EFI_EXT_SCSI_STATUS_HOST_ADAPTER_OTHER;
-    Packet->TargetStatus      = EFI_EXT_SCSI_STATUS_TARGET_GOOD;
-    Packet->SenseDataLength   = 0;
+    gBS->RestoreTPL (OldTpl);
+    FailPacket (Packet);
     return EFI_DEVICE_ERROR;
   }
 
-  return ParseResponse (Packet, &Response);
+  Req->InUse  = TRUE;
+  Req->Done   = FALSE;
+  Req->Packet = Packet;
+  Req->Event  = Event;
+
+  if (Event != NULL) {
+    if (Dev->PendingEvents++ == 0) {
+      gBS->SetTimer (Dev->PollTimer, TimerPeriodic, VSCSI_POLL_PERIOD);
+    }
+    gBS->RestoreTPL (OldTpl);
+    return EFI_SUCCESS;
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  //
+  // Blocking request: poll the used ring until the host returns our chain.
+  // Keep slowing down until we reach a poll period of slightly above 1 ms.
+  //
+  PollPeriodUsecs = 1;
+  for (;;) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    VirtioScsiReapRequests (Dev);
+    if (Req->Done) {
+      Status     = Req->Status;
+      Req->InUse = FALSE;
+      gBS->RestoreTPL (OldTpl);
+      return Status;
+    }
+    gBS->RestoreTPL (OldTpl);
+
+    gBS->Stall (PollPeriodUsecs);
+    if (PollPeriodUsecs < 1024) {
+      PollPeriodUsecs *= 2;
+    }
+  }
 }
 
 
@@ -812,9 +985,9 @@ VirtioScsiInit (
     goto Failed;
   }
   //
-  // VirtioScsiPassThru() uses at most four descriptors
+  // VirtioScsiPassThru() uses at most four descriptors per request
   //
-  if (QueueSize < 4) {
+  if (QueueSize < VSCSI_DESC_PER_REQUEST) {
     Status = EFI_UNSUPPORTED;
     goto Failed;
   }
@@ -824,6 +997,26 @@ VirtioScsiInit (
     goto Failed;
   }
 
+  //
+  // Carve the descriptor table up into request slots, and prepare the timer
+  // that completes non-blocking requests.
+  //
+  Dev->NumRequests   = (UINT16) MIN (QueueSize / VSCSI_DESC_PER_REQUEST,
+                                     VSCSI_MAX_REQUESTS);
+  Dev->LastUsedIdx   = 0;
+  Dev->PendingEvents = 0;
+  Dev->Requests      = AllocateZeroPool (Dev->NumRequests * sizeof *Dev->Requests);
+  if (Dev->Requests == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ReleaseQueue;
+  }
+
+  Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_NOTIFY,
+                  &VirtioScsiPollRequests, Dev, &Dev->PollTimer);
+  if (EFI_ERROR (Status)) {
+    goto ReleaseQueue;
+  }
+
   //
   // Additional steps for MMIO: align the queue appropriately, and set the
   // size. If anything fails from here on, we must release the ring resources.
@@ -904,7 +1097,8 @@ VirtioScsiInit (
   // SCSI Pass Thru Protocol.
   //
   Dev->PassThruMode.Attributes = EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_PHYSICAL |
-                                 EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_LOGICAL;
+                                 EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_LOGICAL |
+                                 EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_NONBLOCKIO;
 
   //
   // no restriction on transfer buffer alignment
@@ -914,6 +1108,15 @@ VirtioScsiInit (
   return EFI_SUCCESS;
 
 ReleaseQueue:
+  if (Dev->PollTimer != NULL) {
+    gBS->CloseEvent (Dev->PollTimer);
+    Dev->PollTimer = NULL;
+  }
+  if (Dev->Requests != NULL) {
+    FreePool (Dev->Requests);
+    Dev->Requests = NULL;
+  }
+  Dev->NumRequests = 0;
   VirtioRingUninit (&Dev->Ring);
 
 Failed:
@@ -941,18 +1144,41 @@ VirtioScsiUninit (
   IN OUT VSCSI_DEV *Dev
   )
 {
+  EFI_TPL OldTpl;
+  UINT16  Slot;
+
   //
   // Reset the virtual device -- see virtio-0.9.5, 2.2.2.1 Device Status. When
   // VIRTIO_CFG_WRITE() returns, the host will have learned to stay away from
   // the old comms area.
   //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
   Dev->VirtIo->SetDeviceStatus (Dev->VirtIo, 0);
 
+  //
+  // Fail the non-blocking requests the host will never return.
+  //
+  for (Slot = 0; Slot < Dev->NumRequests; ++Slot) {
+    if (Dev->Requests[Slot].InUse && Dev->Requests[Slot].Event != NULL) {
+      FailPacket (Dev->Requests[Slot].Packet);
+      Dev->Requests[Slot].InUse = FALSE;
+      gBS->SignalEvent (Dev->Requests[Slot].Event);
+    }
+  }
+  gBS->CloseEvent (Dev->PollTimer);
+  gBS->RestoreTPL (OldTpl);
+
   Dev->InOutSupported = FALSE;
   Dev->MaxTarget      = 0;
   Dev->MaxLun         = 0;
   Dev->MaxSectors     = 0;
 
+  FreePool (Dev->Requests);
+  Dev->Requests      = NULL;
+  Dev->NumRequests   = 0;
+  Dev->PendingEvents = 0;
+  Dev->PollTimer     = NULL;
+
   VirtioRingUninit (&Dev->Ring);
 
   SetMem (&Dev->PassThru,     sizeof Dev->PassThru,     0x00);
@@ -22,7 +22,7 @@
 #include <Protocol/DriverBinding.h>
 #include <Protocol/ScsiPassThruExt.h>
 
-#include <IndustryStandard/Virtio.h>
+#include <IndustryStandard/VirtioScsi.h>
 
 
 //
@@ -40,6 +40,30 @@
 #endif
 
 
+//
+// Every request in flight owns VSCSI_DESC_PER_REQUEST consecutive descriptors
+// of the request queue, starting at (slot index * VSCSI_DESC_PER_REQUEST): the
+// request header, the optional "dataout" buffer, the response, and the
+// optional "datain" buffer. This way we never have to track free descriptors.
+//
+#define VSCSI_DESC_PER_REQUEST 4
+#define VSCSI_MAX_REQUESTS     16
+
+//
+// Period of the timer that collects the results of non-blocking requests.
+//
+#define VSCSI_POLL_PERIOD      EFI_TIMER_PERIOD_MILLISECONDS (1)
+
+typedef struct {
+  BOOLEAN                                    InUse;
+  BOOLEAN                                    Done;     // blocking only
+  EFI_STATUS                                 Status;   // blocking only
+  EFI_EXT_SCSI_PASS_THRU_SCSI_REQUEST_PACKET *Packet;
+  EFI_EVENT                                  Event;    // NULL if blocking
+  volatile VIRTIO_SCSI_REQ                   Request;
+  volatile VIRTIO_SCSI_RESP                  Response;
+} VSCSI_REQUEST;
+
 #define VSCSI_SIG SIGNATURE_32 ('V', 'S', 'C', 'S')
 
 typedef struct {
@@ -57,6 +81,11 @@ typedef struct {
   UINT32                          MaxLun;         // VirtioScsiInit      1
   UINT32                          MaxSectors;     // VirtioScsiInit      1
   VRING                           Ring;           // VirtioRingInit      2
+  VSCSI_REQUEST                   *Requests;      // VirtioScsiInit      1
+  UINT16                          NumRequests;    // VirtioScsiInit      1
+  UINT16                          LastUsedIdx;    // VirtioScsiInit      1
+  UINTN                           PendingEvents;  // VirtioScsiInit      1
+  EFI_EVENT                       PollTimer;      // VirtioScsiInit      1
   EFI_EXT_SCSI_PASS_THRU_PROTOCOL PassThru;       // VirtioScsiInit      1
   EFI_EXT_SCSI_PASS_THRU_MODE     PassThruMode;   // VirtioScsiInit      1
 } VSCSI_DEV;
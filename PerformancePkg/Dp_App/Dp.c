@@ -82,7 +82,10 @@ PARAM_ITEM_LIST  ParamList[] = {
   {STRING_TOKEN (STR_DP_OPTION_LX), TypeFlag},   // -x   eXclude Cumulative Items
   {STRING_TOKEN (STR_DP_OPTION_LI), TypeFlag},   // -i   Display Identifier
   {STRING_TOKEN (STR_DP_OPTION_LN), TypeValue},  // -n # Number of records to display for A and R
-  {STRING_TOKEN (STR_DP_OPTION_LT), TypeValue}   // -t # Threshold of interest
+  {STRING_TOKEN (STR_DP_OPTION_LT), TypeValue},  // -t # Threshold of interest
+  {STRING_TOKEN (STR_DP_OPTION_LJ), TypeValue},  // -j   Chrome trace event (JSON) file to write
+  {STRING_TOKEN (STR_DP_OPTION_LC), TypeValue},  // -c   Per-module CSV file to write
+  {STRING_TOKEN (STR_DP_OPTION_LD), TypeValue}   // -d   Per-module CSV file to compare against
   };
 
 ///@}
@@ -138,6 +141,9 @@ ShowHelp( void )
   PrintToken (STRING_TOKEN (STR_DP_HELP_THRESHOLD));
   PrintToken (STRING_TOKEN (STR_DP_HELP_COUNT));
   PrintToken (STRING_TOKEN (STR_DP_HELP_ID));
+  PrintToken (STRING_TOKEN (STR_DP_HELP_JSON));
+  PrintToken (STRING_TOKEN (STR_DP_HELP_CSV));
+  PrintToken (STRING_TOKEN (STR_DP_HELP_DIFF));
   PrintToken (STRING_TOKEN (STR_DP_HELP_HELP));
   Print(L"\n");
 }
@@ -194,6 +200,9 @@ InitializeDp (
   CONST CHAR16              *CmdLineArg;
   EFI_STRING                StringPtr;
   UINTN                     Number2Display;
+  CONST CHAR16              *JsonFile;
+  CONST CHAR16              *CsvFile;
+  CONST CHAR16              *BaselineFile;
 
   EFI_STATUS                Status;
   BOOLEAN                   SummaryMode;
@@ -218,6 +227,9 @@ InitializeDp (
   EFI_STRING                StringDpOptionLn;
   EFI_STRING                StringDpOptionLt;
   EFI_STRING                StringDpOptionLi;
+  EFI_STRING                StringDpOptionLj;
+  EFI_STRING                StringDpOptionLc;
+  EFI_STRING                StringDpOptionLd;
   
   SummaryMode     = FALSE;
   VerboseMode     = FALSE;
@@ -241,6 +253,9 @@ InitializeDp (
   StringDpOptionLn = NULL;
   StringDpOptionLt = NULL;
   StringDpOptionLi = NULL;
+  StringDpOptionLj = NULL;
+  StringDpOptionLc = NULL;
+  StringDpOptionLd = NULL;
   StringPtr        = NULL;
 
   // Get DP's entry time as soon as possible.
@@ -289,6 +304,9 @@ InitializeDp (
       StringDpOptionLn = HiiGetString (gHiiHandle, STRING_TOKEN (STR_DP_OPTION_LN), NULL);
       StringDpOptionLt = HiiGetString (gHiiHandle, STRING_TOKEN (STR_DP_OPTION_LT), NULL);
       StringDpOptionLi = HiiGetString (gHiiHandle, STRING_TOKEN (STR_DP_OPTION_LI), NULL);
+      StringDpOptionLj = HiiGetString (gHiiHandle, STRING_TOKEN (STR_DP_OPTION_LJ), NULL);
+      StringDpOptionLc = HiiGetString (gHiiHandle, STRING_TOKEN (STR_DP_OPTION_LC), NULL);
+      StringDpOptionLd = HiiGetString (gHiiHandle, STRING_TOKEN (STR_DP_OPTION_LD), NULL);
       
       // Boolean Options
       // 
@@ -322,6 +340,9 @@ InitializeDp (
       else {
         mInterestThreshold = StrDecimalToUint64(CmdLineArg);
       }
+      JsonFile     = ShellCommandLineGetValue (ParamPackage, StringDpOptionLj);
+      CsvFile      = ShellCommandLineGetValue (ParamPackage, StringDpOptionLc);
+      BaselineFile = ShellCommandLineGetValue (ParamPackage, StringDpOptionLd);
       // Handle Flag combinations and default behaviors
       // If both TraceMode and ProfileMode are FALSE, set them both to TRUE
       if ((! TraceMode) && (! ProfileMode)) {
@@ -393,7 +414,13 @@ InitializeDp (
 ****     T &&  P  := (3) Same as Default, both are displayed
 ****************************************************************************/
       GatherStatistics();
-      if (AllMode) {
+      if ((JsonFile != NULL) || (CsvFile != NULL) || (BaselineFile != NULL)) {
+        //
+        // Machine readable output replaces the reports.
+        //
+        Status = ExportTrace (JsonFile, CsvFile, BaselineFile);
+      }
+      else if (AllMode) {
         if (TraceMode) {
           DumpAllTrace( Number2Display, ExcludeMode);
         }
@@ -455,6 +482,9 @@ InitializeDp (
   SafeFreePool (StringDpOptionLn);
   SafeFreePool (StringDpOptionLt);
   SafeFreePool (StringDpOptionLi);
+  SafeFreePool (StringDpOptionLj);
+  SafeFreePool (StringDpOptionLc);
+  SafeFreePool (StringDpOptionLd);
   SafeFreePool (StringPtr);
   SafeFreePool (mPrintTokenBuffer);
 
@@ -17,7 +17,7 @@
 #include <Library/ShellLib.h>
 
 #define DP_MAJOR_VERSION        2
-#define DP_MINOR_VERSION        3
+#define DP_MINOR_VERSION        4
 
 /**
   * The value assigned to DP_DEBUG controls which debug output
@@ -0,0 +1,733 @@
+/** @file
+  Machine readable export of the Trace measurements for the Dp utility.
+
+  The complete Trace measurements are nested by time and written either as
+  Chrome trace events (JSON), or as per-module inclusive and exclusive times
+  in CSV.  Per-module times can also be compared against a CSV file written
+  during an earlier boot, so that boot time regressions between firmware
+  builds can be detected by a script.
+
+  Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/TimerLib.h>
+#include <Library/PerformanceLib.h>
+#include <Library/PrintLib.h>
+#include <Library/HiiLib.h>
+#include <Library/ShellLib.h>
+#include <Library/SortLib.h>
+
+#include <Guid/Performance.h>
+
+#include <PerformanceTokens.h>
+#include "Dp.h"
+#include "Literals.h"
+#include "DpInternal.h"
+
+#define DP_EXPORT_LINE_SIZE     512
+#define DP_NO_PARENT            MAX_UINTN
+
+/// Complete Trace measurement prepared for export.
+typedef struct {
+  MEASUREMENT_RECORD    Measurement;
+  CHAR8                 Name[DP_GAUGE_STRING_LENGTH + 1];   ///< Driver, PEIM, or module name.
+  CHAR8                 Token[DXE_PERFORMANCE_STRING_SIZE]; ///< Measured token, made printable.
+  UINT64                StartTime;        ///< Start time in microseconds.
+  UINT64                Inclusive;        ///< Elapsed time in microseconds.
+  UINT64                Exclusive;        ///< Elapsed time not spent in nested measurements.
+  UINTN                 Parent;           ///< Index of the enclosing record, or DP_NO_PARENT.
+  UINTN                 Depth;            ///< Number of enclosing records.
+  UINTN                 Module;           ///< Index into the module time array.
+} DP_EXPORT_RECORD;
+
+/// Times accumulated for all records with the same name.
+typedef struct {
+  CONST CHAR8           *Name;
+  UINT32                Count;            ///< Number of measurements.
+  UINT64                Inclusive;        ///< Time not already counted by an enclosing record of the same module.
+  UINT64                Exclusive;        ///< Sum of the exclusive times.
+  UINT32                SupportedCount;   ///< Number of Driver Binding Supported() calls.
+  UINT64                Supported;        ///< Time spent in Driver Binding Supported().
+  UINT32                StartCount;       ///< Number of Driver Binding Start() calls.
+  UINT64                Start;            ///< Time spent in Driver Binding Start().
+  BOOLEAN               Matched;          ///< Found in the baseline being compared against.
+} DP_MODULE_TIME;
+
+DP_EXPORT_RECORD          *mExportRecords = NULL;
+UINTN                     mExportCount    = 0;
+DP_MODULE_TIME            *mModuleTimes   = NULL;
+UINTN                     mModuleCount    = 0;
+
+/**
+  Copy a name into an ASCII buffer, replacing the characters that would need
+  quoting in JSON or CSV.
+
+  @param[out] Destination   The ASCII buffer.
+  @param[in]  Size          The number of characters Destination can hold,
+                            including the terminating NULL.
+  @param[in]  Source        The Unicode name.
+
+**/
+VOID
+DpCopyName (
+  OUT CHAR8         *Destination,
+  IN  UINTN         Size,
+  IN  CONST CHAR16  *Source
+  )
+{
+  UINTN     Index;
+
+  for (Index = 0; (Index < Size - 1) && (Source[Index] != L'\0'); Index++) {
+    if ((Source[Index] < L' ') || (Source[Index] > L'~') ||
+        (Source[Index] == L'"') || (Source[Index] == L'\\') || (Source[Index] == L',')) {
+      Destination[Index] = '_';
+    } else {
+      Destination[Index] = (CHAR8) Source[Index];
+    }
+  }
+  Destination[Index] = '\0';
+}
+
+/**
+  Convert a time stamp into microseconds since the timer started counting.
+
+  @param[in]  TimeStamp   The timer value.
+
+  @return     The time in microseconds.
+**/
+UINT64
+DpTimeStampInMicroSeconds (
+  IN UINT64 TimeStamp
+  )
+{
+  if (TimerInfo.CountUp) {
+    if (TimeStamp < TimerInfo.StartCount) {
+      return 0;
+    }
+    return DurationInMicroSeconds (TimeStamp - TimerInfo.StartCount);
+  }
+  if (TimeStamp > TimerInfo.StartCount) {
+    return 0;
+  }
+  return DurationInMicroSeconds (TimerInfo.StartCount - TimeStamp);
+}
+
+/**
+  Order export records by start time, enclosing records first.
+
+  @param[in]  Buffer1   The first DP_EXPORT_RECORD.
+  @param[in]  Buffer2   The second DP_EXPORT_RECORD.
+
+  @retval     <0        Buffer1 sorts before Buffer2.
+  @retval     0         The records start and end at the same time.
+  @retval     >0        Buffer1 sorts after Buffer2.
+**/
+INTN
+EFIAPI
+DpCompareExportRecords (
+  IN CONST VOID   *Buffer1,
+  IN CONST VOID   *Buffer2
+  )
+{
+  CONST DP_EXPORT_RECORD    *Record1;
+  CONST DP_EXPORT_RECORD    *Record2;
+
+  Record1 = Buffer1;
+  Record2 = Buffer2;
+  if (Record1->StartTime != Record2->StartTime) {
+    return (Record1->StartTime < Record2->StartTime) ? -1 : 1;
+  }
+  if (Record1->Inclusive != Record2->Inclusive) {
+    return (Record1->Inclusive > Record2->Inclusive) ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+  Name an export record the way the "All" report names measurements.
+
+  @param[in, out] Record        The export record to name.
+  @param[in]      HandleBuffer  All handles in the handle database.
+  @param[in]      HandleCount   The number of handles in HandleBuffer.
+
+**/
+VOID
+DpNameExportRecord (
+  IN OUT DP_EXPORT_RECORD   *Record,
+  IN     EFI_HANDLE         *HandleBuffer,
+  IN     UINTN              HandleCount
+  )
+{
+  UINTN     Index;
+
+  AsciiStrToUnicodeStr (Record->Measurement.Token, mUnicodeToken);
+  DpCopyName (Record->Token, sizeof (Record->Token), mUnicodeToken);
+
+  //
+  // Use Module by default, and the Token for records without one.
+  //
+  if (*Record->Measurement.Module != '\0') {
+    AsciiStrToUnicodeStr (Record->Measurement.Module, mGaugeString);
+  } else {
+    StrCpyS (mGaugeString, DP_GAUGE_STRING_LENGTH + 1, mUnicodeToken);
+  }
+  if (Record->Measurement.Handle != NULL) {
+    for (Index = 0; Index < HandleCount; Index++) {
+      if (Record->Measurement.Handle == HandleBuffer[Index]) {
+        GetNameFromHandle (HandleBuffer[Index]);
+        break;
+      }
+    }
+  }
+  if (AsciiStrnCmp (Record->Measurement.Token, ALit_PEIM, PERF_TOKEN_LENGTH) == 0) {
+    UnicodeSPrint (mGaugeString, sizeof (mGaugeString), L"%g", Record->Measurement.Handle);
+  }
+  mGaugeString[DP_GAUGE_STRING_LENGTH] = 0;
+
+  DpCopyName (Record->Name, sizeof (Record->Name), mGaugeString);
+}
+
+/**
+  Add the time of an export record to the time of its module.
+
+  @param[in]  RecordIndex   The index of the record in mExportRecords.
+
+**/
+VOID
+DpAccumulateModuleTime (
+  IN UINTN        RecordIndex
+  )
+{
+  DP_EXPORT_RECORD    *Record;
+  DP_MODULE_TIME      *ModuleTime;
+  UINTN               Index;
+
+  Record = &mExportRecords[RecordIndex];
+  for (Index = 0; Index < mModuleCount; Index++) {
+    if (AsciiStrCmp (mModuleTimes[Index].Name, Record->Name) == 0) {
+      break;
+    }
+  }
+  if (Index == mModuleCount) {
+    mModuleTimes[Index].Name = Record->Name;
+    mModuleCount++;
+  }
+  Record->Module = Index;
+  ModuleTime     = &mModuleTimes[Index];
+
+  ModuleTime->Count++;
+  ModuleTime->Exclusive += Record->Exclusive;
+
+  //
+  // Time spent inside another measurement of the same module is already
+  // part of that measurement's inclusive time.
+  //
+  for (Index = Record->Parent; Index != DP_NO_PARENT; Index = mExportRecords[Index].Parent) {
+    if (mExportRecords[Index].Module == Record->Module) {
+      break;
+    }
+  }
+  if (Index == DP_NO_PARENT) {
+    ModuleTime->Inclusive += Record->Inclusive;
+  }
+
+  if (AsciiStrnCmp (Record->Measurement.Token, DRIVERBINDING_START_TOK, PERF_TOKEN_LENGTH) == 0) {
+    ModuleTime->StartCount++;
+    ModuleTime->Start += Record->Inclusive;
+  } else if (AsciiStrnCmp (Record->Measurement.Token, DRIVERBINDING_SUPPORT_TOK, PERF_TOKEN_LENGTH) == 0) {
+    ModuleTime->SupportedCount++;
+    ModuleTime->Supported += Record->Inclusive;
+  }
+}
+
+/**
+  Collect, nest, and total all complete Trace measurements.
+
+  Records are sorted by start time.  A record is nested within the closest
+  earlier record whose time span contains its own; the exclusive time of a
+  record is its elapsed time less that of the records directly nested in it.
+
+  @retval EFI_SUCCESS           mExportRecords and mModuleTimes are filled in.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the records.
+  @return                       Status from a call to gBS->LocateHandle().
+**/
+EFI_STATUS
+DpCollectExportRecords (
+  VOID
+  )
+{
+  MEASUREMENT_RECORD        Measurement;
+  DP_EXPORT_RECORD          *Record;
+  DP_EXPORT_RECORD          *Outer;
+  UINTN                     LogEntryKey;
+  UINTN                     Index;
+  UINTN                     *Stack;
+  UINTN                     StackDepth;
+  EFI_HANDLE                *HandleBuffer;
+  UINTN                     Size;
+  EFI_HANDLE                TempHandle;
+  EFI_STATUS                Status;
+
+  Size = 0;
+  HandleBuffer = &TempHandle;
+  Status  = gBS->LocateHandle (AllHandles, NULL, NULL, &Size, &TempHandle);
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    HandleBuffer = AllocatePool (Size);
+    if (HandleBuffer == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Status  = gBS->LocateHandle (AllHandles, NULL, NULL, &Size, HandleBuffer);
+  }
+  if (EFI_ERROR (Status)) {
+    PrintToken (STRING_TOKEN (STR_DP_HANDLES_ERROR), Status);
+    goto Done;
+  }
+
+  mExportCount   = SummaryData.NumTrace - SummaryData.NumIncomplete;
+  mExportRecords = AllocateZeroPool ((mExportCount + 1) * sizeof (DP_EXPORT_RECORD));
+  mModuleTimes   = AllocateZeroPool ((mExportCount + 1) * sizeof (DP_MODULE_TIME));
+  Stack          = AllocatePool ((mExportCount + 1) * sizeof (UINTN));
+  if ((mExportRecords == NULL) || (mModuleTimes == NULL) || (Stack == NULL)) {
+    SafeFreePool (Stack);
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  Index       = 0;
+  LogEntryKey = 0;
+  while ((Index < mExportCount) &&
+         ((LogEntryKey = GetPerformanceMeasurementEx (
+                           LogEntryKey,
+                           &Measurement.Handle,
+                           &Measurement.Token,
+                           &Measurement.Module,
+                           &Measurement.StartTimeStamp,
+                           &Measurement.EndTimeStamp,
+                           &Measurement.Identifier)) != 0))
+  {
+    if (Measurement.EndTimeStamp == 0) {
+      continue;
+    }
+    Record = &mExportRecords[Index++];
+    CopyMem (&Record->Measurement, &Measurement, sizeof (Measurement));
+    Record->Inclusive = DurationInMicroSeconds (GetDuration (&Record->Measurement));
+    Record->Exclusive = Record->Inclusive;
+    Record->StartTime = DpTimeStampInMicroSeconds (Record->Measurement.StartTimeStamp);
+    DpNameExportRecord (Record, HandleBuffer, Size / sizeof (HandleBuffer[0]));
+  }
+  mExportCount = Index;
+
+  PerformQuickSort (mExportRecords, mExportCount, sizeof (DP_EXPORT_RECORD), DpCompareExportRecords);
+
+  //
+  // Stack holds the chain of records enclosing the current one.
+  //
+  StackDepth = 0;
+  for (Index = 0; Index < mExportCount; Index++) {
+    Record = &mExportRecords[Index];
+    while (StackDepth > 0) {
+      Outer = &mExportRecords[Stack[StackDepth - 1]];
+      if (Outer->StartTime + Outer->Inclusive >= Record->StartTime + Record->Inclusive) {
+        break;
+      }
+      StackDepth--;
+    }
+
+    Record->Depth  = StackDepth;
+    Record->Parent = DP_NO_PARENT;
+    if (StackDepth > 0) {
+      Record->Parent = Stack[StackDepth - 1];
+      Outer = &mExportRecords[Record->Parent];
+      Outer->Exclusive -= MIN (Outer->Exclusive, Record->Inclusive);
+    }
+    Stack[StackDepth++] = Index;
+  }
+  FreePool (Stack);
+
+  //
+  // Exclusive times are final once every record has been nested.
+  //
+  for (Index = 0; Index < mExportCount; Index++) {
+    DpAccumulateModuleTime (Index);
+  }
+
+Done:
+  if (HandleBuffer != &TempHandle) {
+    FreePool (HandleBuffer);
+  }
+  return Status;
+}
+
+/**
+  Create a file for writing, replacing any existing file of the same name.
+
+  @param[in]  FileName    The name of the file.
+  @param[out] FileHandle  The handle of the open file.
+
+  @return     Status from a call to ShellOpenFileByName().
+**/
+EFI_STATUS
+DpCreateFile (
+  IN  CONST CHAR16        *FileName,
+  OUT SHELL_FILE_HANDLE   *FileHandle
+  )
+{
+  if (ShellFileExists (FileName) == EFI_SUCCESS) {
+    ShellDeleteFileByName (FileName);
+  }
+  return ShellOpenFileByName (
+           FileName,
+           FileHandle,
+           EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+           0
+           );
+}
+
+/**
+  Formatted write of an ASCII line to a file.
+
+  @param[in]  FileHandle  The file to write to.
+  @param[in]  Format      An ASCII format string.
+  @param[in]  ...         The variable argument list.
+
+  @return     Status from a call to ShellWriteFile().
+**/
+EFI_STATUS
+EFIAPI
+DpWriteLine (
+  IN SHELL_FILE_HANDLE    FileHandle,
+  IN CONST CHAR8          *Format,
+  ...
+  )
+{
+  CHAR8     Line[DP_EXPORT_LINE_SIZE];
+  VA_LIST   Marker;
+  UINTN     Size;
+
+  VA_START (Marker, Format);
+  Size = AsciiVSPrint (Line, sizeof (Line), Format, Marker);
+  VA_END (Marker);
+
+  return ShellWriteFile (FileHandle, &Size, Line);
+}
+
+/**
+  Write all complete Trace measurements as Chrome trace events.
+
+  Each measurement is a complete ("X") event.  Nesting is shown by the viewer
+  from the event times, and is also given by the depth and self time arguments.
+
+  @param[in]  FileName    The name of the JSON file to write.
+
+  @return     Status from the file operations.
+**/
+EFI_STATUS
+DpWriteTraceEvents (
+  IN CONST CHAR16         *FileName
+  )
+{
+  SHELL_FILE_HANDLE         FileHandle;
+  DP_EXPORT_RECORD          *Record;
+  CONST CHAR8               *Category;
+  UINTN                     Index;
+  EFI_STATUS                Status;
+
+  Status = DpCreateFile (FileName, &FileHandle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = DpWriteLine (FileHandle, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (Index = 0; (Index < mExportCount) && !EFI_ERROR (Status); Index++) {
+    Record = &mExportRecords[Index];
+    if (IsPhase (&Record->Measurement)) {
+      Category = "phase";
+    } else if (AsciiStrnCmp (Record->Measurement.Token, ALit_PEIM, PERF_TOKEN_LENGTH) == 0) {
+      Category = "peim";
+    } else if (Record->Measurement.Handle != NULL) {
+      Category = "driver";
+    } else {
+      Category = "general";
+    }
+    Status = DpWriteLine (
+               FileHandle,
+               "%a{\"name\":\"%a %a\",\"cat\":\"%a\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%Ld,\"dur\":%Ld,"
+               "\"args\":{\"module\":\"%a\",\"token\":\"%a\",\"handle\":\"0x%p\",\"id\":%d,\"depth\":%d,\"self\":%Ld}}\n",
+               (Index == 0) ? "" : ",",
+               Record->Token,
+               Record->Name,
+               Category,
+               Record->StartTime,
+               Record->Inclusive,
+               Record->Name,
+               Record->Token,
+               Record->Measurement.Handle,
+               Record->Measurement.Identifier,
+               Record->Depth,
+               Record->Exclusive
+               );
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = DpWriteLine (FileHandle, "]}\n");
+  }
+
+  ShellCloseFile (&FileHandle);
+  return Status;
+}
+
+/**
+  Write the per-module times as CSV.
+
+  @param[in]  FileName    The name of the CSV file to write.
+
+  @return     Status from the file operations.
+**/
+EFI_STATUS
+DpWriteModuleTimes (
+  IN CONST CHAR16         *FileName
+  )
+{
+  SHELL_FILE_HANDLE         FileHandle;
+  DP_MODULE_TIME            *ModuleTime;
+  UINTN                     Index;
+  EFI_STATUS                Status;
+
+  Status = DpCreateFile (FileName, &FileHandle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = DpWriteLine (
+             FileHandle,
+             "Module,Count,Inclusive(us),Exclusive(us),SupportedCount,Supported(us),StartCount,Start(us)\n"
+             );
+  for (Index = 0; (Index < mModuleCount) && !EFI_ERROR (Status); Index++) {
+    ModuleTime = &mModuleTimes[Index];
+    Status = DpWriteLine (
+               FileHandle,
+               "%a,%d,%Ld,%Ld,%d,%Ld,%d,%Ld\n",
+               ModuleTime->Name,
+               ModuleTime->Count,
+               ModuleTime->Inclusive,
+               ModuleTime->Exclusive,
+               ModuleTime->SupportedCount,
+               ModuleTime->Supported,
+               ModuleTime->StartCount,
+               ModuleTime->Start
+               );
+  }
+
+  ShellCloseFile (&FileHandle);
+  return Status;
+}
+
+/**
+  Print one line of the comparison if the module's time changed by at least
+  mInterestThreshold microseconds.
+
+  @param[in]  Name        The module name.
+  @param[in]  BaseTime    The inclusive time in the baseline, in microseconds.
+  @param[in]  NewTime     The inclusive time in this boot, in microseconds.
+
+  @retval     TRUE        The module became slower by at least the threshold.
+  @retval     FALSE       The module did not become slower by the threshold.
+**/
+BOOLEAN
+DpPrintModuleDifference (
+  IN CONST CHAR8          *Name,
+  IN UINT64               BaseTime,
+  IN UINT64               NewTime
+  )
+{
+  if (NewTime >= BaseTime) {
+    if (NewTime - BaseTime < mInterestThreshold) {
+      return FALSE;
+    }
+  } else if (BaseTime - NewTime < mInterestThreshold) {
+    return FALSE;
+  }
+
+  PrintToken (STRING_TOKEN (STR_DP_DIFF_VARS), Name, BaseTime, NewTime, (INT64) (NewTime - BaseTime));
+  return (BOOLEAN) (NewTime > BaseTime);
+}
+
+/**
+  Compare the per-module inclusive times against a CSV file written with -c.
+
+  Modules missing from either side are compared against a time of zero.
+
+  @param[in]  FileName    The name of the baseline CSV file.
+
+  @retval EFI_SUCCESS     No module became slower by mInterestThreshold or more.
+  @retval EFI_ABORTED     At least one module became slower by mInterestThreshold or more.
+  @return                 Status from the file operations.
+**/
+EFI_STATUS
+DpCompareModuleTimes (
+  IN CONST CHAR16         *FileName
+  )
+{
+  SHELL_FILE_HANDLE         FileHandle;
+  UINT64                    FileSize;
+  UINTN                     ReadSize;
+  CHAR8                     *Buffer;
+  CHAR8                     *Line;
+  CHAR8                     *Next;
+  CHAR8                     *Field;
+  UINT64                    BaseTime;
+  UINT64                    NewTime;
+  UINTN                     Index;
+  UINTN                     Regressions;
+  EFI_STRING                StringPtr;
+  EFI_STATUS                Status;
+
+  Status = ShellOpenFileByName (FileName, &FileHandle, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Buffer = NULL;
+  Status = ShellGetFileSize (FileHandle, &FileSize);
+  if (!EFI_ERROR (Status)) {
+    ReadSize = (UINTN) FileSize;
+    Buffer   = AllocatePool (ReadSize + 1);
+    if (Buffer == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else {
+      Status = ShellReadFile (FileHandle, &ReadSize, Buffer);
+      Buffer[ReadSize] = '\0';
+    }
+  }
+  ShellCloseFile (&FileHandle);
+  if (EFI_ERROR (Status)) {
+    SafeFreePool (Buffer);
+    return Status;
+  }
+
+  StringPtr = HiiGetString (gHiiHandle, STRING_TOKEN (STR_DP_SECTION_DIFF), NULL);
+  PrintToken (STRING_TOKEN (STR_DP_SECTION_HEADER), StringPtr);
+  SafeFreePool (StringPtr);
+  PrintToken (STRING_TOKEN (STR_DP_DIFF_HEADR));
+  PrintToken (STRING_TOKEN (STR_DP_DASHES));
+
+  Regressions = 0;
+
+  //
+  // Skip the header line, then take the module name and inclusive time
+  // from each line.
+  //
+  for (Line = AsciiStrStr (Buffer, "\n"); Line != NULL; Line = Next) {
+    Line++;
+    Next = AsciiStrStr (Line, "\n");
+    if (Next != NULL) {
+      *Next = '\0';
+    }
+    Field = AsciiStrStr (Line, ",");
+    if (Field == NULL) {
+      continue;
+    }
+    *Field = '\0';
+    Field = AsciiStrStr (Field + 1, ",");
+    if (Field == NULL) {
+      continue;
+    }
+    BaseTime = AsciiStrDecimalToUint64 (Field + 1);
+
+    NewTime = 0;
+    for (Index = 0; Index < mModuleCount; Index++) {
+      if (!mModuleTimes[Index].Matched && (AsciiStrCmp (mModuleTimes[Index].Name, Line) == 0)) {
+        mModuleTimes[Index].Matched = TRUE;
+        NewTime = mModuleTimes[Index].Inclusive;
+        break;
+      }
+    }
+    if (DpPrintModuleDifference (Line, BaseTime, NewTime)) {
+      Regressions++;
+    }
+  }
+
+  for (Index = 0; Index < mModuleCount; Index++) {
+    if (!mModuleTimes[Index].Matched &&
+        DpPrintModuleDifference (mModuleTimes[Index].Name, 0, mModuleTimes[Index].Inclusive)) {
+      Regressions++;
+    }
+  }
+  FreePool (Buffer);
+
+  PrintToken (STRING_TOKEN (STR_DP_DIFF_SUMMARY), Regressions, mInterestThreshold);
+  return (Regressions == 0) ? EFI_SUCCESS : EFI_ABORTED;
+}
+
+/**
+  Export the Trace measurements in machine readable form.
+
+  Any combination of the three outputs may be requested.  The measurements
+  are collected once and shared by all of them.
+
+  @pre  GatherStatistics() has been called.
+
+  @param[in]    JsonFile      Name of the Chrome trace event file to write, or NULL.
+  @param[in]    CsvFile       Name of the per-module CSV file to write, or NULL.
+  @param[in]    BaselineFile  Name of a per-module CSV file to compare against, or NULL.
+
+  @retval EFI_SUCCESS         All requested outputs were written, and no module became
+                              slower than in BaselineFile by mInterestThreshold or more.
+  @retval EFI_ABORTED         A module became slower than in BaselineFile.
+  @return                     Status of the first operation to fail.
+**/
+EFI_STATUS
+ExportTrace (
+  IN CONST CHAR16   *JsonFile,      OPTIONAL
+  IN CONST CHAR16   *CsvFile,       OPTIONAL
+  IN CONST CHAR16   *BaselineFile   OPTIONAL
+  )
+{
+  EFI_STATUS        Status;
+
+  Status = DpCollectExportRecords ();
+
+  if (!EFI_ERROR (Status) && (JsonFile != NULL)) {
+    Status = DpWriteTraceEvents (JsonFile);
+    if (EFI_ERROR (Status)) {
+      PrintToken (STRING_TOKEN (STR_DP_EXPORT_ERROR), JsonFile, Status);
+    } else {
+      PrintToken (STRING_TOKEN (STR_DP_EXPORT_DONE), mExportCount, JsonFile);
+    }
+  }
+
+  if (!EFI_ERROR (Status) && (CsvFile != NULL)) {
+    Status = DpWriteModuleTimes (CsvFile);
+    if (EFI_ERROR (Status)) {
+      PrintToken (STRING_TOKEN (STR_DP_EXPORT_ERROR), CsvFile, Status);
+    } else {
+      PrintToken (STRING_TOKEN (STR_DP_EXPORT_DONE), mModuleCount, CsvFile);
+    }
+  }
+
+  if (!EFI_ERROR (Status) && (BaselineFile != NULL)) {
+    Status = DpCompareModuleTimes (BaselineFile);
+    if (EFI_ERROR (Status) && (Status != EFI_ABORTED)) {
+      PrintToken (STRING_TOKEN (STR_DP_DIFF_ERROR), BaselineFile, Status);
+    }
+  }
+
+  SafeFreePool (mExportRecords);
+  SafeFreePool (mModuleTimes);
+  mExportRecords = NULL;
+  mModuleTimes   = NULL;
+  mExportCount   = 0;
+  mModuleCount   = 0;
+
+  return Status;
+}
@@ -4,7 +4,7 @@
   Declarations of data and functions which are private to the Dp application.
   This file should never be referenced by anything other than components of the
   Dp application.  In addition to global data, function declarations for
-  DpUtilities.c, DpTrace.c, and DpProfile.c are included here.
+  DpUtilities.c, DpTrace.c, DpProfile.c, and DpExport.c are included here.
 
   Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
@@ -354,6 +354,30 @@ DumpRawProfile(
   IN BOOLEAN        ExcludeFlag
   );
 
+/**
+  Export the Trace measurements in machine readable form.
+
+  Any combination of the three outputs may be requested.  The measurements
+  are collected once and shared by all of them.
+
+  @pre  GatherStatistics() has been called.
+
+  @param[in]    JsonFile      Name of the Chrome trace event file to write, or NULL.
+  @param[in]    CsvFile       Name of the per-module CSV file to write, or NULL.
+  @param[in]    BaselineFile  Name of a per-module CSV file to compare against, or NULL.
+
+  @retval EFI_SUCCESS         All requested outputs were written, and no module became
+                              slower than in BaselineFile by mInterestThreshold or more.
+  @retval EFI_ABORTED         A module became slower than in BaselineFile.
+  @return                     Status of the first operation to fail.
+**/
+EFI_STATUS
+ExportTrace (
+  IN CONST CHAR16   *JsonFile,      OPTIONAL
+  IN CONST CHAR16   *CsvFile,       OPTIONAL
+  IN CONST CHAR16   *BaselineFile   OPTIONAL
+  );
+
 /**
   Wrap original FreePool to check NULL pointer first.
 
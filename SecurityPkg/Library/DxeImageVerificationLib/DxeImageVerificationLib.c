@@ -12,7 +12,7 @@
   DxeImageVerificationHandler(), HashPeImageByType(), HashPeImage() function will accept
   untrusted PE/COFF image and validate its data structure within this image buffer before use.
 
-Copyright (c) 2009 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -41,6 +41,13 @@ UINT8                               *mImageBase       = NULL;
 UINT8                               mImageDigest[MAX_DIGEST_SIZE];
 UINTN                               mImageDigestSize;
 
+//
+// Parsed db and dbx. RefreshSignatureDbIndex() compares each snapshot with its variable
+// once per image and rebuilds the index when the variable was updated.
+//
+SIGNATURE_DB_INDEX                  mDbIndex  = { EFI_IMAGE_SECURITY_DATABASE };
+SIGNATURE_DB_INDEX                  mDbxIndex = { EFI_IMAGE_SECURITY_DATABASE1 };
+
 //
 // Notify string for authorization UI.
 //
@@ -818,13 +825,403 @@ AddImageExeInfo (
   }
 }
 
+/**
+  Get the hash algorithm of an EFI_CERT_X509_SHAxxx signature type.
+
+  @param[in]  SignatureType     Signature type of a signature list.
+
+  @return HASHALG_xxx of the certificate digest, or HASHALG_MAX if SignatureType
+          is not a certificate hash type.
+
+**/
+UINT32
+GetCertHashAlg (
+  IN EFI_GUID               *SignatureType
+  )
+{
+  if (CompareGuid (SignatureType, &gEfiCertX509Sha256Guid)) {
+    return HASHALG_SHA256;
+  } else if (CompareGuid (SignatureType, &gEfiCertX509Sha384Guid)) {
+    return HASHALG_SHA384;
+  } else if (CompareGuid (SignatureType, &gEfiCertX509Sha512Guid)) {
+    return HASHALG_SHA512;
+  }
+
+  return HASHALG_MAX;
+}
+
+/**
+  Compare a signature database entry with a lookup key.
+
+  @param[in]  Entry             Signature database entry.
+  @param[in]  CertType          Signature type of the key.
+  @param[in]  Key               Key bytes.
+  @param[in]  KeySize           Size of Key in bytes.
+
+  @retval <0                    Entry sorts before the key.
+  @retval 0                     Entry matches the key.
+  @retval >0                    Entry sorts after the key.
+
+**/
+INTN
+CompareSignatureDbKey (
+  IN CONST SIGNATURE_DB_ENTRY  *Entry,
+  IN CONST EFI_GUID            *CertType,
+  IN CONST UINT8               *Key,
+  IN UINTN                     KeySize
+  )
+{
+  INTN                      Result;
+
+  Result = CompareMem (&Entry->CertList->SignatureType, CertType, sizeof (EFI_GUID));
+  if (Result != 0) {
+    return Result;
+  }
+  if (Entry->KeySize != KeySize) {
+    return (Entry->KeySize < KeySize) ? -1 : 1;
+  }
+  return CompareMem (Entry->Key, Key, KeySize);
+}
+
+/**
+  Compare two signature database entries by type, key and position in the variable.
+
+  @param[in]  Entry1            First entry.
+  @param[in]  Entry2            Second entry.
+
+  @retval <0                    Entry1 sorts before Entry2.
+  @retval 0                     Entry1 and Entry2 are the same entry.
+  @retval >0                    Entry1 sorts after Entry2.
+
+**/
+INTN
+CompareSignatureDbEntry (
+  IN CONST SIGNATURE_DB_ENTRY  *Entry1,
+  IN CONST SIGNATURE_DB_ENTRY  *Entry2
+  )
+{
+  INTN                      Result;
+
+  Result = CompareSignatureDbKey (Entry1, &Entry2->CertList->SignatureType, Entry2->Key, Entry2->KeySize);
+  if ((Result != 0) || (Entry1->Ordinal == Entry2->Ordinal)) {
+    return Result;
+  }
+  return (Entry1->Ordinal < Entry2->Ordinal) ? -1 : 1;
+}
+
+/**
+  Sort signature database entries in place with heap sort.
+
+  @param[in, out]  Entries      Entries to sort.
+  @param[in]       Count        Number of entries.
+
+**/
+VOID
+SortSignatureDbEntries (
+  IN OUT SIGNATURE_DB_ENTRY  *Entries,
+  IN     UINTN               Count
+  )
+{
+  SIGNATURE_DB_ENTRY        Swap;
+  UINTN                     Start;
+  UINTN                     End;
+  UINTN                     Root;
+  UINTN                     Child;
+
+  if (Count < 2) {
+    return;
+  }
+
+  Start = Count / 2;
+  End   = Count;
+  while (End > 1) {
+    if (Start > 0) {
+      //
+      // Build the heap.
+      //
+      Start--;
+    } else {
+      //
+      // Move the largest entry behind the heap.
+      //
+      End--;
+      CopyMem (&Swap, &Entries[0], sizeof (Swap));
+      CopyMem (&Entries[0], &Entries[End], sizeof (Swap));
+      CopyMem (&Entries[End], &Swap, sizeof (Swap));
+    }
+
+    Root = Start;
+    while (2 * Root + 1 < End) {
+      Child = 2 * Root + 1;
+      if ((Child + 1 < End) && (CompareSignatureDbEntry (&Entries[Child], &Entries[Child + 1]) < 0)) {
+        Child++;
+      }
+      if (CompareSignatureDbEntry (&Entries[Root], &Entries[Child]) >= 0) {
+        break;
+      }
+      CopyMem (&Swap, &Entries[Root], sizeof (Swap));
+      CopyMem (&Entries[Root], &Entries[Child], sizeof (Swap));
+      CopyMem (&Entries[Child], &Swap, sizeof (Swap));
+      Root = Child;
+    }
+  }
+}
+
+/**
+  Walk the signature lists of a signature database snapshot.
+
+  With NULL entry arrays, only the entries are counted. Otherwise the arrays are filled;
+  they must be large enough for the counts returned by a previous counting walk.
+  The walk stops at the first malformed signature list.
+
+  @param[in, out]  DbIndex      Signature database index whose Data is walked.
+  @param[out]      HashCount    Number of entries other than EFI_CERT_X509_GUID.
+  @param[out]      X509Count    Number of EFI_CERT_X509_GUID entries.
+
+**/
+VOID
+WalkSignatureDb (
+  IN OUT SIGNATURE_DB_INDEX  *DbIndex,
+  OUT    UINTN               *HashCount,
+  OUT    UINTN               *X509Count
+  )
+{
+  EFI_SIGNATURE_LIST        *CertList;
+  EFI_SIGNATURE_DATA        *Cert;
+  SIGNATURE_DB_ENTRY        *Entry;
+  UINTN                     DataSize;
+  UINTN                     CertCount;
+  UINTN                     DataLength;
+  UINTN                     KeySize;
+  UINTN                     Index;
+  UINTN                     Ordinal;
+  UINT32                    HashAlg;
+  BOOLEAN                   IsX509;
+
+  *HashCount = 0;
+  *X509Count = 0;
+  Ordinal    = 0;
+  CertList   = (EFI_SIGNATURE_LIST *) DbIndex->Data;
+  DataSize   = DbIndex->DataSize;
+  while ((DataSize >= sizeof (EFI_SIGNATURE_LIST)) && (DataSize >= CertList->SignatureListSize)) {
+    if ((CertList->SignatureListSize < sizeof (EFI_SIGNATURE_LIST)) ||
+        (CertList->SignatureHeaderSize > CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST)) ||
+        (CertList->SignatureSize <= sizeof (EFI_GUID))) {
+      break;
+    }
+
+    CertCount  = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+    Cert       = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
+    DataLength = CertList->SignatureSize - sizeof (EFI_GUID);
+    IsX509     = CompareGuid (&CertList->SignatureType, &gEfiCertX509Guid);
+    HashAlg    = GetCertHashAlg (&CertList->SignatureType);
+    KeySize    = DataLength;
+    if (HashAlg != HASHALG_MAX) {
+      //
+      // Certificate hash entries are the TBSCertificate digest followed by the revocation time.
+      //
+      KeySize = mHash[HashAlg].DigestLength;
+      if (DataLength < KeySize + sizeof (EFI_TIME)) {
+        CertCount = 0;
+      } else if (CertCount > 0) {
+        DbIndex->CertHashAlgMask |= (UINT32) (1 << HashAlg);
+      }
+    }
+
+    for (Index = 0; Index < CertCount; Index++) {
+      Entry = NULL;
+      if (IsX509) {
+        if (DbIndex->X509 != NULL) {
+          Entry = &DbIndex->X509[*X509Count];
+        }
+        (*X509Count)++;
+      } else {
+        if (DbIndex->Hash != NULL) {
+          Entry = &DbIndex->Hash[*HashCount];
+        }
+        (*HashCount)++;
+      }
+
+      if (Entry != NULL) {
+        Entry->CertList = CertList;
+        Entry->Cert     = Cert;
+        Entry->Key      = Cert->SignatureData;
+        Entry->KeySize  = KeySize;
+        Entry->Ordinal  = Ordinal;
+      }
+
+      Ordinal++;
+      Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
+    }
+
+    DataSize -= CertList->SignatureListSize;
+    CertList  = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
+  }
+}
+
+/**
+  Release the snapshot and entries of a signature database index.
+
+  The scratch buffer is kept for the next refresh.
+
+  @param[in, out]  DbIndex      Signature database index.
+
+**/
+VOID
+FreeSignatureDbIndex (
+  IN OUT SIGNATURE_DB_INDEX  *DbIndex
+  )
+{
+  if (DbIndex->Data != NULL) {
+    FreePool (DbIndex->Data);
+  }
+  if (DbIndex->Hash != NULL) {
+    FreePool (DbIndex->Hash);
+  }
+  if (DbIndex->X509 != NULL) {
+    FreePool (DbIndex->X509);
+  }
+
+  DbIndex->Present         = FALSE;
+  DbIndex->Data            = NULL;
+  DbIndex->DataSize        = 0;
+  DbIndex->CertHashAlgMask = 0;
+  DbIndex->Hash            = NULL;
+  DbIndex->HashCount       = 0;
+  DbIndex->X509            = NULL;
+  DbIndex->X509Count       = 0;
+}
+
+/**
+  Make sure a signature database index describes the current content of its variable.
+
+  The variable is read once per image. When its content differs from the snapshot the
+  index was built from, the index is rebuilt, so db/dbx updates through SetVariable()
+  take effect for the next image verified.
+
+  @param[in, out]  DbIndex      Signature database index.
+
+  @retval TRUE                  The variable exists and DbIndex describes its content.
+  @retval FALSE                 The variable doesn't exist or couldn't be parsed.
+
+**/
+BOOLEAN
+RefreshSignatureDbIndex (
+  IN OUT SIGNATURE_DB_INDEX  *DbIndex
+  )
+{
+  EFI_STATUS                Status;
+  UINTN                     DataSize;
+  UINTN                     HashCount;
+  UINTN                     X509Count;
+
+  if (DbIndex->Checked) {
+    return DbIndex->Present;
+  }
+  DbIndex->Checked = TRUE;
+
+  DataSize = 0;
+  Status   = gRT->GetVariable (DbIndex->VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    if (DbIndex->ScratchSize < DataSize) {
+      if (DbIndex->Scratch != NULL) {
+        FreePool (DbIndex->Scratch);
+      }
+      DbIndex->Scratch     = (UINT8 *) AllocatePool (DataSize);
+      DbIndex->ScratchSize = (DbIndex->Scratch == NULL) ? 0 : DataSize;
+    }
+
+    Status = EFI_OUT_OF_RESOURCES;
+    if (DbIndex->Scratch != NULL) {
+      Status = gRT->GetVariable (DbIndex->VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, DbIndex->Scratch);
+    }
+  }
+  if (EFI_ERROR (Status)) {
+    FreeSignatureDbIndex (DbIndex);
+    return FALSE;
+  }
+
+  if (DbIndex->Present &&
+      (DataSize == DbIndex->DataSize) &&
+      (CompareMem (DbIndex->Scratch, DbIndex->Data, DataSize) == 0)) {
+    return TRUE;
+  }
+
+  //
+  // The variable changed. The fresh copy becomes the snapshot.
+  //
+  FreeSignatureDbIndex (DbIndex);
+  DbIndex->Data        = DbIndex->Scratch;
+  DbIndex->DataSize    = DataSize;
+  DbIndex->Scratch     = NULL;
+  DbIndex->ScratchSize = 0;
+
+  WalkSignatureDb (DbIndex, &HashCount, &X509Count);
+  if (HashCount > 0) {
+    DbIndex->Hash = (SIGNATURE_DB_ENTRY *) AllocatePool (HashCount * sizeof (SIGNATURE_DB_ENTRY));
+  }
+  if (X509Count > 0) {
+    DbIndex->X509 = (SIGNATURE_DB_ENTRY *) AllocatePool (X509Count * sizeof (SIGNATURE_DB_ENTRY));
+  }
+  if (((HashCount > 0) && (DbIndex->Hash == NULL)) || ((X509Count > 0) && (DbIndex->X509 == NULL))) {
+    FreeSignatureDbIndex (DbIndex);
+    return FALSE;
+  }
+
+  WalkSignatureDb (DbIndex, &DbIndex->HashCount, &DbIndex->X509Count);
+  SortSignatureDbEntries (DbIndex->Hash, DbIndex->HashCount);
+  DbIndex->Present = TRUE;
+
+  return TRUE;
+}
+
+/**
+  Find the first entry of a signature database index matching a key.
+
+  @param[in]  DbIndex           Signature database index.
+  @param[in]  CertType          Signature type to search for.
+  @param[in]  Key               Key bytes to search for.
+  @param[in]  KeySize           Size of Key in bytes.
+
+  @return The matching entry that comes first in the variable, or NULL if none matches.
+
+**/
+SIGNATURE_DB_ENTRY *
+LookupSignatureDbIndex (
+  IN SIGNATURE_DB_INDEX     *DbIndex,
+  IN EFI_GUID               *CertType,
+  IN UINT8                  *Key,
+  IN UINTN                  KeySize
+  )
+{
+  UINTN                     Low;
+  UINTN                     High;
+  UINTN                     Middle;
+
+  Low  = 0;
+  High = DbIndex->HashCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (CompareSignatureDbKey (&DbIndex->Hash[Middle], CertType, Key, KeySize) < 0) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if ((Low < DbIndex->HashCount) && (CompareSignatureDbKey (&DbIndex->Hash[Low], CertType, Key, KeySize) == 0)) {
+    return &DbIndex->Hash[Low];
+  }
+
+  return NULL;
+}
+
 /**
   Check whether the hash of an given X.509 certificate is in forbidden database (DBX).
 
   @param[in]  Certificate       Pointer to X.509 Certificate that is searched for.
   @param[in]  CertSize          Size of X.509 Certificate.
-  @param[in]  SignatureList     Pointer to the Signature List in forbidden database.
-  @param[in]  SignatureListSize Size of Signature List.
+  @param[in]  DbxIndex          Index of the forbidden database.
   @param[out] RevocationTime    Return the time that the certificate was revoked.
 
   @return TRUE   The certificate hash is found in the forbidden database.
@@ -835,33 +1232,23 @@ BOOLEAN
 IsCertHashFoundInDatabase (
   IN  UINT8               *Certificate,
   IN  UINTN               CertSize,
-  IN  EFI_SIGNATURE_LIST  *SignatureList,
-  IN  UINTN               SignatureListSize,
+  IN  SIGNATURE_DB_INDEX  *DbxIndex,
   OUT EFI_TIME            *RevocationTime
   )
 {
-  BOOLEAN             IsFound;
   BOOLEAN             Status;
-  EFI_SIGNATURE_LIST  *DbxList;
-  UINTN               DbxSize;
-  EFI_SIGNATURE_DATA  *CertHash;
-  UINTN               CertHashCount;
-  UINTN               Index;
   UINT32              HashAlg;
   VOID                *HashCtx;
   UINT8               CertDigest[MAX_DIGEST_SIZE];
-  UINT8               *DbxCertHash;
-  UINTN               SiglistHeaderSize;
   UINT8               *TBSCert;
   UINTN               TBSCertSize;
+  EFI_GUID            *CertType;
+  SIGNATURE_DB_ENTRY  *Entry;
+  SIGNATURE_DB_ENTRY  *Found;
 
-  IsFound  = FALSE;
-  DbxList  = SignatureList;
-  DbxSize  = SignatureListSize;
-  HashCtx  = NULL;
-  HashAlg  = HASHALG_MAX;
+  Found = NULL;
 
-  if ((RevocationTime == NULL) || (DbxList == NULL)) {
+  if ((RevocationTime == NULL) || (DbxIndex == NULL) || (DbxIndex->CertHashAlgMask == 0)) {
     return FALSE;
   }
 
@@ -872,79 +1259,92 @@ IsCertHashFoundInDatabase (
     return FALSE;
   }
 
-  while ((DbxSize > 0) && (SignatureListSize >= DbxList->SignatureListSize)) {
-    //
-    // Determine Hash Algorithm of Certificate in the forbidden database.
-    //
-    if (CompareGuid (&DbxList->SignatureType, &gEfiCertX509Sha256Guid)) {
-      HashAlg = HASHALG_SHA256;
-    } else if (CompareGuid (&DbxList->SignatureType, &gEfiCertX509Sha384Guid)) {
-      HashAlg = HASHALG_SHA384;
-    } else if (CompareGuid (&DbxList->SignatureType, &gEfiCertX509Sha512Guid)) {
-      HashAlg = HASHALG_SHA512;
-    } else {
-      DbxSize -= DbxList->SignatureListSize;
-      DbxList  = (EFI_SIGNATURE_LIST *) ((UINT8 *) DbxList + DbxList->SignatureListSize);
+  //
+  // Hash the TBSCertificate once for each algorithm used in the forbidden database and
+  // look the digest up. If several entries match, the one coming first in dbx wins.
+  //
+  for (HashAlg = HASHALG_SHA256; HashAlg <= HASHALG_SHA512; HashAlg++) {
+    if ((DbxIndex->CertHashAlgMask & (1 << HashAlg)) == 0) {
       continue;
     }
 
+    if (HashAlg == HASHALG_SHA256) {
+      CertType = &gEfiCertX509Sha256Guid;
+    } else if (HashAlg == HASHALG_SHA384) {
+      CertType = &gEfiCertX509Sha384Guid;
+    } else {
+      CertType = &gEfiCertX509Sha512Guid;
+    }
+
     //
     // Calculate the hash value of current TBSCertificate for comparision.
     //
     if (mHash[HashAlg].GetContextSize == NULL) {
-      goto Done;
+      return FALSE;
     }
     ZeroMem (CertDigest, MAX_DIGEST_SIZE);
     HashCtx = AllocatePool (mHash[HashAlg].GetContextSize ());
     if (HashCtx == NULL) {
-      goto Done;
+      return FALSE;
     }
     Status = mHash[HashAlg].HashInit (HashCtx);
-    if (!Status) {
-      goto Done;
+    if (Status) {
+      Status = mHash[HashAlg].HashUpdate (HashCtx, TBSCert, TBSCertSize);
     }
-    Status = mHash[HashAlg].HashUpdate (HashCtx, TBSCert, TBSCertSize);
-    if (!Status) {
-      goto Done;
+    if (Status) {
+      Status = mHash[HashAlg].HashFinal (HashCtx, CertDigest);
     }
-    Status = mHash[HashAlg].HashFinal (HashCtx, CertDigest);
+    FreePool (HashCtx);
     if (!Status) {
-      goto Done;
+      return FALSE;
     }
 
-    SiglistHeaderSize = sizeof (EFI_SIGNATURE_LIST) + DbxList->SignatureHeaderSize;
-    CertHash          = (EFI_SIGNATURE_DATA *) ((UINT8 *) DbxList + SiglistHeaderSize);
-    CertHashCount     = (DbxList->SignatureListSize - SiglistHeaderSize) / DbxList->SignatureSize;
-    for (Index = 0; Index < CertHashCount; Index++) {
-      //
-      // Iterate each Signature Data Node within this CertList for verify.
-      //
-      DbxCertHash = CertHash->SignatureData;
-      if (CompareMem (DbxCertHash, CertDigest, mHash[HashAlg].DigestLength) == 0) {
-        //
-        // Hash of Certificate is found in forbidden database.
-        //
-        IsFound = TRUE;
-
-        //
-        // Return the revocation time.
-        //
-        CopyMem (RevocationTime, (EFI_TIME *)(DbxCertHash + mHash[HashAlg].DigestLength), sizeof (EFI_TIME));
-        goto Done;
-      }
-      CertHash = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertHash + DbxList->SignatureSize);
+    Entry = LookupSignatureDbIndex (DbxIndex, CertType, CertDigest, mHash[HashAlg].DigestLength);
+    if ((Entry != NULL) && ((Found == NULL) || (Entry->Ordinal < Found->Ordinal))) {
+      Found = Entry;
     }
+  }
 
-    DbxSize -= DbxList->SignatureListSize;
-    DbxList  = (EFI_SIGNATURE_LIST *) ((UINT8 *) DbxList + DbxList->SignatureListSize);
+  if (Found == NULL) {
+    return FALSE;
   }
 
-Done:
-  if (HashCtx != NULL) {
-    FreePool (HashCtx);
+  //
+  // Hash of Certificate is found in forbidden database. Return the revocation time.
+  //
+  CopyMem (RevocationTime, (EFI_TIME *) (Found->Key + Found->KeySize), sizeof (EFI_TIME));
+  return TRUE;
+}
+
+/**
+  Get the signature database index of a db/dbx variable, refreshed for the current image.
+
+  @param[in]  VariableName        Name of database variable.
+
+  @return The signature database index, or NULL if the variable is not an indexed
+          database or doesn't exist.
+
+**/
+SIGNATURE_DB_INDEX *
+GetSignatureDbIndex (
+  IN CHAR16             *VariableName
+  )
+{
+  SIGNATURE_DB_INDEX    *DbIndex;
+
+  if (StrCmp (VariableName, EFI_IMAGE_SECURITY_DATABASE) == 0) {
+    DbIndex = &mDbIndex;
+  } else if (StrCmp (VariableName, EFI_IMAGE_SECURITY_DATABASE1) == 0) {
+    DbIndex = &mDbxIndex;
+  } else {
+    return NULL;
+  }
+
+  if (!RefreshSignatureDbIndex (DbIndex)) {
+    return NULL;
   }
 
-  return IsFound;
+  return DbIndex;
 }
 
 /**
@@ -967,71 +1367,24 @@ IsSignatureFoundInDatabase (
   IN UINTN              SignatureSize
   )
 {
-  EFI_STATUS          Status;
-  EFI_SIGNATURE_LIST  *CertList;
-  EFI_SIGNATURE_DATA  *Cert;
-  UINTN               DataSize;
-  UINT8               *Data;
-  UINTN               Index;
-  UINTN               CertCount;
-  BOOLEAN             IsFound;
-
-  //
-  // Read signature database variable.
-  //
-  IsFound   = FALSE;
-  Data      = NULL;
-  DataSize  = 0;
-  Status    = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  if (Status != EFI_BUFFER_TOO_SMALL) {
+  SIGNATURE_DB_INDEX    *DbIndex;
+  SIGNATURE_DB_ENTRY    *Entry;
+
+  DbIndex = GetSignatureDbIndex (VariableName);
+  if (DbIndex == NULL) {
     return FALSE;
   }
 
-  Data = (UINT8 *) AllocateZeroPool (DataSize);
-  if (Data == NULL) {
+  Entry = LookupSignatureDbIndex (DbIndex, CertType, Signature, SignatureSize);
+  if ((Entry == NULL) || (Entry->CertList->SignatureSize != sizeof (EFI_SIGNATURE_DATA) - 1 + SignatureSize)) {
     return FALSE;
   }
 
-  Status = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
   //
-  // Enumerate all signature data in SigDB to check if executable's signature exists.
+  // Find the signature in database.
   //
-  CertList = (EFI_SIGNATURE_LIST *) Data;
-  while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
-    CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
-    Cert      = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
-    if ((CertList->SignatureSize == sizeof(EFI_SIGNATURE_DATA) - 1 + SignatureSize) && (CompareGuid(&CertList->SignatureType, CertType))) {
-      for (Index = 0; Index < CertCount; Index++) {
-        if (CompareMem (Cert->SignatureData, Signature, SignatureSize) == 0) {
-          //
-          // Find the signature in database.
-          //
-          IsFound = TRUE;
-          SecureBootHook (VariableName, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, Cert);
-          break;
-        }
-
-        Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
-      }
-
-      if (IsFound) {
-        break;
-      }
-    }
-
-    DataSize -= CertList->SignatureListSize;
-    CertList = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
-  }
-
-Done:
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
-  return IsFound;
+  SecureBootHook (VariableName, &gEfiImageSecurityDatabaseGuid, Entry->CertList->SignatureSize, Entry->Cert);
+  return TRUE;
 }
 
 /**
@@ -1210,16 +1563,9 @@ IsForbiddenByDbx (
   IN UINTN                  AuthDataSize
   )
 {
-  EFI_STATUS                Status;
   BOOLEAN                   IsForbidden;
-  UINT8                     *Data;
-  UINTN                     DataSize;
-  EFI_SIGNATURE_LIST        *CertList;
-  UINTN                     CertListSize;
-  EFI_SIGNATURE_DATA        *CertData;
-  UINT8                     *RootCert;
-  UINTN                     RootCertSize;
-  UINTN                     CertCount;
+  SIGNATURE_DB_INDEX        *DbxIndex;
+  SIGNATURE_DB_ENTRY        *Entry;
   UINTN                     Index;
   UINT8                     *CertBuffer;
   UINTN                     BufferLength;
@@ -1235,11 +1581,6 @@ IsForbiddenByDbx (
   // Variable Initialization
   //
   IsForbidden       = FALSE;
-  Data              = NULL;
-  CertList          = NULL;
-  CertData          = NULL;
-  RootCert          = NULL;
-  RootCertSize      = 0;
   Cert              = NULL;
   CertBuffer        = NULL;
   BufferLength      = 0;
@@ -1249,18 +1590,8 @@ IsForbiddenByDbx (
   //
   // The image will not be forbidden if dbx can't be got.
   //
-  DataSize = 0;
-  Status   = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    return IsForbidden;
-  }
-  Data = (UINT8 *) AllocateZeroPool (DataSize);
-  if (Data == NULL) {
-    return IsForbidden;
-  }
-
-  Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, (VOID *) Data);
-  if (EFI_ERROR (Status)) {
+  DbxIndex = GetSignatureDbIndex (EFI_IMAGE_SECURITY_DATABASE1);
+  if (DbxIndex == NULL) {
     return IsForbidden;
   }
 
@@ -1268,42 +1599,24 @@ IsForbiddenByDbx (
   // Verify image signature with RAW X509 certificates in DBX database.
   // If passed, the image will be forbidden.
   //
-  CertList     = (EFI_SIGNATURE_LIST *) Data;
-  CertListSize = DataSize;
-  while ((CertListSize > 0) && (CertListSize >= CertList->SignatureListSize)) {
-    if (CompareGuid (&CertList->SignatureType, &gEfiCertX509Guid)) {
-      CertData  = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
-      CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+  for (Index = 0; Index < DbxIndex->X509Count; Index++) {
+    Entry = &DbxIndex->X509[Index];
 
-      for (Index = 0; Index < CertCount; Index++) {
-        //
-        // Iterate each Signature Data Node within this CertList for verify.
-        //
-        RootCert     = CertData->SignatureData;
-        RootCertSize = CertList->SignatureSize - sizeof (EFI_GUID);
-
-        //
-        // Call AuthenticodeVerify library to Verify Authenticode struct.
-        //
-        IsForbidden = AuthenticodeVerify (
-                        AuthData,
-                        AuthDataSize,
-                        RootCert,
-                        RootCertSize,
-                        mImageDigest,
-                        mImageDigestSize
-                        );
-        if (IsForbidden) {
-          SecureBootHook (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, CertData);
-          goto Done;
-        }
-
-        CertData = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertData + CertList->SignatureSize);
-      }
+    //
+    // Call AuthenticodeVerify library to Verify Authenticode struct.
+    //
+    IsForbidden = AuthenticodeVerify (
+                    AuthData,
+                    AuthDataSize,
+                    Entry->Key,
+                    Entry->KeySize,
+                    mImageDigest,
+                    mImageDigestSize
+                    );
+    if (IsForbidden) {
+      SecureBootHook (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, Entry->CertList->SignatureSize, Entry->Cert);
+      goto Done;
     }
-
-    CertListSize -= CertList->SignatureListSize;
-    CertList      = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
   }
 
   //
@@ -1337,7 +1650,7 @@ IsForbiddenByDbx (
     CertSize = (UINTN) ReadUnaligned32 ((UINT32 *)CertPtr);
     Cert     = (UINT8 *)CertPtr + sizeof (UINT32);
 
-    if (IsCertHashFoundInDatabase (Cert, CertSize, (EFI_SIGNATURE_LIST *)Data, DataSize, &RevocationTime)) {
+    if (IsCertHashFoundInDatabase (Cert, CertSize, DbxIndex, &RevocationTime)) {
       //
       // Check the timestamp signature and signing time to determine if the image can be trusted.
       //
@@ -1352,10 +1665,6 @@ IsForbiddenByDbx (
   }
 
 Done:
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
   Pkcs7FreeSigners (CertBuffer);
   Pkcs7FreeSigners (TrustedCert);
 
@@ -1378,115 +1687,57 @@ IsAllowedByDb (
   IN UINTN              AuthDataSize
   )
 {
-  EFI_STATUS                Status;
   BOOLEAN                   VerifyStatus;
-  EFI_SIGNATURE_LIST        *CertList;
-  EFI_SIGNATURE_DATA        *Cert;
-  UINTN                     DataSize;
-  UINT8                     *Data;
-  UINT8                     *RootCert;
-  UINTN                     RootCertSize;
+  SIGNATURE_DB_INDEX        *DbIndex;
+  SIGNATURE_DB_INDEX        *DbxIndex;
+  SIGNATURE_DB_ENTRY        *Entry;
   UINTN                     Index;
-  UINTN                     CertCount;
-  UINTN                     DbxDataSize;
-  UINT8                     *DbxData;
   EFI_TIME                  RevocationTime;
 
-  Data         = NULL;
-  CertList     = NULL;
-  Cert         = NULL;
-  RootCert     = NULL;
-  DbxData      = NULL;
-  RootCertSize = 0;
+  Entry        = NULL;
   VerifyStatus = FALSE;
 
-  DataSize = 0;
-  Status   = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  if (Status == EFI_BUFFER_TOO_SMALL) {
-    Data = (UINT8 *) AllocateZeroPool (DataSize);
-    if (Data == NULL) {
-      return VerifyStatus;
-    }
+  DbIndex = GetSignatureDbIndex (EFI_IMAGE_SECURITY_DATABASE);
+  if (DbIndex == NULL) {
+    return VerifyStatus;
+  }
 
-    Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, (VOID *) Data);
-    if (EFI_ERROR (Status)) {
-      goto Done;
-    }
+  //
+  // Find X509 certificate in Signature List to verify the signature in pkcs7 signed data.
+  //
+  for (Index = 0; Index < DbIndex->X509Count; Index++) {
+    Entry = &DbIndex->X509[Index];
 
     //
-    // Find X509 certificate in Signature List to verify the signature in pkcs7 signed data.
+    // Call AuthenticodeVerify library to Verify Authenticode struct.
     //
-    CertList = (EFI_SIGNATURE_LIST *) Data;
-    while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
-      if (CompareGuid (&CertList->SignatureType, &gEfiCertX509Guid)) {
-        Cert       = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
-        CertCount  = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
-
-        for (Index = 0; Index < CertCount; Index++) {
-          //
-          // Iterate each Signature Data Node within this CertList for verify.
-          //
-          RootCert     = Cert->SignatureData;
-          RootCertSize = CertList->SignatureSize - sizeof (EFI_GUID);
-
-          //
-          // Call AuthenticodeVerify library to Verify Authenticode struct.
-          //
-          VerifyStatus = AuthenticodeVerify (
-                           AuthData,
-                           AuthDataSize,
-                           RootCert,
-                           RootCertSize,
-                           mImageDigest,
-                           mImageDigestSize
-                           );
-          if (VerifyStatus) {
-            //
-            // Here We still need to check if this RootCert's Hash is revoked
-            //
-            Status   = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DbxDataSize, NULL);
-            if (Status == EFI_BUFFER_TOO_SMALL) {
-              goto Done;
-            }
-            DbxData = (UINT8 *) AllocateZeroPool (DbxDataSize);
-            if (DbxData == NULL) {
-              goto Done;
-            }
-
-            Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DbxDataSize, (VOID *) DbxData);
-            if (EFI_ERROR (Status)) {
-              goto Done;
-            }
-
-            if (IsCertHashFoundInDatabase (RootCert, RootCertSize, (EFI_SIGNATURE_LIST *)DbxData, DbxDataSize, &RevocationTime)) {
-              //
-              // Check the timestamp signature and signing time to determine if the image can be trusted.
-              //
-              VerifyStatus = PassTimestampCheck (AuthData, AuthDataSize, &RevocationTime);
-            }
-
-            goto Done;
-          }
-
-          Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
-        }
+    VerifyStatus = AuthenticodeVerify (
+                     AuthData,
+                     AuthDataSize,
+                     Entry->Key,
+                     Entry->KeySize,
+                     mImageDigest,
+                     mImageDigestSize
+                     );
+    if (VerifyStatus) {
+      //
+      // Here We still need to check if this RootCert's Hash is revoked
+      //
+      DbxIndex = GetSignatureDbIndex (EFI_IMAGE_SECURITY_DATABASE1);
+      if ((DbxIndex != NULL) &&
+          IsCertHashFoundInDatabase (Entry->Key, Entry->KeySize, DbxIndex, &RevocationTime)) {
+        //
+        // Check the timestamp signature and signing time to determine if the image can be trusted.
+        //
+        VerifyStatus = PassTimestampCheck (AuthData, AuthDataSize, &RevocationTime);
       }
 
-      DataSize -= CertList->SignatureListSize;
-      CertList = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
+      break;
     }
   }
 
-Done:
   if (VerifyStatus) {
-    SecureBootHook (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, Cert);
-  }
-
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-  if (DbxData != NULL) {
-    FreePool (DbxData);
+    SecureBootHook (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, Entry->CertList->SignatureSize, Entry->Cert);
   }
 
   return VerifyStatus;
@@ -1649,6 +1900,12 @@ DxeImageVerificationHandler (
   mImageBase  = (UINT8 *) FileBuffer;
   mImageSize  = FileSize;
 
+  //
+  // Compare db and dbx with their snapshots again before they are used for this image.
+  //
+  mDbIndex.Checked  = FALSE;
+  mDbxIndex.Checked = FALSE;
+
   ZeroMem (&ImageContext, sizeof (ImageContext));
   ImageContext.Handle    = (VOID *) FileBuffer;
   ImageContext.ImageRead = (PE_COFF_LOADER_READ_FILE) DxeImageVerificationLibImageRead;
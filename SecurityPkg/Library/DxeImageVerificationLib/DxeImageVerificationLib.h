@@ -2,7 +2,7 @@
   The internal header file includes the common header files, defines
   internal structure and functions used by ImageVerificationLib.
 
-Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -204,4 +204,67 @@ typedef struct {
   HASH_FINAL               HashFinal;
 } HASH_TABLE;
 
+//
+// One entry of a parsed signature database (db or dbx)
+//
+typedef struct {
+  //
+  // Signature list holding the entry, and the entry itself
+  //
+  EFI_SIGNATURE_LIST       *CertList;
+  EFI_SIGNATURE_DATA       *Cert;
+  //
+  // Bytes the entry is looked up by. This is the whole SignatureData, except for
+  // EFI_CERT_X509_SHAxxx entries where it is only the TBSCertificate digest.
+  //
+  UINT8                    *Key;
+  UINTN                    KeySize;
+  //
+  // Position of the entry in the variable, to keep variable order among equal keys
+  //
+  UINTN                    Ordinal;
+} SIGNATURE_DB_ENTRY;
+
+//
+// Parsed snapshot of a signature database variable
+//
+typedef struct {
+  //
+  // Name of the variable under gEfiImageSecurityDatabaseGuid
+  //
+  CHAR16                   *VariableName;
+  //
+  // TRUE when Data holds the current content of the variable
+  //
+  BOOLEAN                  Present;
+  //
+  // TRUE once the snapshot has been compared with the variable for the current image
+  //
+  BOOLEAN                  Checked;
+  //
+  // Raw variable content the entries point into
+  //
+  UINT8                    *Data;
+  UINTN                    DataSize;
+  //
+  // Buffer the variable is re-read into to detect updates
+  //
+  UINT8                    *Scratch;
+  UINTN                    ScratchSize;
+  //
+  // Bit (1 << HASHALG_xxx) set when EFI_CERT_X509_SHAxxx entries are present
+  //
+  UINT32                   CertHashAlgMask;
+  //
+  // Entries other than EFI_CERT_X509_GUID, sorted by type, key and ordinal
+  //
+  SIGNATURE_DB_ENTRY       *Hash;
+  UINTN                    HashCount;
+  //
+  // EFI_CERT_X509_GUID entries in variable order
+  //
+  SIGNATURE_DB_ENTRY       *X509;
+  UINTN                    X509Count;
+} SIGNATURE_DB_INDEX;
+
 #endif
\ No newline at end of file
@@ -1,7 +1,7 @@
 /** @file
   Ihis is BaseCrypto router support function.
 
-Copyright (c) 2013, Intel Corporation. All rights reserved. <BR>
+Copyright (c) 2013 - 2016, Intel Corporation. All rights reserved. <BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -21,6 +21,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/HashLib.h>
 #include <Protocol/TrEEProtocol.h>
 
+#include "HashLibBaseCryptoRouterCommon.h"
+
 typedef struct {
   EFI_GUID  Guid;
   UINT32    Mask;
@@ -75,3 +77,44 @@ Tpm2SetHashToDigestList (
     );
   DigestList->count ++;
 }
+
+/**
+  Feed data to every registered hash interface in a single pass.
+
+  The data is walked in HASH_UPDATE_CHUNK_SIZE chunks and every hash interface
+  consumes a chunk before the next one is touched, instead of each hash interface
+  walking the whole buffer in turn.
+
+  @param HashInterface      Array of registered hash interfaces.
+  @param HashInterfaceCount Number of entries in HashInterface and HashCtx.
+  @param HashCtx            Array of hash contexts, one per hash interface.
+  @param DataToHash         Data to be hashed.
+  @param DataToHashLen      Data size.
+**/
+VOID
+EFIAPI
+Tpm2HashUpdateInterfaces (
+  IN HASH_INTERFACE         *HashInterface,
+  IN UINTN                  HashInterfaceCount,
+  IN HASH_HANDLE            *HashCtx,
+  IN UINT8                  *DataToHash,
+  IN UINTN                  DataToHashLen
+  )
+{
+  UINTN  Index;
+  UINTN  ChunkSize;
+
+  if (HashInterfaceCount == 1) {
+    HashInterface[0].HashUpdate (HashCtx[0], DataToHash, DataToHashLen);
+    return ;
+  }
+
+  while (DataToHashLen > 0) {
+    ChunkSize = MIN (DataToHashLen, HASH_UPDATE_CHUNK_SIZE);
+    for (Index = 0; Index < HashInterfaceCount; Index++) {
+      HashInterface[Index].HashUpdate (HashCtx[Index], DataToHash, ChunkSize);
+    }
+    DataToHash    += ChunkSize;
+    DataToHashLen -= ChunkSize;
+  }
+}
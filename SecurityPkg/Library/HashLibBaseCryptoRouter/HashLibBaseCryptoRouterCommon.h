@@ -1,7 +1,7 @@
 /** @file
   Ihis is BaseCrypto router support function definition.
 
-Copyright (c) 2013, Intel Corporation. All rights reserved. <BR>
+Copyright (c) 2013 - 2016, Intel Corporation. All rights reserved. <BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -15,6 +15,13 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #ifndef _HASH_LIB_BASE_CRYPTO_ROUTER_COMMON_H_
 #define _HASH_LIB_BASE_CRYPTO_ROUTER_COMMON_H_
 
+//
+// When more than one hash interface is active, data is fed to them in chunks of
+// this size so that each chunk is still in the data cache when the next hash
+// engine consumes it. It is a multiple of the SHA-1/SHA-2 block sizes.
+//
+#define HASH_UPDATE_CHUNK_SIZE  SIZE_16KB
+
 /**
   The function get hash mask info from algorithm.
 
@@ -41,4 +48,27 @@ Tpm2SetHashToDigestList (
   IN TPML_DIGEST_VALUES     *Digest
   );
 
+/**
+  Feed data to every registered hash interface in a single pass.
+
+  The data is walked in HASH_UPDATE_CHUNK_SIZE chunks and every hash interface
+  consumes a chunk before the next one is touched, instead of each hash interface
+  walking the whole buffer in turn.
+
+  @param HashInterface      Array of registered hash interfaces.
+  @param HashInterfaceCount Number of entries in HashInterface and HashCtx.
+  @param HashCtx            Array of hash contexts, one per hash interface.
+  @param DataToHash         Data to be hashed.
+  @param DataToHashLen      Data size.
+**/
+VOID
+EFIAPI
+Tpm2HashUpdateInterfaces (
+  IN HASH_INTERFACE         *HashInterface,
+  IN UINTN                  HashInterfaceCount,
+  IN HASH_HANDLE            *HashCtx,
+  IN UINT8                  *DataToHash,
+  IN UINTN                  DataToHashLen
+  );
+
 #endif
@@ -3,7 +3,7 @@
   hash handler registerd, such as SHA1, SHA256.
   Platform can use PcdTpm2HashMask to mask some hash engines.
 
-Copyright (c) 2013 - 2014, Intel Corporation. All rights reserved. <BR>
+Copyright (c) 2013 - 2016, Intel Corporation. All rights reserved. <BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -79,7 +79,6 @@ HashUpdate (
   )
 {
   HASH_HANDLE  *HashCtx;
-  UINTN        Index;
 
   if (mHashInterfaceCount == 0) {
     return EFI_UNSUPPORTED;
@@ -87,9 +86,7 @@ HashUpdate (
 
   HashCtx = (HASH_HANDLE *)HashHandle;
 
-  for (Index = 0; Index < mHashInterfaceCount; Index++) {
-    mHashInterface[Index].HashUpdate (HashCtx[Index], DataToHash, DataToHashLen);
-  }
+  Tpm2HashUpdateInterfaces (mHashInterface, mHashInterfaceCount, HashCtx, DataToHash, DataToHashLen);
 
   return EFI_SUCCESS;
 }
@@ -127,8 +124,8 @@ HashCompleteAndExtend (
   HashCtx = (HASH_HANDLE *)HashHandle;
   ZeroMem (DigestList, sizeof(*DigestList));
 
+  Tpm2HashUpdateInterfaces (mHashInterface, mHashInterfaceCount, HashCtx, DataToHash, DataToHashLen);
   for (Index = 0; Index < mHashInterfaceCount; Index++) {
-    mHashInterface[Index].HashUpdate (HashCtx[Index], DataToHash, DataToHashLen);
     mHashInterface[Index].HashFinal (HashCtx[Index], &Digest);
     Tpm2SetHashToDigestList (DigestList, &Digest);
   }
@@ -1,7 +1,7 @@
 /** @file
   This is THE shell (application)
 
-  Copyright (c) 2009 - 2015, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
   (C) Copyright 2013-2014 Hewlett-Packard Development Company, L.P.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
@@ -15,6 +15,17 @@
 
 #include "Shell.h"
 
+//
+// Period of the timer used to time scripts in debug builds (10ms)
+//
+#define SCRIPT_TIMER_TICK 100000
+
+//
+// Upper bound on re-expanding %var% references that appear inside the values
+// of other environment variables, so self-referencing variables terminate.
+//
+#define MAX_VARIABLE_EXPANSION_PASSES 32
+
 //
 // Initialize the global structure
 //
@@ -418,6 +429,14 @@ UefiMain (
       }
     }
 
+    //
+    // load the environment variables and alias' into memory
+    //
+    Status = InitializeShellVariableStore();
+    if (EFI_ERROR(Status)) {
+      goto FreeResources;
+    }
+
     //
     // create and install the EfiShellParametersProtocol
     //
@@ -641,6 +660,8 @@ FreeResources:
     DEBUG_CODE(ShellInfoObject.NewEfiShellProtocol = NULL;);
   }
 
+  FreeShellVariableStore();
+
   if (!IsListEmpty(&ShellInfoObject.BufferToFreeList.Link)){
     FreeBufferList(&ShellInfoObject.BufferToFreeList);
   }
@@ -1393,15 +1414,117 @@ StripUnreplacedEnvironmentVariables(
   return (EFI_SUCCESS);
 }
 
+/**
+  Function allocates a new command line with every %name% pair that names an
+  existing environment variable replaced by the value of that variable.
+
+  Only the %...% pairs present on the command line are looked up. Values are
+  inserted verbatim, so references inside them are left for the next pass.
+
+  If the return value is not NULL the memory must be caller freed.
+
+  @param[in] OriginalCommandLine    The command line to expand.
+  @param[out] Replaced              Set to TRUE if at least one variable was replaced.
+
+  @retval NULL                      An error occurred.
+  @return                           The command line after one expansion pass.
+**/
+STATIC
+CHAR16*
+ExpandEnvironmentVariablesOnce (
+  IN CONST CHAR16 *OriginalCommandLine,
+  OUT BOOLEAN     *Replaced
+  )
+{
+  CONST CHAR16        *Segment;
+  CONST CHAR16        *FirstPercent;
+  CONST CHAR16        *SecondPercent;
+  CONST CHAR16        *Value;
+  CHAR16              *Name;
+  CHAR16              *Expanded;
+  UINTN               ExpandedSize;
+
+  Expanded      = NULL;
+  ExpandedSize  = 0;
+  *Replaced     = FALSE;
+
+  Segment = OriginalCommandLine;
+  for (FirstPercent = StrStr(OriginalCommandLine, L"%")
+    ;  FirstPercent != NULL
+    ;  FirstPercent = StrStr(FirstPercent, L"%")
+   ){
+    SecondPercent = StrStr(FirstPercent + 1, L"%");
+    if (SecondPercent == NULL) {
+      break;
+    }
+
+    //
+    // we need a following % and no ^ preceding
+    //
+    Value = NULL;
+    if (SecondPercent > FirstPercent + 1
+      && (FirstPercent == OriginalCommandLine || *(FirstPercent - 1) != L'^')
+     ){
+      Name = NULL;
+      Name = StrnCatGrow(&Name, NULL, FirstPercent + 1, SecondPercent - FirstPercent - 1);
+      if (Name == NULL) {
+        SHELL_FREE_NON_NULL(Expanded);
+        return (NULL);
+      }
+      Value = EfiShellGetEnv(Name);
+      FreePool(Name);
+    }
+    if (Value == NULL) {
+      FirstPercent++;
+      continue;
+    }
+
+    if (FirstPercent > Segment) {
+      Expanded = StrnCatGrow(&Expanded, &ExpandedSize, Segment, FirstPercent - Segment);
+      if (Expanded == NULL) {
+        return (NULL);
+      }
+    }
+    if (*Value != CHAR_NULL) {
+      Expanded = StrnCatGrow(&Expanded, &ExpandedSize, Value, 0);
+      if (Expanded == NULL) {
+        return (NULL);
+      }
+    }
+    *Replaced     = TRUE;
+    Segment       = SecondPercent + 1;
+    FirstPercent  = Segment;
+  }
+  if (Expanded == NULL) {
+    //
+    // Nothing was copied yet (or every value was empty); StrnCatGrow does not
+    // allocate for an empty string, so copy the remainder directly.
+    //
+    return (AllocateCopyPool(StrSize(Segment), Segment));
+  }
+  if (*Segment != CHAR_NULL) {
+    Expanded = StrnCatGrow(&Expanded, &ExpandedSize, Segment, 0);
+  }
+
+  return (Expanded);
+}
+
 /**
   Function allocates a new command line and replaces all instances of environment
   variable names that are correctly preset to their values.
 
+  Values that themselves contain %name% references are expanded again, until a
+  pass replaces nothing or MAX_VARIABLE_EXPANSION_PASSES passes have been made.
+  A value that references itself more than once doubles the command line on
+  every pass, so the expansion fails once it grows past PcdShellPrintBufferSize
+  bytes.
+
   If the return value is not NULL the memory must be caller freed.
 
   @param[in] OriginalCommandLine    The original command line
 
-  @retval NULL                      An error occurred.
+  @retval NULL                      An error occurred, or the expanded command
+                                    line is longer than PcdShellPrintBufferSize.
   @return                           The new command line with no environment variables present.
 **/
 CHAR16*
@@ -1410,99 +1533,77 @@ ShellConvertVariables (
   IN CONST CHAR16 *OriginalCommandLine
   )
 {
-  CONST CHAR16        *MasterEnvList;
+  CHAR16              *Expanded;
+  CHAR16              *Previous;
+  BOOLEAN             Replaced;
+  UINTN               Pass;
   UINTN               NewSize;
   CHAR16              *NewCommandLine1;
   CHAR16              *NewCommandLine2;
   CHAR16              *Temp;
-  UINTN               ItemSize;
-  CHAR16              *ItemTemp;
   SCRIPT_FILE         *CurrentScriptFile;
   ALIAS_LIST          *AliasListNode;
 
   ASSERT(OriginalCommandLine != NULL);
 
-  ItemSize          = 0;
-  NewSize           = StrSize(OriginalCommandLine);
   CurrentScriptFile = ShellCommandGetCurrentScriptFile();
-  Temp              = NULL;
 
   ///@todo update this to handle the %0 - %9 for scripting only (borrow from line 1256 area) ? ? ?
 
+  Expanded = ExpandEnvironmentVariablesOnce(OriginalCommandLine, &Replaced);
+  for (Pass = 1; Expanded != NULL && Replaced; Pass++) {
+    if (StrSize(Expanded) > PcdGet16(PcdShellPrintBufferSize)) {
+      FreePool(Expanded);
+      return (NULL);
+    }
+    if (Pass == MAX_VARIABLE_EXPANSION_PASSES) {
+      break;
+    }
+    Previous = Expanded;
+    Expanded = ExpandEnvironmentVariablesOnce(Previous, &Replaced);
+    FreePool(Previous);
+  }
+  if (Expanded == NULL) {
+    return (NULL);
+  }
+
   //
   // calculate the size required for the post-conversion string...
   //
+  NewSize = StrSize(Expanded);
   if (CurrentScriptFile != NULL) {
     for (AliasListNode = (ALIAS_LIST*)GetFirstNode(&CurrentScriptFile->SubstList)
       ;  !IsNull(&CurrentScriptFile->SubstList, &AliasListNode->Link)
       ;  AliasListNode = (ALIAS_LIST*)GetNextNode(&CurrentScriptFile->SubstList, &AliasListNode->Link)
    ){
-      for (Temp = StrStr(OriginalCommandLine, AliasListNode->Alias)
+      for (Temp = StrStr(Expanded, AliasListNode->Alias)
         ;  Temp != NULL
         ;  Temp = StrStr(Temp+1, AliasListNode->Alias)
        ){
         //
         // we need a preceding and if there is space no ^ preceding (if no space ignore)
         //
-        if ((((Temp-OriginalCommandLine)>2) && *(Temp-2) != L'^') || ((Temp-OriginalCommandLine)<=2)) {
+        if ((((Temp-Expanded)>2) && *(Temp-2) != L'^') || ((Temp-Expanded)<=2)) {
           NewSize += StrSize(AliasListNode->CommandString);
         }
       }
     }
   }
 
-  for (MasterEnvList = EfiShellGetEnv(NULL)
-    ;  MasterEnvList != NULL && *MasterEnvList != CHAR_NULL //&& *(MasterEnvList+1) != CHAR_NULL
-    ;  MasterEnvList += StrLen(MasterEnvList) + 1
-   ){
-    if (StrSize(MasterEnvList) > ItemSize) {
-      ItemSize = StrSize(MasterEnvList);
-    }
-    for (Temp = StrStr(OriginalCommandLine, MasterEnvList)
-      ;  Temp != NULL
-      ;  Temp = StrStr(Temp+1, MasterEnvList)
-     ){
-      //
-      // we need a preceding and following % and if there is space no ^ preceding (if no space ignore)
-      //
-      if (*(Temp-1) == L'%' && *(Temp+StrLen(MasterEnvList)) == L'%' &&
-        ((((Temp-OriginalCommandLine)>2) && *(Temp-2) != L'^') || ((Temp-OriginalCommandLine)<=2))) {
-        NewSize+=StrSize(EfiShellGetEnv(MasterEnvList));
-      }
-    }
-  }
-
   //
   // now do the replacements...
   //
-  NewCommandLine1 = AllocateCopyPool(NewSize, OriginalCommandLine);
+  NewCommandLine1 = AllocateZeroPool(NewSize);
   NewCommandLine2 = AllocateZeroPool(NewSize);
-  ItemTemp        = AllocateZeroPool(ItemSize+(2*sizeof(CHAR16)));
-  if (NewCommandLine1 == NULL || NewCommandLine2 == NULL || ItemTemp == NULL) {
+  if (NewCommandLine1 == NULL || NewCommandLine2 == NULL) {
     SHELL_FREE_NON_NULL(NewCommandLine1);
     SHELL_FREE_NON_NULL(NewCommandLine2);
-    SHELL_FREE_NON_NULL(ItemTemp);
+    FreePool(Expanded);
     return (NULL);
   }
-  for (MasterEnvList = EfiShellGetEnv(NULL)
-    ;  MasterEnvList != NULL && *MasterEnvList != CHAR_NULL
-    ;  MasterEnvList += StrLen(MasterEnvList) + 1
-   ){
-    StrCpyS( ItemTemp, 
-              ((ItemSize+(2*sizeof(CHAR16)))/sizeof(CHAR16)), 
-              L"%"
-              );
-    StrCatS( ItemTemp, 
-              ((ItemSize+(2*sizeof(CHAR16)))/sizeof(CHAR16)), 
-              MasterEnvList
-              );
-    StrCatS( ItemTemp, 
-              ((ItemSize+(2*sizeof(CHAR16)))/sizeof(CHAR16)), 
-              L"%"
-              );
-    ShellCopySearchAndReplace(NewCommandLine1, NewCommandLine2, NewSize, ItemTemp, EfiShellGetEnv(MasterEnvList), TRUE, FALSE);
-    StrCpyS(NewCommandLine1, NewSize/sizeof(CHAR16), NewCommandLine2);
-  }
+  StrCpyS(NewCommandLine1, NewSize/sizeof(CHAR16), Expanded);
+  FreePool(Expanded);
+
   if (CurrentScriptFile != NULL) {
     for (AliasListNode = (ALIAS_LIST*)GetFirstNode(&CurrentScriptFile->SubstList)
       ;  !IsNull(&CurrentScriptFile->SubstList, &AliasListNode->Link)
@@ -1525,7 +1626,6 @@ ShellConvertVariables (
   StrCpyS(NewCommandLine1, NewSize/sizeof(CHAR16), NewCommandLine2);
   
   FreePool(NewCommandLine2);
-  FreePool(ItemTemp);
 
   return (NewCommandLine1);
 }
@@ -1647,7 +1747,8 @@ RunSplitCommand(
   @param[in] CmdLine  pointer to the command line to update.
 
   @retval EFI_SUCCESS           the function was successful.
-  @retval EFI_OUT_OF_RESOURCES  a memory allocation failed.
+  @retval EFI_OUT_OF_RESOURCES  a memory allocation failed, or the expanded
+                                command line is longer than PcdShellPrintBufferSize.
 **/
 EFI_STATUS
 EFIAPI
@@ -2546,6 +2647,52 @@ IsValidCommandName(
   return (TRUE);
 }
 
+/**
+  Return the first token of a script line.
+
+  This is the part of the line that goto, for and if compare against as they
+  move through the script, so it is split out once when the script is loaded
+  rather than every time a block is searched.
+
+  @param[in] CommandLine    The script line.
+
+  @return                   The allocated token, or NULL if the allocation failed.
+**/
+CHAR16*
+EFIAPI
+GetScriptLineName (
+  IN CONST CHAR16 *CommandLine
+  )
+{
+  CONST CHAR16  *End;
+
+  //
+  // Skip leading spaces and tabs.
+  //
+  while ((CommandLine[0] == L' ') || (CommandLine[0] == L'\t')) {
+    CommandLine++;
+  }
+  for (End = CommandLine ; *End != CHAR_NULL && *End != L' ' ; End++);
+
+  return (AllocateCopyPool((End - CommandLine + 1) * sizeof(CHAR16), CommandLine));
+}
+
+/**
+  Notification function for the script timing event.
+
+  @param[in] Event      The timer event.
+  @param[in] Context    Pointer to the tick count to increment.
+**/
+VOID
+EFIAPI
+ScriptTimerTick (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  (*(UINT64 *)Context)++;
+}
+
 /**
   Function to process a NSH script file via SHELL_FILE_HANDLE.
 
@@ -2574,6 +2721,9 @@ RunScriptFileHandle (
   BOOLEAN             PreCommandEchoState;
   CONST CHAR16        *CurDir;
   UINTN               LineCount;
+  UINT64              LinesRun;
+  UINT64              Ticks;
+  EFI_EVENT           Timer;
   CHAR16              LeString[50];
 
   ASSERT(!ShellCommandGetScriptExit());
@@ -2640,6 +2790,7 @@ RunScriptFileHandle (
     }
 
     NewScriptFile->CurrentCommand->Cl   = CommandLine;
+    NewScriptFile->CurrentCommand->Name = GetScriptLineName(CommandLine);
     NewScriptFile->CurrentCommand->Data = NULL;
     NewScriptFile->CurrentCommand->Line = LineCount;
 
@@ -2666,6 +2817,20 @@ RunScriptFileHandle (
     return (EFI_OUT_OF_RESOURCES);
   }
 
+  //
+  // Time the script in debug builds
+  //
+  LinesRun  = 0;
+  Ticks     = 0;
+  Timer     = NULL;
+  DEBUG_CODE_BEGIN ();
+  if (EFI_ERROR (gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, ScriptTimerTick, &Ticks, &Timer))) {
+    Timer = NULL;
+  } else {
+    gBS->SetTimer (Timer, TimerPeriodic, SCRIPT_TIMER_TICK);
+  }
+  DEBUG_CODE_END ();
+
   for ( NewScriptFile->CurrentCommand = (SCRIPT_COMMAND_LIST *)GetFirstNode(&NewScriptFile->CommandList)
       ; !IsNull(&NewScriptFile->CommandList, &NewScriptFile->CurrentCommand->Link)
       ; // conditional increment in the body of the loop
@@ -2694,71 +2859,77 @@ RunScriptFileHandle (
 
     if (CommandLine2 != NULL && StrLen(CommandLine2) >= 1) {
       //
-      // Due to variability in starting the find and replace action we need to have both buffers the same.
+      // Lines without a % have no parameters to replace.
       //
-      StrnCpyS( CommandLine, 
-                PrintBuffSize/sizeof(CHAR16), 
-                CommandLine2,
-                PrintBuffSize/sizeof(CHAR16) - 1
-                );
+      if (StrStr(CommandLine2, L"%") != NULL) {
+        //
+        // Due to variability in starting the find and replace action we need to have both buffers the same.
+        //
+        StrnCpyS( CommandLine, 
+                  PrintBuffSize/sizeof(CHAR16), 
+                  CommandLine2,
+                  PrintBuffSize/sizeof(CHAR16) - 1
+                  );
 
-      //
-      // Remove the %0 to %9 from the command line (if we have some arguments)
-      //
-      if (NewScriptFile->Argv != NULL) {
-        switch (NewScriptFile->Argc) {
-          default:
-            Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%9", NewScriptFile->Argv[9], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-          case 9:
-            Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%8", NewScriptFile->Argv[8], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-          case 8:
-            Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%7", NewScriptFile->Argv[7], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-          case 7:
-            Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%6", NewScriptFile->Argv[6], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-          case 6:
-            Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%5", NewScriptFile->Argv[5], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-          case 5:
-            Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%4", NewScriptFile->Argv[4], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-          case 4:
-            Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%3", NewScriptFile->Argv[3], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-          case 3:
-            Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%2", NewScriptFile->Argv[2], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-          case 2:
-            Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%1", NewScriptFile->Argv[1], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-          case 1:
-            Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%0", NewScriptFile->Argv[0], FALSE, TRUE);
-            ASSERT_EFI_ERROR(Status);
-            break;
-          case 0:
-            break;
+        //
+        // Remove the %0 to %9 from the command line (if we have some arguments)
+        //
+        if (NewScriptFile->Argv != NULL) {
+          switch (NewScriptFile->Argc) {
+            default:
+              Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%9", NewScriptFile->Argv[9], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+            case 9:
+              Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%8", NewScriptFile->Argv[8], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+            case 8:
+              Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%7", NewScriptFile->Argv[7], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+            case 7:
+              Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%6", NewScriptFile->Argv[6], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+            case 6:
+              Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%5", NewScriptFile->Argv[5], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+            case 5:
+              Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%4", NewScriptFile->Argv[4], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+            case 4:
+              Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%3", NewScriptFile->Argv[3], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+            case 3:
+              Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%2", NewScriptFile->Argv[2], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+            case 2:
+              Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%1", NewScriptFile->Argv[1], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+            case 1:
+              Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%0", NewScriptFile->Argv[0], FALSE, TRUE);
+              ASSERT_EFI_ERROR(Status);
+              break;
+            case 0:
+              break;
+          }
         }
+        Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%1", L"\"\"", FALSE, FALSE);
+        Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%2", L"\"\"", FALSE, FALSE);
+        Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%3", L"\"\"", FALSE, FALSE);
+        Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%4", L"\"\"", FALSE, FALSE);
+        Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%5", L"\"\"", FALSE, FALSE);
+        Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%6", L"\"\"", FALSE, FALSE);
+        Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%7", L"\"\"", FALSE, FALSE);
+        Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%8", L"\"\"", FALSE, FALSE);
+        Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%9", L"\"\"", FALSE, FALSE);
+
+        StrnCpyS( CommandLine2, 
+                  PrintBuffSize/sizeof(CHAR16), 
+                  CommandLine,
+                  PrintBuffSize/sizeof(CHAR16) - 1
+                  );
       }
-      Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%1", L"\"\"", FALSE, FALSE);
-      Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%2", L"\"\"", FALSE, FALSE);
-      Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%3", L"\"\"", FALSE, FALSE);
-      Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%4", L"\"\"", FALSE, FALSE);
-      Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%5", L"\"\"", FALSE, FALSE);
-      Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%6", L"\"\"", FALSE, FALSE);
-      Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%7", L"\"\"", FALSE, FALSE);
-      Status = ShellCopySearchAndReplace(CommandLine,  CommandLine2, PrintBuffSize, L"%8", L"\"\"", FALSE, FALSE);
-      Status = ShellCopySearchAndReplace(CommandLine2,  CommandLine, PrintBuffSize, L"%9", L"\"\"", FALSE, FALSE);
-
-      StrnCpyS( CommandLine2, 
-                PrintBuffSize/sizeof(CHAR16), 
-                CommandLine,
-                PrintBuffSize/sizeof(CHAR16) - 1
-                );
 
       LastCommand = NewScriptFile->CurrentCommand;
+      LinesRun++;
 
       for (CommandLine3 = CommandLine2 ; CommandLine3[0] == L' ' ; CommandLine3++);
 
@@ -2841,6 +3012,11 @@ RunScriptFileHandle (
   }
 
 
+  if (Timer != NULL) {
+    gBS->CloseEvent (Timer);
+    DEBUG ((DEBUG_INFO, "%S: %Ld lines in %Ld ms\n", Name, LinesRun, MultU64x32 (Ticks, SCRIPT_TIMER_TICK / 10000)));
+  }
+
   FreePool(CommandLine);
   FreePool(CommandLine2);
   ShellCommandSetNewScript (NULL);
@@ -1,7 +1,7 @@
 /** @file
   function declarations for shell environment functions.
 
-  Copyright (c) 2009 - 2015, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -15,7 +15,647 @@
 #include "Shell.h"
 
 #define INIT_NAME_BUFFER_SIZE  128
-#define INIT_DATA_BUFFER_SIZE  1024
+
+#define SHELL_VARIABLE_BUCKET_COUNT 64
+
+typedef struct {
+  LIST_ENTRY  Link;       ///< Link in the hash bucket.
+  CHAR16      *Name;      ///< The variable name.
+  VOID        *Data;      ///< The variable data.
+  UINTN       DataSize;   ///< The size in bytes of Data.
+  UINT32      Atts;       ///< The variable attributes.
+} SHELL_VARIABLE;
+
+typedef struct {
+  CONST EFI_GUID  *Guid;                                  ///< The GUID the variables are stored under.
+  LIST_ENTRY      Buckets[SHELL_VARIABLE_BUCKET_COUNT];   ///< Hash buckets of SHELL_VARIABLE objects.
+} SHELL_VARIABLE_STORE;
+
+BOOLEAN               mShellVariableStoreReady = FALSE;
+SHELL_VARIABLE_STORE  mShellEnvStore;
+SHELL_VARIABLE_STORE  mShellAliasStore;
+
+/**
+  Find the store for a GUID.
+
+  @param[in] Guid       The GUID of the variable.
+
+  @return               The store, or NULL if the GUID is not a shell GUID.
+**/
+SHELL_VARIABLE_STORE*
+GetShellVariableStore (
+  IN CONST EFI_GUID *Guid
+  )
+{
+  if (CompareGuid(Guid, &gShellVariableGuid)) {
+    return (&mShellEnvStore);
+  }
+  if (CompareGuid(Guid, &gShellAliasGuid)) {
+    return (&mShellAliasStore);
+  }
+  return (NULL);
+}
+
+/**
+  Hash a variable name to its bucket.
+
+  @param[in] Name       The variable name.
+
+  @return               The bucket index.
+**/
+UINTN
+HashShellVariableName (
+  IN CONST CHAR16 *Name
+  )
+{
+  UINTN Hash;
+
+  for (Hash = 0 ; *Name != CHAR_NULL ; Name++) {
+    Hash = (Hash * 31) + *Name;
+  }
+  return (Hash % SHELL_VARIABLE_BUCKET_COUNT);
+}
+
+/**
+  Find a variable in a store.
+
+  @param[in] Store      The store to search.
+  @param[in] Name       The variable name.
+
+  @return               The variable, or NULL if it is not in the store.
+**/
+SHELL_VARIABLE*
+FindShellVariable (
+  IN SHELL_VARIABLE_STORE *Store,
+  IN CONST CHAR16         *Name
+  )
+{
+  LIST_ENTRY      *Bucket;
+  SHELL_VARIABLE  *Variable;
+
+  Bucket = &Store->Buckets[HashShellVariableName(Name)];
+  for ( Variable = (SHELL_VARIABLE*)GetFirstNode(Bucket)
+      ; !IsNull(Bucket, &Variable->Link)
+      ; Variable = (SHELL_VARIABLE*)GetNextNode(Bucket, &Variable->Link)
+     ){
+    if (StrCmp(Variable->Name, Name) == 0) {
+      return (Variable);
+    }
+  }
+  return (NULL);
+}
+
+/**
+  Free a variable that has been removed from its store.
+
+  @param[in] Variable   The variable to free.
+**/
+VOID
+FreeShellVariable (
+  IN SHELL_VARIABLE *Variable
+  )
+{
+  SHELL_FREE_NON_NULL(Variable->Name);
+  SHELL_FREE_NON_NULL(Variable->Data);
+  FreePool(Variable);
+}
+
+/**
+  Add a new variable to a store.  The variable must not already be in the store.
+
+  @param[in] Store      The store to add to.
+  @param[in] Name       The variable name.
+  @param[in] Attributes The variable attributes.
+  @param[in] DataSize   The size in bytes of Data.
+  @param[in] Data       The variable data.
+
+  @retval EFI_SUCCESS           The variable was added.
+  @retval EFI_OUT_OF_RESOURCES  A memory allocation failed.
+**/
+EFI_STATUS
+AddShellVariable (
+  IN SHELL_VARIABLE_STORE *Store,
+  IN CONST CHAR16         *Name,
+  IN UINT32               Attributes,
+  IN UINTN                DataSize,
+  IN CONST VOID           *Data
+  )
+{
+  SHELL_VARIABLE  *Variable;
+
+  Variable = AllocateZeroPool(sizeof(SHELL_VARIABLE));
+  if (Variable == NULL) {
+    return (EFI_OUT_OF_RESOURCES);
+  }
+  Variable->Name      = AllocateCopyPool(StrSize(Name), Name);
+  Variable->Data      = AllocateCopyPool(DataSize, Data);
+  Variable->DataSize  = DataSize;
+  Variable->Atts      = Attributes;
+  if (Variable->Name == NULL || Variable->Data == NULL) {
+    FreeShellVariable(Variable);
+    return (EFI_OUT_OF_RESOURCES);
+  }
+  InsertTailList(&Store->Buckets[HashShellVariableName(Name)], &Variable->Link);
+  return (EFI_SUCCESS);
+}
+
+/**
+  Remove and free every variable in a store.
+
+  @param[in] Store      The store to empty.
+**/
+VOID
+EmptyShellVariableStore (
+  IN SHELL_VARIABLE_STORE *Store
+  )
+{
+  UINTN           Index;
+  SHELL_VARIABLE  *Variable;
+
+  for (Index = 0 ; Index < SHELL_VARIABLE_BUCKET_COUNT ; Index++) {
+    while (!IsListEmpty(&Store->Buckets[Index])) {
+      Variable = (SHELL_VARIABLE*)GetFirstNode(&Store->Buckets[Index]);
+      RemoveEntryList(&Variable->Link);
+      FreeShellVariable(Variable);
+    }
+  }
+}
+
+/**
+  Initialize an empty store.
+
+  @param[in] Store      The store to initialize.
+  @param[in] Guid       The GUID the variables in the store are kept under.
+**/
+VOID
+InitializeShellVariableStoreBuckets (
+  IN SHELL_VARIABLE_STORE *Store,
+  IN CONST EFI_GUID       *Guid
+  )
+{
+  UINTN Index;
+
+  Store->Guid = Guid;
+  for (Index = 0 ; Index < SHELL_VARIABLE_BUCKET_COUNT ; Index++) {
+    InitializeListHead(&Store->Buckets[Index]);
+  }
+}
+
+/**
+  Move every variable from one store to another, empty, store.
+
+  @param[in, out] Destination   The empty store to move the variables to.
+  @param[in, out] Source        The store to move the variables from.
+**/
+VOID
+MoveShellVariableStore (
+  IN OUT SHELL_VARIABLE_STORE *Destination,
+  IN OUT SHELL_VARIABLE_STORE *Source
+  )
+{
+  UINTN       Index;
+  LIST_ENTRY  *Link;
+
+  for (Index = 0 ; Index < SHELL_VARIABLE_BUCKET_COUNT ; Index++) {
+    while (!IsListEmpty(&Source->Buckets[Index])) {
+      Link = GetFirstNode(&Source->Buckets[Index]);
+      RemoveEntryList(Link);
+      InsertTailList(&Destination->Buckets[Index], Link);
+    }
+  }
+}
+
+/**
+  Read all UEFI variables under the shell variable and shell alias GUIDs into
+  two stores, using a single walk of the variable name space.
+
+  @param[in] EnvStore           The store for gShellVariableGuid variables.
+  @param[in] AliasStore         The store for gShellAliasGuid variables.
+
+  @retval EFI_SUCCESS           The variables were read.
+  @retval EFI_OUT_OF_RESOURCES  A memory allocation failed.
+**/
+EFI_STATUS
+LoadShellVariables (
+  IN SHELL_VARIABLE_STORE *EnvStore,
+  IN SHELL_VARIABLE_STORE *AliasStore
+  )
+{
+  EFI_STATUS            Status;
+  CHAR16                *VariableName;
+  CHAR16                *NewName;
+  UINTN                 NameSize;
+  UINTN                 NameBufferSize;
+  EFI_GUID              Guid;
+  VOID                  *Data;
+  UINTN                 DataSize;
+  UINT32                Attributes;
+  SHELL_VARIABLE_STORE  *Store;
+
+  NameBufferSize = INIT_NAME_BUFFER_SIZE;
+  VariableName = AllocateZeroPool(NameBufferSize);
+  if (VariableName == NULL) {
+    return (EFI_OUT_OF_RESOURCES);
+  }
+
+  Status = EFI_SUCCESS;
+  while (!EFI_ERROR(Status)) {
+    NameSize = NameBufferSize;
+    Status = gRT->GetNextVariableName(&NameSize, VariableName, &Guid);
+    if (Status == EFI_NOT_FOUND) {
+      Status = EFI_SUCCESS;
+      break;
+    } else if (Status == EFI_BUFFER_TOO_SMALL) {
+      //
+      // Grow the buffer, keeping the current name so the walk continues from it.
+      //
+      NewName = AllocateZeroPool(NameSize);
+      if (NewName == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        break;
+      }
+      CopyMem(NewName, VariableName, NameBufferSize);
+      FreePool(VariableName);
+      VariableName    = NewName;
+      NameBufferSize  = NameSize;
+      Status = gRT->GetNextVariableName(&NameSize, VariableName, &Guid);
+    }
+    if (EFI_ERROR(Status)) {
+      break;
+    }
+
+    if (CompareGuid(&Guid, EnvStore->Guid)) {
+      Store = EnvStore;
+    } else if (CompareGuid(&Guid, AliasStore->Guid)) {
+      Store = AliasStore;
+    } else {
+      continue;
+    }
+
+    DataSize  = 0;
+    Data      = NULL;
+    Status = gRT->GetVariable(VariableName, &Guid, &Attributes, &DataSize, Data);
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      Data = AllocateZeroPool(DataSize);
+      if (Data == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        break;
+      }
+      Status = gRT->GetVariable(VariableName, &Guid, &Attributes, &DataSize, Data);
+    }
+    if (!EFI_ERROR(Status)) {
+      Status = AddShellVariable(Store, VariableName, Attributes, DataSize, Data);
+    } else {
+      //
+      // Skip a variable that cannot be read rather than fail the whole load.
+      //
+      Status = EFI_SUCCESS;
+    }
+    SHELL_FREE_NON_NULL(Data);
+  }
+  FreePool(VariableName);
+
+  return (Status);
+}
+
+/**
+  Load the shell environment variables and alias' into memory.
+
+  All variables under the shell variable and shell alias GUIDs are read once.
+  After this call the SHELL_*_ENVIRONMENT_VARIABLE macros, IsVolatileEnv and the
+  alias functions read from memory.  Every change is still written through to
+  UEFI variables, volatile ones included, so other images and nested shells see
+  the same variables as before.
+
+  @retval EFI_SUCCESS           The store was loaded.
+  @retval EFI_OUT_OF_RESOURCES  A memory allocation failed.
+**/
+EFI_STATUS
+EFIAPI
+InitializeShellVariableStore (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  ASSERT(!mShellVariableStoreReady);
+
+  InitializeShellVariableStoreBuckets(&mShellEnvStore, &gShellVariableGuid);
+  InitializeShellVariableStoreBuckets(&mShellAliasStore, &gShellAliasGuid);
+
+  Status = LoadShellVariables(&mShellEnvStore, &mShellAliasStore);
+  if (EFI_ERROR(Status)) {
+    EmptyShellVariableStore(&mShellEnvStore);
+    EmptyShellVariableStore(&mShellAliasStore);
+    return (Status);
+  }
+
+  mShellVariableStoreReady = TRUE;
+  return (EFI_SUCCESS);
+}
+
+/**
+  Re-read the shell environment variables and alias' from UEFI variables.
+
+  This is used after another image has run, since it may have changed them,
+  either directly or as a nested shell.  If the variables cannot be read the
+  current contents of the store are kept.
+
+  @retval EFI_SUCCESS           The store was reloaded.
+  @retval EFI_NOT_READY         InitializeShellVariableStore has not succeeded.
+  @retval EFI_OUT_OF_RESOURCES  A memory allocation failed.
+**/
+EFI_STATUS
+EFIAPI
+ReloadShellVariableStore (
+  VOID
+  )
+{
+  EFI_STATUS            Status;
+  SHELL_VARIABLE_STORE  EnvStore;
+  SHELL_VARIABLE_STORE  AliasStore;
+
+  if (!mShellVariableStoreReady) {
+    return (EFI_NOT_READY);
+  }
+
+  InitializeShellVariableStoreBuckets(&EnvStore, &gShellVariableGuid);
+  InitializeShellVariableStoreBuckets(&AliasStore, &gShellAliasGuid);
+
+  Status = LoadShellVariables(&EnvStore, &AliasStore);
+  if (EFI_ERROR(Status)) {
+    EmptyShellVariableStore(&EnvStore);
+    EmptyShellVariableStore(&AliasStore);
+    return (Status);
+  }
+
+  EmptyShellVariableStore(&mShellEnvStore);
+  EmptyShellVariableStore(&mShellAliasStore);
+  MoveShellVariableStore(&mShellEnvStore, &EnvStore);
+  MoveShellVariableStore(&mShellAliasStore, &AliasStore);
+  return (EFI_SUCCESS);
+}
+
+/**
+  Free the in-memory shell environment variables and alias'.
+
+  Every change has already been written through to UEFI variables, so nothing
+  is lost.
+**/
+VOID
+EFIAPI
+FreeShellVariableStore (
+  VOID
+  )
+{
+  if (!mShellVariableStoreReady) {
+    return;
+  }
+  mShellVariableStoreReady = FALSE;
+  EmptyShellVariableStore(&mShellEnvStore);
+  EmptyShellVariableStore(&mShellAliasStore);
+}
+
+/**
+  Get a shell environment variable or alias.
+
+  This has the same behavior as the Runtime Services call GetVariable, but reads
+  from the in-memory store.
+
+  @param[in] VariableName       The name of the variable.
+  @param[in] VendorGuid         gShellVariableGuid or gShellAliasGuid.
+  @param[out] Attributes        If not NULL, the attributes of the variable.
+  @param[in, out] DataSize      On input the size in bytes of Data.  On output
+                                the size of the variable data.
+  @param[out] Data              The buffer to receive the variable data.
+
+  @retval EFI_SUCCESS           The variable was found.
+  @retval EFI_NOT_FOUND         The variable was not found.
+  @retval EFI_BUFFER_TOO_SMALL  DataSize is too small.  It was updated with the
+                                size needed.
+  @retval EFI_INVALID_PARAMETER A parameter was invalid.
+  @retval EFI_NOT_READY         InitializeShellVariableStore has not succeeded.
+**/
+EFI_STATUS
+EFIAPI
+GetShellVariable (
+  IN CONST CHAR16     *VariableName,
+  IN CONST EFI_GUID   *VendorGuid,
+  OUT UINT32          *Attributes OPTIONAL,
+  IN OUT UINTN        *DataSize,
+  OUT VOID            *Data OPTIONAL
+  )
+{
+  SHELL_VARIABLE_STORE  *Store;
+  SHELL_VARIABLE        *Variable;
+
+  if (VariableName == NULL || VendorGuid == NULL || DataSize == NULL) {
+    return (EFI_INVALID_PARAMETER);
+  }
+  Store = GetShellVariableStore(VendorGuid);
+  if (Store == NULL) {
+    return (EFI_INVALID_PARAMETER);
+  }
+  if (!mShellVariableStoreReady) {
+    return (EFI_NOT_READY);
+  }
+
+  Variable = FindShellVariable(Store, VariableName);
+  if (Variable == NULL) {
+    return (EFI_NOT_FOUND);
+  }
+  if (Attributes != NULL) {
+    *Attributes = Variable->Atts;
+  }
+  if (*DataSize < Variable->DataSize) {
+    *DataSize = Variable->DataSize;
+    return (EFI_BUFFER_TOO_SMALL);
+  }
+  if (Data == NULL) {
+    return (EFI_INVALID_PARAMETER);
+  }
+  CopyMem(Data, Variable->Data, Variable->DataSize);
+  *DataSize = Variable->DataSize;
+  return (EFI_SUCCESS);
+}
+
+/**
+  Set or delete a shell environment variable or alias.
+
+  This has the same behavior as the Runtime Services call SetVariable.  The
+  in-memory store is updated and the change is written through to UEFI variable
+  storage, for volatile and non-volatile variables alike.
+
+  @param[in] VariableName       The name of the variable.
+  @param[in] VendorGuid         gShellVariableGuid or gShellAliasGuid.
+  @param[in] Attributes         The attributes of the variable.  0 deletes it.
+  @param[in] DataSize           The size in bytes of Data.  0 deletes the variable.
+  @param[in] Data               The variable data.
+
+  @retval EFI_SUCCESS           The variable was set or deleted.
+  @retval EFI_NOT_FOUND         The variable to delete was not found.
+  @retval EFI_INVALID_PARAMETER The variable exists with different attributes,
+                                or a parameter was invalid.
+  @retval EFI_OUT_OF_RESOURCES  A memory allocation failed.
+  @retval EFI_NOT_READY         InitializeShellVariableStore has not succeeded.
+  @return                       The error from writing the UEFI variable.
+**/
+EFI_STATUS
+EFIAPI
+SetShellVariable (
+  IN CONST CHAR16     *VariableName,
+  IN CONST EFI_GUID   *VendorGuid,
+  IN UINT32           Attributes,
+  IN UINTN            DataSize,
+  IN CONST VOID       *Data
+  )
+{
+  EFI_STATUS            Status;
+  SHELL_VARIABLE_STORE  *Store;
+  SHELL_VARIABLE        *Variable;
+  VOID                  *NewData;
+
+  if (VariableName == NULL || *VariableName == CHAR_NULL || VendorGuid == NULL) {
+    return (EFI_INVALID_PARAMETER);
+  }
+  Store = GetShellVariableStore(VendorGuid);
+  if (Store == NULL) {
+    return (EFI_INVALID_PARAMETER);
+  }
+  if (!mShellVariableStoreReady) {
+    return (EFI_NOT_READY);
+  }
+
+  Variable = FindShellVariable(Store, VariableName);
+
+  //
+  // Delete
+  //
+  if (DataSize == 0 || Attributes == 0) {
+    if (Variable == NULL) {
+      return (EFI_NOT_FOUND);
+    }
+    Status = gRT->SetVariable((CHAR16*)VariableName, (EFI_GUID*)VendorGuid, 0, 0, NULL);
+    if (EFI_ERROR(Status) && Status != EFI_NOT_FOUND) {
+      return (Status);
+    }
+    RemoveEntryList(&Variable->Link);
+    FreeShellVariable(Variable);
+    return (EFI_SUCCESS);
+  }
+
+  if (Data == NULL || (Variable != NULL && Variable->Atts != Attributes)) {
+    return (EFI_INVALID_PARAMETER);
+  }
+
+  //
+  // Add or replace
+  //
+  if (Variable == NULL) {
+    Status = AddShellVariable(Store, VariableName, Attributes, DataSize, Data);
+    if (EFI_ERROR(Status)) {
+      return (Status);
+    }
+    Status = gRT->SetVariable((CHAR16*)VariableName, (EFI_GUID*)VendorGuid, Attributes, DataSize, (VOID*)Data);
+    if (EFI_ERROR(Status)) {
+      Variable = FindShellVariable(Store, VariableName);
+      RemoveEntryList(&Variable->Link);
+      FreeShellVariable(Variable);
+    }
+    return (Status);
+  }
+
+  NewData = AllocateCopyPool(DataSize, Data);
+  if (NewData == NULL) {
+    return (EFI_OUT_OF_RESOURCES);
+  }
+  Status = gRT->SetVariable((CHAR16*)VariableName, (EFI_GUID*)VendorGuid, Attributes, DataSize, (VOID*)Data);
+  if (EFI_ERROR(Status)) {
+    FreePool(NewData);
+    return (Status);
+  }
+  FreePool(Variable->Data);
+  Variable->Data      = NewData;
+  Variable->DataSize  = DataSize;
+  return (EFI_SUCCESS);
+}
+
+/**
+  Enumerate the shell environment variables or alias'.
+
+  This has the same behavior as the Runtime Services call GetNextVariableName,
+  but only returns names under VendorGuid and reads from the in-memory store.
+
+  @param[in, out] VariableNameSize  On input the size in bytes of VariableName.
+                                    On output the size of the next name.
+  @param[in, out] VariableName      On input the previous name, or an empty string
+                                    to start.  On output the next name.
+  @param[in] VendorGuid             gShellVariableGuid or gShellAliasGuid.
+
+  @retval EFI_SUCCESS           The next name was returned.
+  @retval EFI_NOT_FOUND         There are no more names.
+  @retval EFI_BUFFER_TOO_SMALL  VariableNameSize is too small.  It was updated
+                                with the size needed.
+  @retval EFI_INVALID_PARAMETER VariableName is not in the store, or a parameter
+                                was invalid.
+  @retval EFI_NOT_READY         InitializeShellVariableStore has not succeeded.
+**/
+EFI_STATUS
+EFIAPI
+GetNextShellVariableName (
+  IN OUT UINTN          *VariableNameSize,
+  IN OUT CHAR16         *VariableName,
+  IN CONST EFI_GUID     *VendorGuid
+  )
+{
+  SHELL_VARIABLE_STORE  *Store;
+  SHELL_VARIABLE        *Variable;
+  LIST_ENTRY            *Link;
+  UINTN                 Index;
+
+  if (VariableNameSize == NULL || VariableName == NULL || VendorGuid == NULL) {
+    return (EFI_INVALID_PARAMETER);
+  }
+  Store = GetShellVariableStore(VendorGuid);
+  if (Store == NULL) {
+    return (EFI_INVALID_PARAMETER);
+  }
+  if (!mShellVariableStoreReady) {
+    return (EFI_NOT_READY);
+  }
+
+  //
+  // Find where to continue from
+  //
+  if (*VariableName == CHAR_NULL) {
+    Index = 0;
+    Link  = Store->Buckets[0].ForwardLink;
+  } else {
+    Variable = FindShellVariable(Store, VariableName);
+    if (Variable == NULL) {
+      return (EFI_INVALID_PARAMETER);
+    }
+    Index = HashShellVariableName(VariableName);
+    Link  = Variable->Link.ForwardLink;
+  }
+
+  while (Link == &Store->Buckets[Index]) {
+    Index++;
+    if (Index == SHELL_VARIABLE_BUCKET_COUNT) {
+      return (EFI_NOT_FOUND);
+    }
+    Link = Store->Buckets[Index].ForwardLink;
+  }
+
+  Variable = (SHELL_VARIABLE*)Link;
+  if (*VariableNameSize < StrSize(Variable->Name)) {
+    *VariableNameSize = StrSize(Variable->Name);
+    return (EFI_BUFFER_TOO_SMALL);
+  }
+  *VariableNameSize = StrSize(Variable->Name);
+  CopyMem(VariableName, Variable->Name, *VariableNameSize);
+  return (EFI_SUCCESS);
+}
 
 /**
   Reports whether an environment variable is Volatile or Non-Volatile.
@@ -31,44 +671,22 @@ IsVolatileEnv (
   IN CONST CHAR16 *EnvVarName
   )
 {
-  EFI_STATUS  Status;
-  UINTN       Size;
-  VOID        *Buffer;
-  UINT32      Attribs;
+  SHELL_VARIABLE  *Variable;
 
-  Size = 0;
-  Buffer = NULL;
+  ASSERT(mShellVariableStoreReady);
 
-  //
-  // get the variable
-  //
-  Status = gRT->GetVariable((CHAR16*)EnvVarName,
-                            &gShellVariableGuid,
-                            &Attribs,
-                            &Size,
-                            Buffer);
-  if (Status == EFI_BUFFER_TOO_SMALL) {
-    Buffer = AllocateZeroPool(Size);
-    ASSERT(Buffer != NULL);
-    Status = gRT->GetVariable((CHAR16*)EnvVarName,
-                              &gShellVariableGuid,
-                              &Attribs,
-                              &Size,
-                              Buffer);
-    FreePool(Buffer);
-  }
   //
   // not found means volatile
   //
-  if (Status == EFI_NOT_FOUND) {
+  Variable = FindShellVariable(&mShellEnvStore, EnvVarName);
+  if (Variable == NULL) {
     return (TRUE);
   }
-  ASSERT_EFI_ERROR(Status);
 
   //
   // check for the Non Volatile bit
   //
-  if ((Attribs & EFI_VARIABLE_NON_VOLATILE) == EFI_VARIABLE_NON_VOLATILE) {
+  if ((Variable->Atts & EFI_VARIABLE_NON_VOLATILE) == EFI_VARIABLE_NON_VOLATILE) {
     return (FALSE);
   }
 
@@ -126,96 +744,48 @@ GetEnvironmentVariableList(
   IN OUT LIST_ENTRY *ListHead
   )
 {
-  CHAR16            *VariableName;
-  UINTN             NameSize;
-  UINTN             NameBufferSize;
-  EFI_STATUS        Status;
-  EFI_GUID          Guid;
-  UINTN             ValSize;
-  UINTN             ValBufferSize;
+  UINTN             Index;
+  LIST_ENTRY        *Bucket;
+  SHELL_VARIABLE    *Variable;
   ENV_VAR_LIST      *VarList;
 
   if (ListHead == NULL) {
     return (EFI_INVALID_PARAMETER);
   }
-  
-  Status = EFI_SUCCESS;
-  
-  ValBufferSize = INIT_DATA_BUFFER_SIZE;
-  NameBufferSize = INIT_NAME_BUFFER_SIZE;
-  VariableName = AllocateZeroPool(NameBufferSize);
-  if (VariableName == NULL) {
-    return (EFI_OUT_OF_RESOURCES);
+  if (!mShellVariableStoreReady) {
+    return (EFI_NOT_READY);
   }
-  *VariableName = CHAR_NULL;
 
-  while (!EFI_ERROR(Status)) {
-    NameSize = NameBufferSize;
-    Status = gRT->GetNextVariableName(&NameSize, VariableName, &Guid);
-    if (Status == EFI_NOT_FOUND){
-      Status = EFI_SUCCESS;
-      break;
-    } else if (Status == EFI_BUFFER_TOO_SMALL) {
-      NameBufferSize = NameSize > NameBufferSize * 2 ? NameSize : NameBufferSize * 2;
-      SHELL_FREE_NON_NULL(VariableName);
-      VariableName = AllocateZeroPool(NameBufferSize);
-      if (VariableName == NULL) {
-        Status = EFI_OUT_OF_RESOURCES;
-        break;
-      }
-      NameSize = NameBufferSize;
-      Status = gRT->GetNextVariableName(&NameSize, VariableName, &Guid);
-    }
-    
-    if (!EFI_ERROR(Status) && CompareGuid(&Guid, &gShellVariableGuid)){
+  for (Index = 0 ; Index < SHELL_VARIABLE_BUCKET_COUNT ; Index++) {
+    Bucket = &mShellEnvStore.Buckets[Index];
+    for ( Variable = (SHELL_VARIABLE*)GetFirstNode(Bucket)
+        ; !IsNull(Bucket, &Variable->Link)
+        ; Variable = (SHELL_VARIABLE*)GetNextNode(Bucket, &Variable->Link)
+       ){
       VarList = AllocateZeroPool(sizeof(ENV_VAR_LIST));
       if (VarList == NULL) {
-        Status = EFI_OUT_OF_RESOURCES;
-      } else {
-        ValSize = ValBufferSize;
-        VarList->Val = AllocateZeroPool(ValSize);
-        if (VarList->Val == NULL) {
-            SHELL_FREE_NON_NULL(VarList);
-            Status = EFI_OUT_OF_RESOURCES;
-            break;
-        }
-        Status = SHELL_GET_ENVIRONMENT_VARIABLE_AND_ATTRIBUTES(VariableName, &VarList->Atts, &ValSize, VarList->Val);
-        if (Status == EFI_BUFFER_TOO_SMALL){
-          ValBufferSize = ValSize > ValBufferSize * 2 ? ValSize : ValBufferSize * 2;
-          SHELL_FREE_NON_NULL (VarList->Val);
-          VarList->Val = AllocateZeroPool(ValBufferSize);
-          if (VarList->Val == NULL) {
-            SHELL_FREE_NON_NULL(VarList);
-            Status = EFI_OUT_OF_RESOURCES;
-            break;
-          }
-          
-          ValSize = ValBufferSize;
-          Status = SHELL_GET_ENVIRONMENT_VARIABLE_AND_ATTRIBUTES(VariableName, &VarList->Atts, &ValSize, VarList->Val);
-        }
-        if (!EFI_ERROR(Status)) {
-          VarList->Key = AllocateCopyPool(StrSize(VariableName), VariableName);
-          if (VarList->Key == NULL) {
-            SHELL_FREE_NON_NULL(VarList->Val);
-            SHELL_FREE_NON_NULL(VarList);
-            Status = EFI_OUT_OF_RESOURCES;
-          } else {
-            InsertTailList(ListHead, &VarList->Link);
-          }
-        } else {
-          SHELL_FREE_NON_NULL(VarList->Val);
-          SHELL_FREE_NON_NULL(VarList);
-        }
-      } // if (VarList == NULL) ... else ...
-    } // compare guid
-  } // while
-  SHELL_FREE_NON_NULL (VariableName);
-
-  if (EFI_ERROR(Status)) {
-    FreeEnvironmentVariableList(ListHead);
+        FreeEnvironmentVariableList(ListHead);
+        return (EFI_OUT_OF_RESOURCES);
+      }
+      //
+      // Keep the value terminated even if the data was not a string
+      //
+      VarList->Key  = AllocateCopyPool(StrSize(Variable->Name), Variable->Name);
+      VarList->Val  = AllocateZeroPool(Variable->DataSize + sizeof(CHAR16));
+      VarList->Atts = Variable->Atts;
+      if (VarList->Key == NULL || VarList->Val == NULL) {
+        SHELL_FREE_NON_NULL(VarList->Key);
+        SHELL_FREE_NON_NULL(VarList->Val);
+        FreePool(VarList);
+        FreeEnvironmentVariableList(ListHead);
+        return (EFI_OUT_OF_RESOURCES);
+      }
+      CopyMem(VarList->Val, Variable->Data, Variable->DataSize);
+      InsertTailList(ListHead, &VarList->Link);
+    }
   }
 
-  return (Status);
+  return (EFI_SUCCESS);
 }
 
 /**
@@ -6,7 +6,7 @@
 //#include <Library/UefiRuntimeServicesTableLib.h>
 
 
-  Copyright (c) 2009 - 2010, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -27,10 +27,146 @@ typedef struct {
   UINT32      Atts;
 } ENV_VAR_LIST;
 
+/**
+  Load the shell environment variables and alias' into memory.
+
+  All variables under the shell variable and shell alias GUIDs are read once.
+  After this call the SHELL_*_ENVIRONMENT_VARIABLE macros, IsVolatileEnv and the
+  alias functions read from memory.  Every change is still written through to
+  UEFI variables, volatile ones included, so other images and nested shells see
+  the same variables as before.
+
+  @retval EFI_SUCCESS           The store was loaded.
+  @retval EFI_OUT_OF_RESOURCES  A memory allocation failed.
+**/
+EFI_STATUS
+EFIAPI
+InitializeShellVariableStore (
+  VOID
+  );
+
+/**
+  Re-read the shell environment variables and alias' from UEFI variables.
+
+  This is used after another image has run, since it may have changed them,
+  either directly or as a nested shell.  If the variables cannot be read the
+  current contents of the store are kept.
+
+  @retval EFI_SUCCESS           The store was reloaded.
+  @retval EFI_NOT_READY         InitializeShellVariableStore has not succeeded.
+  @retval EFI_OUT_OF_RESOURCES  A memory allocation failed.
+**/
+EFI_STATUS
+EFIAPI
+ReloadShellVariableStore (
+  VOID
+  );
+
+/**
+  Free the in-memory shell environment variables and alias'.
+
+  Every change has already been written through to UEFI variables, so nothing
+  is lost.
+**/
+VOID
+EFIAPI
+FreeShellVariableStore (
+  VOID
+  );
+
+/**
+  Get a shell environment variable or alias.
+
+  This has the same behavior as the Runtime Services call GetVariable, but reads
+  from the in-memory store.
+
+  @param[in] VariableName       The name of the variable.
+  @param[in] VendorGuid         gShellVariableGuid or gShellAliasGuid.
+  @param[out] Attributes        If not NULL, the attributes of the variable.
+  @param[in, out] DataSize      On input the size in bytes of Data.  On output
+                                the size of the variable data.
+  @param[out] Data              The buffer to receive the variable data.
+
+  @retval EFI_SUCCESS           The variable was found.
+  @retval EFI_NOT_FOUND         The variable was not found.
+  @retval EFI_BUFFER_TOO_SMALL  DataSize is too small.  It was updated with the
+                                size needed.
+  @retval EFI_INVALID_PARAMETER A parameter was invalid.
+  @retval EFI_NOT_READY         InitializeShellVariableStore has not succeeded.
+**/
+EFI_STATUS
+EFIAPI
+GetShellVariable (
+  IN CONST CHAR16     *VariableName,
+  IN CONST EFI_GUID   *VendorGuid,
+  OUT UINT32          *Attributes OPTIONAL,
+  IN OUT UINTN        *DataSize,
+  OUT VOID            *Data OPTIONAL
+  );
+
+/**
+  Set or delete a shell environment variable or alias.
+
+  This has the same behavior as the Runtime Services call SetVariable.  The
+  in-memory store is updated and the change is written through to UEFI variable
+  storage, for volatile and non-volatile variables alike.
+
+  @param[in] VariableName       The name of the variable.
+  @param[in] VendorGuid         gShellVariableGuid or gShellAliasGuid.
+  @param[in] Attributes         The attributes of the variable.  0 deletes it.
+  @param[in] DataSize           The size in bytes of Data.  0 deletes the variable.
+  @param[in] Data               The variable data.
+
+  @retval EFI_SUCCESS           The variable was set or deleted.
+  @retval EFI_NOT_FOUND         The variable to delete was not found.
+  @retval EFI_INVALID_PARAMETER The variable exists with different attributes,
+                                or a parameter was invalid.
+  @retval EFI_OUT_OF_RESOURCES  A memory allocation failed.
+  @retval EFI_NOT_READY         InitializeShellVariableStore has not succeeded.
+  @return                       The error from writing the UEFI variable.
+**/
+EFI_STATUS
+EFIAPI
+SetShellVariable (
+  IN CONST CHAR16     *VariableName,
+  IN CONST EFI_GUID   *VendorGuid,
+  IN UINT32           Attributes,
+  IN UINTN            DataSize,
+  IN CONST VOID       *Data
+  );
+
+/**
+  Enumerate the shell environment variables or alias'.
+
+  This has the same behavior as the Runtime Services call GetNextVariableName,
+  but only returns names under VendorGuid and reads from the in-memory store.
+
+  @param[in, out] VariableNameSize  On input the size in bytes of VariableName.
+                                    On output the size of the next name.
+  @param[in, out] VariableName      On input the previous name, or an empty string
+                                    to start.  On output the next name.
+  @param[in] VendorGuid             gShellVariableGuid or gShellAliasGuid.
+
+  @retval EFI_SUCCESS           The next name was returned.
+  @retval EFI_NOT_FOUND         There are no more names.
+  @retval EFI_BUFFER_TOO_SMALL  VariableNameSize is too small.  It was updated
+                                with the size needed.
+  @retval EFI_INVALID_PARAMETER VariableName is not in the store, or a parameter
+                                was invalid.
+  @retval EFI_NOT_READY         InitializeShellVariableStore has not succeeded.
+**/
+EFI_STATUS
+EFIAPI
+GetNextShellVariableName (
+  IN OUT UINTN          *VariableNameSize,
+  IN OUT CHAR16         *VariableName,
+  IN CONST EFI_GUID     *VendorGuid
+  );
+
 /**
   Reports whether an environment variable is Volatile or Non-Volatile
 
-  This will use the Runtime Services call GetVariable to to search for the variable.
+  This will search the in-memory shell variable store for the variable.
 
   @param EnvVarName             The name of the environment variable in question
 
@@ -46,7 +182,7 @@ IsVolatileEnv (
 /**
   Delete a Non-Violatile environment variable.
 
-  This will use the Runtime Services call SetVariable to remove a non-violatile variable.
+  This will use the shell variable store to remove a variable.
 
   @param EnvVarName             The name of the environment variable in question
 
@@ -55,7 +191,7 @@ IsVolatileEnv (
   @sa SetVariable
 **/
 #define SHELL_DELETE_ENVIRONMENT_VARIABLE(EnvVarName) \
-  (gRT->SetVariable((CHAR16*)EnvVarName, \
+  (SetShellVariable((CHAR16*)EnvVarName, \
   &gShellVariableGuid,          \
   0,                            \
   0,                            \
@@ -64,7 +200,8 @@ IsVolatileEnv (
 /**
   Set a Non-Violatile environment variable.
 
-  This will use the Runtime Services call SetVariable to set a non-violatile variable.
+  This will use the shell variable store to set a non-violatile variable.  The
+  variable is also written to UEFI variable storage.
 
   @param EnvVarName             The name of the environment variable in question
   @param BufferSize             UINTN size of Buffer
@@ -75,7 +212,7 @@ IsVolatileEnv (
   @sa SetVariable
 **/
 #define SHELL_SET_ENVIRONMENT_VARIABLE_NV(EnvVarName,BufferSize,Buffer)  \
-  (gRT->SetVariable((CHAR16*)EnvVarName,                          \
+  (SetShellVariable((CHAR16*)EnvVarName,                          \
   &gShellVariableGuid,                                            \
   EFI_VARIABLE_NON_VOLATILE|EFI_VARIABLE_BOOTSERVICE_ACCESS,      \
   BufferSize,                                                     \
@@ -84,7 +221,7 @@ IsVolatileEnv (
 /**
   Get an environment variable.
 
-  This will use the Runtime Services call GetVariable to get a variable.
+  This will use the shell variable store to get a variable.
 
   @param EnvVarName             The name of the environment variable in question
   @param BufferSize             Pointer to the UINTN size of Buffer
@@ -95,7 +232,7 @@ IsVolatileEnv (
   @sa SetVariable
 **/
 #define SHELL_GET_ENVIRONMENT_VARIABLE(EnvVarName,BufferSize,Buffer)    \
-  (gRT->GetVariable((CHAR16*)EnvVarName,                        \
+  (GetShellVariable((CHAR16*)EnvVarName,                        \
   &gShellVariableGuid,                                          \
   0,                                                            \
   BufferSize,                                                   \
@@ -104,7 +241,7 @@ IsVolatileEnv (
 /**
   Get an environment variable.
 
-  This will use the Runtime Services call GetVariable to get a variable.
+  This will use the shell variable store to get a variable.
 
   @param EnvVarName             The name of the environment variable in question
   @param Atts                   Pointer to the UINT32 for attributes (or NULL)
@@ -116,7 +253,7 @@ IsVolatileEnv (
   @sa SetVariable
 **/
 #define SHELL_GET_ENVIRONMENT_VARIABLE_AND_ATTRIBUTES(EnvVarName,Atts,BufferSize,Buffer)    \
-  (gRT->GetVariable((CHAR16*)EnvVarName,                        \
+  (GetShellVariable((CHAR16*)EnvVarName,                        \
   &gShellVariableGuid,                                          \
   Atts,                                                            \
   BufferSize,                                                   \
@@ -125,7 +262,7 @@ IsVolatileEnv (
 /**
   Set a Violatile environment variable.
 
-  This will use the Runtime Services call SetVariable to set a violatile variable.
+  This will use the shell variable store to set a violatile variable.
 
   @param EnvVarName             The name of the environment variable in question
   @param BufferSize             UINTN size of Buffer
@@ -136,7 +273,7 @@ IsVolatileEnv (
   @sa SetVariable
 **/
 #define SHELL_SET_ENVIRONMENT_VARIABLE_V(EnvVarName,BufferSize,Buffer) \
-  (gRT->SetVariable((CHAR16*)EnvVarName,                      \
+  (SetShellVariable((CHAR16*)EnvVarName,                      \
   &gShellVariableGuid,                                        \
   EFI_VARIABLE_BOOTSERVICE_ACCESS,                            \
   BufferSize,                                                 \
@@ -3,7 +3,7 @@
   manipulation, and initialization of EFI_SHELL_PROTOCOL.
 
   (C) Copyright 2014 Hewlett-Packard Development Company, L.P.<BR>
-  Copyright (c) 2009 - 2015, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -1547,6 +1547,12 @@ InternalShellExecuteDevicePath(
         *StartImageStatus = StartStatus;
       }
 
+      //
+      // The image may have changed shell variables, either directly or as a
+      // nested shell, so pick up the current values.
+      //
+      ReloadShellVariableStore();
+
       CleanupStatus = gBS->UninstallProtocolInterface(
                             NewHandle,
                             &gEfiShellParametersProtocolGuid,
@@ -2712,10 +2718,23 @@ InternalEfiShellSetEnv(
   IN BOOLEAN Volatile
   )
 {
+  UINT32  Atts;
+  UINTN   Size;
+
   if (Value == NULL || StrLen(Value) == 0) {
     return (SHELL_DELETE_ENVIRONMENT_VARIABLE(Name));
   } else {
-    SHELL_DELETE_ENVIRONMENT_VARIABLE(Name);
+    //
+    // The attributes can only change by deleting the variable first.  This
+    // covers any stored attributes, not only a different volatility.
+    //
+    Atts = 0;
+    Size = 0;
+    SHELL_GET_ENVIRONMENT_VARIABLE_AND_ATTRIBUTES(Name, &Atts, &Size, NULL);
+    if (Atts != 0
+      && Atts != (Volatile ? EFI_VARIABLE_BOOTSERVICE_ACCESS : (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS))) {
+      SHELL_DELETE_ENVIRONMENT_VARIABLE(Name);
+    }
     if (Volatile) {
       return (SHELL_SET_ENVIRONMENT_VARIABLE_V(Name, StrSize(Value), Value));
     } else {
@@ -3113,8 +3132,8 @@ InternalEfiShellGetListAlias(
 {
   
   EFI_STATUS        Status;
-  EFI_GUID          Guid;
   CHAR16            *VariableName;
+  CHAR16            *NewName;
   UINTN             NameSize;
   UINTN             NameBufferSize;
   CHAR16            *RetVal;
@@ -3133,22 +3152,21 @@ InternalEfiShellGetListAlias(
 
   while (TRUE) {
     NameSize = NameBufferSize;
-    Status = gRT->GetNextVariableName(&NameSize, VariableName, &Guid);
+    Status = GetNextShellVariableName(&NameSize, VariableName, &gShellAliasGuid);
     if (Status == EFI_NOT_FOUND){
       break;
     } else if (Status == EFI_BUFFER_TOO_SMALL) {
-      NameBufferSize = NameSize > NameBufferSize * 2 ? NameSize : NameBufferSize * 2;
-      SHELL_FREE_NON_NULL(VariableName);
-      VariableName = AllocateZeroPool(NameBufferSize);
-      if (VariableName == NULL) {
-        Status = EFI_OUT_OF_RESOURCES;
+      NewName = AllocateZeroPool(NameSize);
+      if (NewName == NULL) {
         SHELL_FREE_NON_NULL(RetVal);
         RetVal = NULL;
         break;
       }
-      
-      NameSize = NameBufferSize;
-      Status = gRT->GetNextVariableName(&NameSize, VariableName, &Guid);
+      CopyMem(NewName, VariableName, NameBufferSize);
+      FreePool(VariableName);
+      VariableName    = NewName;
+      NameBufferSize  = NameSize;
+      Status = GetNextShellVariableName(&NameSize, VariableName, &gShellAliasGuid);
     }
     
     if (EFI_ERROR (Status)) {
@@ -3157,11 +3175,9 @@ InternalEfiShellGetListAlias(
       break;
     }
     
-    if (CompareGuid(&Guid, &gShellAliasGuid)){
-      ASSERT((RetVal == NULL && RetSize == 0) || (RetVal != NULL));
-      RetVal = StrnCatGrow(&RetVal, &RetSize, VariableName, 0);
-      RetVal = StrnCatGrow(&RetVal, &RetSize, L";", 0);
-    } // compare guid
+    ASSERT((RetVal == NULL && RetSize == 0) || (RetVal != NULL));
+    RetVal = StrnCatGrow(&RetVal, &RetSize, VariableName, 0);
+    RetVal = StrnCatGrow(&RetVal, &RetSize, L";", 0);
   } // while
   SHELL_FREE_NON_NULL(VariableName);
 
@@ -3228,26 +3244,30 @@ EfiShellGetAlias(
     ASSERT (AliasLower != NULL);
     ToLower (AliasLower);
 
-    if (Volatile == NULL) {
-      return (AddBufferToFreeList(GetVariable(AliasLower, &gShellAliasGuid)));
-    }
     RetSize = 0;
     RetVal = NULL;
-    Status = gRT->GetVariable(AliasLower, &gShellAliasGuid, &Attribs, &RetSize, RetVal);
+    Status = GetShellVariable(AliasLower, &gShellAliasGuid, &Attribs, &RetSize, RetVal);
     if (Status == EFI_BUFFER_TOO_SMALL) {
       RetVal = AllocateZeroPool(RetSize);
-      Status = gRT->GetVariable(AliasLower, &gShellAliasGuid, &Attribs, &RetSize, RetVal);
+      if (RetVal == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+      } else {
+        Status = GetShellVariable(AliasLower, &gShellAliasGuid, &Attribs, &RetSize, RetVal);
+      }
     }
     if (EFI_ERROR(Status)) {
       if (RetVal != NULL) {
         FreePool(RetVal);
       }
+      FreePool (AliasLower);
       return (NULL);
     }
-    if ((EFI_VARIABLE_NON_VOLATILE & Attribs) == EFI_VARIABLE_NON_VOLATILE) {
-      *Volatile = FALSE;
-    } else {
-      *Volatile = TRUE;
+    if (Volatile != NULL) {
+      if ((EFI_VARIABLE_NON_VOLATILE & Attribs) == EFI_VARIABLE_NON_VOLATILE) {
+        *Volatile = FALSE;
+      } else {
+        *Volatile = TRUE;
+      }
     }
 
     FreePool (AliasLower);
@@ -3299,16 +3319,16 @@ InternalSetAlias(
     //
     // remove an alias (but passed in COMMAND parameter)
     //
-    Status = (gRT->SetVariable((CHAR16*)Command, &gShellAliasGuid, 0, 0, NULL));
+    Status = (SetShellVariable((CHAR16*)Command, &gShellAliasGuid, 0, 0, NULL));
   } else {
     //
     // Add and replace are the same
     //
 
     // We dont check the error return on purpose since the variable may not exist.
-    gRT->SetVariable((CHAR16*)Command, &gShellAliasGuid, 0, 0, NULL);
+    SetShellVariable((CHAR16*)Command, &gShellAliasGuid, 0, 0, NULL);
 
-    Status = (gRT->SetVariable((CHAR16*)Alias, &gShellAliasGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS|(Volatile?0:EFI_VARIABLE_NON_VOLATILE), StrSize(Command), (VOID*)Command));
+    Status = (SetShellVariable((CHAR16*)Alias, &gShellAliasGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS|(Volatile?0:EFI_VARIABLE_NON_VOLATILE), StrSize(Command), (VOID*)Command));
   }
 
   if (Alias != NULL) {
@@ -5,7 +5,7 @@
   This library will not funciton if it is used for UEFI Shell 2.0 Applications.
 
   (C) Copyright 2013-2014 Hewlett-Packard Development Company, L.P.<BR>
-  Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -389,6 +389,7 @@ typedef struct {
   LIST_ENTRY      Link;     ///< List enumerator items.
   UINTN           Line;     ///< What line of the script file this was on.
   CHAR16          *Cl;      ///< The original command line.
+  CHAR16          *Name;    ///< The first token of Cl, parsed once when the script is loaded.  May be NULL.
   VOID            *Data;    ///< The data structure format dependant upon Command. (not always used)
   BOOLEAN         Reset;    ///< Reset the command (it must be treated like a initial run (but it may have data already))
 } SCRIPT_COMMAND_LIST;
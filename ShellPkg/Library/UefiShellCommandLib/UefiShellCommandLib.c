@@ -2,7 +2,7 @@
   Provides interface to shell internal functions for shell commands.
 
   (C) Copyright 2013-2015 Hewlett-Packard Development Company, L.P.<BR>
-  Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -1025,6 +1025,7 @@ DeleteScriptFileStruct (
       if (Script->CurrentCommand->Cl != NULL) {
         SHELL_FREE_NON_NULL(Script->CurrentCommand->Cl);
       }
+      SHELL_FREE_NON_NULL(Script->CurrentCommand->Name);
       if (Script->CurrentCommand->Data != NULL) {
         SHELL_FREE_NON_NULL(Script->CurrentCommand->Data);
       }
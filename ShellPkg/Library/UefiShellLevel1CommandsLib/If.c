@@ -2,7 +2,7 @@
   Main file for If and else shell level 1 function.
 
   (C) Copyright 2013-2015 Hewlett-Packard Development Company, L.P.<BR>
-  Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -729,22 +729,26 @@ MoveToTagSpecial (
     // get just the first part of the command line...
     //
     CommandName   = NULL;
-    CommandName   = StrnCatGrow(&CommandName, NULL, CommandNode->Cl, 0);
-    if (CommandName == NULL) {
-      continue;
-    }
-    CommandWalker = CommandName;
+    if (CommandNode->Name != NULL) {
+      CommandWalker = CommandNode->Name;
+    } else {
+      CommandName   = StrnCatGrow(&CommandName, NULL, CommandNode->Cl, 0);
+      if (CommandName == NULL) {
+        continue;
+      }
+      CommandWalker = CommandName;
 
-    //
-    // Skip leading spaces and tabs.
-    //
-    while ((CommandWalker[0] == L' ') || (CommandWalker[0] == L'\t')) {
-      CommandWalker++;
-    }
-    TempLocation  = StrStr(CommandWalker, L" ");
+      //
+      // Skip leading spaces and tabs.
+      //
+      while ((CommandWalker[0] == L' ') || (CommandWalker[0] == L'\t')) {
+        CommandWalker++;
+      }
+      TempLocation  = StrStr(CommandWalker, L" ");
 
-    if (TempLocation != NULL) {
-      *TempLocation = CHAR_NULL;
+      if (TempLocation != NULL) {
+        *TempLocation = CHAR_NULL;
+      }
     }
 
     //
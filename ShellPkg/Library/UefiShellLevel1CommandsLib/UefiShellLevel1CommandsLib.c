@@ -2,7 +2,7 @@
   Main file for NULL named library for level 1 shell command functions.
 
   (C) Copyright 2013 Hewlett-Packard Development Company, L.P.<BR>
-  Copyright (c) 2009 - 2011, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -145,23 +145,30 @@ TestNodeForMove (
   // get just the first part of the command line...
   //
   CommandName   = NULL;
-  CommandName   = StrnCatGrow(&CommandName, NULL, CommandNode->Cl, 0);
-  if (CommandName == NULL) {
-    return (FALSE);
-  }
+  if (CommandNode->Name != NULL) {
+    //
+    // The shell already split this out when the script was loaded.
+    //
+    CommandNameWalker = CommandNode->Name;
+  } else {
+    CommandName   = StrnCatGrow(&CommandName, NULL, CommandNode->Cl, 0);
+    if (CommandName == NULL) {
+      return (FALSE);
+    }
 
-  CommandNameWalker = CommandName;
+    CommandNameWalker = CommandName;
 
-  //
-  // Skip leading spaces and tabs.
-  //
-  while ((CommandNameWalker[0] == L' ') || (CommandNameWalker[0] == L'\t')) {
-    CommandNameWalker++;
-  }
-  TempLocation  = StrStr(CommandNameWalker, L" ");
+    //
+    // Skip leading spaces and tabs.
+    //
+    while ((CommandNameWalker[0] == L' ') || (CommandNameWalker[0] == L'\t')) {
+      CommandNameWalker++;
+    }
+    TempLocation  = StrStr(CommandNameWalker, L" ");
 
-  if (TempLocation != NULL) {
-    *TempLocation = CHAR_NULL;
+    if (TempLocation != NULL) {
+      *TempLocation = CHAR_NULL;
+    }
   }
 
   //
@@ -218,7 +225,7 @@ TestNodeForMove (
   //
   // Free the memory for this loop...
   //
-  FreePool(CommandName);
+  SHELL_FREE_NON_NULL(CommandName);
   return (Found);
 }
 
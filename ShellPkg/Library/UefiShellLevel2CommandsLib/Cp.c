@@ -2,7 +2,7 @@
   Main file for cp shell level 2 function.
 
   (C) Copyright 2015 Hewlett-Packard Development Company, L.P.<BR>
-  Copyright (c) 2009 - 2015, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -44,6 +44,417 @@ ValidateAndCopyFiles(
   IN VOID                       **Resp
   );
 
+///
+/// Files larger than this are copied through the multi-buffer engine.
+///
+#define COPY_ENGINE_BUFFER_SIZE   SIZE_1MB
+
+///
+/// Number of buffers in the copy engine, one being read, one being
+/// written and one waiting between the two.
+///
+#define COPY_ENGINE_BUFFER_COUNT  3
+
+///
+/// Period of the timer used to measure the copy, 10 milliseconds in
+/// 100 nanosecond units.
+///
+#define COPY_ENGINE_TICK          100000
+
+typedef enum {
+  CopyBufferFree,
+  CopyBufferReading,
+  CopyBufferFull,
+  CopyBufferWriting
+} COPY_BUFFER_STATE;
+
+typedef struct {
+  COPY_BUFFER_STATE   State;
+  UINTN               DataSize;
+  EFI_FILE_IO_TOKEN   Token;
+} COPY_BUFFER;
+
+/**
+  Count the timer ticks during a copy.
+
+  @param[in] Event    The periodic timer event.
+  @param[in] Context  Address of the UINT64 tick count.
+**/
+VOID
+EFIAPI
+CopyTimerTick (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  (*(UINT64 *)Context)++;
+}
+
+/**
+  Start reading the next block of the source file into a buffer.
+
+  Uses ReadEx when the file protocol supports it so the read overlaps
+  the write of the previous block.  Otherwise the read completes before
+  returning and the buffer event is signaled by hand.
+
+  @param[in] File         The source file protocol.
+  @param[in, out] Async   TRUE to try ReadEx, set to FALSE once ReadEx is found unsupported.
+  @param[in, out] Buffer  The buffer to read into.
+  @param[in] BufferSize   The size of the buffer in bytes.
+
+  @retval EFI_SUCCESS     The read was started or completed.
+  @return                 The error returned by the file protocol.
+**/
+EFI_STATUS
+EFIAPI
+CopyStartRead (
+  IN     EFI_FILE_PROTOCOL  *File,
+  IN OUT BOOLEAN            *Async,
+  IN OUT COPY_BUFFER        *Buffer,
+  IN     UINTN              BufferSize
+  )
+{
+  EFI_STATUS  Status;
+
+  Buffer->Token.Status     = EFI_SUCCESS;
+  Buffer->Token.BufferSize = BufferSize;
+  if (*Async) {
+    Status = File->ReadEx (File, &Buffer->Token);
+    if (Status != EFI_UNSUPPORTED) {
+      return (Status);
+    }
+    *Async = FALSE;
+  }
+  Buffer->Token.Status = File->Read (File, &Buffer->Token.BufferSize, Buffer->Token.Buffer);
+  gBS->SignalEvent (Buffer->Token.Event);
+  return (EFI_SUCCESS);
+}
+
+/**
+  Start writing a full buffer to the destination file.
+
+  Uses WriteEx when the file protocol supports it so the write overlaps
+  the read of the next block.  Otherwise the write completes before
+  returning and the buffer event is signaled by hand.
+
+  @param[in] File         The destination file protocol.
+  @param[in, out] Async   TRUE to try WriteEx, set to FALSE once WriteEx is found unsupported.
+  @param[in, out] Buffer  The buffer to write.
+
+  @retval EFI_SUCCESS     The write was started or completed.
+  @return                 The error returned by the file protocol.
+**/
+EFI_STATUS
+EFIAPI
+CopyStartWrite (
+  IN     EFI_FILE_PROTOCOL  *File,
+  IN OUT BOOLEAN            *Async,
+  IN OUT COPY_BUFFER        *Buffer
+  )
+{
+  EFI_STATUS  Status;
+
+  Buffer->Token.Status     = EFI_SUCCESS;
+  Buffer->Token.BufferSize = Buffer->DataSize;
+  if (*Async) {
+    Status = File->WriteEx (File, &Buffer->Token);
+    if (Status != EFI_UNSUPPORTED) {
+      return (Status);
+    }
+    *Async = FALSE;
+  }
+  Buffer->Token.Status = File->Write (File, &Buffer->Token.BufferSize, Buffer->Token.Buffer);
+  gBS->SignalEvent (Buffer->Token.Event);
+  return (EFI_SUCCESS);
+}
+
+/**
+  Copy the data of a large file using several buffers.
+
+  Reads run ahead of the writes through a ring of buffers so that with
+  ReadEx and WriteEx the source and destination devices work at the same
+  time.  At most one read and one write are outstanding because the file
+  position advances as each request is queued.
+
+  @param[in] SourceFile   The source file protocol.
+  @param[in] DestFile     The destination file protocol.
+  @param[in] BufferSize   The size of each buffer in bytes.
+  @param[out] Copied      The number of bytes written to the destination.
+  @param[out] ReadFailed  TRUE when the error came from reading the source.
+  @param[out] NotStarted  TRUE when the buffers or their events could not be
+                          set up.  No data was read or written then.
+
+  @retval EFI_SUCCESS           The file data was copied.
+  @retval EFI_OUT_OF_RESOURCES  The buffers could not be set up, or the file
+                                protocol ran out of resources.
+  @return                       The error returned by the file protocol.
+**/
+EFI_STATUS
+EFIAPI
+CopyFileDataBuffered (
+  IN  EFI_FILE_PROTOCOL *SourceFile,
+  IN  EFI_FILE_PROTOCOL *DestFile,
+  IN  UINTN             BufferSize,
+  OUT UINT64            *Copied,
+  OUT BOOLEAN           *ReadFailed,
+  OUT BOOLEAN           *NotStarted
+  )
+{
+  COPY_BUFFER   Buffers[COPY_ENGINE_BUFFER_COUNT];
+  EFI_EVENT     WaitList[2];
+  COPY_BUFFER   *WaitBuffer[2];
+  COPY_BUFFER   *Buffer;
+  BOOLEAN       AsyncRead;
+  BOOLEAN       AsyncWrite;
+  BOOLEAN       EndOfFile;
+  UINTN         ReadIndex;
+  UINTN         WriteIndex;
+  UINTN         WaitCount;
+  UINTN         Index;
+  EFI_STATUS    Status;
+  EFI_STATUS    TempStatus;
+
+  *Copied     = 0;
+  *ReadFailed = FALSE;
+  *NotStarted = FALSE;
+  Status      = EFI_SUCCESS;
+
+  ZeroMem (Buffers, sizeof (Buffers));
+  for (Index = 0; Index < COPY_ENGINE_BUFFER_COUNT; Index++) {
+    Buffers[Index].Token.Buffer = AllocatePool (BufferSize);
+    if (Buffers[Index].Token.Buffer == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      break;
+    }
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Buffers[Index].Token.Event);
+    if (EFI_ERROR (Status)) {
+      Buffers[Index].Token.Event = NULL;
+      Status = EFI_OUT_OF_RESOURCES;
+      break;
+    }
+  }
+  if (EFI_ERROR (Status)) {
+    *NotStarted = TRUE;
+  }
+
+  AsyncRead  = (BOOLEAN)(SourceFile->Revision >= EFI_FILE_PROTOCOL_REVISION2);
+  AsyncWrite = (BOOLEAN)(DestFile->Revision >= EFI_FILE_PROTOCOL_REVISION2);
+  EndOfFile  = FALSE;
+  ReadIndex  = 0;
+  WriteIndex = 0;
+
+  while (!EFI_ERROR (Status)) {
+    //
+    // Keep a read going while there is room to receive the data
+    //
+    Buffer = &Buffers[ReadIndex];
+    if (!EndOfFile && Buffer->State == CopyBufferFree) {
+      Status = CopyStartRead (SourceFile, &AsyncRead, Buffer, BufferSize);
+      if (EFI_ERROR (Status)) {
+        *ReadFailed = TRUE;
+        break;
+      }
+      Buffer->State = CopyBufferReading;
+    }
+
+    //
+    // Write the oldest block once its read is complete
+    //
+    Buffer = &Buffers[WriteIndex];
+    if (Buffer->State == CopyBufferFull) {
+      Status = CopyStartWrite (DestFile, &AsyncWrite, Buffer);
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+      Buffer->State = CopyBufferWriting;
+    }
+
+    //
+    // Wait for one of the outstanding operations
+    //
+    WaitCount = 0;
+    for (Index = 0; Index < COPY_ENGINE_BUFFER_COUNT; Index++) {
+      if (Buffers[Index].State == CopyBufferReading || Buffers[Index].State == CopyBufferWriting) {
+        WaitBuffer[WaitCount] = &Buffers[Index];
+        WaitList[WaitCount]   = Buffers[Index].Token.Event;
+        WaitCount++;
+      }
+    }
+    if (WaitCount == 0) {
+      break;
+    }
+    Status = gBS->WaitForEvent (WaitCount, WaitList, &Index);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    Buffer = WaitBuffer[Index];
+    if (Buffer->State == CopyBufferReading) {
+      //
+      // A short read marks the end of the file
+      //
+      if (EFI_ERROR (Buffer->Token.Status)) {
+        Status      = Buffer->Token.Status;
+        *ReadFailed = TRUE;
+        Buffer->State = CopyBufferFree;
+        break;
+      }
+      Buffer->DataSize = Buffer->Token.BufferSize;
+      EndOfFile = (BOOLEAN)(Buffer->DataSize < BufferSize);
+      Buffer->State = (Buffer->DataSize == 0) ? CopyBufferFree : CopyBufferFull;
+      if (Buffer->State == CopyBufferFull) {
+        ReadIndex = (ReadIndex + 1) % COPY_ENGINE_BUFFER_COUNT;
+      }
+    } else {
+      Buffer->State = CopyBufferFree;
+      if (EFI_ERROR (Buffer->Token.Status)) {
+        Status = Buffer->Token.Status;
+        break;
+      }
+      if (Buffer->Token.BufferSize != Buffer->DataSize) {
+        Status = EFI_DEVICE_ERROR;
+        break;
+      }
+      *Copied += Buffer->DataSize;
+      WriteIndex = (WriteIndex + 1) % COPY_ENGINE_BUFFER_COUNT;
+    }
+  }
+
+  //
+  // Let any outstanding operation finish before releasing its buffer
+  //
+  for (Index = 0; Index < COPY_ENGINE_BUFFER_COUNT; Index++) {
+    if (Buffers[Index].State == CopyBufferReading || Buffers[Index].State == CopyBufferWriting) {
+      TempStatus = gBS->WaitForEvent (1, &Buffers[Index].Token.Event, &WaitCount);
+      ASSERT_EFI_ERROR (TempStatus);
+    }
+    if (Buffers[Index].Token.Event != NULL) {
+      gBS->CloseEvent (Buffers[Index].Token.Event);
+    }
+    SHELL_FREE_NON_NULL (Buffers[Index].Token.Buffer);
+  }
+
+  return (Status);
+}
+
+/**
+  Copy the data from one open file to another.
+
+  Small files are copied with a single PcdShellFileOperationSize buffer.
+  Larger files go through CopyFileDataBuffered and, unless SilentMode is
+  set, the throughput is displayed.
+
+  @param[in] SourceHandle   The open source file.
+  @param[in] DestHandle     The open destination file.
+  @param[in] FileSize       The size of the source file in bytes.
+  @param[in] Source         The source file name.
+  @param[in] Dest           The destination file name.
+  @param[in] SilentMode     TRUE to eliminate screen output.
+  @param[in] CmdName        The command name for error messages.
+
+  @retval SHELL_SUCCESS     The data was copied.
+  @return                   The error converted from the file protocol status.
+**/
+SHELL_STATUS
+EFIAPI
+CopyFileData (
+  IN SHELL_FILE_HANDLE  SourceHandle,
+  IN SHELL_FILE_HANDLE  DestHandle,
+  IN UINT64             FileSize,
+  IN CONST CHAR16       *Source,
+  IN CONST CHAR16       *Dest,
+  IN BOOLEAN            SilentMode,
+  IN CONST CHAR16       *CmdName
+  )
+{
+  VOID          *Buffer;
+  UINTN         ReadSize;
+  UINT64        Copied;
+  UINT64        Ticks;
+  UINT64        Milliseconds;
+  BOOLEAN       ReadFailed;
+  BOOLEAN       SingleBuffer;
+  EFI_EVENT     Timer;
+  EFI_STATUS    Status;
+
+  Copied     = 0;
+  ReadFailed = FALSE;
+
+  if (FileSize > PcdGet32(PcdShellFileOperationSize)) {
+    //
+    // Time the copy with a periodic timer
+    //
+    Ticks = 0;
+    Timer = NULL;
+    if (!SilentMode) {
+      Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, CopyTimerTick, &Ticks, &Timer);
+      if (!EFI_ERROR (Status)) {
+        gBS->SetTimer (Timer, TimerPeriodic, COPY_ENGINE_TICK);
+      } else {
+        Timer = NULL;
+      }
+    }
+
+    Status = CopyFileDataBuffered (
+               ConvertShellHandleToEfiFileProtocol (SourceHandle),
+               ConvertShellHandleToEfiFileProtocol (DestHandle),
+               (FileSize < COPY_ENGINE_BUFFER_SIZE) ? (UINTN)FileSize + 1 : COPY_ENGINE_BUFFER_SIZE,
+               &Copied,
+               &ReadFailed,
+               &SingleBuffer
+               );
+
+    if (Timer != NULL) {
+      gBS->CloseEvent (Timer);
+      if (!EFI_ERROR (Status)) {
+        Milliseconds = MultU64x32 (Ticks, COPY_ENGINE_TICK / 10000);
+        if (Milliseconds == 0) {
+          Milliseconds = 1;
+        }
+        ShellPrintHiiEx(-1, -1, NULL, STRING_TOKEN (STR_CP_THROUGHPUT), gShellLevel2HiiHandle, Copied, Milliseconds, DivU64x64Remainder (MultU64x32 (Copied, 1000), MultU64x32 (Milliseconds, 1024), NULL));
+      }
+    }
+  } else {
+    //
+    // Small files fit in one read
+    //
+    SingleBuffer = TRUE;
+  }
+
+  //
+  // Fall back to the single buffer copy when the engine buffers are not
+  // available.  Nothing has been read or written then, so both files are
+  // still at their start.
+  //
+  if (SingleBuffer) {
+    ReadSize = PcdGet32(PcdShellFileOperationSize);
+    Buffer = AllocateZeroPool(ReadSize);
+    if (Buffer == NULL) {
+      return (SHELL_OUT_OF_RESOURCES);
+    }
+    Status = EFI_SUCCESS;
+    while (ReadSize == PcdGet32(PcdShellFileOperationSize) && !EFI_ERROR(Status)) {
+      Status = ShellReadFile(SourceHandle, &ReadSize, Buffer);
+      if (!EFI_ERROR(Status)) {
+        Status = ShellWriteFile(DestHandle, &ReadSize, Buffer);
+      } else {
+        ReadFailed = TRUE;
+      }
+    }
+    FreePool (Buffer);
+  }
+
+  if (EFI_ERROR (Status)) {
+    if (ReadFailed) {
+      ShellPrintHiiEx(-1, -1, NULL, STRING_TOKEN (STR_GEN_CPY_READ_ERROR), gShellLevel2HiiHandle, CmdName, Source);
+    } else {
+      ShellPrintHiiEx(-1, -1, NULL, STRING_TOKEN (STR_GEN_CPY_WRITE_ERROR), gShellLevel2HiiHandle, CmdName, Dest);
+    }
+    return ((SHELL_STATUS) (Status & (~MAX_BIT)));
+  }
+  return (SHELL_SUCCESS);
+}
+
 /**
   Function to Copy one file to another location
 
@@ -68,15 +479,14 @@ CopySingleFile(
   )
 {
   VOID                  *Response;
-  UINTN                 ReadSize;
   SHELL_FILE_HANDLE     SourceHandle;
   SHELL_FILE_HANDLE     DestHandle;
   EFI_STATUS            Status;
-  VOID                  *Buffer;
   CHAR16                *TempName;
   UINTN                 Size;
   EFI_SHELL_FILE_INFO   *List;
   SHELL_STATUS          ShellStatus;
+  UINT64                FileSize;
   UINT64                SourceFileSize;
   UINT64                DestFileSize;
   EFI_FILE_PROTOCOL     *DestVolumeFP;
@@ -92,7 +502,6 @@ CopySingleFile(
   DestVolumeInfo  = NULL;
   ShellStatus     = SHELL_SUCCESS;
 
-  ReadSize = PcdGet32(PcdShellFileOperationSize);
   // Why bother copying a file to itself
   if (StrCmp(Source, Dest) == 0) {
     return (SHELL_SUCCESS);
@@ -173,6 +582,7 @@ CopySingleFile(
     Status = ShellOpenFileByName (Source, &SourceHandle, EFI_FILE_MODE_READ, 0);
     if (EFI_ERROR (Status)) {
       ShellPrintHiiEx (-1, -1, NULL, STRING_TOKEN (STR_CP_SRC_OPEN_FAIL), gShellLevel2HiiHandle, CmdName, Source);
+      ShellCloseFile(&DestHandle);
       return (SHELL_ACCESS_DENIED);
     }
 
@@ -181,6 +591,7 @@ CopySingleFile(
     //
     ShellGetFileSize(SourceHandle, &SourceFileSize);
     ShellGetFileSize(DestHandle, &DestFileSize);
+    FileSize = SourceFileSize;
 
     //
     //if the destination file already exists then it will be replaced, meaning the sourcefile effectively needs less storage space
@@ -192,17 +603,20 @@ CopySingleFile(
     }
 
     //
-    //get the system volume info to check the free space
+    //get the system volume info to check the free space, unless no additional space is needed
     //
     DestVolumeFP = ConvertShellHandleToEfiFileProtocol(DestHandle);
     DestVolumeInfo = NULL;
     DestVolumeInfoSize = 0;
-    Status = DestVolumeFP->GetInfo(
-      DestVolumeFP,
-      &gEfiFileSystemInfoGuid,
-      &DestVolumeInfoSize,
-      DestVolumeInfo
-      );
+    Status = EFI_SUCCESS;
+    if (SourceFileSize != 0) {
+      Status = DestVolumeFP->GetInfo(
+        DestVolumeFP,
+        &gEfiFileSystemInfoGuid,
+        &DestVolumeInfoSize,
+        DestVolumeInfo
+        );
+    }
 
     if (Status == EFI_BUFFER_TOO_SMALL) {
       DestVolumeInfo = AllocateZeroPool(DestVolumeInfoSize);
@@ -228,23 +642,7 @@ CopySingleFile(
       //
       // copy data between files
       //
-      Buffer = AllocateZeroPool(ReadSize);
-      ASSERT(Buffer != NULL);
-      while (ReadSize == PcdGet32(PcdShellFileOperationSize) && !EFI_ERROR(Status)) {
-        Status = ShellReadFile(SourceHandle, &ReadSize, Buffer);
-        if (!EFI_ERROR(Status)) {
-          Status = ShellWriteFile(DestHandle, &ReadSize, Buffer);
-          if (EFI_ERROR(Status)) {
-            ShellStatus = (SHELL_STATUS) (Status & (~MAX_BIT));
-            ShellPrintHiiEx(-1, -1, NULL, STRING_TOKEN (STR_GEN_CPY_WRITE_ERROR), gShellLevel2HiiHandle, CmdName, Dest);   
-            break;
-          }
-        } else {
-          ShellStatus = (SHELL_STATUS) (Status & (~MAX_BIT));
-          ShellPrintHiiEx(-1, -1, NULL, STRING_TOKEN (STR_GEN_CPY_READ_ERROR), gShellLevel2HiiHandle, CmdName, Source);  
-          break;
-        }
-      }
+      ShellStatus = CopyFileData(SourceHandle, DestHandle, FileSize, Source, Dest, SilentMode, CmdName);
     }
     SHELL_FREE_NON_NULL(DestVolumeInfo);
   }
@@ -1,7 +1,7 @@
 /** @file
   Provides interface to shell functionality for shell commands and applications.
 
-  Copyright (c) 2006 - 2015, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -2605,8 +2605,12 @@ ShellCopySearchAndReplace(
   IN CONST BOOLEAN                    ParameterReplacing
   )
 {
-  UINTN Size;
-  CHAR16 *Replace;
+  CONST CHAR16  *Start;
+  CHAR16        *Replace;
+  UINTN         Length;
+  UINTN         MaxLength;
+  UINTN         TargetLength;
+  UINTN         ReplaceLength;
 
   if ( (SourceString == NULL)
     || (NewString    == NULL)
@@ -2629,31 +2633,43 @@ ShellCopySearchAndReplace(
   if (Replace == NULL) {
     return (EFI_OUT_OF_RESOURCES);
   }
-  NewString = ZeroMem(NewString, NewSize);
+  //
+  // Track the output length as we go so each character is only copied once.
+  //
+  Start         = SourceString;
+  Length        = 0;
+  MaxLength     = NewSize / sizeof(CHAR16);
+  TargetLength  = StrLen(FindTarget);
+  ReplaceLength = StrLen(Replace);
+  if (MaxLength == 0) {
+    FreePool(Replace);
+    return (EFI_BUFFER_TOO_SMALL);
+  }
+  NewString[0] = CHAR_NULL;
   while (*SourceString != CHAR_NULL) {
     //
     // if we find the FindTarget and either Skip == FALSE or Skip  and we
     // dont have a carrot do a replace...
     //
-    if (StrnCmp(SourceString, FindTarget, StrLen(FindTarget)) == 0
-      && ((SkipPreCarrot && *(SourceString-1) != L'^') || !SkipPreCarrot)
+    if (*SourceString == *FindTarget
+      && StrnCmp(SourceString, FindTarget, TargetLength) == 0
+      && (!SkipPreCarrot || SourceString == Start || *(SourceString-1) != L'^')
      ){
-      SourceString += StrLen(FindTarget);
-      Size = StrSize(NewString);
-      if ((Size + (StrLen(Replace)*sizeof(CHAR16))) > NewSize) {
+      SourceString += TargetLength;
+      if (Length + ReplaceLength + 1 > MaxLength) {
         FreePool(Replace);
         return (EFI_BUFFER_TOO_SMALL);
       }
-      StrCatS(NewString, NewSize/sizeof(CHAR16), Replace);
+      CopyMem(NewString + Length, Replace, ReplaceLength * sizeof(CHAR16));
+      Length += ReplaceLength;
     } else {
-      Size = StrSize(NewString);
-      if (Size + sizeof(CHAR16) > NewSize) {
+      if (Length + 2 > MaxLength) {
         FreePool(Replace);
         return (EFI_BUFFER_TOO_SMALL);
       }
-      StrnCatS(NewString, NewSize/sizeof(CHAR16), SourceString, 1);
-      SourceString++;
+      NewString[Length++] = *SourceString++;
     }
+    NewString[Length] = CHAR_NULL;
   }
   FreePool(Replace);
   return (EFI_SUCCESS);
@@ -5,7 +5,7 @@
   * Bound - pSocket->PortList is not NULL
   * Listen - AcceptWait event is not NULL
 
-  Copyright (c) 2010 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials are licensed and made available under
   the terms and conditions of the BSD License that accompanies this distribution.
   The full text of the license may be found at
@@ -215,6 +215,12 @@
   is eventually shutdown by ::EslSocketPortCloseTxDone and the resources in these
   structures are released in ::EslSocketPortClose by a call to ::EslSocketIoFree.
 
+  The number of receive ESL_IO_MGMT structures, and thus the number of receive
+  operations kept posted to the network layer, comes from ESL_SOCKET_BINDING::RxIo.
+  An application may select a deeper (or shallower) receive queue with the
+  SO_RCVDEPTH socket option before the port is allocated by bind, connect or
+  listen.  Sockets created by accept inherit the depth of the listening socket.
+
 <code><pre>
 
          pPort->pRxActive
@@ -454,6 +460,16 @@
   the socket is active or calls the ::EslSocketPortCloseTxDone routine
   when the socket is shutting down.
 
+  The TCP transmit engines gather data when all of the ESL_IO_MGMT
+  structures are busy.  Rather than queuing a new ::ESL_PACKET behind
+  the others, the network specific TxBuffer routine appends the
+  packet's data buffer to the fragment table of the packet at the
+  tail of the queue and links the new packet onto that packet's
+  ESL_PACKET::pGatherList.  The network stack then sends up to
+  TX_FRAGMENTS application writes with a single transmit token and no
+  additional copy.  ::EslSocketPacketFree releases the gathered packets
+  along with the packet that references them.
+
 **/
 
 #include "Socket.h"
@@ -2875,6 +2891,14 @@ EslSocketOptionGet (
         LengthInBytes = sizeof ( pSocket->MaxRxBuf );
         break;
 
+      case SO_RCVDEPTH:
+        //
+        //  Return the number of receive operations posted per port
+        //
+        pOptionData = (CONST UINT8 *)&pSocket->RxIoDepth;
+        LengthInBytes = sizeof ( pSocket->RxIoDepth );
+        break;
+
       case SO_REUSEADDR:
         //
         //  Return the address reuse flag
@@ -2981,6 +3005,7 @@ EslSocketOptionSet (
   socklen_t LengthInBytes;
   UINT8 * pOptionData;
   ESL_SOCKET * pSocket;
+  UINT32 RxIoDepth;
   EFI_STATUS Status;
 
   DBG_ENTER ( );
@@ -3105,6 +3130,44 @@ EslSocketOptionSet (
           LengthInBytes = sizeof ( pSocket->MaxRxBuf );
           break;
 
+        case SO_RCVDEPTH:
+          //
+          //  The receive ESL_IO_MGMT structures are allocated with
+          //  the port, so the depth must be set before the socket
+          //  is bound to a port
+          //
+          if ( NULL != pSocket->pPortList ) {
+            DEBUG (( DEBUG_OPTION,
+                      "ERROR - Receive depth must be set before the port is allocated!\r\n" ));
+            break;
+          }
+          pOptionData = (UINT8 *)&pSocket->RxIoDepth;
+          LengthInBytes = sizeof ( pSocket->RxIoDepth );
+
+          //
+          //  Validate the option length
+          //
+          if ( sizeof ( UINT32 ) == OptionLength ) {
+            //
+            //  Limit the depth to the supported range
+            //
+            RxIoDepth = *(UINT32 *)pOptionValue;
+            if ( 0 == RxIoDepth ) {
+              RxIoDepth = 1;
+            }
+            if ( MAX_RX_IO < RxIoDepth ) {
+              RxIoDepth = MAX_RX_IO;
+            }
+            pOptionValue = &RxIoDepth;
+          }
+          else {
+            //
+            //  Force an invalid option length error
+            //
+            OptionLength = LengthInBytes - 1;
+          }
+          break;
+
         case SO_REUSEADDR:
           //
           //  Return the address reuse flag
@@ -3205,6 +3268,7 @@ EslSocketPacketAllocate (
     if ( 0 != ZeroBytes ) {
       ZeroMem ( &pPacket->Op, ZeroBytes );
     }
+    pPacket->pGatherList = NULL;
     pPacket->PacketSize = LengthInBytes;
   }
   else {
@@ -3247,10 +3311,20 @@ EslSocketPacketFree (
   )
 {
   UINTN LengthInBytes;
+  ESL_PACKET * pGather;
   EFI_STATUS Status;
 
   DBG_ENTER ( );
 
+  //
+  //  Free the packets gathered into this packet's fragment table
+  //
+  while ( NULL != pPacket->pGatherList ) {
+    pGather = pPacket->pGatherList;
+    pPacket->pGatherList = pGather->pNext;
+    EslSocketPacketFree ( pGather, DebugFlags );
+  }
+
   //
   //  Free a packet structure
   //
@@ -3409,19 +3483,35 @@ EslSocketPoll (
       }
 
       //
-      //  Check for urgent transmit data buffer space
+      //  The remote system closed the connection
       //
-      if (( MAX_TX_DATA > pSocket->TxOobBytes )
-        || ( EFI_SUCCESS != pSocket->TxError )) {
-        DetectedEvents |= POLLWRBAND;
+      if ( EFI_CONNECTION_FIN == pSocket->RxError ) {
+        DetectedEvents |= POLLHUP;
       }
 
       //
-      //  Check for normal transmit data buffer space
+      //  Connection oriented sockets are not writable until the
+      //  connection is established, use the transmit buffer limit
+      //  set by SO_SNDBUF to determine if there is space available
       //
-      if (( MAX_TX_DATA > pSocket->TxBytes )
-        || ( EFI_SUCCESS != pSocket->TxError )) {
-        DetectedEvents |= POLLWRNORM;
+      if (( SOCKET_STATE_CONNECTED == pSocket->State )
+        || (( SOCK_STREAM != pSocket->Type )
+          && ( SOCK_SEQPACKET != pSocket->Type ))) {
+        //
+        //  Check for urgent transmit data buffer space
+        //
+        if (( pSocket->MaxTxBuf > pSocket->TxOobBytes )
+          || ( EFI_SUCCESS != pSocket->TxError )) {
+          DetectedEvents |= POLLWRBAND;
+        }
+
+        //
+        //  Check for normal transmit data buffer space
+        //
+        if (( pSocket->MaxTxBuf > pSocket->TxBytes )
+          || ( EFI_SUCCESS != pSocket->TxError )) {
+          DetectedEvents |= POLLWRNORM;
+        }
       }
 
       //
@@ -3502,6 +3592,7 @@ EslSocketPortAllocate (
   ESL_IO_MGMT * pIo;
   ESL_LAYER * pLayer;
   ESL_PORT * pPort;
+  UINTN RxIo;
   EFI_SERVICE_BINDING_PROTOCOL * pServiceBinding;
   CONST ESL_SOCKET_BINDING * pSocketBinding;
   EFI_STATUS Status;
@@ -3518,13 +3609,21 @@ EslSocketPortAllocate (
   //  Use for/break instead of goto
   pSocketBinding = pService->pSocketBinding;
   for ( ; ; ) {
+    //
+    //  Determine the number of receive operations to keep posted
+    //
+    if ( 0 == pSocket->RxIoDepth ) {
+      pSocket->RxIoDepth = (UINT32)pSocketBinding->RxIo;
+    }
+    RxIo = ( 0 == pSocketBinding->RxIo ) ? 0 : pSocket->RxIoDepth;
+
     //
     //  Allocate a port structure
     //
     pLayer = &mEslLayer;
     LengthInBytes = sizeof ( *pPort )
                   + ESL_STRUCTURE_ALIGNMENT_BYTES
-                  + (( pSocketBinding->RxIo
+                  + (( RxIo
                        + pSocketBinding->TxIoNormal
                        + pSocketBinding->TxIoUrgent )
                      * sizeof ( ESL_IO_MGMT ));
@@ -3605,11 +3704,11 @@ EslSocketPortAllocate (
     pBuffer = &pBuffer[ ESL_STRUCTURE_ALIGNMENT_BYTES ];
     pBuffer = (UINT8 *)( ESL_STRUCTURE_ALIGNMENT_MASK & (UINTN)pBuffer );
     pIo = (ESL_IO_MGMT *)pBuffer;
-    if (( 0 != pSocketBinding->RxIo )
+    if (( 0 != RxIo )
       && ( NULL != pSocket->pApi->pfnRxComplete )) {
       Status = EslSocketIoInit ( pPort,
                                  &pIo,
-                                 pSocketBinding->RxIo,
+                                 RxIo,
                                  &pPort->pRxFree,
                                  DebugFlags | DEBUG_POOL,
                                  "receive",
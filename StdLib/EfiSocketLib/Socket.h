@@ -1,7 +1,7 @@
 /** @file
   Definitions for the Socket layer driver.
 
-  Copyright (c) 2011, Intel Corporation
+  Copyright (c) 2011 - 2016, Intel Corporation
   All rights reserved. This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -37,6 +37,8 @@
 #define MAX_TX_DATA         ( MAX_RX_DATA * 2 ) ///<  Maximum buffered transmit data in bytes
 #define RX_PACKET_DATA      0x00100000  ///<  Maximum number of bytes in a RX packet
 #define MAX_UDP_RETRANSMIT  16          ///<  UDP retransmit attempts to handle address not mapped
+#define MAX_RX_IO           64          ///<  Maximum receive operations posted per port
+#define TX_FRAGMENTS        8           ///<  Maximum queued TCP packets gathered into one transmit
 
 #define ESL_STRUCTURE_ALIGNMENT_BYTES   15  ///<  Number of bytes for structure alignment
 #define ESL_STRUCTURE_ALIGNMENT_MASK    ( ~ESL_STRUCTURE_ALIGNMENT_BYTES )  ///<  Mask to align structures
@@ -133,6 +135,7 @@ typedef struct
 typedef struct
 {
   EFI_TCP4_TRANSMIT_DATA TxData;        ///<  Transmit operation description
+  EFI_TCP4_FRAGMENT_DATA FragmentTable[ TX_FRAGMENTS - 1 ]; ///<  Extends TxData.FragmentTable for gathered packets
   UINT8 Buffer[ 1 ];                    ///<  Data buffer
 } ESL_TCP4_TX_DATA;
 
@@ -153,6 +156,7 @@ typedef struct
 typedef struct
 {
   EFI_TCP6_TRANSMIT_DATA TxData;        ///<  Transmit operation description
+  EFI_TCP6_FRAGMENT_DATA FragmentTable[ TX_FRAGMENTS - 1 ]; ///<  Extends TxData.FragmentTable for gathered packets
   UINT8 Buffer[ 1 ];                    ///<  Data buffer
 } ESL_TCP6_TX_DATA;
 
@@ -206,6 +210,7 @@ typedef struct
 **/
 typedef struct _ESL_PACKET {
   ESL_PACKET * pNext;                   ///<  Next packet in the receive list
+  ESL_PACKET * pGatherList;             ///<  Transmit packets referenced by this packet's fragment table
   size_t PacketSize;                    ///<  Size of this data structure
   size_t ValidBytes;                    ///<  Length of valid data in bytes
   UINT8 * pBuffer;                      ///<  Current data pointer
@@ -1054,6 +1059,7 @@ typedef struct _ESL_SOCKET {
   //  Receive data management
   //
   UINT32 MaxRxBuf;                  ///<  Maximum size of the receive buffer
+  UINT32 RxIoDepth;                 ///<  Receive operations posted per port, zero selects the binding default
   struct timeval RxTimeout;         ///<  Receive timeout
   ESL_PACKET * pRxFree;             ///<  Free packet list
   ESL_PACKET * pRxOobPacketListHead;///<  Urgent data list head
@@ -1,7 +1,7 @@
 /** @file
   Implement the TCP6 driver support for the socket layer.
 
-  Copyright (c) 2011 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2011 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials are licensed and made available
   under the terms and conditions of the BSD License which accompanies this
   distribution.  The full text of the license may be found at
@@ -910,6 +910,7 @@ EslTcp6ListenComplete (
       pNewSocket->Domain = pSocket->Domain;
       pNewSocket->Protocol = pSocket->Protocol;
       pNewSocket->Type = pSocket->Type;
+      pNewSocket->RxIoDepth = pSocket->RxIoDepth;
 
       //
       //  Build the local address
@@ -1991,6 +1992,7 @@ EslTcp6TxBuffer (
   ESL_PACKET ** ppQueueHead;
   ESL_PACKET ** ppQueueTail;
   ESL_PACKET * pPreviousPacket;
+  EFI_TCP6_TRANSMIT_DATA * pPreviousTxData;
   size_t * pTxBytes;
   EFI_TCP6_TRANSMIT_DATA * pTxData;
   EFI_STATUS Status;
@@ -2097,21 +2099,52 @@ EslTcp6TxBuffer (
                       pBuffer ));
 
             //
-            //  Queue the data for transmission
+            //  The packet at the tail of the queue is waiting for a
+            //  free transmit token.  Gather this data into that
+            //  packet's fragment table instead of queuing another
+            //  transmit operation.
             //
-            pPacket->pNext = NULL;
             pPreviousPacket = *ppQueueTail;
-            if ( NULL == pPreviousPacket ) {
-              *ppQueueHead = pPacket;
+            pPreviousTxData = NULL;
+            if ( NULL != pPreviousPacket ) {
+              pPreviousTxData = &pPreviousPacket->Op.Tcp6Tx.TxData;
+            }
+            if (( NULL != pPreviousTxData )
+              && ( TX_FRAGMENTS > pPreviousTxData->FragmentCount )
+              && ( bUrgent == pPreviousTxData->Urgent )
+              && (( MAX_UINT32 - pPreviousTxData->DataLength ) >= BufferLength )) {
+              pPreviousTxData->FragmentTable[ pPreviousTxData->FragmentCount ] = pTxData->FragmentTable[0];
+              pPreviousTxData->FragmentCount += 1;
+              pPreviousTxData->DataLength += (UINT32) BufferLength;
+
+              //
+              //  Release this packet with the one that sends its data
+              //
+              pPacket->pNext = pPreviousPacket->pGatherList;
+              pPreviousPacket->pGatherList = pPacket;
+              DEBUG (( DEBUG_TX,
+                        "0x%08x: Packet gathered into 0x%08x as fragment %d\r\n",
+                        pPacket,
+                        pPreviousPacket,
+                        pPreviousTxData->FragmentCount ));
             }
             else {
-              pPreviousPacket->pNext = pPacket;
+              //
+              //  Queue the data for transmission
+              //
+              pPacket->pNext = NULL;
+              if ( NULL == pPreviousPacket ) {
+                *ppQueueHead = pPacket;
+              }
+              else {
+                pPreviousPacket->pNext = pPacket;
+              }
+              *ppQueueTail = pPacket;
+              DEBUG (( DEBUG_TX,
+                        "0x%08x: Packet on %s transmit list\r\n",
+                        pPacket,
+                        bUrgentQueue ? L"urgent" : L"normal" ));
             }
-            *ppQueueTail = pPacket;
-            DEBUG (( DEBUG_TX,
-                      "0x%08x: Packet on %s transmit list\r\n",
-                      pPacket,
-                      bUrgentQueue ? L"urgent" : L"normal" ));
 
             //
             //  Account for the buffered data
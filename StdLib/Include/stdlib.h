@@ -78,6 +78,9 @@
     const char *getprogname (void);
     void        setprogname (const char *progname);
 
+    ################  Functions specific to this implementation
+    void        GetMallocStats  (MALLOC_STATS *Stats);
+
     ############  Integer Numeric conversion functions
     int                   atoi      (const char *nptr);
     long                  atol      (const char *nptr);
@@ -101,7 +104,7 @@
                                      char ** __restrict endptr);
   @endverbatim
 
-  Copyright (c) 2010 - 2012, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials are licensed and made available under
   the terms and conditions of the BSD License that accompanies this distribution.
   The full text of the license may be found at
@@ -895,6 +898,29 @@ void setprogname(const char *progname);
 
 /* ###############  Functions specific to this implementation  ############# */
 
+/** Statistics about the memory managed by malloc, reported by GetMallocStats. **/
+typedef struct {
+  size_t  ArenaBytes;       ///< Bytes of arenas obtained from the UEFI page allocator.
+  size_t  HugeBytes;        ///< Bytes of huge blocks, each with its own pages.
+  size_t  SmallBytes;       ///< Bytes of small blocks in use, rounded up to their size class.
+  size_t  LargeBytes;       ///< Bytes of large blocks in use, headers included.
+  size_t  RunBytes;         ///< Bytes of arena space handed to the small size classes.
+  size_t  LargeFreeBytes;   ///< Bytes of free large blocks in the arenas.
+  size_t  MallocCalls;      ///< Successful allocations by malloc, calloc, and realloc.
+  size_t  FreeCalls;        ///< Regions released by free and realloc.
+  size_t  PageAllocations;  ///< Calls made to the UEFI AllocatePages service.
+  size_t  PageFrees;        ///< Calls made to the UEFI FreePages service.
+} MALLOC_STATS;
+
+/** Report statistics about the memory managed by malloc, calloc, realloc,
+    and free.  Intended for debugging and tuning of applications.
+
+    @param[out]   Stats     Where to store the statistics.
+**/
+void
+EFIAPI
+GetMallocStats(MALLOC_STATS *Stats);
+
 /*  Determine the number of bytes needed to represent a Wide character
     as a MBCS character.
 
@@ -136,6 +136,7 @@ typedef _BSD_SSIZE_T_ ssize_t;
 #define SO_ERROR  0x1007    /* get error status and clear */
 #define SO_TYPE   0x1008    /* get socket type */
 #define SO_OVERFLOWED 0x1009    /* datagrams: return packets dropped */
+#define SO_RCVDEPTH 0x100a    /* EFI: receive operations posted per port */
 
 /*
  * Structure used for manipulating linger option.
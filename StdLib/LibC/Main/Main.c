@@ -4,7 +4,7 @@
   All of the global data in the gMD structure is initialized to 0, NULL, or
   SIG_DFL; as appropriate.
 
-  Copyright (c) 2010 - 2014, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials are licensed and made available under
   the terms and conditions of the BSD License that accompanies this distribution.
   The full text of the license may be found at
@@ -205,6 +205,9 @@ ShellAppMain (
       }
       FreePool( gMD );
   }
+
+    /* Return the memory managed by malloc */
+    __ReleaseMallocMemory();
   }
   return ExitVal;
 }
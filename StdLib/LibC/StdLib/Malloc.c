@@ -14,7 +14,21 @@
   either a null pointer or a unique pointer.  The value of a pointer that
   refers to freed space is indeterminate.
 
-  Copyright (c) 2010 - 2014, Intel Corporation. All rights reserved.<BR>
+  Memory is obtained from the UEFI page allocator in large pieces and carved
+  up here, so that the common small allocation does not need a boot services
+  call.  Requests are served in one of three ways:
+    - Small:  Up to SMALL_MAX bytes.  The size is rounded up to one of
+              NUM_SIZE_CLASSES size classes.  Each class has a free list and
+              is refilled from runs of RUN_SIZE bytes taken from an arena.
+    - Large:  Up to LARGE_MAX bytes.  Blocks are split from arenas of
+              ARENA_SIZE bytes.  Freed blocks are merged with free neighbors
+              and kept on free lists binned by size.
+    - Huge:   Anything bigger gets its own pages.
+
+  Like the rest of the library, these functions must not be called from
+  event notification functions.
+
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -35,46 +49,408 @@
 #include  <assert.h>
 #include  <stdlib.h>
 #include  <errno.h>
+#include  <MainData.h>
 
 #define CPOOL_HEAD_SIGNATURE   SIGNATURE_32('C','p','h','d')
+#define CPOOL_FREE_SIGNATURE   SIGNATURE_32('C','p','f','r')
 
-/** The UEFI functions do not provide a way to determine the size of an
-    allocated region of memory given just a pointer to the start of that
-    region.  Since this is required for the implementation of realloc,
-    the memory head structure, CPOOL_HEAD, containing the necessary
-    information is prepended to the requested space.
+#define SMALL_MAX           1024              ///< Largest size served from a size class
+#define NUM_SIZE_CLASSES    20                ///< Number of small size classes
+#define RUN_SIZE            SIZE_64KB         ///< Bytes taken from an arena to refill a size class
+#define ARENA_SIZE          SIZE_1MB          ///< Bytes of each arena
+#define LARGE_MAX           SIZE_256KB        ///< Largest size served from an arena
+#define NUM_LARGE_BINS      16                ///< Number of free lists for large blocks
 
-    The order of members is important.  This structure is 8-byte aligned,
-    as per the UEFI specification for memory allocation functions.  By
-    specifying Size as a 64-bit value and placing it immediately before
-    Data, it ensures that Data will always be 8-byte aligned.
+#define CLASS_LARGE         NUM_SIZE_CLASSES         ///< CPOOL_HEAD.Class of a large block
+#define CLASS_HUGE          (NUM_SIZE_CLASSES + 1)   ///< CPOOL_HEAD.Class of a huge block
+#define CLASS_RUN           (NUM_SIZE_CLASSES + 2)   ///< CPOOL_HEAD.Class of an arena block holding a run
 
-    On IA32 systems, this structure is 24 bytes long, excluding Data.
-    On X64  systems, this structure is 32 bytes long, excluding Data.
+/** Every region returned by malloc is immediately preceded by a CPOOL_HEAD,
+    which is all free and realloc need to find their way back.
+
+    The structure is 16 bytes long on all architectures, and every head starts
+    on a 16-byte boundary, so Data is always 16-byte aligned.
 **/
 typedef struct {
-  LIST_ENTRY      List;
-  UINT32          Signature;
-  UINT64          Size;
+  UINT32          Signature;    ///< CPOOL_HEAD_SIGNATURE, or CPOOL_FREE_SIGNATURE once freed
+  UINT32          Class;        ///< Size class index, or one of the CLASS_xxx values
+  UINT64          Size;         ///< Small: usable bytes.  Otherwise: bytes of the whole block.
   CHAR8           Data[1];
 } CPOOL_HEAD;
 
-// List of memory allocated by malloc/calloc/etc.
-static  LIST_ENTRY      MemPoolHead = INITIALIZE_LIST_HEAD_VARIABLE(MemPoolHead);
+#define CPOOL_HEAD_SIZE     OFFSET_OF(CPOOL_HEAD, Data)
+
+/** Head of a large, huge, or run block.
+
+    Large blocks record the size of the block physically before them in the
+    arena, so that a freed block can be merged with both of its neighbors.
+    Huge blocks use the same space to link themselves into mHugeList.
+
+    The block data starts LARGE_HEAD_SIZE (32) bytes into the block on all
+    architectures.
+**/
+typedef struct {
+  union {
+    UINT64        PrevSize;     ///< Large: bytes of the preceding block, 0 for the first block of an arena
+    LIST_ENTRY    Link;         ///< Huge: link in mHugeList
+    UINT8         Reserved[16];
+  } u;
+  CPOOL_HEAD      Head;
+} LARGE_HEAD;
+
+#define LARGE_HEAD_SIZE     OFFSET_OF(LARGE_HEAD, Head.Data)
+#define LARGE_FROM_DATA(p)  ((LARGE_HEAD *)((UINT8 *)(p) - LARGE_HEAD_SIZE))
+#define NEXT_LARGE(b)       ((LARGE_HEAD *)((UINT8 *)(b) + (UINTN)(b)->Head.Size))
+#define PREV_LARGE(b)       ((LARGE_HEAD *)((UINT8 *)(b) - (UINTN)(b)->u.PrevSize))
+
+/** A free large block links itself into one of the mLargeBins lists through
+    the start of its data area.
+**/
+#define FREE_LINK(b)        ((LIST_ENTRY *)(b)->Head.Data)
+#define FREE_FROM_LINK(l)   LARGE_FROM_DATA(l)
+#define MIN_LARGE_BLOCK     ALIGN_VALUE(LARGE_HEAD_SIZE + sizeof(LIST_ENTRY), 16)
+
+/** Head of an arena.  The blocks follow it, and a zero-sized in-use block
+    marks the end of the arena.
+**/
+typedef struct {
+  LIST_ENTRY      Link;         ///< Link in mArenaList
+  UINT8           Reserved[32 - sizeof(LIST_ENTRY)];
+} ARENA_HEAD;
+
+/** Free list and current run of one small size class. **/
+typedef struct {
+  CPOOL_HEAD     *FreeList;     ///< Freed blocks, linked through their Data
+  UINT8          *RunNext;      ///< Next never-used block in the current run
+  UINT8          *RunEnd;       ///< End of the current run
+} SIZE_CLASS;
+
+/// Usable bytes of each small size class
+static CONST UINT16   mClassSize[NUM_SIZE_CLASSES] = {
+    16,   32,   48,   64,   80,   96,  112,  128,
+   160,  192,  224,  256,
+   320,  384,  448,  512,
+   640,  768,  896, 1024
+};
+
+static  SIZE_CLASS    mSizeClass[NUM_SIZE_CLASSES];
+static  LIST_ENTRY    mLargeBins[NUM_LARGE_BINS];
+static  LIST_ENTRY    mArenaList = INITIALIZE_LIST_HEAD_VARIABLE(mArenaList);
+static  LIST_ENTRY    mHugeList  = INITIALIZE_LIST_HEAD_VARIABLE(mHugeList);
+static  BOOLEAN       mBinsReady = FALSE;
+static  MALLOC_STATS  mStats;
 
 /****************************/
 
+/** Find the small size class serving a request.
+
+    @param  Size    Requested size, 1 to SMALL_MAX bytes.
+
+    @return   Index into mClassSize of the smallest class holding Size bytes.
+**/
+static
+UINTN
+SizeToClass(size_t Size)
+{
+  UINTN   Group;
+
+  if(Size <= 128) {
+    return (UINTN)((Size + 15) / 16) - 1;
+  }
+  // Above 128 bytes, each power of two is split into four classes.
+  Group = (UINTN)HighBitSet64((UINT64)(Size - 1));
+  return 8 + ((Group - 7) * 4) + (UINTN)RShiftU64((UINT64)(Size - 1), Group - 2) - 4;
+}
+
+/** Find the free list a large block of BlockSize bytes belongs to. **/
+static
+UINTN
+SizeToBin(UINTN BlockSize)
+{
+  INTN    Bit;
+
+  Bit = HighBitSet64((UINT64)BlockSize) - 5;
+  if(Bit < 0) {
+    return 0;
+  }
+  return MIN((UINTN)Bit, NUM_LARGE_BINS - 1);
+}
+
+/** Put a large block on its free list. **/
+static
+void
+InsertFreeLarge(LARGE_HEAD *Block)
+{
+  Block->Head.Signature = CPOOL_FREE_SIGNATURE;
+  Block->Head.Class     = CLASS_LARGE;
+  InsertHeadList(&mLargeBins[SizeToBin((UINTN)Block->Head.Size)], FREE_LINK(Block));
+  mStats.LargeFreeBytes += (size_t)Block->Head.Size;
+}
+
+/** Take a large block off its free list. **/
+static
+void
+RemoveFreeLarge(LARGE_HEAD *Block)
+{
+  RemoveEntryList(FREE_LINK(Block));
+  mStats.LargeFreeBytes -= (size_t)Block->Head.Size;
+}
+
+/** Get pages from UEFI for an arena or a huge block. **/
+static
+void *
+GetPages(UINTN Pages)
+{
+  EFI_PHYSICAL_ADDRESS  Memory;
+  EFI_STATUS            Status;
+
+  Status = gBS->AllocatePages(AllocateAnyPages, EfiLoaderData, Pages, &Memory);
+  if(EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "\nERROR malloc: AllocatePages returned %r\n", Status));
+    return NULL;
+  }
+  ++mStats.PageAllocations;
+  return (void *)(UINTN)Memory;
+}
+
+/** Give pages obtained by GetPages back to UEFI. **/
+static
+void
+ReleasePages(void *Memory, UINTN Pages)
+{
+  (void) gBS->FreePages((EFI_PHYSICAL_ADDRESS)(UINTN)Memory, Pages);
+  ++mStats.PageFrees;
+}
+
+/** Add a new arena, holding a single free block. **/
+static
+BOOLEAN
+AddArena(void)
+{
+  ARENA_HEAD   *Arena;
+  LARGE_HEAD   *Block;
+  LARGE_HEAD   *End;
+
+  Arena = GetPages(EFI_SIZE_TO_PAGES(ARENA_SIZE));
+  if(Arena == NULL) {
+    return FALSE;
+  }
+  InsertTailList(&mArenaList, &Arena->Link);
+  mStats.ArenaBytes += ARENA_SIZE;
+
+  Block = (LARGE_HEAD *)(Arena + 1);
+  Block->u.PrevSize = 0;
+  Block->Head.Size  = ARENA_SIZE - sizeof(ARENA_HEAD) - LARGE_HEAD_SIZE;
+
+  // The end marker looks like an in-use block, so nothing merges past it.
+  End = NEXT_LARGE(Block);
+  End->u.PrevSize     = Block->Head.Size;
+  End->Head.Signature = CPOOL_HEAD_SIGNATURE;
+  End->Head.Class     = CLASS_LARGE;
+  End->Head.Size      = 0;
+
+  InsertFreeLarge(Block);
+  return TRUE;
+}
+
+/** Allocate a block of BlockSize bytes, head included, from the arenas.
+
+    @param  BlockSize   Bytes needed, a multiple of 16 of at least MIN_LARGE_BLOCK.
+    @param  Class       CLASS_LARGE or CLASS_RUN.
+
+    @return   The block, or NULL if no memory could be obtained.
+**/
+static
+LARGE_HEAD *
+AllocLarge(UINTN BlockSize, UINT32 Class)
+{
+  LIST_ENTRY   *Link;
+  LARGE_HEAD   *Block;
+  LARGE_HEAD   *Rest;
+  UINTN         Bin;
+
+  do {
+    Block = NULL;
+    for(Bin = SizeToBin(BlockSize); (Block == NULL) && (Bin < NUM_LARGE_BINS); ++Bin) {
+      for(Link = GetFirstNode(&mLargeBins[Bin]); !IsNull(&mLargeBins[Bin], Link); Link = GetNextNode(&mLargeBins[Bin], Link)) {
+        if(FREE_FROM_LINK(Link)->Head.Size >= BlockSize) {
+          Block = FREE_FROM_LINK(Link);
+          break;
+        }
+      }
+    }
+  } while((Block == NULL) && AddArena());
+
+  if(Block == NULL) {
+    return NULL;
+  }
+  RemoveFreeLarge(Block);
+
+  // Split off the tail if it is big enough to be useful on its own.
+  if(Block->Head.Size - BlockSize >= MIN_LARGE_BLOCK) {
+    Rest = (LARGE_HEAD *)((UINT8 *)Block + BlockSize);
+    Rest->u.PrevSize = BlockSize;
+    Rest->Head.Size  = Block->Head.Size - BlockSize;
+    NEXT_LARGE(Rest)->u.PrevSize = Rest->Head.Size;
+    Block->Head.Size = BlockSize;
+    InsertFreeLarge(Rest);
+  }
+
+  Block->Head.Signature = CPOOL_HEAD_SIGNATURE;
+  Block->Head.Class     = Class;
+  return Block;
+}
+
+/** Return a block to the arenas, merging it with free neighbors.  An arena
+    left completely free is given back to UEFI, unless it is the last one.
+**/
+static
+void
+FreeLarge(LARGE_HEAD *Block)
+{
+  LARGE_HEAD   *Next;
+  LARGE_HEAD   *Prev;
+  ARENA_HEAD   *Arena;
+
+  Next = NEXT_LARGE(Block);
+  if(Next->Head.Signature == CPOOL_FREE_SIGNATURE) {
+    RemoveFreeLarge(Next);
+    Block->Head.Size += Next->Head.Size;
+  }
+  if(Block->u.PrevSize != 0) {
+    Prev = PREV_LARGE(Block);
+    if(Prev->Head.Signature == CPOOL_FREE_SIGNATURE) {
+      RemoveFreeLarge(Prev);
+      Prev->Head.Size += Block->Head.Size;
+      Block = Prev;
+    }
+  }
+  Next = NEXT_LARGE(Block);
+  Next->u.PrevSize = Block->Head.Size;
+
+  if((Block->u.PrevSize == 0) && (Next->Head.Size == 0)) {
+    Arena = (ARENA_HEAD *)Block - 1;
+    if(GetNextNode(&mArenaList, &Arena->Link) != GetPreviousNode(&mArenaList, &Arena->Link)) {
+      RemoveEntryList(&Arena->Link);
+      mStats.ArenaBytes -= ARENA_SIZE;
+      ReleasePages(Arena, EFI_SIZE_TO_PAGES(ARENA_SIZE));
+      return;
+    }
+  }
+  InsertFreeLarge(Block);
+}
+
+/** Allocate Size bytes without touching errno. **/
+static
+void *
+AllocateMemory(size_t Size)
+{
+  SIZE_CLASS   *SizeClass;
+  CPOOL_HEAD   *Head;
+  LARGE_HEAD   *Block;
+  UINTN         Class;
+  UINTN         BlockSize;
+  UINTN         Pages;
+
+  if(Size <= SMALL_MAX) {
+    Class     = SizeToClass(Size);
+    SizeClass = &mSizeClass[Class];
+    BlockSize = CPOOL_HEAD_SIZE + mClassSize[Class];
+    Head      = SizeClass->FreeList;
+    if(Head != NULL) {
+      SizeClass->FreeList = *(CPOOL_HEAD **)Head->Data;
+    }
+    else {
+      if((UINTN)(SizeClass->RunEnd - SizeClass->RunNext) < BlockSize) {
+        Block = AllocLarge(LARGE_HEAD_SIZE + RUN_SIZE, CLASS_RUN);
+        if(Block == NULL) {
+          return NULL;
+        }
+        mStats.RunBytes    += (size_t)Block->Head.Size;
+        SizeClass->RunNext  = (UINT8 *)Block->Head.Data;
+        SizeClass->RunEnd   = (UINT8 *)Block + (UINTN)Block->Head.Size;
+      }
+      Head = (CPOOL_HEAD *)SizeClass->RunNext;
+      SizeClass->RunNext += BlockSize;
+      Head->Class = (UINT32)Class;
+      Head->Size  = mClassSize[Class];
+    }
+    Head->Signature = CPOOL_HEAD_SIGNATURE;
+    mStats.SmallBytes += mClassSize[Class];
+    return Head->Data;
+  }
+
+  if(Size <= LARGE_MAX) {
+    BlockSize = ALIGN_VALUE(LARGE_HEAD_SIZE + (UINTN)Size, 16);
+    Block     = AllocLarge(MAX(BlockSize, MIN_LARGE_BLOCK), CLASS_LARGE);
+    if(Block == NULL) {
+      return NULL;
+    }
+    mStats.LargeBytes += (size_t)Block->Head.Size;
+    return Block->Head.Data;
+  }
+
+  if(Size > MAX_UINTN - LARGE_HEAD_SIZE - EFI_PAGE_SIZE) {
+    return NULL;
+  }
+  Pages = EFI_SIZE_TO_PAGES(LARGE_HEAD_SIZE + (UINTN)Size);
+  Block = GetPages(Pages);
+  if(Block == NULL) {
+    return NULL;
+  }
+  InsertTailList(&mHugeList, &Block->u.Link);
+  Block->Head.Signature = CPOOL_HEAD_SIGNATURE;
+  Block->Head.Class     = CLASS_HUGE;
+  Block->Head.Size      = EFI_PAGES_TO_SIZE(Pages);
+  mStats.HugeBytes     += (size_t)Block->Head.Size;
+  return Block->Head.Data;
+}
+
+/** Find and check the head of a region returned by malloc.
+
+    @param  Ptr     Region to check.
+    @param  Caller  Name of the calling function, for the error message.
+
+    @return   The head of the region, or NULL with errno set to EFAULT if Ptr
+              is not an allocated region.
+**/
+static
+CPOOL_HEAD *
+GetHead(void *Ptr, CONST CHAR8 *Caller)
+{
+  CPOOL_HEAD   *Head;
+
+  Head = BASE_CR(Ptr, CPOOL_HEAD, Data);
+  if((Head->Signature != CPOOL_HEAD_SIGNATURE) || (Head->Class > CLASS_HUGE)) {
+    errno = EFAULT;
+    DEBUG((DEBUG_ERROR, "ERROR %a(0x%p): Signature is 0x%8X, expected 0x%8X\n",
+           Caller, Ptr, Head->Signature, CPOOL_HEAD_SIGNATURE));
+    return NULL;
+  }
+  return Head;
+}
+
+/** Number of bytes the caller may use in an allocated region. **/
+static
+size_t
+UsableSize(CPOOL_HEAD *Head)
+{
+  if(Head->Class < NUM_SIZE_CLASSES) {
+    return (size_t)Head->Size;
+  }
+  return (size_t)(Head->Size - LARGE_HEAD_SIZE);
+}
+
 /** The malloc function allocates space for an object whose size is specified
     by size and whose value is indeterminate.
 
-    This implementation uses the UEFI memory allocation boot services to get a
-    region of memory that is 8-byte aligned and of the specified size.  The
-    region is allocated with type EfiLoaderData.
+    This implementation carves the region out of memory obtained with the UEFI
+    page allocator, with type EfiLoaderData.  The region is 16-byte aligned.
 
     @param  size    Size, in bytes, of the region to allocate.
 
     @return   NULL is returned if the space could not be allocated and errno
-              contains the cause.  Otherwise, a pointer to an 8-byte aligned
+              contains the cause.  Otherwise, a pointer to a 16-byte aligned
               region of the requested size is returned.<BR>
               If NULL is returned, errno may contain:
               - EINVAL: Requested Size is zero.
@@ -83,10 +459,8 @@ static  LIST_ENTRY      MemPoolHead = INITIALIZE_LIST_HEAD_VARIABLE(MemPoolHead)
 void *
 malloc(size_t Size)
 {
-  CPOOL_HEAD   *Head;
   void         *RetVal;
-  EFI_STATUS    Status;
-  UINTN         NodeSize;
+  UINTN         Bin;
 
   if( Size == 0) {
     errno = EINVAL;   // Make errno diffenent, just in case of a lingering ENOMEM.
@@ -94,29 +468,22 @@ malloc(size_t Size)
     return NULL;
   }
 
-  NodeSize = (UINTN)(Size + sizeof(CPOOL_HEAD));
-
-  DEBUG((DEBUG_POOL, "malloc(%d): NodeSz: %d", Size, NodeSize));
+  if(!mBinsReady) {
+    for(Bin = 0; Bin < NUM_LARGE_BINS; ++Bin) {
+      InitializeListHead(&mLargeBins[Bin]);
+    }
+    mBinsReady = TRUE;
+  }
 
-  Status = gBS->AllocatePool( EfiLoaderData, NodeSize, (void**)&Head);
-  if( Status != EFI_SUCCESS) {
-    RetVal  = NULL;
-    errno   = ENOMEM;
-    DEBUG((DEBUG_ERROR, "\nERROR malloc: AllocatePool returned %r\n", Status));
+  RetVal = AllocateMemory(Size);
+  if(RetVal == NULL) {
+    errno = ENOMEM;
+    DEBUG((DEBUG_ERROR, "\nERROR malloc(%d): out of memory\n", Size));
   }
   else {
-    assert(Head != NULL);
-    // Fill out the pool header
-    Head->Signature = CPOOL_HEAD_SIGNATURE;
-    Head->Size      = NodeSize;
-
-    // Add this node to the list
-    (void)InsertTailList(&MemPoolHead, (LIST_ENTRY *)Head);
-
-    // Return a pointer to the data
-    RetVal          = (void*)Head->Data;
-    DEBUG((DEBUG_POOL, " Head: %p, Returns %p\n", Head, RetVal));
+    ++mStats.MallocCalls;
   }
+  DEBUG((DEBUG_POOL, "malloc(%d): Returns %p\n", Size, RetVal));
 
   return RetVal;
 }
@@ -124,15 +491,14 @@ malloc(size_t Size)
 /** The calloc function allocates space for an array of Num objects, each of
     whose size is Size.  The space is initialized to all bits zero.
 
-    This implementation uses the UEFI memory allocation boot services to get a
-    region of memory that is 8-byte aligned and of the specified size.  The
-    region is allocated with type EfiLoaderData.
+    This implementation gets the region from malloc, so it is 16-byte aligned
+    and comes from memory of type EfiLoaderData.
 
     @param  Num     Number of objects to allocate.
     @param  Size    Size, in bytes, of the objects to allocate space for.
 
     @return   NULL is returned if the space could not be allocated and errno
-              contains the cause.  Otherwise, a pointer to an 8-byte aligned
+              contains the cause.  Otherwise, a pointer to a 16-byte aligned
               region of the requested size is returned.
 **/
 void *
@@ -143,7 +509,7 @@ calloc(size_t Num, size_t Size)
 
   NumSize = Num * Size;
   RetVal  = NULL;
-  if (NumSize != 0) {
+  if ((NumSize != 0) && ((NumSize / Num) == Size)) {
   RetVal = malloc(NumSize);
   if( RetVal != NULL) {
     (VOID)ZeroMem( RetVal, NumSize);
@@ -169,25 +535,88 @@ void
 free(void *Ptr)
 {
   CPOOL_HEAD   *Head;
+  LARGE_HEAD   *Block;
+  SIZE_CLASS   *SizeClass;
 
-  Head = BASE_CR(Ptr, CPOOL_HEAD, Data);
-  assert(Head != NULL);
-  DEBUG((DEBUG_POOL, "free(%p): Head: %p\n", Ptr, Head));
+  DEBUG((DEBUG_POOL, "free(%p)\n", Ptr));
 
   if(Ptr != NULL) {
-    if (Head->Signature == CPOOL_HEAD_SIGNATURE) {
-      (void) RemoveEntryList((LIST_ENTRY *)Head);   // Remove this node from the malloc pool
-      (void) gBS->FreePool (Head);                  // Now free the associated memory
-    }
-    else {
-      errno = EFAULT;
-      DEBUG((DEBUG_ERROR, "ERROR free(0x%p): Signature is 0x%8X, expected 0x%8X\n",
-             Ptr, Head->Signature, CPOOL_HEAD_SIGNATURE));
+    Head = GetHead(Ptr, "free");
+    if(Head != NULL) {
+      ++mStats.FreeCalls;
+      if(Head->Class < NUM_SIZE_CLASSES) {
+        // Small blocks go back on the free list of their size class
+        SizeClass = &mSizeClass[Head->Class];
+        mStats.SmallBytes -= (size_t)Head->Size;
+        Head->Signature = CPOOL_FREE_SIGNATURE;
+        *(CPOOL_HEAD **)Head->Data = SizeClass->FreeList;
+        SizeClass->FreeList = Head;
+      }
+      else {
+        Block = BASE_CR(Head, LARGE_HEAD, Head);
+        if(Head->Class == CLASS_HUGE) {
+          RemoveEntryList(&Block->u.Link);
+          mStats.HugeBytes -= (size_t)Head->Size;
+          Head->Signature = CPOOL_FREE_SIGNATURE;
+          ReleasePages(Block, EFI_SIZE_TO_PAGES((UINTN)Head->Size));
+        }
+        else {
+          mStats.LargeBytes -= (size_t)Head->Size;
+          FreeLarge(Block);
+        }
+      }
     }
   }
   DEBUG((DEBUG_POOL, "free Done\n"));
 }
 
+/** Try to grow a large block in place by taking the free block after it.
+
+    @param  Head      Head of an allocated large block.
+    @param  NewSize   Number of usable bytes needed.
+
+    @retval TRUE      The block now holds at least NewSize bytes.
+    @retval FALSE     The block is unchanged.
+**/
+static
+BOOLEAN
+GrowLarge(CPOOL_HEAD *Head, size_t NewSize)
+{
+  LARGE_HEAD   *Block;
+  LARGE_HEAD   *Next;
+  LARGE_HEAD   *Rest;
+  UINTN         BlockSize;
+  UINTN         Total;
+
+  if((Head->Class != CLASS_LARGE) || (NewSize > LARGE_MAX)) {
+    return FALSE;
+  }
+  Block     = BASE_CR(Head, LARGE_HEAD, Head);
+  Next      = NEXT_LARGE(Block);
+  BlockSize = MAX(ALIGN_VALUE(LARGE_HEAD_SIZE + (UINTN)NewSize, 16), MIN_LARGE_BLOCK);
+  Total     = (UINTN)(Block->Head.Size + Next->Head.Size);
+  if((Next->Head.Signature != CPOOL_FREE_SIGNATURE) || (Total < BlockSize)) {
+    return FALSE;
+  }
+
+  RemoveFreeLarge(Next);
+  mStats.LargeBytes -= (size_t)Block->Head.Size;
+  if(Total - BlockSize >= MIN_LARGE_BLOCK) {
+    Rest = (LARGE_HEAD *)((UINT8 *)Block + BlockSize);
+    Rest->u.PrevSize = BlockSize;
+    Rest->Head.Size  = Total - BlockSize;
+    NEXT_LARGE(Rest)->u.PrevSize = Rest->Head.Size;
+    InsertFreeLarge(Rest);
+    Block->Head.Size = BlockSize;
+  }
+  else {
+    Block->Head.Size = Total;
+    NEXT_LARGE(Block)->u.PrevSize = Total;
+  }
+  mStats.LargeBytes += (size_t)Block->Head.Size;
+  return TRUE;
+}
+
 /** The realloc function changes the size of the object pointed to by Ptr to
     the size specified by NewSize.
 
@@ -207,9 +636,9 @@ free(void *Ptr)
     If NewSize is zero and Ptr is not a null pointer, the object it points to
     is freed.
 
-    This implementation uses the UEFI memory allocation boot services to get a
-    region of memory that is 8-byte aligned and of the specified size.  The
-    region is allocated with type EfiLoaderData.
+    The region is resized in place when it is already big enough, or when it
+    can be extended into free space that follows it.  Otherwise a new region
+    is obtained from malloc.
 
     The following combinations of Ptr and NewSize can occur:<BR>
       Ptr     NewSize<BR>
@@ -217,8 +646,8 @@ free(void *Ptr)
     - NULL        0                 Returns NULL;
     - NULL      > 0                 Same as malloc(NewSize)
     - invalid     X                 Returns NULL;
-    - valid   NewSize >= OldSize    Returns malloc(NewSize) with Oldsize bytes copied from Ptr
-    - valid   NewSize <  OldSize    Returns new buffer with Oldsize bytes copied from Ptr
+    - valid   NewSize >= OldSize    Returns a region of NewSize with OldSize bytes copied from Ptr
+    - valid   NewSize <  OldSize    Returns a region of NewSize with NewSize bytes copied from Ptr
     - valid       0                 Return NULL.  Frees Ptr.
 
 
@@ -226,7 +655,7 @@ free(void *Ptr)
     @param  NewSize Size, in bytes, of the new object to allocate space for.
 
     @return   NULL is returned if the space could not be allocated and errno
-              contains the cause.  Otherwise, a pointer to an 8-byte aligned
+              contains the cause.  Otherwise, a pointer to a 16-byte aligned
               region of the requested size is returned.  If NewSize is zero,
               NULL is returned and errno will be unchanged.
 **/
@@ -236,32 +665,32 @@ realloc(void *Ptr, size_t ReqSize)
   void       *RetVal = NULL;
   CPOOL_HEAD *Head    = NULL;
   size_t      OldSize = 0;
-  size_t      NewSize;
   size_t      NumCpy;
 
   // Find out the size of the OLD memory region
   if( Ptr != NULL) {
-    Head = BASE_CR (Ptr, CPOOL_HEAD, Data);
-    assert(Head != NULL);
-    if (Head->Signature != CPOOL_HEAD_SIGNATURE) {
-      errno = EFAULT;
-      DEBUG((DEBUG_ERROR, "ERROR realloc(0x%p): Signature is 0x%8X, expected 0x%8X\n",
-             Ptr, Head->Signature, CPOOL_HEAD_SIGNATURE));
+    Head = GetHead(Ptr, "realloc");
+    if (Head == NULL) {
       return NULL;
     }
-    OldSize = (size_t)Head->Size;
+    OldSize = UsableSize(Head);
   }
 
-  // At this point, Ptr is either NULL or a valid pointer to an allocated space
-  NewSize = (size_t)(ReqSize + (sizeof(CPOOL_HEAD)));
-
   if( ReqSize > 0) {
-    RetVal = malloc(NewSize); // Get the NEW memory region
+    if( Ptr != NULL) {
+      // Keep the region if it is big enough and not much too big.
+      if(((ReqSize <= OldSize) && ((ReqSize > OldSize / 2) || (OldSize <= SMALL_MAX))) ||
+         GrowLarge(Head, ReqSize)) {
+        DEBUG((DEBUG_POOL, "0x%p = realloc(%p, %d): in place\n", Ptr, Ptr, ReqSize));
+        return Ptr;
+      }
+    }
+    RetVal = malloc(ReqSize); // Get the NEW memory region
     if( Ptr != NULL) {          // If there is an OLD region...
       if( RetVal != NULL) {     // and the NEW region was successfully allocated
         NumCpy = OldSize;
-        if( OldSize > NewSize) {
-          NumCpy = NewSize;
+        if( OldSize > ReqSize) {
+          NumCpy = ReqSize;
         }
         (VOID)CopyMem( RetVal, Ptr, NumCpy);  // Copy old data to the new region.
         free( Ptr);                           // and reclaim the old region.
@@ -274,8 +703,46 @@ realloc(void *Ptr, size_t ReqSize)
   else {
     free( Ptr);                           // Reclaim the old region.
   }
-  DEBUG((DEBUG_POOL, "0x%p = realloc(%p, %d): Head: %p NewSz: %d\n",
-         RetVal, Ptr, ReqSize, Head, NewSize));
+  DEBUG((DEBUG_POOL, "0x%p = realloc(%p, %d): Head: %p\n",
+         RetVal, Ptr, ReqSize, Head));
 
   return RetVal;
 }
+
+/** Report statistics about the memory managed by malloc.
+
+    @param[out]   Stats     Where to store the statistics.
+**/
+void
+EFIAPI
+GetMallocStats(MALLOC_STATS *Stats)
+{
+  if(Stats != NULL) {
+    CopyMem(Stats, &mStats, sizeof(MALLOC_STATS));
+  }
+}
+
+/** Give all memory obtained by malloc back to UEFI.
+
+    Called once the program has exited; any region still allocated becomes
+    invalid.
+**/
+void
+__ReleaseMallocMemory(void)
+{
+  LIST_ENTRY   *Link;
+
+  while(!IsListEmpty(&mHugeList)) {
+    Link = GetFirstNode(&mHugeList);
+    RemoveEntryList(Link);
+    ReleasePages(Link, EFI_SIZE_TO_PAGES((UINTN)BASE_CR(Link, LARGE_HEAD, u.Link)->Head.Size));
+  }
+  while(!IsListEmpty(&mArenaList)) {
+    Link = GetFirstNode(&mArenaList);
+    RemoveEntryList(Link);
+    ReleasePages(Link, EFI_SIZE_TO_PAGES(ARENA_SIZE));
+  }
+  ZeroMem(mSizeClass, sizeof(mSizeClass));
+  ZeroMem(&mStats, sizeof(mStats));
+  mBinsReady = FALSE;
+}
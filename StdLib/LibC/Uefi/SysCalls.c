@@ -1,7 +1,7 @@
 /** @file
   EFI versions of NetBSD system calls.
 
-  Copyright (c) 2010 - 2012, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials are licensed and made available under
   the terms and conditions of the BSD License that accompanies this distribution.
   The full text of the license may be found at
@@ -766,11 +766,12 @@ poll (
   UINT64 TimerTicks;
 
   //
-  //  Create the timer for the timeout
+  //  Create the timer for the timeout, a zero timeout makes a
+  //  single pass over the descriptors without waiting
   //
   Timer = NULL;
   Status = EFI_SUCCESS;
-  if ( INFTIM != timeout ) {
+  if (( INFTIM != timeout ) && ( 0 < timeout )) {
     Status = gBS->CreateEvent ( EVT_TIMER,
                                 TPL_NOTIFY,
                                 NULL,
@@ -786,10 +787,6 @@ poll (
                                TimerRelative,
                                TimerTicks );
     }
-    else {
-      SelectedFDs = -1;
-      errno = ENOMEM;
-    }
   }
   if ( !EFI_ERROR ( Status )) {
     //
@@ -805,28 +802,34 @@ poll (
       pEnd = &pPollFD [ nfds ];
       while ( pEnd > pPollFD ) {
         //
-        //  Validate the file descriptor
-        //
-        if ( !ValidateFD ( pPollFD->fd, VALID_OPEN )) {
-          errno = EINVAL;
-          return -1;
-        }
-
+        //  Negative file descriptors are ignored
         //
-        //  Poll the device or file
-        //
-        pDescriptor = &gMD->fdarray [ pPollFD->fd ];
-        pPollFD->revents = pDescriptor->f_ops->fo_poll ( pDescriptor,
-                                                         pPollFD->events );
+        pPollFD->revents = 0;
+        if ( 0 <= pPollFD->fd ) {
+          //
+          //  Validate the file descriptor
+          //
+          if ( !ValidateFD ( pPollFD->fd, VALID_OPEN )) {
+            pPollFD->revents = POLLNVAL;
+          }
+          else {
+            //
+            //  Poll the device or file
+            //
+            pDescriptor = &gMD->fdarray [ pPollFD->fd ];
+            pPollFD->revents = pDescriptor->f_ops->fo_poll ( pDescriptor,
+                                                             pPollFD->events );
+          }
 
-        //
-        //  Determine if this file descriptor detected an event
-        //
-        if ( 0 != pPollFD->revents ) {
           //
-          //  Select this descriptor
+          //  Determine if this file descriptor detected an event
           //
-          SelectedFDs += 1;
+          if ( 0 != pPollFD->revents ) {
+            //
+            //  Select this descriptor
+            //
+            SelectedFDs += 1;
+          }
         }
 
         //
@@ -838,6 +841,9 @@ poll (
       //
       //  Check for timeout
       //
+      if ( 0 == timeout ) {
+        break;
+      }
       if ( NULL != Timer ) {
         Status = gBS->CheckEvent ( Timer );
         if ( EFI_SUCCESS == Status ) {
@@ -848,8 +854,8 @@ poll (
         }
         else if ( EFI_NOT_READY == Status ) {
           Status = EFI_SUCCESS;
-    }
-    }
+        }
+      }
     } while (( 0 == SelectedFDs )
         && ( EFI_SUCCESS == Status ));
 
@@ -860,7 +866,7 @@ poll (
       gBS->SetTimer ( Timer,
                       TimerCancel,
                       0 );
-  }
+    }
   }
   else {
     SelectedFDs = -1;
@@ -103,41 +103,54 @@ selscan(
   fd_mask **ibits,
   fd_mask **obits,
   int nfd,
+  struct pollfd *pfd,
   int *nselected
   )
 {
   int   msk;
   int i;
-  int j;
   int fd;
   int n;
-  struct pollfd pfd;
-  int FdCount;
-  fd_mask   bits;
+  int npfd;
+  fd_mask   bit;
   /* Note: backend also returns POLLHUP/POLLERR if appropriate. */
   static int16_t  flag[3] = { POLLRDNORM, POLLWRNORM, POLLRDBAND };
 
-  for (msk = 0, n = 0; msk < 3; msk++) {
-    if (ibits[msk] == NULL)
-      continue;
-    for (i = 0; i < nfd; i += NFDBITS) {
-      bits = ibits[ msk ][ i / NFDBITS ];
-      while (( 0 != (j = ffs(bits))) && ((fd = i + --j) < nfd)) {
-        bits &= ~(1 << j);
+  /*
+   *  Build a single poll request for all of the descriptors of interest
+   */
+  for (fd = 0, npfd = 0; fd < nfd; fd++) {
+    bit = (1 << (fd % NFDBITS));
+    pfd[npfd].events = 0;
+    for (msk = 0; msk < 3; msk++) {
+      if ((ibits[msk] != NULL) && (0 != (ibits[msk][fd / NFDBITS] & bit)))
+        pfd[npfd].events |= flag[msk];
+    }
+    if (pfd[npfd].events != 0) {
+      pfd[npfd].fd = fd;
+      pfd[npfd].revents = 0;
+      npfd++;
+    }
+  }
+  if ((npfd != 0) && (-1 == poll(pfd, npfd, 0)))
+    return errno;
 
-        pfd.fd = fd;
-        pfd.events = flag[msk];
-        pfd.revents = 0;
-        FdCount = poll ( &pfd, 1, 0 );
-        if ( -1 == FdCount ) {
-          return errno;
-        }
-        if ( 0 != FdCount ) {
-          obits[msk][(fd)/NFDBITS] |=
-            (1 << ((fd) % NFDBITS));
-          n++;
-          break;
-        }
+  /*
+   *  Report the ready descriptors, hangup and errors satisfy both
+   *  the read and write sets
+   */
+  for (i = 0, n = 0; i < npfd; i++) {
+    if (0 != (pfd[i].revents & POLLNVAL))
+      return EBADF;
+    fd = pfd[i].fd;
+    bit = (1 << (fd % NFDBITS));
+    for (msk = 0; msk < 3; msk++) {
+      if (0 == (pfd[i].events & flag[msk]))
+        continue;
+      if ((0 != (pfd[i].revents & flag[msk]))
+        || ((msk < 2) && (0 != (pfd[i].revents & (POLLHUP | POLLERR))))) {
+        obits[msk][fd / NFDBITS] |= bit;
+        n++;
       }
     }
   }
@@ -155,12 +168,17 @@ select(
   )
 {
   fd_mask *ibits[3], *obits[3], *selbits, *sbp;
+  struct pollfd *pfd;
   int error, forever, nselected;
   u_int nbufbytes, ncpbytes, nfdbits;
   int64_t timo;
 
-  if (nd < 0)
-    return (EINVAL);
+  if (nd < 0) {
+    errno = EINVAL;
+    return (-1);
+  }
+  if (nd > FD_SETSIZE)
+    nd = FD_SETSIZE;
 
   /*
    * Allocate just enough bits for the non-null fd_sets.  Use the
@@ -175,7 +193,12 @@ select(
     nbufbytes += 2 * ncpbytes;
   if (ex != NULL)
     nbufbytes += 2 * ncpbytes;
-  selbits = malloc(nbufbytes);
+  selbits = malloc(nbufbytes + (nd * sizeof *pfd));
+  if (selbits == NULL) {
+    errno = ENOMEM;
+    return (-1);
+  }
+  pfd = (struct pollfd *)((char *)selbits + nbufbytes);
 
   /*
    * Assign pointers into the bit buffers and fetch the input bits.
@@ -217,7 +240,7 @@ select(
     /*
      *  Scan for pending I/O
      */
-    error = selscan(ibits, obits, nd, &nselected);
+    error = selscan(ibits, obits, nd, pfd, &nselected);
     if (error || nselected)
       break;
 
@@ -1,7 +1,7 @@
 /** @file
   Global data for the program environment.
 
-  Copyright (c) 2010 - 2011, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2016, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials are licensed and made available
   under the terms and conditions of the BSD License which accompanies this
   distribution.  The full text of the license may be found at
@@ -95,3 +95,6 @@ struct  __MainData {
 };
 
 extern struct  __MainData  *gMD;
+
+/** Give all memory obtained by malloc back to UEFI once the program has exited. **/
+void  __ReleaseMallocMemory(void);